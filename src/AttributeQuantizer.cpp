@@ -0,0 +1,240 @@
+#include "AttributeQuantizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#ifdef __AVX__
+#include <immintrin.h>
+
+// Same as std::round: x - trunc(x) is exact, so the half check has no rounding error
+static inline __m256 RoundHalfAwayFromZero(__m256 x)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 truncated = _mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 fraction = _mm256_andnot_ps(signMask, _mm256_sub_ps(x, truncated));
+    __m256 increment = _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+    __m256 signedOne = _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_and_ps(x, signMask));
+    return _mm256_add_ps(truncated, _mm256_and_ps(increment, signedOne));
+}
+#endif
+
+short AttributeQuantizer::FloatToSnorm16Scalar(float value)
+{
+    int quantized = std::round(value * 32768.0f);
+    return static_cast<short>(std::clamp(quantized, -32768, 32767));
+}
+
+unsigned short AttributeQuantizer::FloatToUnorm16Scalar(float value)
+{
+    // Values out of range wrap around, as the previous direct cast did
+    return static_cast<unsigned short>(static_cast<int>(std::round(value * 65535.0f)));
+}
+
+unsigned char AttributeQuantizer::FloatToUnorm8Scalar(float value)
+{
+    return static_cast<unsigned char>(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+void AttributeQuantizer::FloatToSnorm16(const float *input, size_t scalarsCount, short *output)
+{
+    size_t i = 0;
+#ifdef __AVX__
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 minValue = _mm256_set1_ps(-32768.0f);
+    const __m256 maxValue = _mm256_set1_ps(32767.0f);
+    for(; i + 8 <= scalarsCount; i += 8){
+        __m256 value = RoundHalfAwayFromZero(_mm256_mul_ps(_mm256_loadu_ps(input + i), scale));
+        value = _mm256_min_ps(_mm256_max_ps(value, minValue), maxValue);
+        __m256i integers = _mm256_cvttps_epi32(value);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extractf128_si256(integers, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#endif
+    for(; i < scalarsCount; i++){
+        output[i] = FloatToSnorm16Scalar(input[i]);
+    }
+}
+
+void AttributeQuantizer::Float2ToUnorm16(const float *input, size_t count, int stride, unsigned short *output)
+{
+    size_t i = 0;
+#ifdef __AVX__
+    const __m256 scale = _mm256_set1_ps(65535.0f);
+    const __m128i lowBits = _mm_set1_epi32(0xFFFF);
+    float gathered[16];
+    for(; i + 8 <= count; i += 8){
+        // Eight vectors per iteration. Components x and y are packed before conversion
+        for(int j = 0; j < 8; j++){
+            gathered[2 * j] = input[(i + j) * stride];
+            gathered[2 * j + 1] = input[(i + j) * stride + 1];
+        }
+        for(int half = 0; half < 2; half++){
+            __m256 value = RoundHalfAwayFromZero(_mm256_mul_ps(_mm256_loadu_ps(gathered + 8 * half), scale));
+            __m256i integers = _mm256_cvttps_epi32(value);
+            __m128i low = _mm_and_si128(_mm256_castsi256_si128(integers), lowBits);
+            __m128i high = _mm_and_si128(_mm256_extractf128_si256(integers, 1), lowBits);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * i + 8 * half), _mm_packus_epi32(low, high));
+        }
+    }
+#endif
+    for(; i < count; i++){
+        output[2 * i] = FloatToUnorm16Scalar(input[i * stride]);
+        output[2 * i + 1] = FloatToUnorm16Scalar(input[i * stride + 1]);
+    }
+}
+
+void AttributeQuantizer::FloatToUnorm8(const float *input, size_t scalarsCount, unsigned char *output)
+{
+    size_t i = 0;
+#ifdef __AVX__
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for(; i + 8 <= scalarsCount; i += 8){
+        __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(input + i), zero), one);
+        value = RoundHalfAwayFromZero(_mm256_mul_ps(value, scale));
+        __m256i integers = _mm256_cvttps_epi32(value);
+        __m128i shorts = _mm_packus_epi32(_mm256_castsi256_si128(integers), _mm256_extractf128_si256(integers, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(shorts, shorts));
+    }
+#endif
+    for(; i < scalarsCount; i++){
+        output[i] = FloatToUnorm8Scalar(input[i]);
+    }
+}
+
+void AttributeQuantizer::MinMax(const float *input, size_t count, int stride, float *minValues, float *maxValues)
+{
+    for(int c = 0; c < stride; c++){
+        minValues[c] = std::numeric_limits<float>::max();
+        maxValues[c] = std::numeric_limits<float>::lowest();
+    }
+    size_t i = 0;
+#ifdef __AVX__
+    // Blocks of 8 vectors fill exactly stride registers, so each lane always holds the same component
+    if(count >= 8 && stride <= 4){
+        __m256 minLanes[4];
+        __m256 maxLanes[4];
+        for(int k = 0; k < stride; k++){
+            minLanes[k] = _mm256_set1_ps(std::numeric_limits<float>::max());
+            maxLanes[k] = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+        }
+        for(; i + 8 <= count; i += 8){
+            const float *block = input + i * stride;
+            for(int k = 0; k < stride; k++){
+                __m256 value = _mm256_loadu_ps(block + 8 * k);
+                minLanes[k] = _mm256_min_ps(minLanes[k], value);
+                maxLanes[k] = _mm256_max_ps(maxLanes[k], value);
+            }
+        }
+        alignas(32) float minStored[8];
+        alignas(32) float maxStored[8];
+        for(int k = 0; k < stride; k++){
+            _mm256_store_ps(minStored, minLanes[k]);
+            _mm256_store_ps(maxStored, maxLanes[k]);
+            for(int lane = 0; lane < 8; lane++){
+                int component = (8 * k + lane) % stride;
+                minValues[component] = std::min(minValues[component], minStored[lane]);
+                maxValues[component] = std::max(maxValues[component], maxStored[lane]);
+            }
+        }
+    }
+#endif
+    for(; i < count; i++){
+        for(int c = 0; c < stride; c++){
+            minValues[c] = std::min(minValues[c], input[i * stride + c]);
+            maxValues[c] = std::max(maxValues[c], input[i * stride + c]);
+        }
+    }
+}
+
+void AttributeQuantizer::PositionsToUnorm16(const float *positions, size_t count, const float *offset, const float *scale, unsigned short *output)
+{
+    float inverseScale[3];
+    for(int c = 0; c < 3; c++)
+        inverseScale[c] = scale[c] > 0.0f ? 1.0f / scale[c] : 0.0f;
+    for(size_t i = 0; i < count; i++){
+        for(int c = 0; c < 3; c++){
+            float value = std::clamp((positions[3 * i + c] - offset[c]) * inverseScale[c], 0.0f, 1.0f);
+            output[4 * i + c] = static_cast<unsigned short>(std::round(value * 65535.0f));
+        }
+        output[4 * i + 3] = 65535;
+    }
+}
+
+void AttributeQuantizer::NormalsToOctahedral(const float *normals, size_t count, short *output)
+{
+    auto toSnorm = [](float value){
+        return static_cast<short>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    };
+    for(size_t i = 0; i < count; i++){
+        glm::vec3 normal(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]);
+        float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        glm::vec2 encoded = length > 0.0f ? glm::vec2(normal) / length : glm::vec2(0.0f);
+        if(normal.z < 0.0f){ // Lower hemisphere is folded over the diagonals
+            glm::vec2 signs(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+            encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signs;
+        }
+        output[2 * i] = toSnorm(encoded.x);
+        output[2 * i + 1] = toSnorm(encoded.y);
+    }
+}
+
+void AttributeQuantizer::TangentFramesToQTangents(const float *normals, const float *tangents, const float *bitangents, size_t count, short *output)
+{
+    // Smallest w that keeps its sign after snorm16 quantization
+    const float bias = 1.0f / 32767.0f;
+    for(size_t i = 0; i < count; i++){
+        glm::vec3 normal(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]);
+        glm::vec3 tangent(tangents[3 * i], tangents[3 * i + 1], tangents[3 * i + 2]);
+        glm::vec3 bitangent(bitangents[3 * i], bitangents[3 * i + 1], bitangents[3 * i + 2]);
+        normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+        tangent = tangent - normal * glm::dot(normal, tangent);
+        if(glm::length(tangent) < 1e-6f) // Degenerated tangent. Any perpendicular direction is used
+            tangent = glm::abs(normal.x) < 0.9f ? glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f)) : glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f));
+        tangent = glm::normalize(tangent);
+        glm::vec3 rightHandedBitangent = glm::cross(normal, tangent);
+        bool reflected = glm::dot(rightHandedBitangent, bitangent) < 0.0f;
+        glm::quat frame = glm::normalize(glm::quat_cast(glm::mat3(tangent, rightHandedBitangent, normal)));
+        if(frame.w < 0.0f)
+            frame = -frame;
+        if(frame.w < bias){
+            float xyzScale = std::sqrt(1.0f - bias * bias);
+            frame = glm::quat(bias, frame.x * xyzScale, frame.y * xyzScale, frame.z * xyzScale);
+        }
+        if(reflected)
+            frame = -frame;
+        output[4 * i] = static_cast<short>(std::round(std::clamp(frame.x, -1.0f, 1.0f) * 32767.0f));
+        output[4 * i + 1] = static_cast<short>(std::round(std::clamp(frame.y, -1.0f, 1.0f) * 32767.0f));
+        output[4 * i + 2] = static_cast<short>(std::round(std::clamp(frame.z, -1.0f, 1.0f) * 32767.0f));
+        output[4 * i + 3] = static_cast<short>(std::round(std::clamp(frame.w, -1.0f, 1.0f) * 32767.0f));
+    }
+}
+
+void AttributeQuantizer::WeightsToUnorm8(const float *weights, size_t count, unsigned char *output)
+{
+    for(size_t i = 0; i < count; i++){
+        const float *vertexWeights = weights + 4 * i;
+        unsigned char *vertexOutput = output + 4 * i;
+        float sum = 0.0f;
+        int largest = 0;
+        for(int c = 0; c < 4; c++){
+            sum += std::max(vertexWeights[c], 0.0f);
+            if(vertexWeights[c] > vertexWeights[largest])
+                largest = c;
+        }
+        if(sum <= 0.0f){ // Unweighted vertex follows its first joint
+            vertexOutput[0] = 255;
+            vertexOutput[1] = vertexOutput[2] = vertexOutput[3] = 0;
+            continue;
+        }
+        int total = 0;
+        for(int c = 0; c < 4; c++){
+            vertexOutput[c] = FloatToUnorm8Scalar(std::max(vertexWeights[c], 0.0f) / sum);
+            total += vertexOutput[c];
+        }
+        // Rounding error goes to the largest weight, which absorbs it with the smallest relative change
+        vertexOutput[largest] = static_cast<unsigned char>(std::clamp(vertexOutput[largest] + 255 - total, 0, 255));
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef ATTRIBUTE_QUANTIZER_H
+#define ATTRIBUTE_QUANTIZER_H
+#include <cstddef>
+
+// Conversion kernels for vertex attributes. AVX is used when available, with scalar fallback.
+// Rounding is half away from zero, so results are equal to std::round based conversions
+class AttributeQuantizer{
+private:
+    static short FloatToSnorm16Scalar(float value);
+    static unsigned short FloatToUnorm16Scalar(float value);
+    static unsigned char FloatToUnorm8Scalar(float value);
+public:
+    // round(x * 32768) clamped to [-32768, 32767]
+    static void FloatToSnorm16(const float *input, size_t scalarsCount, short *output);
+    // Reads x and y of count vectors spaced by stride floats (e.g. aiVector3D has stride 3)
+    static void Float2ToUnorm16(const float *input, size_t count, int stride, unsigned short *output);
+    // round(clamp(x, 0, 1) * 255)
+    static void FloatToUnorm8(const float *input, size_t scalarsCount, unsigned char *output);
+    // Component wise min and max of count vectors with stride floats each. Vectorized for stride up to 4
+    static void MinMax(const float *input, size_t count, int stride, float *minValues, float *maxValues);
+    // Positions relative to bounds (offset is minimum and scale is extent) as unorm16x4. Fourth component is 1
+    static void PositionsToUnorm16(const float *positions, size_t count, const float *offset, const float *scale, unsigned short *output);
+    // Octahedral normal encoding in snorm16x2
+    static void NormalsToOctahedral(const float *normals, size_t count, short *output);
+    // Tangent frames as quaternions in snorm16x4. Sign of w stores bitangent handedness
+    static void TangentFramesToQTangents(const float *normals, const float *tangents, const float *bitangents, size_t count, short *output);
+    // Skin weights (4 per vertex) normalized to unorm8 with exact sum 255
+    static void WeightsToUnorm8(const float *weights, size_t count, unsigned char *output);
+};
+#endif
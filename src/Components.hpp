@@ -5,12 +5,22 @@
 #include "Material.hpp"
 #include "Mesh.hpp"
 #include "Resource.hpp"
+#include "Skeleton.hpp"
 
 struct MeshRendererComponent{
     // Reference to active mesh resource
     Resource<Mesh> mesh;
     // Reference to active material
     Resource<Material> material;
+    // Dynamic meshes get their own render group with spare buffer capacity, and their dirty ranges
+    // are uploaded every frame
+    bool isDynamic = false;
+    // Pose source of skinned or morphed meshes. Null renders mesh in bind pose
+    Ref<Animator> animator;
+    // Joints of mesh in animator skeleton. Null for meshes only with morph targets
+    Ref<Skin> skin;
+    // Skeleton node of mesh, whose transform is the object transform and whose morph weights are used
+    int animatorNode = -1;
     MeshRendererComponent(Ref<Mesh> mesh, Ref<Material> material){
         this->mesh = Resource<Mesh>(mesh);
         this->material = Resource<Material>(material);
@@ -36,6 +36,8 @@ namespace Constants
         const int texCoord6AttribLocation = 11;
         // Default tex coordinate 7 attribute location
         const int texCoord7AttribLocation = 12;
+        // Default QTangent (compressed tangent frame) attribute location
+        const int qTangentAttribLocation = 13;
         // Default position attribute name
         const std::string positionAttribName = "position";
         // Default normal attribute name
@@ -62,6 +64,8 @@ namespace Constants
         const std::string texCoord6AttribName = "texCoord6";
         // Default tex coordinate 7 attribute name
         const std::string texCoord7AttribName = "texCoord7";
+        // Default QTangent attribute name
+        const std::string qTangentAttribName = "qTangent";
         // Uniform name for the view/camera/eye world position
         const std::string viewPosName = "viewPos";
         // Default diffuse map key name
@@ -76,6 +80,30 @@ namespace Constants
         const std::string specularUniformName = "specularUniform";
         // Default lighting use flag key name
         const std::string lightingName = "lighting";
+        // Alpha tested material flag key name. Fragments with albedo alpha below cutoff are discarded
+        const std::string alphaMaskName = "alphaMask";
+        // Alpha blended material flag key name. Drawn after opaque objects, sorted back to front
+        const std::string transparentName = "transparent";
+        const float alphaCutoff = 0.5f;
+        // Variant key flag of depth only variants of alpha tested materials. Not a material flag
+        const std::string depthOnlyName = "depthOnly";
+        // Variant key flag of variants writing deferred shading G-buffer. Not a material flag
+        const std::string gBufferName = "gBuffer";
+        // Vertex pulling use flag key name
+        const std::string vertexPullingName = "vertexPulling";
+        // Shader storage binding of vertex data in vertex pulling mode
+        const int vertexDataStorageBinding = 0;
+        // Shader storage binding of per object attributes layouts in vertex pulling mode
+        const int vertexLayoutsStorageBinding = 1;
+        // Attributes slots of each object layout in vertex pulling mode
+        const int positionPullingSlot = 0;
+        const int normalPullingSlot = 1;
+        const int tangentPullingSlot = 2;
+        const int bitangentPullingSlot = 3;
+        const int colorPullingSlot = 4;
+        const int texCoord0PullingSlot = 5;
+        const int qTangentPullingSlot = 6;
+        const int pullingSlotsCount = 7;
         // Default diffuse map indices uniform block binding name
         const std::string diffuseMapIndicesBinding = "diffuseMapIndices";
         // Default normal map indices uniform block binding name
@@ -98,6 +126,10 @@ namespace Constants
         const unsigned long maxSpotLights = 16;
         // Maximum number of lights to use in a scene
         const unsigned long maxLights = maxPointLights + maxDirectionalLights + maxSpotLights;
+        // Maximum number of lights of each type in deferred shading, read from storage buffers
+        const unsigned long maxDeferredLights = 4096;
+        // Point and spot lights affecting a deferred shading tile of 16x16 pixels. Further lights are dropped
+        const unsigned long maxTileLights = 512;
         // Default point light uniform block binding name
         const std::string pointLightsBinding = "pointLights";
         // Default directional light uniform block binding name
@@ -0,0 +1,399 @@
+#include "FrameGraph.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+FrameGraphBuilder::FrameGraphBuilder(FrameGraph &graph, int pass) : graph(graph), pass(pass)
+{
+}
+
+void FrameGraphBuilder::Read(FrameGraphResource resource, FrameGraphUsage usage)
+{
+    graph.passes[pass].accesses.push_back({resource, usage, false});
+}
+
+void FrameGraphBuilder::Write(FrameGraphResource resource, FrameGraphUsage usage)
+{
+    graph.passes[pass].accesses.push_back({resource, usage, true});
+}
+
+void FrameGraphBuilder::WriteAttachment(FrameGraphResource resource, GLenum attachment, bool load)
+{
+    graph.passes[pass].attachments.emplace_back(attachment, resource);
+    Write(resource, FrameGraphUsage::Attachment);
+    if(load)
+        Read(resource, FrameGraphUsage::Attachment);
+}
+
+void FrameGraphBuilder::SetSideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+}
+
+FrameGraphContext::FrameGraphContext(FrameGraph &graph, int pass) : graph(graph), pass(pass)
+{
+}
+
+GL::TextureGL &FrameGraphContext::GetTexture(FrameGraphResource resource) const
+{
+    return *graph.resources[resource].texture;
+}
+
+GLuint FrameGraphContext::GetBuffer(FrameGraphResource resource) const
+{
+    return graph.resources[resource].buffer;
+}
+
+GLuint FrameGraphContext::GetFramebuffer() const
+{
+    return graph.passes[pass].framebuffer;
+}
+
+GLuint FrameGraphContext::GetReadFramebuffer() const
+{
+    return graph.passes[pass].readFramebuffer;
+}
+
+FrameGraph::~FrameGraph()
+{
+    for(auto &&pooledTexture : texturePool)
+        pooledTexture.texture->Release();
+    for(auto &&framebuffer : framebuffers)
+        framebuffer.second->Release();
+    for(auto &&passQueries : passesQueries)
+        glDeleteQueries(timingFrames, passQueries.second.queries.data());
+}
+
+void FrameGraph::Reset()
+{
+    resources.clear();
+    passes.clear();
+    size_t pooledTextures = texturePool.size();
+    stats = FrameGraphStats();
+    stats.pooledTextures = pooledTextures;
+    compiled = false;
+}
+
+FrameGraphResource FrameGraph::AddResource(ResourceNode &&resource)
+{
+    resources.push_back(std::move(resource));
+    return static_cast<FrameGraphResource>(resources.size() - 1);
+}
+
+FrameGraphResource FrameGraph::CreateTexture(const std::string &name, const FrameGraphTextureDesc &desc)
+{
+    ResourceNode resource;
+    resource.name = name;
+    resource.desc = desc;
+    return AddResource(std::move(resource));
+}
+
+FrameGraphResource FrameGraph::ImportTexture(const std::string &name, const Ref<GL::TextureGL> &texture)
+{
+    ResourceNode resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.texture = texture;
+    return AddResource(std::move(resource));
+}
+
+FrameGraphResource FrameGraph::ImportBuffer(const std::string &name, GLuint buffer)
+{
+    ResourceNode resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.buffer = buffer;
+    return AddResource(std::move(resource));
+}
+
+FrameGraphResource FrameGraph::ImportBackbuffer(int width, int height)
+{
+    ResourceNode resource;
+    resource.name = "Backbuffer";
+    resource.imported = true;
+    resource.backbuffer = true;
+    resource.desc.width = width;
+    resource.desc.height = height;
+    return AddResource(std::move(resource));
+}
+
+void FrameGraph::AddPass(const std::string &name, const SetupFunction &setup, const ExecuteFunction &execute)
+{
+    PassNode pass;
+    pass.name = name;
+    pass.execute = execute;
+    passes.push_back(std::move(pass));
+    FrameGraphBuilder builder(*this, static_cast<int>(passes.size() - 1));
+    setup(builder);
+}
+
+void FrameGraph::Compile()
+{
+    stats.passes = passes.size();
+    // Passes only read what earlier passes wrote, so walking them backwards finds every pass whose writes
+    // reach an imported resource or a side effect
+    for(int p = static_cast<int>(passes.size()) - 1; p >= 0; p--){
+        PassNode &pass = passes[p];
+        bool kept = pass.sideEffect;
+        for(auto &&access : pass.accesses){
+            if(access.write && (resources[access.resource].imported || resources[access.resource].needed))
+                kept = true;
+        }
+        pass.culled = !kept;
+        if(!kept){
+            stats.culledPasses++;
+            continue;
+        }
+        for(auto &&access : pass.accesses){
+            if(!access.write)
+                resources[access.resource].needed = true;
+        }
+    }
+    for(int p = 0; p < static_cast<int>(passes.size()); p++){
+        if(passes[p].culled)
+            continue;
+        for(auto &&access : passes[p].accesses){
+            ResourceNode &resource = resources[access.resource];
+            if(resource.firstPass < 0)
+                resource.firstPass = p;
+            resource.lastPass = p;
+        }
+    }
+    // Transient textures take a pooled texture at their first pass and give it back after their last pass, so
+    // a later texture of same format may alias it
+    for(int p = 0; p < static_cast<int>(passes.size()); p++){
+        if(passes[p].culled)
+            continue;
+        for(auto &&resource : resources){
+            if(!resource.imported && resource.firstPass == p){
+                resource.texture = AcquireTexture(resource.desc);
+                stats.transientTextures++;
+            }
+        }
+        for(auto &&resource : resources){
+            if(!resource.imported && resource.lastPass == p)
+                ReleaseTexture(resource.texture);
+        }
+    }
+    for(auto &&pass : passes){
+        if(pass.culled)
+            continue;
+        std::vector<std::pair<GLenum, GLuint>> attachments;
+        bool backbuffer = false;
+        for(auto &&attachment : pass.attachments){
+            const ResourceNode &resource = resources[attachment.second];
+            if(resource.desc.width > 0 && pass.width == 0){
+                pass.width = resource.desc.width;
+                pass.height = resource.desc.height;
+            }
+            if(resource.backbuffer)
+                backbuffer = true;
+            else
+                attachments.emplace_back(attachment.first, resource.texture->GetHandle());
+        }
+        if(backbuffer && !attachments.empty())
+            std::cout << "Pass " << pass.name << " mixes backbuffer and texture attachments - Backbuffer is used\n";
+        pass.framebuffer = backbuffer || attachments.empty() ? 0 : FindFramebuffer(attachments);
+        std::vector<std::pair<GLenum, GLuint>> readAttachments;
+        for(auto &&access : pass.accesses){
+            if(!access.write && access.usage == FrameGraphUsage::BlitSource && resources[access.resource].texture)
+                readAttachments.emplace_back(GL_COLOR_ATTACHMENT0 + readAttachments.size(), resources[access.resource].texture->GetHandle());
+        }
+        pass.readFramebuffer = readAttachments.empty() ? 0 : FindFramebuffer(readAttachments);
+    }
+    compiled = true;
+}
+
+void FrameGraph::Execute()
+{
+    if(!compiled)
+        Compile();
+    timings.clear();
+    for(int p = 0; p < static_cast<int>(passes.size()); p++){
+        PassNode &pass = passes[p];
+        if(pass.culled)
+            continue;
+        GLbitfield barriers = 0;
+        for(auto &&access : pass.accesses){
+            ResourceNode &resource = resources[access.resource];
+            if(resource.incoherentWrite)
+                barriers |= BarrierBit(access.usage) & ~resource.barrierBits;
+        }
+        if(barriers != 0){
+            glMemoryBarrier(barriers);
+            stats.barriers++;
+            for(auto &&resource : resources)
+                resource.barrierBits |= barriers;
+        }
+        if(!pass.attachments.empty()){
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+            if(pass.width > 0)
+                glViewport(0, 0, pass.width, pass.height);
+        }
+        auto passBegin = std::chrono::high_resolution_clock::now();
+        PassQueries *passQueries = nullptr;
+        if(timing){
+            passQueries = &passesQueries[pass.name];
+            BeginPassQuery(*passQueries);
+        }
+        pass.execute(FrameGraphContext(*this, p));
+        if(passQueries){
+            glEndQuery(GL_TIME_ELAPSED);
+            auto passEnd = std::chrono::high_resolution_clock::now();
+            timings.push_back({pass.name, std::chrono::duration<double, std::milli>(passEnd - passBegin).count(),
+            passQueries->gpuMilliseconds});
+        }
+        for(auto &&access : pass.accesses){
+            if(access.write && (access.usage == FrameGraphUsage::Image || access.usage == FrameGraphUsage::Storage)){
+                resources[access.resource].incoherentWrite = true;
+                resources[access.resource].barrierBits = 0;
+            }
+        }
+    }
+    // Later passes draw to default framebuffer as before the graph
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    frameIndex++;
+    ReleaseUnusedTextures();
+    compiled = false;
+}
+
+Ref<GL::TextureGL> FrameGraph::AcquireTexture(const FrameGraphTextureDesc &desc)
+{
+    for(auto &&pooledTexture : texturePool){
+        if(pooledTexture.inUse || !(pooledTexture.desc == desc))
+            continue;
+        if(pooledTexture.usedThisFrame)
+            stats.aliasedTextures++;
+        pooledTexture.inUse = true;
+        pooledTexture.usedThisFrame = true;
+        return pooledTexture.texture;
+    }
+    PooledTexture pooledTexture;
+    pooledTexture.desc = desc;
+    pooledTexture.texture = CreateRef<GL::TextureGL>(GL_TEXTURE_2D, desc.internalFormat);
+    pooledTexture.texture->SetupStorage2D(desc.width, desc.height);
+    pooledTexture.texture->SetParameterI(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    pooledTexture.texture->SetParameterI(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    pooledTexture.texture->SetParameterI(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    pooledTexture.texture->SetParameterI(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    pooledTexture.inUse = true;
+    pooledTexture.usedThisFrame = true;
+    texturePool.push_back(pooledTexture);
+    stats.pooledTextures = texturePool.size();
+    return pooledTexture.texture;
+}
+
+void FrameGraph::ReleaseTexture(const Ref<GL::TextureGL> &texture)
+{
+    for(auto &&pooledTexture : texturePool){
+        if(pooledTexture.texture == texture)
+            pooledTexture.inUse = false;
+    }
+}
+
+void FrameGraph::ReleaseUnusedTextures()
+{
+    size_t pooledTextures = texturePool.size();
+    for(auto &&pooledTexture : texturePool){
+        pooledTexture.unusedFrames = pooledTexture.usedThisFrame ? 0 : pooledTexture.unusedFrames + 1;
+        pooledTexture.usedThisFrame = false;
+        pooledTexture.inUse = false;
+        // Objects are released explicitly, as framebuffers and tracked bindings may still name them
+        if(pooledTexture.unusedFrames > maxUnusedFrames)
+            pooledTexture.texture->Release();
+    }
+    texturePool.erase(std::remove_if(texturePool.begin(), texturePool.end(), [](const PooledTexture &pooledTexture){
+        return pooledTexture.unusedFrames > maxUnusedFrames;
+    }), texturePool.end());
+    stats.releasedTextures = pooledTextures - texturePool.size();
+    stats.pooledTextures = texturePool.size();
+    if(stats.releasedTextures == 0)
+        return;
+    for(auto &&framebuffer : framebuffers)
+        framebuffer.second->Release();
+    framebuffers.clear();
+}
+
+GLuint FrameGraph::FindFramebuffer(const std::vector<std::pair<GLenum, GLuint>> &attachments)
+{
+    auto it = framebuffers.find(attachments);
+    if(it != framebuffers.end())
+        return it->second->GetHandle();
+    Ref<GL::FrameBufferGL> framebuffer = CreateRef<GL::FrameBufferGL>();
+    std::vector<GLenum> drawBuffers;
+    for(auto &&attachment : attachments){
+        framebuffer->AttachTexture(attachment.first, attachment.second, 0);
+        if(attachment.first >= GL_COLOR_ATTACHMENT0 && attachment.first <= GL_COLOR_ATTACHMENT15)
+            drawBuffers.push_back(attachment.first);
+    }
+    if(drawBuffers.empty()){
+        framebuffer->SpecifyDrawBufferMode(GL_NONE);
+        framebuffer->SpecifyReadBufferMode(GL_NONE);
+    } else {
+        glNamedFramebufferDrawBuffers(framebuffer->GetHandle(), drawBuffers.size(), drawBuffers.data());
+        framebuffer->SpecifyReadBufferMode(drawBuffers[0]);
+    }
+    if(!framebuffer->CheckStatus())
+        std::cout << "Frame graph framebuffer is not complete\n";
+    framebuffers.emplace(attachments, framebuffer);
+    return framebuffer->GetHandle();
+}
+
+GLbitfield FrameGraph::BarrierBit(FrameGraphUsage usage)
+{
+    switch(usage){
+        case FrameGraphUsage::Attachment:
+        case FrameGraphUsage::BlitSource: return GL_FRAMEBUFFER_BARRIER_BIT;
+        case FrameGraphUsage::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case FrameGraphUsage::Image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        case FrameGraphUsage::Storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+        case FrameGraphUsage::Uniform: return GL_UNIFORM_BARRIER_BIT;
+        case FrameGraphUsage::Indirect: return GL_COMMAND_BARRIER_BIT;
+    }
+    return 0;
+}
+
+void FrameGraph::BeginPassQuery(PassQueries &passQueries)
+{
+    if(passQueries.queries[0] == 0)
+        glGenQueries(timingFrames, passQueries.queries.data());
+    int slot = frameIndex % timingFrames;
+    GLuint query = passQueries.queries[slot];
+    // Result of this slot is from some frames before, so it is usually available without waiting
+    if(passQueries.issued[slot]){
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available){
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            passQueries.gpuMilliseconds = elapsed / 1000000.0;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    passQueries.issued[slot] = true;
+}
+
+void FrameGraph::SetTimingState(bool timing)
+{
+    this->timing = timing;
+}
+
+const std::vector<FrameGraphPassTiming> &FrameGraph::GetTimings() const
+{
+    return timings;
+}
+
+double FrameGraph::GetGPUMilliseconds() const
+{
+    double gpuMilliseconds = -1.0;
+    for(auto &&passTiming : timings){
+        if(passTiming.gpuMilliseconds >= 0.0)
+            gpuMilliseconds = std::max(gpuMilliseconds, 0.0) + passTiming.gpuMilliseconds;
+    }
+    return gpuMilliseconds;
+}
+
+const FrameGraphStats &FrameGraph::GetStats() const
+{
+    return stats;
+}
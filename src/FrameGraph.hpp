@@ -0,0 +1,191 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+#include <GL/glew.h>
+#include <array>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "GLObjects.hpp"
+#include "Base.hpp"
+
+// Index of a resource declared to a frame graph, valid for the frame it was declared in
+using FrameGraphResource = int;
+
+// How a pass accesses a resource. Accesses after shader image or storage writes need a memory barrier
+enum class FrameGraphUsage{
+    Attachment,
+    BlitSource,
+    Sampled,
+    Image,
+    Storage,
+    Uniform,
+    Indirect
+};
+
+struct FrameGraphTextureDesc{
+    int width = 0;
+    int height = 0;
+    GLenum internalFormat = GL_RGBA8;
+
+    bool operator==(const FrameGraphTextureDesc &other) const{
+        return width == other.width && height == other.height && internalFormat == other.internalFormat;
+    }
+};
+
+struct FrameGraphStats{
+    size_t passes = 0;
+    size_t culledPasses = 0;
+    size_t transientTextures = 0;
+    size_t aliasedTextures = 0; // Transient textures given a pooled texture already used earlier in the frame
+    size_t pooledTextures = 0;
+    size_t releasedTextures = 0; // Pooled textures freed at end of frame, as they were unused for some frames
+    size_t barriers = 0;
+};
+
+// Times of last frame of timings. GPU time is of a frame some frames before, as queries are read without waiting.
+// Negative when not available yet
+struct FrameGraphPassTiming{
+    std::string name;
+    double cpuMilliseconds = 0.0;
+    double gpuMilliseconds = -1.0;
+};
+
+class FrameGraph;
+
+// Declares accesses of a pass when it is added
+class FrameGraphBuilder{
+private:
+    FrameGraph &graph;
+    int pass;
+public:
+    FrameGraphBuilder(FrameGraph &graph, int pass);
+    void Read(FrameGraphResource resource, FrameGraphUsage usage);
+    void Write(FrameGraphResource resource, FrameGraphUsage usage);
+    // Attaches texture to framebuffer of pass. Loaded attachments are also read, as blending or depth test does
+    void WriteAttachment(FrameGraphResource resource, GLenum attachment, bool load);
+    // Pass is kept even when nothing reads its writes
+    void SetSideEffect();
+};
+
+// Resources of a pass when it is executed
+class FrameGraphContext{
+private:
+    FrameGraph &graph;
+    int pass;
+public:
+    FrameGraphContext(FrameGraph &graph, int pass);
+    GL::TextureGL &GetTexture(FrameGraphResource resource) const;
+    GLuint GetBuffer(FrameGraphResource resource) const;
+    // Framebuffer of attachments of pass, bound before pass is executed. Zero for backbuffer
+    GLuint GetFramebuffer() const;
+    // Framebuffer with blit source textures of pass as color attachments, in their read order
+    GLuint GetReadFramebuffer() const;
+};
+
+// Passes of a frame declared with resources they read and write. Compiling culls passes whose writes are
+// never read and assigns pooled textures to transient textures for their lifetime, so textures of passes
+// that don't overlap are shared. Executing binds attachments and inserts memory barriers between passes
+class FrameGraph{
+public:
+    using SetupFunction = std::function<void(FrameGraphBuilder&)>;
+    using ExecuteFunction = std::function<void(const FrameGraphContext&)>;
+
+    FrameGraph() = default;
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph &operator=(const FrameGraph&) = delete;
+    ~FrameGraph();
+    // Drops passes and resources of last frame. Pooled textures are kept
+    void Reset();
+    FrameGraphResource CreateTexture(const std::string &name, const FrameGraphTextureDesc &desc);
+    FrameGraphResource ImportTexture(const std::string &name, const Ref<GL::TextureGL> &texture);
+    FrameGraphResource ImportBuffer(const std::string &name, GLuint buffer);
+    // Default framebuffer of window size. Passes writing imported resources are never culled
+    FrameGraphResource ImportBackbuffer(int width, int height);
+    void AddPass(const std::string &name, const SetupFunction &setup, const ExecuteFunction &execute);
+    void Compile();
+    void Execute();
+    // Timer queries are only issued when timings are enabled
+    void SetTimingState(bool timing);
+    const std::vector<FrameGraphPassTiming> &GetTimings() const;
+    // Sum of GPU times of passes of last timings. Negative when none is available
+    double GetGPUMilliseconds() const;
+    const FrameGraphStats &GetStats() const;
+
+private:
+    friend class FrameGraphBuilder;
+    friend class FrameGraphContext;
+    // Frames a pooled texture is kept without being used
+    static constexpr int maxUnusedFrames = 3;
+    // Frames of timer queries in flight for each pass
+    static constexpr int timingFrames = 3;
+
+    struct ResourceNode{
+        std::string name;
+        bool imported = false;
+        bool backbuffer = false;
+        FrameGraphTextureDesc desc;
+        Ref<GL::TextureGL> texture; // Imported or pooled texture
+        GLuint buffer = 0;
+        int firstPass = -1; // Lifetime in executed passes
+        int lastPass = -1;
+        bool needed = false;
+        // Shader image or storage writes are seen by later accesses only after a barrier of their usage
+        bool incoherentWrite = false;
+        GLbitfield barrierBits = 0; // Barriers issued since last incoherent write
+    };
+    struct Access{
+        FrameGraphResource resource;
+        FrameGraphUsage usage;
+        bool write;
+    };
+    struct PassNode{
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<Access> accesses;
+        std::vector<std::pair<GLenum, FrameGraphResource>> attachments;
+        bool sideEffect = false;
+        bool culled = false;
+        GLuint framebuffer = 0;
+        GLuint readFramebuffer = 0;
+        // Size of attachments, set as viewport when pass is bound
+        int width = 0;
+        int height = 0;
+    };
+    struct PooledTexture{
+        FrameGraphTextureDesc desc;
+        Ref<GL::TextureGL> texture;
+        bool inUse = false;
+        bool usedThisFrame = false;
+        int unusedFrames = 0;
+    };
+    struct PassQueries{
+        std::array<GLuint, timingFrames> queries = {};
+        std::array<bool, timingFrames> issued = {};
+        double gpuMilliseconds = -1.0;
+    };
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<PooledTexture> texturePool;
+    // Framebuffers by attachments as attachment point and texture name. Cleared when pooled textures are freed
+    std::map<std::vector<std::pair<GLenum, GLuint>>, Ref<GL::FrameBufferGL>> framebuffers;
+    std::unordered_map<std::string, PassQueries> passesQueries;
+    std::vector<FrameGraphPassTiming> timings;
+    FrameGraphStats stats;
+    bool compiled = false;
+    bool timing = false;
+    size_t frameIndex = 0;
+
+    FrameGraphResource AddResource(ResourceNode &&resource);
+    Ref<GL::TextureGL> AcquireTexture(const FrameGraphTextureDesc &desc);
+    void ReleaseTexture(const Ref<GL::TextureGL> &texture);
+    void ReleaseUnusedTextures();
+    GLuint FindFramebuffer(const std::vector<std::pair<GLenum, GLuint>> &attachments);
+    static GLbitfield BarrierBit(FrameGraphUsage usage);
+    void BeginPassQuery(PassQueries &passQueries);
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "GLObjects.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 
 void GL::ObjectGL::Release(){
     // GL call to delete resource
@@ -83,13 +85,13 @@ void GL::TextureGL::SetupImage2D(GLsizei width, GLsizei height, GLenum format, G
     glTexImage2D(textureType, 0, internalFormat, width, height, 0, format, type, pixels);
 }
 
-void GL::TextureGL::SetupStorage3D(GLsizei width, GLsizei height, int layers){
+void GL::TextureGL::SetupStorage3D(GLsizei width, GLsizei height, int layers, GLsizei levels){
     this->width = width;
     this->height = height;
-    // Test mipmaps levels later
-    GLsizei levels = static_cast<int>(std::floor(std::log2(glm::max(width, height)))) + 1;
-    this->levels = levels;
-    //this->levels = 1;
+    GLsizei maxLevels = static_cast<int>(std::floor(std::log2(glm::max(width, height)))) + 1;
+    this->levels = levels > 0 ? glm::min(levels, maxLevels) : maxLevels;
+    // Sampling must not reach levels out of storage
+    glTextureParameteri(this->handle, GL_TEXTURE_MAX_LEVEL, this->levels - 1);
     glTextureStorage3D(this->handle, this->levels, this->internalFormat, width, height, layers);
 }
 
@@ -130,14 +132,14 @@ void GL::TextureGL::PushData3DLayer(GLsizei width, GLsizei height, int layer, GL
     glTextureSubImage3D(this->handle, 0, 0, 0, layer, width, height, 1, format, GL_FLOAT, pixels.size() == 0 ? nullptr : pixels.data());
 }
 
-void GL::TextureGL::PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, GLenum type, const void *pixels)
+void GL::TextureGL::PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, GLenum type, const void *pixels, int level)
 {
-    glTextureSubImage3D(this->handle, 0, 0, 0, layer, width, height, 1, format, type, pixels);
+    glTextureSubImage3D(this->handle, level, 0, 0, layer, width, height, 1, format, type, pixels);
 }
 
-void GL::TextureGL::PushCompressedData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, int imageSize, const void *pixels)
+void GL::TextureGL::PushCompressedData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, int imageSize, const void *pixels, int level)
 {
-    glCompressedTextureSubImage3D(this->handle, 0, 0, 0, layer, width, height, 1, format, imageSize, pixels);
+    glCompressedTextureSubImage3D(this->handle, level, 0, 0, layer, width, height, 1, format, imageSize, pixels);
 }
 
 void GL::TextureGL::GenerateMipmaps(){
@@ -145,6 +147,11 @@ void GL::TextureGL::GenerateMipmaps(){
         glGenerateTextureMipmap(this->handle);
 }
 
+GLsizei GL::TextureGL::GetLevels() const
+{
+    return levels;
+}
+
 void GL::TextureGL::Release(){
     glDeleteTextures(1, &this->handle);
 }
@@ -192,6 +199,8 @@ void GL::ShaderObjectGL::Compile(const std::string &source){
             shaderTypeString = "VERTEX_SHADER";
         else if(shaderType == GL_FRAGMENT_SHADER)
             shaderTypeString = "FRAGMENT_SHADER";
+        else if(shaderType == GL_COMPUTE_SHADER)
+            shaderTypeString = "COMPUTE_SHADER";
         else
             shaderTypeString = "UNDEFINED_SHADER_TYPE";
 
@@ -246,6 +255,9 @@ void GL::ShaderObjectGL::Release(){
 // ShaderGL
 
 void GL::ShaderGL::GetUniformsInfo(){
+    uniforms.clear();
+    uniformsHashes.clear();
+    uniformsValues.clear();
     GLint uniform_count = 0;
     glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &uniform_count);
 
@@ -267,11 +279,45 @@ void GL::ShaderGL::GetUniformsInfo(){
             uniform_info.location = glGetUniformLocation(handle, uniform_name.get());
             uniform_info.count = count;
             uniform_info.type = type;
-            uniforms.emplace(std::make_pair(std::string(uniform_name.get(), length), uniform_info));
+            uniform_info.index = uniformsValues.size();
+            UniformValue value;
+            value.location = uniform_info.location;
+            uniformsValues.push_back(value);
+            std::string name(uniform_name.get(), length);
+            if(!uniformsHashes.emplace(UniformName::Hash(name.c_str()), uniform_info.index).second)
+                std::cout << "Uniform " << name << " has the hash of another uniform - Use its name to find it\n";
+            uniforms.emplace(std::make_pair(std::move(name), uniform_info));
         }
     }
 }
 
+GL::UniformCounters GL::ShaderGL::uniformCounters;
+
+int GL::ShaderGL::FindUniformIndex(const std::string &name) const{
+    uniformCounters.stringLookups++;
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second.index : -1;
+}
+
+int GL::ShaderGL::FindUniformIndex(UniformName name) const{
+    auto it = uniformsHashes.find(name.hash);
+    return it != uniformsHashes.end() ? it->second : -1;
+}
+
+bool GL::ShaderGL::UpdateUniformValue(int index, const void *data, size_t size) const{
+    if(index < 0)
+        return false;
+    UniformValue &value = uniformsValues[index];
+    if(value.isSet && std::memcmp(value.data, data, size) == 0){
+        uniformCounters.redundantCalls++;
+        return false;
+    }
+    std::memcpy(value.data, data, size);
+    value.isSet = true;
+    uniformCounters.uniformCalls++;
+    return true;
+}
+
 GL::ShaderGL::ShaderGL(){
     debugInfo = false;
     handle = glCreateProgram();
@@ -320,10 +366,70 @@ void GL::ShaderGL::Create(){
 }
 void GL::ShaderGL::Link(){
     glLinkProgram(handle);
+    FinishLink();
+}
+void GL::ShaderGL::BeginLink(){
+    glLinkProgram(handle);
+    linkPending = true;
+}
+bool GL::ShaderGL::IsReady(){
+    if(!linkPending)
+        return true;
+    if(parallelCompile){
+        GLint completed = GL_FALSE;
+        glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &completed);
+        if(completed == GL_FALSE)
+            return false;
+    }
+    FinishLink();
+    return true;
+}
+bool GL::ShaderGL::IsLinked() const{
+    return linked;
+}
+void GL::ShaderGL::SetParallelCompile(bool parallelCompile){
+    ShaderGL::parallelCompile = parallelCompile;
+}
+bool GL::ShaderGL::parallelCompile = false;
+void GL::ShaderGL::SetBinaryRetrievable(){
+    glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+bool GL::ShaderGL::GetBinary(GLenum &format, std::vector<unsigned char> &binary) const{
+    if(!linked)
+        return false;
+    GLint binaryLength = 0;
+    glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if(binaryLength <= 0)
+        return false;
+    binary.resize(binaryLength);
+    GLsizei writtenLength = 0;
+    glGetProgramBinary(handle, binaryLength, &writtenLength, &format, binary.data());
+    binary.resize(writtenLength);
+    return writtenLength > 0;
+}
+bool GL::ShaderGL::LoadBinary(GLenum format, const std::vector<unsigned char> &binary){
+    glProgramBinary(handle, format, binary.data(), binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(handle, GL_LINK_STATUS, &success);
+    if(success == GL_FALSE)
+        return false;
+    linkPending = false;
+    linked = true;
+    GetUniformsInfo();
+    return true;
+}
+void GL::ShaderGL::SetBinaryKey(uint64_t binaryKey){
+    this->binaryKey = binaryKey;
+}
+uint64_t GL::ShaderGL::GetBinaryKey() const{
+    return binaryKey;
+}
+void GL::ShaderGL::FinishLink(){
+    linkPending = false;
+    GLint success;
+    glGetProgramiv(handle, GL_LINK_STATUS, &success);
+    linked = success == GL_TRUE;
     if(debugInfo){
-        GLint success;
-        glGetProgramiv(handle, GL_LINK_STATUS, &success);
-
         if(success == GL_FALSE){
             GLint maxLength = 0;
             glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &maxLength);
@@ -335,40 +441,104 @@ void GL::ShaderGL::Link(){
         }
     }
     GetUniformsInfo();
+    for(auto &&blockBinding : pendingBlockBindings)
+        SetBlockBinding(blockBinding.first, blockBinding.second);
+    pendingBlockBindings.clear();
 }
 void GL::ShaderGL::Use(){
     glUseProgram(handle);
 }
+void GL::ShaderGL::Set(UniformHandle<bool> uniform, bool value) const{
+    int intValue = value;
+    if(UpdateUniformValue(uniform.index, &intValue, sizeof(intValue)))
+        glProgramUniform1i(handle, uniformsValues[uniform.index].location, intValue);
+}
+void GL::ShaderGL::Set(UniformHandle<int> uniform, int value) const{
+    if(UpdateUniformValue(uniform.index, &value, sizeof(value)))
+        glProgramUniform1i(handle, uniformsValues[uniform.index].location, value);
+}
+void GL::ShaderGL::Set(UniformHandle<float> uniform, float value) const{
+    if(UpdateUniformValue(uniform.index, &value, sizeof(value)))
+        glProgramUniform1f(handle, uniformsValues[uniform.index].location, value);
+}
+void GL::ShaderGL::Set(UniformHandle<double> uniform, double value) const{
+    if(UpdateUniformValue(uniform.index, &value, sizeof(value)))
+        glProgramUniform1d(handle, uniformsValues[uniform.index].location, value);
+}
+void GL::ShaderGL::Set(UniformHandle<glm::vec3> uniform, glm::vec3 value) const{
+    if(UpdateUniformValue(uniform.index, &value, sizeof(value)))
+        glProgramUniform3f(handle, uniformsValues[uniform.index].location, value.x, value.y, value.z);
+}
+void GL::ShaderGL::Set(UniformHandle<glm::vec4> uniform, glm::vec4 value) const{
+    if(UpdateUniformValue(uniform.index, &value, sizeof(value)))
+        glProgramUniform4f(handle, uniformsValues[uniform.index].location, value.x, value.y, value.z, value.w);
+}
+void GL::ShaderGL::Set(UniformHandle<glm::mat4> uniform, const glm::mat4 &matrix) const{
+    if(UpdateUniformValue(uniform.index, &matrix, sizeof(matrix)))
+        glProgramUniformMatrix4fv(handle, uniformsValues[uniform.index].location, 1, GL_FALSE, glm::value_ptr(matrix));
+}
 void GL::ShaderGL::SetBool(const std::string &name, bool value) const {
-    if(uniforms.count(name) > 0)
-        glProgramUniform1i(handle, uniforms.at(name).location, (int)value);
+    Set(GetUniformHandle<bool>(name), value);
 }
 void GL::ShaderGL::SetInt(const std::string &name, int value) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniform1i(handle, uniforms.at(name).location, value);
+    Set(GetUniformHandle<int>(name), value);
 }
 void GL::ShaderGL::SetFloat(const std::string &name, float value) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniform1f(handle, uniforms.at(name).location, value);
+    Set(GetUniformHandle<float>(name), value);
 }
 void GL::ShaderGL::SetDouble(const std::string &name, double value) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniform1d(handle, uniforms.at(name).location, value);
+    Set(GetUniformHandle<double>(name), value);
 }
 void GL::ShaderGL::SetVec3(const std::string &name, glm::vec3 value) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniform3f(handle, uniforms.at(name).location, value.x, value.y, value.z);
+    Set(GetUniformHandle<glm::vec3>(name), value);
 }
 void GL::ShaderGL::SetVec4(const std::string &name, glm::vec4 value) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniform4f(handle, uniforms.at(name).location, value.x, value.y, value.z, value.w);
+    Set(GetUniformHandle<glm::vec4>(name), value);
 }
 
 void GL::ShaderGL::SetMat4Float(const std::string &name, const glm::mat4 &matrix) const{
-    if(uniforms.count(name) > 0)
-        glProgramUniformMatrix4fv(handle, uniforms.at(name).location, 1, GL_FALSE, glm::value_ptr(matrix));
+    Set(GetUniformHandle<glm::mat4>(name), matrix);
+}
+void GL::ShaderGL::CopyUniformValues(const ShaderGL &source) const{
+    for(auto &&uniform : source.uniforms){
+        const UniformValue &value = source.uniformsValues[uniform.second.index];
+        auto target = uniforms.find(uniform.first);
+        if(!value.isSet || target == uniforms.end() || target->second.type != uniform.second.type)
+            continue;
+        int index = target->second.index;
+        switch(uniform.second.type){
+            case GL_BOOL:
+            case GL_INT:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_CUBE:
+                Set(UniformHandle<int>{index}, *reinterpret_cast<const int*>(value.data));
+                break;
+            case GL_FLOAT:
+                Set(UniformHandle<float>{index}, *reinterpret_cast<const float*>(value.data));
+                break;
+            case GL_DOUBLE:
+                Set(UniformHandle<double>{index}, *reinterpret_cast<const double*>(value.data));
+                break;
+            case GL_FLOAT_VEC3:
+                Set(UniformHandle<glm::vec3>{index}, *reinterpret_cast<const glm::vec3*>(value.data));
+                break;
+            case GL_FLOAT_VEC4:
+                Set(UniformHandle<glm::vec4>{index}, *reinterpret_cast<const glm::vec4*>(value.data));
+                break;
+            case GL_FLOAT_MAT4:
+                Set(UniformHandle<glm::mat4>{index}, *reinterpret_cast<const glm::mat4*>(value.data));
+                break;
+            default:
+                break;
+        }
+    }
 }
-void GL::ShaderGL::SetBlockBinding(const std::string &name, unsigned int bindingPoint) const{
+void GL::ShaderGL::SetBlockBinding(const std::string &name, unsigned int bindingPoint){
+    // Querying block index would wait for link
+    if(linkPending){
+        pendingBlockBindings.emplace_back(name, bindingPoint);
+        return;
+    }
     unsigned int index = glGetUniformBlockIndex(handle, name.c_str());
     glUniformBlockBinding(handle, index, bindingPoint);
 }
@@ -386,6 +556,11 @@ std::unordered_map<std::string, GL::ShaderGL::uniform_info> GL::ShaderGL::GetUni
     return this->uniforms;
 }
 
+GL::UniformCounters &GL::ShaderGL::GetUniformCounters()
+{
+    return uniformCounters;
+}
+
 void GL::ShaderGL::Release(){
     glDeleteProgram(this->handle);
 }
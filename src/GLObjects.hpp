@@ -2,6 +2,7 @@
 #define GLOBJECTS_H
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -38,7 +39,8 @@ namespace GL{
         void SetParameterI(GLenum pname, GLint param);
         void SetupStorage2D(GLsizei width, GLsizei height);
         void SetupImage2D(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
-        void SetupStorage3D(GLsizei width, GLsizei height, int layers);
+        // Levels count equal to 0 allocates the complete mip chain
+        void SetupStorage3D(GLsizei width, GLsizei height, int layers, GLsizei levels = 0);
         void PushData2D(GLsizei width, GLsizei height, GLenum format, const std::vector<GLubyte> &pixels);
         void PushData2D(GLsizei width, GLsizei height, GLenum format, const std::vector<GLfloat> &pixels);
         void PushData2D(GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
@@ -48,9 +50,10 @@ namespace GL{
         void PushData3D(GLsizei width, GLsizei height, int layers, GLenum format, const std::vector<GLubyte> &pixels);
         void PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, const std::vector<GLubyte> &pixels);
         void PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, const std::vector<GLfloat> &pixels);
-        void PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, GLenum type, const void *pixels);
-        void PushCompressedData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, int imageSize, const void *pixels);
+        void PushData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, GLenum type, const void *pixels, int level = 0);
+        void PushCompressedData3DLayer(GLsizei width, GLsizei height, int layer, GLenum format, int imageSize, const void *pixels, int level = 0);
         void GenerateMipmaps();
+        GLsizei GetLevels() const;
         void Release() override;
     };
 
@@ -71,6 +74,35 @@ namespace GL{
         void Release() override;
     };
 
+    // Uniform name hashed at compile time when built from a literal, so uniforms are found without strings
+    struct UniformName{
+        uint64_t hash;
+        // FNV-1a of name
+        static constexpr uint64_t Hash(const char *name){
+            uint64_t hash = 14695981039346656037ULL;
+            for(; *name != '\0'; name++)
+                hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ULL;
+            return hash;
+        }
+        constexpr UniformName(const char *name):hash(Hash(name)){}
+    };
+
+    // Uniform of a program resolved once. Handles of uniforms not active in program make setters do nothing
+    template <typename T>
+    struct UniformHandle{
+        int index = -1;
+        bool IsValid() const{
+            return index >= 0;
+        }
+    };
+
+    // Uniforms lookups and calls of every program, for profiling
+    struct UniformCounters{
+        size_t stringLookups = 0;
+        size_t uniformCalls = 0;
+        size_t redundantCalls = 0; // Skipped as value was already set
+    };
+
     class ShaderGL : public ObjectGL {
     public:
         struct uniform_info
@@ -78,11 +110,32 @@ namespace GL{
             GLint location;
             GLsizei count;
             GLenum type;
+            int index; // Position in uniforms values
         };
     private:
+        // Last value set to uniform, large enough for a mat4
+        struct UniformValue{
+            GLint location = -1;
+            bool isSet = false;
+            alignas(16) unsigned char data[sizeof(glm::mat4)];
+        };
         bool debugInfo;
+        bool linkPending = false;
+        bool linked = false;
+        uint64_t binaryKey = 0; // Binary cache key of program sources. Zero when binary isn't to be stored
+        // Block bindings set while link is pending, applied when it finishes
+        std::vector<std::pair<std::string, unsigned int>> pendingBlockBindings;
+        static bool parallelCompile;
         std::unordered_map<std::string, uniform_info> uniforms;
+        std::unordered_map<uint64_t, int> uniformsHashes;
+        mutable std::vector<UniformValue> uniformsValues;
+        static UniformCounters uniformCounters;
         void GetUniformsInfo();
+        int FindUniformIndex(const std::string &name) const;
+        int FindUniformIndex(UniformName name) const;
+        // Stores value and returns true when uniform needs a GL call
+        bool UpdateUniformValue(int index, const void *data, size_t size) const;
+        void FinishLink();
 
     public:
         ShaderGL();
@@ -93,7 +146,38 @@ namespace GL{
         void AttachShaderObject(ShaderObjectGL &&shaderObject);
         void Create();
         void Link();
+        // Issues link without waiting for it. Uniforms aren't found until IsReady returns true
+        void BeginLink();
+        // Never waits when parallel compile is supported, otherwise finishes a pending link
+        bool IsReady();
+        bool IsLinked() const;
+        static void SetParallelCompile(bool parallelCompile);
+        // Must be set before link for binary to be retrievable
+        void SetBinaryRetrievable();
+        // Returns false when program isn't linked or has no binary
+        bool GetBinary(GLenum &format, std::vector<unsigned char> &binary) const;
+        // Loads a binary instead of linking. Returns false when driver rejects it, so program can still be linked
+        bool LoadBinary(GLenum format, const std::vector<unsigned char> &binary);
+        void SetBinaryKey(uint64_t binaryKey);
+        uint64_t GetBinaryKey() const;
         void Use();
+        template <typename T>
+        UniformHandle<T> GetUniformHandle(const std::string &name) const{
+            return UniformHandle<T>{FindUniformIndex(name)};
+        }
+        template <typename T>
+        UniformHandle<T> GetUniformHandle(UniformName name) const{
+            return UniformHandle<T>{FindUniformIndex(name)};
+        }
+        // GL calls are only issued when value differs from the last value set to uniform
+        void Set(UniformHandle<bool> handle, bool value) const;
+        void Set(UniformHandle<int> handle, int value) const;
+        void Set(UniformHandle<float> handle, float value) const;
+        void Set(UniformHandle<double> handle, double value) const;
+        void Set(UniformHandle<glm::vec3> handle, glm::vec3 value) const;
+        void Set(UniformHandle<glm::vec4> handle, glm::vec4 value) const;
+        void Set(UniformHandle<glm::mat4> handle, const glm::mat4 &matrix) const;
+        // Setters by name look up uniform on each call. Handles are preferred for repeated calls
         void SetBool(const std::string &name, bool value) const;
         void SetInt(const std::string &name, int value) const;
         void SetFloat(const std::string &name, float value) const;
@@ -101,10 +185,13 @@ namespace GL{
         void SetVec3(const std::string &name, glm::vec3 value) const;
         void SetVec4(const std::string &name, glm::vec4 value) const;
         void SetMat4Float(const std::string &name, const glm::mat4 &matrix) const;
-        void SetBlockBinding(const std::string &name, unsigned int bindingPoint) const;
+        // Sets values set to uniforms of source to uniforms of same name and type, as when replacing a program
+        void CopyUniformValues(const ShaderGL &source) const;
+        void SetBlockBinding(const std::string &name, unsigned int bindingPoint);
         void DetachShaderObject(const ShaderObjectGL &shaderObject);
         void DetachShaderObject(ShaderObjectGL &&shaderObject);
         std::unordered_map<std::string, uniform_info> GetUniforms();
+        static UniformCounters &GetUniformCounters();
         void Release() override;
     };
 
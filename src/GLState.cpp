@@ -0,0 +1,219 @@
+#include "GLState.hpp"
+#include <algorithm>
+
+// Name never returned by GL, so unknown bindings always differ from bound names
+static const GLuint unknownName = ~0u;
+
+GLuint &GL::StateTracker::Binding(std::vector<GLuint> &bindings, GLuint index)
+{
+    if(index >= bindings.size())
+        bindings.resize(index + 1, unknownName);
+    return bindings[index];
+}
+
+void GL::StateTracker::SetMultiBindState(bool multiBind)
+{
+    this->multiBind = multiBind;
+}
+
+void GL::StateTracker::UseProgram(GLuint program)
+{
+    if(programKnown && this->program == program){
+        counters.elidedCalls++;
+        return;
+    }
+    this->program = program;
+    programKnown = true;
+    counters.issuedCalls++;
+    glUseProgram(program);
+}
+
+void GL::StateTracker::BindVertexArray(GLuint vertexArray)
+{
+    if(vertexArrayKnown && this->vertexArray == vertexArray){
+        counters.elidedCalls++;
+        return;
+    }
+    this->vertexArray = vertexArray;
+    vertexArrayKnown = true;
+    counters.issuedCalls++;
+    glBindVertexArray(vertexArray);
+}
+
+void GL::StateTracker::SetVertexArrayElementBuffer(GLuint vertexArray, GLuint buffer)
+{
+    auto it = elementBuffers.try_emplace(vertexArray, unknownName).first;
+    if(Update(it->second, buffer))
+        glVertexArrayElementBuffer(vertexArray, buffer);
+}
+
+void GL::StateTracker::BindBuffer(GLenum target, GLuint buffer)
+{
+    auto it = buffers.try_emplace(target, unknownName).first;
+    if(Update(it->second, buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GL::StateTracker::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // Indexed binding may also change generic binding of target, so it becomes unknown
+    buffers.erase(target);
+    if(Update(Binding(indexedBuffers[target], index), buffer))
+        glBindBufferBase(target, index, buffer);
+}
+
+void GL::StateTracker::BindBuffersBase(GLenum target, std::vector<std::pair<GLuint, GLuint>> &bindings)
+{
+    std::sort(bindings.begin(), bindings.end());
+    std::vector<GLuint> &targetBindings = indexedBuffers[target];
+    std::vector<GLuint> run; // Changed buffers of consecutive binding points
+    GLuint runFirst = 0;
+    auto flush = [&](){
+        if(run.size() > 1 && multiBind){
+            glBindBuffersBase(target, runFirst, run.size(), run.data());
+            counters.issuedCalls++;
+        } else {
+            for(size_t i = 0; i < run.size(); i++){
+                glBindBufferBase(target, runFirst + i, run[i]);
+                counters.issuedCalls++;
+            }
+        }
+        run.clear();
+    };
+    for(auto &&[index, buffer] : bindings){
+        GLuint &bound = Binding(targetBindings, index);
+        if(bound == buffer){
+            counters.elidedCalls++;
+            continue;
+        }
+        bound = buffer;
+        if(!run.empty() && runFirst + run.size() != index)
+            flush();
+        if(run.empty())
+            runFirst = index;
+        run.push_back(buffer);
+    }
+    if(!run.empty())
+        flush();
+    buffers.erase(target);
+}
+
+void GL::StateTracker::BindTextureUnit(GLuint unit, GLuint texture)
+{
+    if(Update(Binding(textures, unit), texture))
+        glBindTextureUnit(unit, texture);
+}
+
+void GL::StateTracker::BindTextures(GLuint first, GLsizei count, const GLuint *textures)
+{
+    // Changed units from first to last changed are bound together, as unchanged units in between are rebound
+    // with the same textures
+    GLsizei changedBegin = count, changedEnd = 0;
+    for(GLsizei i = 0; i < count; i++){
+        GLuint &bound = Binding(this->textures, first + i);
+        if(bound != textures[i]){
+            bound = textures[i];
+            changedBegin = std::min(changedBegin, i);
+            changedEnd = i + 1;
+        }
+    }
+    if(changedBegin >= changedEnd){
+        counters.elidedCalls += count;
+        return;
+    }
+    if(multiBind){
+        glBindTextures(first + changedBegin, changedEnd - changedBegin, textures + changedBegin);
+        counters.issuedCalls++;
+        counters.elidedCalls += count - (changedEnd - changedBegin);
+        return;
+    }
+    for(GLsizei i = 0; i < count; i++){
+        if(i >= changedBegin && i < changedEnd){
+            glBindTextureUnit(first + i, textures[i]);
+            counters.issuedCalls++;
+        } else {
+            counters.elidedCalls++;
+        }
+    }
+}
+
+void GL::StateTracker::BindSampler(GLuint unit, GLuint sampler)
+{
+    if(Update(Binding(samplers, unit), sampler))
+        glBindSampler(unit, sampler);
+}
+
+void GL::StateTracker::SetCapability(GLenum capability, bool enabled)
+{
+    auto it = capabilities.find(capability);
+    if(it != capabilities.end() && it->second == enabled){
+        counters.elidedCalls++;
+        return;
+    }
+    capabilities[capability] = enabled;
+    counters.issuedCalls++;
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GL::StateTracker::SetDepthFunc(GLenum function)
+{
+    if(Update(depthFunc, function))
+        glDepthFunc(function);
+}
+
+void GL::StateTracker::SetDepthMask(bool mask)
+{
+    if(Update(depthMask, static_cast<int>(mask)))
+        glDepthMask(mask ? GL_TRUE : GL_FALSE);
+}
+
+void GL::StateTracker::SetColorMask(bool red, bool green, bool blue, bool alpha)
+{
+    int mask = red | green << 1 | blue << 2 | alpha << 3;
+    if(Update(colorMask, mask))
+        glColorMask(red, green, blue, alpha);
+}
+
+void GL::StateTracker::SetBlendFunc(GLenum source, GLenum destination)
+{
+    if(blendSource == source && blendDestination == destination){
+        counters.elidedCalls++;
+        return;
+    }
+    blendSource = source;
+    blendDestination = destination;
+    counters.issuedCalls++;
+    glBlendFunc(source, destination);
+}
+
+void GL::StateTracker::SetCullFace(GLenum face)
+{
+    if(Update(cullFace, face))
+        glCullFace(face);
+}
+
+void GL::StateTracker::Invalidate()
+{
+    capabilities.clear();
+    programKnown = vertexArrayKnown = false;
+    elementBuffers.clear();
+    buffers.clear();
+    indexedBuffers.clear();
+    textures.clear();
+    samplers.clear();
+    depthFunc = blendSource = blendDestination = cullFace = GL_NONE;
+    depthMask = colorMask = -1;
+}
+
+void GL::StateTracker::ResetCounters()
+{
+    counters = StateCounters();
+}
+
+const GL::StateCounters &GL::StateTracker::GetCounters() const
+{
+    return counters;
+}
@@ -0,0 +1,80 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+#include <GL/glew.h>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace GL{
+    struct StateCounters{
+        size_t issuedCalls = 0;
+        size_t elidedCalls = 0; // State already set, so no call was made
+    };
+
+    // Cache of bound objects and fixed function state, so calls that don't change state are not issued.
+    // State changed without the tracker must be followed by Invalidate
+    class StateTracker{
+    private:
+        // Zero or one for known capability state. Absent when unknown
+        std::unordered_map<GLenum, bool> capabilities;
+        GLuint program = 0;
+        GLuint vertexArray = 0;
+        bool programKnown = false;
+        bool vertexArrayKnown = false;
+        // Element buffers set to vertex arrays
+        std::unordered_map<GLuint, GLuint> elementBuffers;
+        // Buffers of non indexed targets
+        std::unordered_map<GLenum, GLuint> buffers;
+        // Buffers of each binding point of indexed targets, and textures and samplers of each unit
+        std::unordered_map<GLenum, std::vector<GLuint>> indexedBuffers;
+        std::vector<GLuint> textures;
+        std::vector<GLuint> samplers;
+        GLenum depthFunc = GL_NONE;
+        GLenum blendSource = GL_NONE;
+        GLenum blendDestination = GL_NONE;
+        GLenum cullFace = GL_NONE;
+        int depthMask = -1;
+        int colorMask = -1; // RGBA bits
+        bool multiBind = false;
+        StateCounters counters;
+        // Returns true when cached value changes
+        template <typename T>
+        bool Update(T &cached, T value){
+            if(cached == value){
+                counters.elidedCalls++;
+                return false;
+            }
+            cached = value;
+            counters.issuedCalls++;
+            return true;
+        }
+        // Binding of index in bindings, growing them with unknown bindings
+        static GLuint &Binding(std::vector<GLuint> &bindings, GLuint index);
+    public:
+        // Multi-bind needs GL 4.4. Without it ranges are bound one by one
+        void SetMultiBindState(bool multiBind);
+        void UseProgram(GLuint program);
+        void BindVertexArray(GLuint vertexArray);
+        void SetVertexArrayElementBuffer(GLuint vertexArray, GLuint buffer);
+        void BindBuffer(GLenum target, GLuint buffer);
+        void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+        // Bindings as binding point and buffer. Changed bindings with consecutive points are bound by one call
+        void BindBuffersBase(GLenum target, std::vector<std::pair<GLuint, GLuint>> &bindings);
+        void BindTextureUnit(GLuint unit, GLuint texture);
+        // Textures of consecutive units starting at first
+        void BindTextures(GLuint first, GLsizei count, const GLuint *textures);
+        void BindSampler(GLuint unit, GLuint sampler);
+        void SetCapability(GLenum capability, bool enabled);
+        void SetDepthFunc(GLenum function);
+        void SetDepthMask(bool mask);
+        void SetColorMask(bool red, bool green, bool blue, bool alpha);
+        void SetBlendFunc(GLenum source, GLenum destination);
+        void SetCullFace(GLenum face);
+        // Forgets cached state, so next calls are issued
+        void Invalidate();
+        void ResetCounters();
+        const StateCounters &GetCounters() const;
+    };
+}
+#endif
@@ -0,0 +1,1054 @@
+#include "GLTFLoader.hpp"
+#include "Constants.hpp"
+#include "AttributeQuantizer.hpp"
+#include <stb/stb_image.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <variant>
+
+// Accessors component types
+static const int componentTypeByte = 5120;
+static const int componentTypeUnsignedByte = 5121;
+static const int componentTypeShort = 5122;
+static const int componentTypeUnsignedShort = 5123;
+static const int componentTypeUnsignedInt = 5125;
+static const int componentTypeFloat = 5126;
+// GLB header and chunks magic values
+static const uint32_t glbMagic = 0x46546C67; // "glTF"
+static const uint32_t glbChunkJSON = 0x4E4F534A;
+static const uint32_t glbChunkBIN = 0x004E4942;
+
+std::string GLTFLoader::DecodeURI(const std::string &uri)
+{
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for(size_t i = 0; i < uri.size(); i++){
+        if(uri[i] == '%' && i + 2 < uri.size()){
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            decoded.push_back(uri[i]);
+        }
+    }
+    return decoded;
+}
+
+bool GLTFLoader::DecodeBase64(const std::string &input, std::vector<unsigned char> &output)
+{
+    auto decodeChar = [](char c) -> int{
+        if(c >= 'A' && c <= 'Z') return c - 'A';
+        if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if(c >= '0' && c <= '9') return c - '0' + 52;
+        if(c == '+') return 62;
+        if(c == '/') return 63;
+        return -1;
+    };
+    output.clear();
+    output.reserve(input.size() * 3 / 4);
+    unsigned int accumulator = 0;
+    int bits = 0;
+    for(char c : input){
+        if(c == '=')
+            break;
+        int value = decodeChar(c);
+        if(value < 0)
+            return false;
+        accumulator = (accumulator << 6) | value;
+        bits += 6;
+        if(bits >= 8){
+            bits -= 8;
+            output.push_back(static_cast<unsigned char>((accumulator >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+int GLTFLoader::ComponentSize(int componentType)
+{
+    switch(componentType){
+        case componentTypeByte:
+        case componentTypeUnsignedByte: return 1;
+        case componentTypeShort:
+        case componentTypeUnsignedShort: return 2;
+        case componentTypeUnsignedInt:
+        case componentTypeFloat: return 4;
+        default: return 0;
+    }
+}
+
+int GLTFLoader::ComponentsCount(const std::string &type)
+{
+    if(type == "SCALAR") return 1;
+    if(type == "VEC2") return 2;
+    if(type == "VEC3") return 3;
+    if(type == "VEC4") return 4;
+    if(type == "MAT2") return 4;
+    if(type == "MAT3") return 9;
+    if(type == "MAT4") return 16;
+    return 0;
+}
+
+float GLTFLoader::ReadComponentAsFloat(const unsigned char *data, int componentType, bool normalized)
+{
+    switch(componentType){
+        case componentTypeFloat:{
+            float value;
+            std::memcpy(&value, data, sizeof(float));
+            return value;
+        }
+        case componentTypeUnsignedByte:{
+            float value = *data;
+            return normalized ? value / 255.0f : value;
+        }
+        case componentTypeByte:{
+            float value = static_cast<signed char>(*data);
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case componentTypeUnsignedShort:{
+            unsigned short value;
+            std::memcpy(&value, data, sizeof(unsigned short));
+            return normalized ? value / 65535.0f : value;
+        }
+        case componentTypeShort:{
+            short value;
+            std::memcpy(&value, data, sizeof(short));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case componentTypeUnsignedInt:{
+            unsigned int value;
+            std::memcpy(&value, data, sizeof(unsigned int));
+            return static_cast<float>(value);
+        }
+        default: return 0.0f;
+    }
+}
+
+bool GLTFLoader::ParseFile(const std::string &path)
+{
+    glbFile = CreateRef<MappedFile>();
+    if(!glbFile->Open(path))
+        return false;
+    const unsigned char *fileData = glbFile->GetData();
+    size_t fileSize = glbFile->GetSize();
+    uint32_t magic = 0;
+    if(fileSize >= sizeof(uint32_t))
+        std::memcpy(&magic, fileData, sizeof(uint32_t));
+
+    if(magic != glbMagic){ // Text glTF. Json is parsed directly from mapped memory
+        document = nlohmann::json::parse(fileData, fileData + fileSize, nullptr, false);
+        glbFile->Close();
+        return !document.is_discarded();
+    }
+    // Binary glTF: 12 bytes header, json chunk and optional binary chunk
+    size_t offset = 12;
+    bool jsonFound = false;
+    while(offset + 8 <= fileSize){
+        uint32_t chunkLength = 0;
+        uint32_t chunkType = 0;
+        std::memcpy(&chunkLength, fileData + offset, sizeof(uint32_t));
+        std::memcpy(&chunkType, fileData + offset + 4, sizeof(uint32_t));
+        const unsigned char *chunkData = fileData + offset + 8;
+        if(offset + 8 + chunkLength > fileSize)
+            return false;
+        if(chunkType == glbChunkJSON){
+            document = nlohmann::json::parse(chunkData, chunkData + chunkLength, nullptr, false);
+            jsonFound = !document.is_discarded();
+        } else if(chunkType == glbChunkBIN && buffers.empty()){
+            // First buffer without uri refers to this chunk
+            BufferData glbBuffer;
+            glbBuffer.file = glbFile;
+            glbBuffer.data = chunkData;
+            glbBuffer.size = chunkLength;
+            buffers.push_back(glbBuffer);
+        }
+        offset += 8 + chunkLength;
+    }
+    return jsonFound;
+}
+
+bool GLTFLoader::LoadBuffers()
+{
+    // Buffer pushed while parsing is the GLB binary chunk
+    BufferData glbBuffer;
+    if(!buffers.empty())
+        glbBuffer = buffers[0];
+    buffers.clear();
+    if(!document.contains("buffers"))
+        return true;
+    for(const auto &buffer : document["buffers"]){
+        BufferData bufferData;
+        if(!buffer.contains("uri")){
+            bufferData = glbBuffer;
+        } else {
+            std::string uri = buffer["uri"].get<std::string>();
+            if(uri.compare(0, 5, "data:") == 0){
+                size_t dataBegin = uri.find(',');
+                if(dataBegin == std::string::npos || !DecodeBase64(uri.substr(dataBegin + 1), bufferData.decoded))
+                    return false;
+                bufferData.data = bufferData.decoded.data();
+                bufferData.size = bufferData.decoded.size();
+            } else {
+                bufferData.file = CreateRef<MappedFile>();
+                if(!bufferData.file->Open(directory + '/' + DecodeURI(uri)))
+                    return false;
+                bufferData.data = bufferData.file->GetData();
+                bufferData.size = bufferData.file->GetSize();
+            }
+        }
+        if(bufferData.data == nullptr || bufferData.size < buffer.value("byteLength", size_t(0)))
+            return false;
+        buffers.push_back(std::move(bufferData));
+    }
+    // Decoded vectors were moved, so data pointers are still valid
+    return true;
+}
+
+bool GLTFLoader::GetAccessorView(int accessorIndex, AccessorView &view) const
+{
+    const auto &accessors = document.at("accessors");
+    if(accessorIndex < 0 || accessorIndex >= static_cast<int>(accessors.size()))
+        return false;
+    const auto &accessor = accessors[accessorIndex];
+    if(!accessor.contains("bufferView"))
+        return false;
+    const auto &bufferView = document.at("bufferViews").at(accessor["bufferView"].get<int>());
+    const auto &buffer = buffers.at(bufferView.at("buffer").get<int>());
+
+    view.componentType = accessor.at("componentType").get<int>();
+    view.componentsCount = ComponentsCount(accessor.at("type").get<std::string>());
+    view.count = accessor.at("count").get<size_t>();
+    view.normalized = accessor.value("normalized", false);
+    size_t elementSize = ComponentSize(view.componentType) * view.componentsCount;
+    view.stride = bufferView.value("byteStride", size_t(0));
+    if(view.stride == 0)
+        view.stride = elementSize;
+    size_t offset = bufferView.value("byteOffset", size_t(0)) + accessor.value("byteOffset", size_t(0));
+    if(elementSize == 0 || (view.count > 0 && offset + view.stride * (view.count - 1) + elementSize > buffer.size))
+        return false;
+    view.data = buffer.data + offset;
+    view.file = buffer.file;
+    return true;
+}
+
+void GLTFLoader::ReadAccessorFloat(const AccessorView &view, int componentsCount, std::vector<float> &output) const
+{
+    output.resize(view.count * componentsCount);
+    // Same layout, so memory is copied as is
+    if(view.componentType == componentTypeFloat && view.componentsCount == componentsCount
+    && view.stride == componentsCount * sizeof(float)){
+        std::memcpy(output.data(), view.data, output.size() * sizeof(float));
+        return;
+    }
+    int componentSize = ComponentSize(view.componentType);
+    for(size_t i = 0; i < view.count; i++){
+        const unsigned char *element = view.data + i * view.stride;
+        for(int c = 0; c < componentsCount; c++){
+            if(c < view.componentsCount)
+                output[i * componentsCount + c] = ReadComponentAsFloat(element + c * componentSize, view.componentType, view.normalized);
+            else // Missing alpha is opaque
+                output[i * componentsCount + c] = c == 3 ? 1.0f : 0.0f;
+        }
+    }
+}
+
+bool GLTFLoader::ReadIndices(const nlohmann::json &primitive, size_t verticesCount, std::vector<unsigned int> &indices) const
+{
+    std::vector<unsigned int> source;
+    if(primitive.contains("indices")){
+        AccessorView view;
+        if(!GetAccessorView(primitive["indices"].get<int>(), view))
+            return false;
+        source.resize(view.count);
+        if(view.componentType == componentTypeUnsignedInt && view.stride == sizeof(unsigned int)){
+            std::memcpy(source.data(), view.data, view.count * sizeof(unsigned int));
+        } else {
+            for(size_t i = 0; i < view.count; i++){
+                const unsigned char *element = view.data + i * view.stride;
+                if(view.componentType == componentTypeUnsignedShort){
+                    unsigned short value;
+                    std::memcpy(&value, element, sizeof(unsigned short));
+                    source[i] = value;
+                } else if(view.componentType == componentTypeUnsignedByte){
+                    source[i] = *element;
+                } else {
+                    std::memcpy(&source[i], element, sizeof(unsigned int));
+                }
+            }
+        }
+    } else { // Non indexed geometry
+        source.resize(verticesCount);
+        for(size_t i = 0; i < verticesCount; i++)
+            source[i] = static_cast<unsigned int>(i);
+    }
+    int mode = primitive.value("mode", 4);
+    if(mode == 4){ // Triangles
+        indices = std::move(source);
+    } else if(mode == 5){ // Triangle strip. Odd triangles are swapped to keep winding
+        indices.clear();
+        for(size_t i = 0; i + 2 < source.size(); i++){
+            if(i % 2 == 0)
+                indices.insert(indices.end(), {source[i], source[i + 1], source[i + 2]});
+            else
+                indices.insert(indices.end(), {source[i + 1], source[i], source[i + 2]});
+        }
+    } else if(mode == 6){ // Triangle fan
+        indices.clear();
+        for(size_t i = 1; i + 1 < source.size(); i++){
+            indices.insert(indices.end(), {source[i], source[i + 1], source[0]});
+        }
+    } else {
+        return false;
+    }
+    for(unsigned int index : indices){
+        if(index >= verticesCount)
+            return false;
+    }
+    return true;
+}
+
+Ref<Mesh> GLTFLoader::ProcessPrimitive(const nlohmann::json &primitive) const
+{
+    const auto &attributes = primitive.at("attributes");
+    AccessorView positionView;
+    if(!attributes.contains("POSITION") || !GetAccessorView(attributes["POSITION"].get<int>(), positionView))
+        return Ref<Mesh>(nullptr);
+    size_t verticesCount = positionView.count;
+    std::vector<unsigned int> indices;
+    if(!ReadIndices(primitive, verticesCount, indices))
+        return Ref<Mesh>(nullptr);
+
+    std::vector<float> positions;
+    ReadAccessorFloat(positionView, 3, positions);
+    // Skinning writes whole floats, so deformable primitives keep float positions and tangent frames
+    bool deformable = (attributes.contains("JOINTS_0") && attributes.contains("WEIGHTS_0")) || primitive.contains("targets");
+    bool compress = compressVertices && !deformable;
+
+    // Normals, tangents and bitangents are processed in right handed space and mirrored at end
+    std::vector<float> normals;
+    AccessorView normalView;
+    if(attributes.contains("NORMAL") && GetAccessorView(attributes["NORMAL"].get<int>(), normalView)
+    && normalView.count == verticesCount){
+        ReadAccessorFloat(normalView, 3, normals);
+    } else { // Smooth normals weighted by triangles area, as aiProcess_GenSmoothNormals
+        normals = std::vector<float>(3 * verticesCount, 0.0f);
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            glm::vec3 p0 = glm::make_vec3(&positions[3 * indices[i]]);
+            glm::vec3 p1 = glm::make_vec3(&positions[3 * indices[i + 1]]);
+            glm::vec3 p2 = glm::make_vec3(&positions[3 * indices[i + 2]]);
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            for(int j = 0; j < 3; j++){
+                for(int c = 0; c < 3; c++)
+                    normals[3 * indices[i + j] + c] += faceNormal[c];
+            }
+        }
+        for(size_t i = 0; i < verticesCount; i++){
+            glm::vec3 normal = glm::make_vec3(&normals[3 * i]);
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            std::copy(&normal[0], &normal[0] + 3, &normals[3 * i]);
+        }
+    }
+
+    // glTF UVs origin is at top left. Assimp flips them at import and aiProcess_FlipUVs flips again,
+    // so they are only changed here when flipUVs is not set
+    bool hasTexCoords0 = false;
+    bool adoptTexCoords0 = false; // Unorm16 UVs in a mapped file are referenced by mesh without copy
+    std::variant<std::vector<float>, std::vector<unsigned short>> texCoords0 = std::vector<unsigned short>(2 * verticesCount, 0);
+    std::vector<float> texCoordsFloat;
+    AccessorView texCoordView;
+    if(attributes.contains("TEXCOORD_0") && GetAccessorView(attributes["TEXCOORD_0"].get<int>(), texCoordView)
+    && texCoordView.count == verticesCount){
+        hasTexCoords0 = true;
+        adoptTexCoords0 = flipUVs && texCoordView.componentType == componentTypeUnsignedShort && texCoordView.normalized
+        && texCoordView.file;
+        if(!adoptTexCoords0 && flipUVs && texCoordView.componentType == componentTypeUnsignedShort && texCoordView.normalized
+        && texCoordView.stride == 2 * sizeof(unsigned short)){
+            auto &texCoords = std::get<std::vector<unsigned short>>(texCoords0);
+            std::memcpy(texCoords.data(), texCoordView.data, texCoords.size() * sizeof(unsigned short));
+        }
+        // Float UVs are also needed for tangents generation
+        ReadAccessorFloat(texCoordView, 2, texCoordsFloat);
+    }
+
+    bool hasTangentsAndBitangents = false;
+    std::vector<float> tangents;
+    std::vector<float> bitangents;
+    AccessorView tangentView;
+    if(attributes.contains("TANGENT") && GetAccessorView(attributes["TANGENT"].get<int>(), tangentView)
+    && tangentView.count == verticesCount){
+        std::vector<float> tangentsW;
+        ReadAccessorFloat(tangentView, 4, tangentsW);
+        tangents.resize(3 * verticesCount);
+        bitangents.resize(3 * verticesCount);
+        for(size_t i = 0; i < verticesCount; i++){
+            glm::vec3 tangent = glm::make_vec3(&tangentsW[4 * i]);
+            glm::vec3 bitangent = glm::cross(glm::make_vec3(&normals[3 * i]), tangent) * tangentsW[4 * i + 3];
+            std::copy(&tangent[0], &tangent[0] + 3, &tangents[3 * i]);
+            std::copy(&bitangent[0], &bitangent[0] + 3, &bitangents[3 * i]);
+        }
+        hasTangentsAndBitangents = true;
+    } else if(hasTexCoords0){ // As aiProcess_CalcTangentSpace. V is taken with bottom left origin
+        std::vector<glm::vec3> tangentsSum(verticesCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> bitangentsSum(verticesCount, glm::vec3(0.0f));
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            unsigned int i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+            glm::vec3 p0 = glm::make_vec3(&positions[3 * i0]);
+            glm::vec3 edge1 = glm::make_vec3(&positions[3 * i1]) - p0;
+            glm::vec3 edge2 = glm::make_vec3(&positions[3 * i2]) - p0;
+            glm::vec2 uv0(texCoordsFloat[2 * i0], 1.0f - texCoordsFloat[2 * i0 + 1]);
+            glm::vec2 deltaUV1 = glm::vec2(texCoordsFloat[2 * i1], 1.0f - texCoordsFloat[2 * i1 + 1]) - uv0;
+            glm::vec2 deltaUV2 = glm::vec2(texCoordsFloat[2 * i2], 1.0f - texCoordsFloat[2 * i2 + 1]) - uv0;
+            float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+            if(std::abs(determinant) < 1e-12f)
+                continue;
+            float inverse = 1.0f / determinant;
+            glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * inverse;
+            glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * inverse;
+            for(unsigned int index : {i0, i1, i2}){
+                tangentsSum[index] += tangent;
+                bitangentsSum[index] += bitangent;
+            }
+        }
+        tangents.resize(3 * verticesCount);
+        bitangents.resize(3 * verticesCount);
+        for(size_t i = 0; i < verticesCount; i++){
+            glm::vec3 normal = glm::make_vec3(&normals[3 * i]);
+            // Gram-Schmidt orthogonalization against normal
+            glm::vec3 tangent = tangentsSum[i] - normal * glm::dot(normal, tangentsSum[i]);
+            glm::vec3 bitangent = bitangentsSum[i] - normal * glm::dot(normal, bitangentsSum[i]);
+            tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : glm::vec3(1.0f, 0.0f, 0.0f);
+            bitangent = glm::length(bitangent) > 0.0f ? glm::normalize(bitangent) : glm::cross(normal, tangent);
+            std::copy(&tangent[0], &tangent[0] + 3, &tangents[3 * i]);
+            std::copy(&bitangent[0], &bitangent[0] + 3, &bitangents[3 * i]);
+        }
+        hasTangentsAndBitangents = true;
+    }
+
+    // Mirror Z axis, as aiProcess_MakeLeftHanded
+    for(size_t i = 0; i < verticesCount; i++){
+        positions[3 * i + 2] = -positions[3 * i + 2];
+        normals[3 * i + 2] = -normals[3 * i + 2];
+        if(hasTangentsAndBitangents){
+            tangents[3 * i + 2] = -tangents[3 * i + 2];
+            bitangents[3 * i + 2] = -bitangents[3 * i + 2];
+        }
+    }
+
+    // Conversion to formats used by renderer
+    auto toSnorm16 = [](const std::vector<float> &values){
+        std::vector<short> output(values.size());
+        AttributeQuantizer::FloatToSnorm16(values.data(), values.size(), output.data());
+        return output;
+    };
+    if(hasTexCoords0 && !adoptTexCoords0 && !(flipUVs && texCoordView.componentType == componentTypeUnsignedShort && texCoordView.normalized
+    && texCoordView.stride == 2 * sizeof(unsigned short))){
+        if(!flipUVs){
+            for(size_t i = 0; i < verticesCount; i++)
+                texCoordsFloat[2 * i + 1] = 1.0f - texCoordsFloat[2 * i + 1];
+        }
+        // Tex coords outside [0, 1] are kept as float for correct interpolation
+        float minValues[2], maxValues[2];
+        AttributeQuantizer::MinMax(texCoordsFloat.data(), verticesCount, 2, minValues, maxValues);
+        bool outOfRange = std::min(minValues[0], minValues[1]) < -1.0f || std::max(maxValues[0], maxValues[1]) > 1.0f;
+        if(outOfRange){
+            texCoords0 = std::move(texCoordsFloat);
+        } else {
+            auto &texCoords = std::get<std::vector<unsigned short>>(texCoords0);
+            AttributeQuantizer::Float2ToUnorm16(texCoordsFloat.data(), verticesCount, 2, texCoords.data());
+        }
+    }
+
+    Ref<Mesh> mesh = CreateRef<Mesh>();
+    if(compress && verticesCount > 0){
+        glm::vec3 minValues, maxValues;
+        AttributeQuantizer::MinMax(positions.data(), verticesCount, 3, &minValues.x, &maxValues.x);
+        glm::vec3 extent = maxValues - minValues;
+        std::vector<unsigned short> positionsQuantized(4 * verticesCount);
+        AttributeQuantizer::PositionsToUnorm16(positions.data(), verticesCount, &minValues.x, &extent.x, positionsQuantized.data());
+        mesh->PushAttributePosition(positionsQuantized, minValues, extent);
+    } else {
+        mesh->PushAttributePosition(positions);
+    }
+    if(adoptTexCoords0){
+        mesh->AdoptAttribute("texCoord0", MeshAttributeFormat::Vec2, MeshAttributeType::UnsignedShort, true, texCoordView.file,
+        texCoordView.data, verticesCount, texCoordView.stride, false, MeshAttributeAlias::TexCoord0);
+    } else {
+        std::visit([&mesh](auto&& value){
+            mesh->PushAttributeTexCoord0(value);
+        }, texCoords0);
+    }
+    if(compress && hasTangentsAndBitangents){
+        std::vector<short> qTangents(4 * verticesCount);
+        AttributeQuantizer::TangentFramesToQTangents(normals.data(), tangents.data(), bitangents.data(), verticesCount, qTangents.data());
+        mesh->PushAttributeQTangent(qTangents);
+    } else if(compress){
+        std::vector<short> normalsOctahedral(2 * verticesCount);
+        AttributeQuantizer::NormalsToOctahedral(normals.data(), verticesCount, normalsOctahedral.data());
+        mesh->PushAttributeNormalOctahedral(normalsOctahedral);
+    } else if(deformable){
+        mesh->PushAttributeNormal(normals);
+        if(hasTangentsAndBitangents){
+            mesh->PushAttributeTangent(tangents);
+            mesh->PushAttributeBitangent(bitangents);
+        }
+    } else {
+        mesh->PushAttributeNormal(toSnorm16(normals));
+        if(hasTangentsAndBitangents){
+            mesh->PushAttributeTangent(toSnorm16(tangents));
+            mesh->PushAttributeBitangent(toSnorm16(bitangents));
+        }
+    }
+    AccessorView colorView;
+    if(attributes.contains("COLOR_0") && GetAccessorView(attributes["COLOR_0"].get<int>(), colorView)
+    && colorView.count == verticesCount){
+        if(colorView.componentType == componentTypeUnsignedByte && colorView.componentsCount == 4 && colorView.file){
+            // Colors in a mapped file are referenced by mesh without copy
+            mesh->AdoptAttribute("color", MeshAttributeFormat::Vec4, MeshAttributeType::UnsignedByte, true, colorView.file,
+            colorView.data, verticesCount, colorView.stride, false, MeshAttributeAlias::Color);
+        } else {
+            std::vector<unsigned char> colors(4 * verticesCount);
+            if(colorView.componentType == componentTypeUnsignedByte && colorView.componentsCount == 4 && colorView.stride == 4){
+                std::memcpy(colors.data(), colorView.data, colors.size());
+            } else {
+                std::vector<float> colorsFloat;
+                ReadAccessorFloat(colorView, 4, colorsFloat);
+                AttributeQuantizer::FloatToUnorm8(colorsFloat.data(), colors.size(), colors.data());
+            }
+            mesh->PushAttributeColor(colors);
+        }
+    }
+
+    if(deformable)
+        ReadDeformation(primitive, verticesCount, *mesh);
+
+    unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+    if(maxIndex <= 65535){
+        mesh->SetIndices(std::vector<unsigned short>(indices.begin(), indices.end()), MeshTopology::Triangles);
+    } else {
+        mesh->SetIndices(std::move(indices), MeshTopology::Triangles);
+    }
+    return mesh;
+}
+
+bool GLTFLoader::ReadDeformation(const nlohmann::json &primitive, size_t verticesCount, Mesh &mesh) const
+{
+    const auto &attributes = primitive.at("attributes");
+    AccessorView jointsView;
+    AccessorView weightsView;
+    if(attributes.contains("JOINTS_0") && attributes.contains("WEIGHTS_0")){
+        if(!GetAccessorView(attributes["JOINTS_0"].get<int>(), jointsView) || !GetAccessorView(attributes["WEIGHTS_0"].get<int>(), weightsView)
+        || jointsView.count != verticesCount || weightsView.count != verticesCount)
+            return false;
+        std::vector<float> jointsFloat;
+        std::vector<float> weightsFloat;
+        ReadAccessorFloat(jointsView, 4, jointsFloat);
+        ReadAccessorFloat(weightsView, 4, weightsFloat);
+        // Joints are stored in 8 bits, so only influences of the first 256 joints can be kept
+        for(size_t i = 0; i < jointsFloat.size(); i++){
+            if(jointsFloat[i] > 255.0f && weightsFloat[i] > 0.0f){
+                std::cout << "Skins with more than 256 joints are not supported - Using bind pose\n";
+                return false;
+            }
+        }
+        std::vector<glm::u8vec4> joints(verticesCount);
+        std::vector<glm::u8vec4> weights(verticesCount);
+        for(size_t i = 0; i < verticesCount; i++){
+            for(int c = 0; c < 4; c++)
+                joints[i][c] = weightsFloat[4 * i + c] > 0.0f ? static_cast<unsigned char>(jointsFloat[4 * i + c]) : 0;
+        }
+        AttributeQuantizer::WeightsToUnorm8(weightsFloat.data(), verticesCount, reinterpret_cast<unsigned char*>(weights.data()));
+        if(!mesh.SetSkinInfluences(std::move(joints), std::move(weights)))
+            return false;
+    }
+    if(primitive.contains("targets")){
+        // Deltas are mirrored in Z as attributes
+        auto readDeltas = [&](const nlohmann::json &target, const char *name, std::vector<glm::vec3> &deltas){
+            AccessorView view;
+            if(!target.contains(name) || !GetAccessorView(target[name].get<int>(), view) || view.count != verticesCount)
+                return false;
+            std::vector<float> values;
+            ReadAccessorFloat(view, 3, values);
+            deltas.resize(verticesCount);
+            for(size_t i = 0; i < verticesCount; i++)
+                deltas[i] = glm::vec3(values[3 * i], values[3 * i + 1], -values[3 * i + 2]);
+            return true;
+        };
+        for(const auto &target : primitive["targets"]){
+            MorphTarget morphTarget;
+            if(!readDeltas(target, "POSITION", morphTarget.positionDeltas))
+                morphTarget.positionDeltas = std::vector<glm::vec3>(verticesCount, glm::vec3(0.0f));
+            readDeltas(target, "NORMAL", morphTarget.normalDeltas);
+            if(!mesh.PushMorphTarget(std::move(morphTarget)))
+                return false;
+        }
+    }
+    return true;
+}
+
+int GLTFLoader::RequestTexture(const nlohmann::json &textureInfo, bool isSRGB)
+{
+    if(!textureInfo.is_object() || !textureInfo.contains("index") || !document.contains("textures"))
+        return -1;
+    const auto &texture = document["textures"].at(textureInfo["index"].get<int>());
+    if(!texture.contains("source"))
+        return -1;
+    int image = texture["source"].get<int>();
+    int key = 2 * image + (isSRGB ? 1 : 0);
+    auto found = textureRequestsIndices.find(key);
+    if(found != textureRequestsIndices.end())
+        return found->second;
+    TextureRequest request;
+    request.image = image;
+    request.isSRGB = isSRGB;
+    textureRequests.push_back(request);
+    textureRequestsIndices[key] = textureRequests.size() - 1;
+    return textureRequests.size() - 1;
+}
+
+Ref<Texture> GLTFLoader::LoadImage(int imageIndex, bool isSRGB) const
+{
+    const auto &image = document.at("images").at(imageIndex);
+    Ref<Texture> texture = CreateRef<Texture>();
+    const unsigned char *encoded = nullptr;
+    size_t encodedSize = 0;
+    std::vector<unsigned char> decoded;
+    if(image.contains("bufferView")){ // Embedded in binary buffer (GLB)
+        const auto &bufferView = document.at("bufferViews").at(image["bufferView"].get<int>());
+        const auto &buffer = buffers.at(bufferView.at("buffer").get<int>());
+        size_t offset = bufferView.value("byteOffset", size_t(0));
+        encodedSize = bufferView.at("byteLength").get<size_t>();
+        if(offset + encodedSize > buffer.size)
+            return Ref<Texture>(nullptr);
+        encoded = buffer.data + offset;
+    } else if(image.contains("uri")){
+        std::string uri = image["uri"].get<std::string>();
+        if(uri.compare(0, 5, "data:") == 0){
+            size_t dataBegin = uri.find(',');
+            if(dataBegin == std::string::npos || !DecodeBase64(uri.substr(dataBegin + 1), decoded))
+                return Ref<Texture>(nullptr);
+            encoded = decoded.data();
+            encodedSize = decoded.size();
+        } else {
+            std::string fileName = DecodeURI(uri);
+            std::vector<std::string> possibleTexturePaths =
+            {
+                directory + '/' + fileName,
+                directory + "/textures/" + fileName
+            };
+            for(auto &&path : possibleTexturePaths){
+                if(texture->Load(path, isSRGB))
+                    return texture;
+            }
+            return Ref<Texture>(nullptr);
+        }
+    }
+    if(encoded == nullptr)
+        return Ref<Texture>(nullptr);
+    // Embedded images are expanded to four channels, as Model does with Assimp embedded textures
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char *pixels = stbi_load_from_memory(encoded, static_cast<int>(encodedSize), &width, &height, &channels, 4);
+    if(pixels == nullptr){
+        std::cerr << "Erro ao carregar textura embutida.\n";
+        return Ref<Texture>(nullptr);
+    }
+    gli::format format = isSRGB ? gli::format::FORMAT_RGBA8_SRGB_PACK8 : gli::format::FORMAT_RGBA8_UNORM_PACK8;
+    bool loaded = texture->LoadFromMemory(std::vector<unsigned char>(pixels, pixels + 4 * width * height), format, width, height);
+    stbi_image_free(pixels);
+    return loaded ? texture : Ref<Texture>(nullptr);
+}
+
+void GLTFLoader::ProcessMaterials()
+{
+    struct MaterialMaps{
+        int diffuse = -1;
+        int normal = -1;
+        int specular = -1;
+    };
+    nlohmann::json emptyMaterials = nlohmann::json::array();
+    const auto &materialsJSON = document.contains("materials") ? document["materials"] : emptyMaterials;
+    std::vector<MaterialMaps> materialsMaps(materialsJSON.size());
+    for(size_t i = 0; i < materialsJSON.size(); i++){
+        const auto &material = materialsJSON[i];
+        const auto &extensions = material.contains("extensions") ? material["extensions"] : nlohmann::json::object();
+        if(material.contains("pbrMetallicRoughness") && material["pbrMetallicRoughness"].contains("baseColorTexture"))
+            materialsMaps[i].diffuse = RequestTexture(material["pbrMetallicRoughness"]["baseColorTexture"], true);
+        if(material.contains("normalTexture"))
+            materialsMaps[i].normal = RequestTexture(material["normalTexture"], false);
+        if(extensions.contains("KHR_materials_pbrSpecularGlossiness")){
+            const auto &specularGlossiness = extensions["KHR_materials_pbrSpecularGlossiness"];
+            if(specularGlossiness.contains("diffuseTexture"))
+                materialsMaps[i].diffuse = RequestTexture(specularGlossiness["diffuseTexture"], true);
+            if(specularGlossiness.contains("specularGlossinessTexture"))
+                materialsMaps[i].specular = RequestTexture(specularGlossiness["specularGlossinessTexture"], false);
+        } else if(extensions.contains("KHR_materials_specular") && extensions["KHR_materials_specular"].contains("specularColorTexture")){
+            materialsMaps[i].specular = RequestTexture(extensions["KHR_materials_specular"]["specularColorTexture"], false);
+        }
+    }
+    // Images are decoded and their mip chains built in parallel
+    tbb::parallel_for(size_t(0), textureRequests.size(), [&](size_t i){
+        textureRequests[i].texture = LoadImage(textureRequests[i].image, textureRequests[i].isSRGB);
+    });
+    auto getTexture = [this](int request){
+        return request >= 0 ? textureRequests[request].texture : Ref<Texture>(nullptr);
+    };
+
+    materials.clear();
+    for(size_t i = 0; i < materialsJSON.size(); i++){
+        const auto &material = materialsJSON[i];
+        const auto &extensions = material.contains("extensions") ? material["extensions"] : nlohmann::json::object();
+        Ref<Material> materialData = CreateRef<Material>(this->defaultShader);
+        materialData->SetParameterMap(Constants::ShaderStandard::diffuseMapName, getTexture(materialsMaps[i].diffuse));
+        materialData->SetParameterMap(Constants::ShaderStandard::normalMapName, getTexture(materialsMaps[i].normal));
+        materialData->SetParameterMap(Constants::ShaderStandard::specularMapName, getTexture(materialsMaps[i].specular));
+        { // Diffuse uniform or base color (albedo)
+            glm::vec4 diffuse(1.0f);
+            if(material.contains("pbrMetallicRoughness") && material["pbrMetallicRoughness"].contains("baseColorFactor")){
+                auto factor = material["pbrMetallicRoughness"]["baseColorFactor"].get<std::vector<float>>();
+                diffuse = glm::vec4(factor.at(0), factor.at(1), factor.at(2), factor.at(3));
+            }
+            materialData->SetParameterVector4(Constants::ShaderStandard::diffuseUniformName, diffuse);
+        }
+        { // Specular uniform. Same values Assimp reads for glTF specular extensions
+            glm::vec3 specularColor(0.0f);
+            float specularFactor = 1.0f;
+            if(extensions.contains("KHR_materials_pbrSpecularGlossiness")){
+                auto factor = extensions["KHR_materials_pbrSpecularGlossiness"].value("specularFactor", std::vector<float>{1.0f, 1.0f, 1.0f});
+                specularColor = glm::vec3(factor.at(0), factor.at(1), factor.at(2));
+            } else if(extensions.contains("KHR_materials_specular")){
+                const auto &specular = extensions["KHR_materials_specular"];
+                auto factor = specular.value("specularColorFactor", std::vector<float>{1.0f, 1.0f, 1.0f});
+                specularColor = glm::vec3(factor.at(0), factor.at(1), factor.at(2));
+                specularFactor = specular.value("specularFactor", 1.0f);
+            }
+            materialData->SetParameterVector4(Constants::ShaderStandard::specularUniformName,
+            specularFactor*glm::vec4(specularColor.r, specularColor.g, specularColor.b, specularColor.b));
+        }
+        materialData->SetFlag(Constants::ShaderStandard::lightingName, useLighting);
+        { // Alpha mode. Cutoff of masked materials is the glTF default
+            std::string alphaMode = material.value("alphaMode", std::string("OPAQUE"));
+            materialData->SetFlag(Constants::ShaderStandard::alphaMaskName, alphaMode == "MASK");
+            materialData->SetFlag(Constants::ShaderStandard::transparentName, alphaMode == "BLEND");
+        }
+        materials.push_back(materialData);
+    }
+    // Default material for primitives without one
+    Ref<Material> defaultMaterial = CreateRef<Material>(this->defaultShader);
+    defaultMaterial->SetParameterMap(Constants::ShaderStandard::diffuseMapName, Ref<Texture>(nullptr));
+    defaultMaterial->SetParameterMap(Constants::ShaderStandard::normalMapName, Ref<Texture>(nullptr));
+    defaultMaterial->SetParameterMap(Constants::ShaderStandard::specularMapName, Ref<Texture>(nullptr));
+    defaultMaterial->SetParameterVector4(Constants::ShaderStandard::diffuseUniformName, glm::vec4(1.0f));
+    defaultMaterial->SetParameterVector4(Constants::ShaderStandard::specularUniformName, glm::vec4(0.0f));
+    defaultMaterial->SetFlag(Constants::ShaderStandard::lightingName, useLighting);
+    materials.push_back(defaultMaterial);
+}
+
+// Decomposition as aiMatrix4x4::Decompose
+static void DecomposeTransform(const glm::mat4 &transform, glm::vec3 &position, glm::quat &rotation, glm::vec3 &scaling)
+{
+    position = glm::vec3(transform[3]);
+    scaling = glm::vec3(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+    glm::length(glm::vec3(transform[2])));
+    if(glm::determinant(transform) < 0.0f)
+        scaling = -scaling;
+    glm::mat3 rotationMatrix = glm::mat3(glm::vec3(transform[0]) / scaling.x, glm::vec3(transform[1]) / scaling.y,
+    glm::vec3(transform[2]) / scaling.z);
+    rotation = glm::quat_cast(rotationMatrix);
+}
+
+void GLTFLoader::BuildSkeleton(const std::vector<int> &rootNodes)
+{
+    const auto &nodes = document["nodes"];
+    skeleton = CreateRef<Skeleton>();
+    // Poses are evaluated in glTF space and mirrored as meshes
+    skeleton->SetMirrorZ(true);
+    skeletonNodes = std::vector<int>(nodes.size(), -1);
+    // Depth first traversal, so parents are added before children. Pairs of node and parent in skeleton
+    std::vector<std::pair<int, int>> stack;
+    for(auto root = rootNodes.rbegin(); root != rootNodes.rend(); root++)
+        stack.emplace_back(*root, -1);
+    while(!stack.empty()){
+        auto [nodeIndex, parent] = stack.back();
+        stack.pop_back();
+        if(nodeIndex < 0 || nodeIndex >= static_cast<int>(nodes.size()) || skeletonNodes[nodeIndex] >= 0)
+            continue;
+        const auto &node = nodes[nodeIndex];
+        SkeletonNode skeletonNode;
+        skeletonNode.name = node.value("name", std::string());
+        skeletonNode.parent = parent;
+        if(node.contains("matrix")){
+            auto matrix = node["matrix"].get<std::vector<float>>();
+            if(matrix.size() == 16)
+                DecomposeTransform(glm::make_mat4(matrix.data()), skeletonNode.translation, skeletonNode.rotation, skeletonNode.scale);
+        } else {
+            auto translation = node.value("translation", std::vector<float>{0.0f, 0.0f, 0.0f});
+            auto rotation = node.value("rotation", std::vector<float>{0.0f, 0.0f, 0.0f, 1.0f});
+            auto scaling = node.value("scale", std::vector<float>{1.0f, 1.0f, 1.0f});
+            skeletonNode.translation = glm::make_vec3(translation.data());
+            skeletonNode.rotation = glm::quat(rotation.at(3), rotation.at(0), rotation.at(1), rotation.at(2));
+            skeletonNode.scale = glm::make_vec3(scaling.data());
+        }
+        // Node weights override the ones of its mesh
+        if(node.contains("weights")){
+            skeletonNode.morphWeights = node["weights"].get<std::vector<float>>();
+        } else if(node.contains("mesh")){
+            const auto &mesh = document["meshes"].at(node["mesh"].get<int>());
+            if(mesh.contains("weights"))
+                skeletonNode.morphWeights = mesh["weights"].get<std::vector<float>>();
+        }
+        skeletonNodes[nodeIndex] = skeleton->AddNode(skeletonNode);
+        if(node.contains("children")){
+            const auto &children = node["children"];
+            for(auto child = children.rbegin(); child != children.rend(); child++)
+                stack.emplace_back(child->get<int>(), skeletonNodes[nodeIndex]);
+        }
+    }
+}
+
+void GLTFLoader::ProcessSkins()
+{
+    if(!document.contains("skins"))
+        return;
+    for(const auto &skinJSON : document["skins"]){
+        Ref<Skin> skin = CreateRef<Skin>();
+        bool supported = true;
+        for(const auto &joint : skinJSON.at("joints")){
+            int node = joint.get<int>();
+            int skeletonNode = node >= 0 && node < static_cast<int>(skeletonNodes.size()) ? skeletonNodes[node] : -1;
+            supported = supported && skeletonNode >= 0;
+            skin->joints.push_back(skeletonNode);
+        }
+        skin->inverseBindMatrices = std::vector<glm::mat4>(skin->joints.size(), glm::mat4(1.0f));
+        AccessorView view;
+        if(skinJSON.contains("inverseBindMatrices") && GetAccessorView(skinJSON["inverseBindMatrices"].get<int>(), view)
+        && view.componentsCount == 16 && view.count >= skin->joints.size()){
+            std::vector<float> values;
+            ReadAccessorFloat(view, 16, values);
+            for(size_t i = 0; i < skin->joints.size(); i++)
+                skin->inverseBindMatrices[i] = glm::make_mat4(&values[16 * i]); // Column major as glm
+        }
+        // Joints indices of vertices are stored in 8 bits
+        if(skin->joints.size() > 256 || !supported){
+            std::cout << "Skin with more than 256 joints or joints outside scene is not supported - Using bind pose\n";
+            skin = Ref<Skin>(nullptr);
+        }
+        skins.push_back(skin);
+    }
+}
+
+void GLTFLoader::ProcessAnimations()
+{
+    if(!document.contains("animations"))
+        return;
+    for(const auto &animation : document["animations"]){
+        AnimationClip clip;
+        clip.name = animation.value("name", std::string());
+        const auto &samplers = animation.at("samplers");
+        for(const auto &channelJSON : animation.at("channels")){
+            const auto &target = channelJSON.at("target");
+            if(!target.contains("node"))
+                continue;
+            int node = target["node"].get<int>();
+            if(node < 0 || node >= static_cast<int>(skeletonNodes.size()) || skeletonNodes[node] < 0)
+                continue;
+            AnimationChannel channel;
+            channel.node = skeletonNodes[node];
+            std::string path = target.at("path").get<std::string>();
+            if(path == "translation")
+                channel.path = AnimationPath::Translation;
+            else if(path == "rotation")
+                channel.path = AnimationPath::Rotation;
+            else if(path == "scale")
+                channel.path = AnimationPath::Scale;
+            else if(path == "weights")
+                channel.path = AnimationPath::MorphWeights;
+            else
+                continue;
+            const auto &sampler = samplers.at(channelJSON.at("sampler").get<int>());
+            std::string interpolation = sampler.value("interpolation", std::string("LINEAR"));
+            channel.interpolation = interpolation == "STEP" ? AnimationInterpolation::Step : AnimationInterpolation::Linear;
+            AccessorView inputView;
+            AccessorView outputView;
+            if(!GetAccessorView(sampler.at("input").get<int>(), inputView) || !GetAccessorView(sampler.at("output").get<int>(), outputView)
+            || inputView.count == 0)
+                continue;
+            ReadAccessorFloat(inputView, 1, channel.times);
+            std::vector<float> values;
+            ReadAccessorFloat(outputView, outputView.componentsCount, values);
+            // Cubic spline keys have in tangent, value and out tangent. Only values are kept, interpolated linearly
+            size_t elements = interpolation == "CUBICSPLINE" ? 3 : 1;
+            size_t keysCount = channel.times.size();
+            size_t valuesCount = values.size() / (keysCount * elements);
+            if(valuesCount == 0)
+                continue;
+            channel.values.resize(keysCount * valuesCount);
+            for(size_t k = 0; k < keysCount; k++){
+                const float *value = &values[(k * elements + elements / 2) * valuesCount];
+                std::copy(value, value + valuesCount, &channel.values[k * valuesCount]);
+            }
+            clip.duration = std::max(clip.duration, channel.times.back());
+            clip.channels.push_back(std::move(channel));
+        }
+        skeleton->AddClip(std::move(clip));
+    }
+}
+
+void GLTFLoader::ProcessNode(int nodeIndex, const glm::mat4 &parentTransform, std::vector<bool> &visited)
+{
+    const auto &nodes = document.at("nodes");
+    if(nodeIndex < 0 || nodeIndex >= static_cast<int>(nodes.size()) || visited[nodeIndex])
+        return;
+    visited[nodeIndex] = true;
+    const auto &node = nodes[nodeIndex];
+
+    glm::mat4 localTransform(1.0f);
+    if(node.contains("matrix")){
+        auto matrix = node["matrix"].get<std::vector<float>>();
+        if(matrix.size() == 16)
+            localTransform = glm::make_mat4(matrix.data()); // Column major as glm
+    } else {
+        auto translation = node.value("translation", std::vector<float>{0.0f, 0.0f, 0.0f});
+        auto rotation = node.value("rotation", std::vector<float>{0.0f, 0.0f, 0.0f, 1.0f});
+        auto scaling = node.value("scale", std::vector<float>{1.0f, 1.0f, 1.0f});
+        localTransform = glm::translate(glm::mat4(1.0f), glm::make_vec3(translation.data()))
+        * glm::mat4_cast(glm::quat(rotation.at(3), rotation.at(0), rotation.at(1), rotation.at(2)))
+        * glm::scale(glm::mat4(1.0f), glm::make_vec3(scaling.data()));
+    }
+    glm::mat4 nodeTransform = parentTransform * localTransform;
+
+    if(node.contains("mesh")){
+        int meshIndex = node["mesh"].get<int>();
+        // Mirror Z axis, as aiProcess_MakeLeftHanded
+        glm::mat4 mirror = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, -1.0f));
+        glm::mat4 transformMatrix = mirror * nodeTransform * mirror;
+        glm::vec3 position;
+        glm::quat rotation;
+        glm::vec3 scaling;
+        DecomposeTransform(transformMatrix, position, rotation, scaling);
+        TransformComponent transform(position, rotation, scaling * this->scale);
+
+        if(meshIndex >= 0 && meshIndex < static_cast<int>(meshes.size())){
+            for(size_t i = 0; i < meshes[meshIndex].size(); i++){
+                if(!meshes[meshIndex][i])
+                    continue;
+                int materialIndex = primitivesMaterials[meshIndex][i];
+                if(materialIndex < 0 || materialIndex >= static_cast<int>(materials.size()) - 1)
+                    materialIndex = materials.size() - 1;
+                // Each object has its own material, as Model does with Assimp
+                MeshRendererComponent meshRenderer(meshes[meshIndex][i], CreateRef<Material>(*materials[materialIndex]));
+                // Skinned meshes keep node transform, as their palettes are relative to mesh node
+                if(animator && meshRenderer.mesh->IsDeformable()){
+                    meshRenderer.animator = animator;
+                    meshRenderer.animatorNode = skeletonNodes[nodeIndex];
+                    int skinIndex = node.value("skin", -1);
+                    if(skinIndex >= 0 && skinIndex < static_cast<int>(skins.size()) && meshRenderer.mesh->IsSkinned())
+                        meshRenderer.skin = skins[skinIndex];
+                }
+                components.emplace_back(std::move(meshRenderer), transform);
+            }
+        }
+    }
+    if(node.contains("children")){
+        for(const auto &child : node["children"])
+            ProcessNode(child.get<int>(), nodeTransform, visited);
+    }
+}
+
+bool GLTFLoader::Load(const std::string &path, Ref<ShaderStandard> defaultShader, bool useLighting, bool flipUVs, float scale,
+bool compressVertices)
+{
+    this->defaultShader = defaultShader;
+    this->useLighting = useLighting;
+    this->flipUVs = flipUVs;
+    this->scale = scale;
+    this->compressVertices = compressVertices;
+    directory = path.substr(0, path.find_last_of('/'));
+    try{
+        if(!ParseFile(path))
+            return false;
+        // Extensions changing geometry storage are left to Assimp
+        if(document.contains("extensionsRequired")){
+            for(const auto &extension : document["extensionsRequired"]){
+                std::string name = extension.get<std::string>();
+                if(name != "KHR_materials_pbrSpecularGlossiness" && name != "KHR_materials_specular" && name != "KHR_mesh_quantization")
+                    return false;
+            }
+        }
+        if(document.contains("accessors")){
+            for(const auto &accessor : document["accessors"]){
+                if(accessor.contains("sparse") || !accessor.contains("bufferView"))
+                    return false;
+            }
+        }
+        if(!LoadBuffers() || !document.contains("meshes") || !document.contains("nodes"))
+            return false;
+
+        // Meshes primitives are independent, so they are processed in parallel
+        const auto &meshesJSON = document["meshes"];
+        std::vector<std::pair<int, int>> primitivesIndices;
+        meshes = std::vector<std::vector<Ref<Mesh>>>(meshesJSON.size());
+        primitivesMaterials = std::vector<std::vector<int>>(meshesJSON.size());
+        bool hasMorphTargets = false;
+        for(size_t i = 0; i < meshesJSON.size(); i++){
+            const auto &primitives = meshesJSON[i].at("primitives");
+            meshes[i] = std::vector<Ref<Mesh>>(primitives.size());
+            for(size_t j = 0; j < primitives.size(); j++){
+                primitivesIndices.emplace_back(i, j);
+                primitivesMaterials[i].push_back(primitives[j].value("material", -1));
+                hasMorphTargets = hasMorphTargets || primitives[j].contains("targets");
+            }
+        }
+        tbb::parallel_for(size_t(0), primitivesIndices.size(), [&](size_t i){
+            auto [meshIndex, primitiveIndex] = primitivesIndices[i];
+            meshes[meshIndex][primitiveIndex] = ProcessPrimitive(meshesJSON[meshIndex]["primitives"][primitiveIndex]);
+            if(meshes[meshIndex][primitiveIndex] && meshesJSON[meshIndex].contains("weights"))
+                meshes[meshIndex][primitiveIndex]->SetMorphWeights(meshesJSON[meshIndex]["weights"].get<std::vector<float>>());
+        });
+        ProcessMaterials();
+
+        std::vector<bool> visited(document["nodes"].size(), false);
+        std::vector<int> rootNodes;
+        if(document.contains("scenes") && !document["scenes"].empty()){
+            const auto &scene = document["scenes"].at(document.value("scene", 0));
+            if(scene.contains("nodes"))
+                rootNodes = scene["nodes"].get<std::vector<int>>();
+        } else { // Without scenes, every node without parent is a root
+            std::vector<bool> isChild(document["nodes"].size(), false);
+            for(const auto &node : document["nodes"]){
+                if(node.contains("children")){
+                    for(const auto &child : node["children"])
+                        isChild.at(child.get<int>()) = true;
+                }
+            }
+            for(size_t i = 0; i < isChild.size(); i++){
+                if(!isChild[i])
+                    rootNodes.push_back(i);
+            }
+        }
+        // Skinned and morphed meshes are posed by an animator of the whole node hierarchy
+        if(document.contains("skins") || hasMorphTargets){
+            BuildSkeleton(rootNodes);
+            ProcessSkins();
+            ProcessAnimations();
+            animator = CreateRef<Animator>(skeleton);
+        }
+        for(int node : rootNodes)
+            ProcessNode(node, glm::mat4(1.0f), visited);
+    } catch(const std::exception &e){
+        std::cerr << "Erro ao carregar glTF: " << e.what() << std::endl;
+        components.clear();
+        return false;
+    }
+    return !components.empty();
+}
+
+std::vector<std::pair<MeshRendererComponent, TransformComponent>> &GLTFLoader::GetComponents()
+{
+    return components;
+}
@@ -0,0 +1,84 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+#include <nlohmann/json.hpp>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "MappedFile.hpp"
+#include "ShaderStandard.hpp"
+#include "Components.hpp"
+
+// Native glTF 2.0 (.gltf/.glb) loader. Buffers are memory mapped and accessors are read straight
+// into mesh attributes, converting only when accessor format differs from the one used by the renderer.
+// Output matches Model loading through Assimp (left handed, same attributes layout)
+class GLTFLoader{
+private:
+    struct BufferData{
+        Ref<MappedFile> file;
+        std::vector<unsigned char> decoded; // Used for data URIs
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+    };
+    struct AccessorView{
+        const unsigned char *data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int componentsCount = 0;
+        bool normalized = false;
+        Ref<MappedFile> file; // Mapped file of data, if any, so it can be referenced by meshes
+    };
+    // Texture loading requests are gathered first, so images are decoded in parallel
+    struct TextureRequest{
+        int image = -1;
+        bool isSRGB = false;
+        Ref<Texture> texture;
+    };
+    nlohmann::json document;
+    Ref<MappedFile> glbFile;
+    std::vector<BufferData> buffers;
+    std::string directory;
+    Ref<ShaderStandard> defaultShader;
+    bool useLighting = true;
+    bool flipUVs = false;
+    float scale = 1.0f;
+    bool compressVertices = false; // Quantized positions and octahedral normals or QTangents
+    std::vector<std::vector<Ref<Mesh>>> meshes; // Meshes of each primitive of each glTF mesh
+    std::vector<std::vector<int>> primitivesMaterials;
+    std::vector<Ref<Material>> materials; // Last one is the default material
+    std::vector<TextureRequest> textureRequests;
+    std::unordered_map<int, int> textureRequestsIndices; // Key: image index * 2 + sRGB
+    std::vector<std::pair<MeshRendererComponent, TransformComponent>> components;
+    // Node hierarchy of skinned or morphed models, with one animator shared by their components
+    Ref<Skeleton> skeleton;
+    Ref<Animator> animator;
+    std::vector<int> skeletonNodes; // Skeleton node of each glTF node, -1 when not in scene
+    std::vector<Ref<Skin>> skins; // Null for skins that are not supported
+
+    static std::string DecodeURI(const std::string &uri);
+    static bool DecodeBase64(const std::string &input, std::vector<unsigned char> &output);
+    static int ComponentSize(int componentType);
+    static int ComponentsCount(const std::string &type);
+    static float ReadComponentAsFloat(const unsigned char *data, int componentType, bool normalized);
+    bool ParseFile(const std::string &path);
+    bool LoadBuffers();
+    bool GetAccessorView(int accessorIndex, AccessorView &view) const;
+    // Reads any accessor to floats with componentsCount elements per entry
+    void ReadAccessorFloat(const AccessorView &view, int componentsCount, std::vector<float> &output) const;
+    bool ReadIndices(const nlohmann::json &primitive, size_t verticesCount, std::vector<unsigned int> &indices) const;
+    Ref<Mesh> ProcessPrimitive(const nlohmann::json &primitive) const;
+    // Joints, weights and morph targets of primitive. Returns false when they can't be used
+    bool ReadDeformation(const nlohmann::json &primitive, size_t verticesCount, Mesh &mesh) const;
+    void BuildSkeleton(const std::vector<int> &rootNodes);
+    void ProcessSkins();
+    void ProcessAnimations();
+    int RequestTexture(const nlohmann::json &textureInfo, bool isSRGB);
+    Ref<Texture> LoadImage(int imageIndex, bool isSRGB) const;
+    void ProcessMaterials();
+    void ProcessNode(int nodeIndex, const glm::mat4 &parentTransform, std::vector<bool> &visited);
+public:
+    bool Load(const std::string &path, Ref<ShaderStandard> defaultShader, bool useLighting = true,
+    bool flipUVs = false, float scale = 1.0f, bool compressVertices = false);
+    std::vector<std::pair<MeshRendererComponent, TransformComponent>> &GetComponents();
+};
+#endif
@@ -30,6 +30,8 @@ Material::Material(Ref<Shader> shader)
     for(const auto &materialFlag : materialFlags){
         flags.push_back(materialFlag);
     }
+    shaderVariantKey = this->shader->GetVariantKey();
+    UpdateVariantKey();
     // for(auto &&parameter : materialParameters){
     //     AddParameter(parameter.first, parameter.second);
     // }
@@ -79,6 +81,18 @@ void Material::AddGlobalParameter(const std::string &name, MaterialParameterType
         globalVertexShaderParameters[name] = globalParameter;
 }
 
+void Material::UpdateVariantKey(){
+    variantKey = shaderVariantKey;
+    for(auto &&parameter : parameters){
+        if(parameter.second.type == MaterialParameterType::Map && std::get<Ref<Texture>>(parameter.second.data))
+            variantKey.SetFeature(ShaderFeatureKind::Map, parameter.first);
+    }
+    for(auto &&flag : flags){
+        if(flag.second)
+            variantKey.SetFeature(ShaderFeatureKind::Flag, flag.first);
+    }
+}
+
 void Material::DeleteParameters(){
     parameters.clear();
 }
@@ -104,6 +118,7 @@ std::vector<std::pair<std::string, MaterialParameter>>::iterator Material::FindP
 void Material::SetParameterMap(const std::string &name, Ref<Texture> value)
 {
     SetParameter(name, value);
+    UpdateVariantKey();
 }
 
 void Material::SetParameterFloat(const std::string &name, float value)
@@ -128,6 +143,7 @@ void Material::SetFlag(const std::string &name, bool value){
     });
     if(flagsIt != flags.end())
         flagsIt->second = value;
+    UpdateVariantKey();
 }
 
 void Material::SetOnGlobalFloatChangeCallback(std::function<void(const std::string&, float)> callback){
@@ -214,6 +230,10 @@ const std::vector<std::pair<std::string, bool>> &Material::GetFlags(){
     return flags;
 }
 
+const ShaderVariantKey &Material::GetVariantKey() const{
+    return variantKey;
+}
+
 void Material::SetGlobalParameterMap(const std::string &name, Ref<Texture> value)
 {
     if(globalShaderParameters.count(name) > 0)
@@ -20,11 +20,15 @@ private:
     std::unordered_map<std::string, MaterialParameter> globalShaderParameters;
     std::unordered_map<std::string, MaterialParameter> globalVertexShaderParameters;
     Ref<Shader> shader;
+    // Variant of shader with activated maps and flags. Shader part is taken when material is created
+    ShaderVariantKey shaderVariantKey;
+    ShaderVariantKey variantKey;
     template <typename T>
     void SetParameter(const std::string &name, T value);
     void AddParameter(const std::string &name, const MaterialParameter &parameter);
     void AddGlobalParameter(const std::string &name, MaterialParameterType type, bool isFragOrVert);
     void DeleteParameters();
+    void UpdateVariantKey();
     MaterialParameterType GetParameterType(ShaderDataType type);
     std::vector<std::pair<std::string, MaterialParameter>>::iterator FindParameter(const std::string &name);
 public:
@@ -47,6 +51,7 @@ public:
     std::vector<std::pair<std::string, MaterialParameter>> GetMapParameters() const;
     std::vector<std::pair<std::string, MaterialParameter>> GetActivatedMapParameters() const;
     const std::vector<std::pair<std::string, bool>> &GetFlags();
+    const ShaderVariantKey &GetVariantKey() const;
     std::vector<std::pair<std::string, MaterialParameter>> GetFloatParameters() const;
     std::vector<std::pair<std::string, MaterialParameter>> GetBooleanParameters() const;
     std::vector<std::pair<std::string, MaterialParameter>> GetVector4Parameters() const;
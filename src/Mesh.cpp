@@ -1,17 +1,204 @@
 #include "Mesh.hpp"
 #include <numeric>
 #include <algorithm>
+#include <cstring>
+#include <new>
 // Mesh::~Mesh(){ 
 // }
 
-template <typename T>
-bool Mesh::PushAttributeBase(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized, 
-std::vector<T> &&data, bool interpretAsInt, MeshAttributeAlias alias){
-    std::div_t verticesDiv = std::div(data.size(), MeshAttribute::ScalarElementsCount(format));
-    if(verticesDiv.rem > 0 || (verticesCount > 0 && verticesCount != verticesDiv.quot)){
+void AttributeBuffer::AlignedDeleter::operator()(unsigned char *bytes) const{
+    ::operator delete(bytes, std::align_val_t(AttributeBuffer::alignment));
+}
+
+void AttributeBuffer::Reallocate(size_t newCapacity){
+    std::unique_ptr<unsigned char[], AlignedDeleter> newBytes(
+        static_cast<unsigned char*>(::operator new(std::max(newCapacity, size_t(1)), std::align_val_t(alignment))));
+    // Adopted buffers have no capacity, so they may be reallocated smaller than their size
+    size = std::min(size, newCapacity);
+    if(size > 0)
+        std::memcpy(newBytes.get(), bytes, size);
+    ownedBytes = std::move(newBytes);
+    externalOwner.reset();
+    bytes = ownedBytes.get();
+    capacity = newCapacity;
+}
+
+AttributeBuffer::AttributeBuffer(const AttributeBuffer &buffer){
+    *this = buffer;
+}
+
+AttributeBuffer::AttributeBuffer(AttributeBuffer &&buffer) noexcept{
+    *this = std::move(buffer);
+}
+
+AttributeBuffer &AttributeBuffer::operator=(const AttributeBuffer &buffer){
+    if(this == &buffer)
+        return *this;
+    if(buffer.IsAdopted()){ // Copies of adopted data reference the same external memory
+        ownedBytes.reset();
+        externalOwner = buffer.externalOwner;
+        bytes = buffer.bytes;
+        size = buffer.size;
+        capacity = 0;
+    } else {
+        Assign(buffer.bytes, buffer.size);
+    }
+    return *this;
+}
+
+AttributeBuffer &AttributeBuffer::operator=(AttributeBuffer &&buffer) noexcept{
+    ownedBytes = std::move(buffer.ownedBytes);
+    externalOwner = std::move(buffer.externalOwner);
+    bytes = buffer.bytes;
+    size = buffer.size;
+    capacity = buffer.capacity;
+    buffer.bytes = nullptr;
+    buffer.size = 0;
+    buffer.capacity = 0;
+    return *this;
+}
+
+void AttributeBuffer::Assign(const void *data, size_t dataSize){
+    if(IsAdopted() || dataSize > capacity){
+        externalOwner.reset();
+        bytes = nullptr;
+        size = 0;
+        Reallocate(dataSize);
+    }
+    if(dataSize > 0)
+        std::memcpy(ownedBytes.get(), data, dataSize);
+    size = dataSize;
+}
+
+void AttributeBuffer::Adopt(std::shared_ptr<const void> owner, const void *data, size_t dataSize){
+    ownedBytes.reset();
+    externalOwner = std::move(owner);
+    bytes = static_cast<const unsigned char*>(data);
+    size = dataSize;
+    capacity = 0;
+}
+
+void AttributeBuffer::Reserve(size_t newCapacity){
+    if(IsAdopted() || newCapacity > capacity)
+        Reallocate(std::max(newCapacity, size));
+}
+
+void AttributeBuffer::Resize(size_t newSize){
+    if(IsAdopted() || newSize > capacity)
+        Reallocate(std::max(newSize, capacity * 2));
+    size = newSize;
+}
+
+void AttributeBuffer::Append(const void *data, size_t dataSize){
+    if(dataSize == 0)
+        return;
+    size_t offset = size;
+    Resize(size + dataSize);
+    std::memcpy(ownedBytes.get() + offset, data, dataSize);
+}
+
+const unsigned char *AttributeBuffer::Data() const{
+    return bytes;
+}
+
+unsigned char *AttributeBuffer::MutableData(){
+    if(IsAdopted())
+        Reallocate(size);
+    return ownedBytes.get();
+}
+
+size_t AttributeBuffer::Size() const{
+    return size;
+}
+
+bool AttributeBuffer::IsAdopted() const{
+    return bytes != nullptr && bytes != ownedBytes.get();
+}
+
+void MeshAttributeData::Append(const MeshAttributeData &attributeData){
+    int attributeSize = attribute.AttributeDataSize();
+    if(attributeData.IsPacked()){
+        data.Append(attributeData.data.Data(), attributeData.dataSize);
+    } else {
+        size_t offset = data.Size();
+        data.Resize(offset + attributeData.dataSize);
+        unsigned char *destination = data.MutableData() + offset;
+        const unsigned char *source = attributeData.data.Data();
+        for(size_t i = 0, count = attributeData.VerticesCount(); i < count; i++)
+            std::memcpy(destination + i * attributeSize, source + i * attributeData.stride, attributeSize);
+    }
+    dataSize += attributeData.dataSize;
+    stride = attributeSize;
+}
+
+bool MeshAttributeData::HasSameData(const MeshAttributeData &attributeData) const{
+    int attributeSize = attribute.AttributeDataSize();
+    if(dataSize != attributeData.dataSize || attributeSize != attributeData.attribute.AttributeDataSize())
         return false;
-    } else if(verticesCount == 0){
-        verticesCount = verticesDiv.quot;
+    if(IsPacked() && attributeData.IsPacked())
+        return dataSize == 0 || std::memcmp(data.Data(), attributeData.data.Data(), dataSize) == 0;
+    for(size_t i = 0, count = VerticesCount(); i < count; i++){
+        if(std::memcmp(data.Data() + i * stride, attributeData.data.Data() + i * attributeData.stride, attributeSize) != 0)
+            return false;
+    }
+    return true;
+}
+
+void DirtyRanges::Mark(size_t first, size_t count){
+    if(count == 0)
+        return;
+    Range range{first, first + count};
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), range, [](const Range &a, const Range &b){
+        return a.first < b.first;
+    });
+    it = ranges.insert(it, range);
+    // Merges with touching neighbours
+    if(it != ranges.begin() && std::prev(it)->end >= it->first){
+        auto previous = std::prev(it);
+        previous->end = std::max(previous->end, it->end);
+        it = std::prev(ranges.erase(it));
+    }
+    auto next = std::next(it);
+    while(next != ranges.end() && next->first <= it->end){
+        it->end = std::max(it->end, next->end);
+        next = ranges.erase(next);
+    }
+    while(ranges.size() > maxRanges){
+        size_t smallestGap = 0;
+        for(size_t i = 1; i + 1 < ranges.size(); i++){
+            if(ranges[i + 1].first - ranges[i].end < ranges[smallestGap + 1].first - ranges[smallestGap].end)
+                smallestGap = i;
+        }
+        ranges[smallestGap].end = ranges[smallestGap + 1].end;
+        ranges.erase(ranges.begin() + smallestGap + 1);
+    }
+}
+
+void DirtyRanges::Clear(){
+    ranges.clear();
+}
+
+bool DirtyRanges::IsEmpty() const{
+    return ranges.empty();
+}
+
+size_t DirtyRanges::ElementsCount() const{
+    size_t count = 0;
+    for(auto &&range : ranges)
+        count += range.end - range.first;
+    return count;
+}
+
+const std::vector<DirtyRanges::Range> &DirtyRanges::GetRanges() const{
+    return ranges;
+}
+
+bool Mesh::PushAttributeData(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized,
+AttributeBuffer &&data, size_t verticesCount, size_t stride, bool interpretAsInt, MeshAttributeAlias alias){
+    if(this->verticesCount > 0 && static_cast<size_t>(this->verticesCount) != verticesCount){
+        return false;
+    } else if(this->verticesCount == 0){
+        this->verticesCount = verticesCount;
     }
     MeshAttribute meshAttribute;
     meshAttribute.name = name;
@@ -20,16 +207,47 @@ std::vector<T> &&data, bool interpretAsInt, MeshAttributeAlias alias){
     meshAttribute.normalized = normalized;
     meshAttribute.interpretAsInt = interpretAsInt;
     meshAttribute.alias = alias;
-    int totalDataSize = MeshAttribute::AttributeDataSize(type, format)*verticesCount;
-    attributesData.emplace_back(std::move(data), totalDataSize, meshAttribute);
+    int totalDataSize = MeshAttribute::AttributeDataSize(type, format)*this->verticesCount;
+    attributesData.emplace_back(std::move(data), totalDataSize, static_cast<int>(stride), meshAttribute);
     layout.attributes.push_back(meshAttribute);
     return true;
 }
 
+// Moved vectors are adopted, so loaders output is not copied again
+template <typename T>
+bool Mesh::PushAttributeBase(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized, 
+std::vector<T> &&data, bool interpretAsInt, MeshAttributeAlias alias){
+    std::div_t verticesDiv = std::div(data.size(), MeshAttribute::ScalarElementsCount(format));
+    if(verticesDiv.rem > 0)
+        return false;
+    auto owner = std::make_shared<std::vector<T>>(std::move(data));
+    AttributeBuffer buffer;
+    buffer.Adopt(owner, owner->data(), owner->size() * sizeof(T));
+    return PushAttributeData(name, format, type, normalized, std::move(buffer), verticesDiv.quot,
+    MeshAttribute::AttributeDataSize(type, format), interpretAsInt, alias);
+}
+
 template <typename T>
 bool Mesh::PushAttributeBase(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized, 
 const std::vector<T> &data, bool interpretAsInt, MeshAttributeAlias alias){
-    return PushAttributeBase(name, format, type, normalized, std::vector<T>(data), interpretAsInt, alias);
+    std::div_t verticesDiv = std::div(data.size(), MeshAttribute::ScalarElementsCount(format));
+    if(verticesDiv.rem > 0)
+        return false;
+    AttributeBuffer buffer;
+    buffer.Assign(data.data(), data.size() * sizeof(T));
+    return PushAttributeData(name, format, type, normalized, std::move(buffer), verticesDiv.quot,
+    MeshAttribute::AttributeDataSize(type, format), interpretAsInt, alias);
+}
+
+bool Mesh::AdoptAttribute(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized,
+std::shared_ptr<const void> owner, const void *data, size_t verticesCount, size_t stride, bool interpretAsInt,
+MeshAttributeAlias alias){
+    size_t attributeSize = MeshAttribute::AttributeDataSize(type, format);
+    if(CheckIfAliasExists(alias) || attributeSize == 0 || stride < attributeSize || (data == nullptr && verticesCount > 0))
+        return false;
+    AttributeBuffer buffer;
+    buffer.Adopt(std::move(owner), data, verticesCount > 0 ? stride * (verticesCount - 1) + attributeSize : 0);
+    return PushAttributeData(name, format, type, normalized, std::move(buffer), verticesCount, stride, interpretAsInt, alias);
 }
 
 bool Mesh::CheckIfAliasExists(MeshAttributeAlias alias)
@@ -51,6 +269,8 @@ void Mesh::SetIndices(const std::vector<unsigned short> &indices, MeshTopology t
 void Mesh::SetIndices(std::vector<unsigned short> &&indices, MeshTopology topology){
     this->indicesData = MeshIndexData(std::move(indices), sizeof(unsigned short)*indices.size(), MeshIndexType::UnsignedShort);
     this->topology = topology;
+    this->meshlets.clear();
+    dirtyIndices.Mark(0, GetIndicesCount());
 }
 
 void Mesh::SetIndices(const std::vector<unsigned int> &indices, MeshTopology topology){
@@ -60,6 +280,8 @@ void Mesh::SetIndices(const std::vector<unsigned int> &indices, MeshTopology top
 void Mesh::SetIndices(std::vector<unsigned int> &&indices, MeshTopology topology){
     this->indicesData = MeshIndexData(std::move(indices), sizeof(unsigned int)*indices.size(), MeshIndexType::UnsignedInt);
     this->topology = topology;
+    this->meshlets.clear();
+    dirtyIndices.Mark(0, GetIndicesCount());
 }
 
 bool Mesh::PushAttribute(const std::string &name, MeshAttributeFormat format, bool normalized, const std::vector<float> &data, bool interpretAsInt, MeshAttributeAlias alias){
@@ -148,6 +370,17 @@ bool Mesh::PushAttribute(const std::string &name, MeshAttributeFormat format, bo
 bool Mesh::PushAttributePosition(const std::vector<float> &positions){
     return PushAttribute("position", MeshAttributeFormat::Vec3, false, positions, false, MeshAttributeAlias::Position);
 }
+bool Mesh::PushAttributePosition(const std::vector<unsigned short> &positions, const glm::vec3 &offset, const glm::vec3 &scale){
+    if(!PushAttribute("position", MeshAttributeFormat::Vec4, true, positions, false, MeshAttributeAlias::Position))
+        return false;
+    positionDequantization = glm::mat4(
+        glm::vec4(scale.x, 0.0f, 0.0f, 0.0f),
+        glm::vec4(0.0f, scale.y, 0.0f, 0.0f),
+        glm::vec4(0.0f, 0.0f, scale.z, 0.0f),
+        glm::vec4(offset, 1.0f));
+    quantizedPositions = true;
+    return true;
+}
 bool Mesh::PushAttributeTexCoord0(const std::vector<float> &texCoords0){
     return PushAttribute("texCoord0", MeshAttributeFormat::Vec2, false, texCoords0, false, MeshAttributeAlias::TexCoord0);
 }
@@ -202,6 +435,9 @@ bool Mesh::PushAttributeNormal(const std::vector<float> &normals){
 bool Mesh::PushAttributeNormal(const std::vector<short> &normals){
     return PushAttribute("normal", MeshAttributeFormat::Vec3, true, normals, false, MeshAttributeAlias::Normal);
 }
+bool Mesh::PushAttributeNormalOctahedral(const std::vector<short> &normals){
+    return PushAttribute("normal", MeshAttributeFormat::Vec2, true, normals, false, MeshAttributeAlias::Normal);
+}
 bool Mesh::PushAttributeTangent(const std::vector<float> &tangents){
     return PushAttribute("tangent", MeshAttributeFormat::Vec3, false, tangents, false, MeshAttributeAlias::Tangent);
 }
@@ -217,6 +453,325 @@ bool Mesh::PushAttributeBitangent(const std::vector<short> &bitangents){
 bool Mesh::PushAttributeColor(const std::vector<unsigned char> &colors){
     return PushAttribute("color", MeshAttributeFormat::Vec4, true, colors, false, MeshAttributeAlias::Color);
 }
+bool Mesh::PushAttributeQTangent(const std::vector<short> &qTangents){
+    return PushAttribute("qTangent", MeshAttributeFormat::Vec4, true, qTangents, false, MeshAttributeAlias::QTangent);
+}
+void Mesh::RemapVertices(const std::vector<unsigned int> &remap, int newVerticesCount){
+    for(auto &&attributeData : attributesData){
+        size_t attributeSize = attributeData.attribute.AttributeDataSize();
+        AttributeBuffer remapped;
+        remapped.Resize(static_cast<size_t>(newVerticesCount) * attributeSize);
+        unsigned char *destination = remapped.MutableData();
+        std::memset(destination, 0, remapped.Size());
+        const unsigned char *source = attributeData.data.Data();
+        for(size_t i = 0; i < remap.size(); i++){
+            if(remap[i] == ~0u)
+                continue;
+            std::memcpy(destination + static_cast<size_t>(remap[i]) * attributeSize, source + i * attributeData.stride, attributeSize);
+        }
+        attributeData.data = std::move(remapped);
+        attributeData.dataSize = attributeSize * newVerticesCount;
+        attributeData.stride = attributeSize;
+    }
+    auto remapValues = [&remap, newVerticesCount](auto &values){
+        if(values.empty())
+            return;
+        std::decay_t<decltype(values)> remapped(newVerticesCount);
+        for(size_t i = 0; i < remap.size(); i++){
+            if(remap[i] != ~0u)
+                remapped[remap[i]] = values[i];
+        }
+        values = std::move(remapped);
+    };
+    remapValues(skinJoints);
+    remapValues(skinWeights);
+    for(auto &&target : morphTargets){
+        remapValues(target.positionDeltas);
+        remapValues(target.normalDeltas);
+    }
+    for(auto &&lod : lods){
+        std::visit([&remap](auto &&indices){
+            for(auto &index : indices)
+                index = remap[index];
+        }, lod.indicesData.indices);
+    }
+    verticesCount = newVerticesCount;
+    dirtyVertices.Mark(0, verticesCount);
+}
+
+void Mesh::PromoteIndices(){
+    auto promote = [](MeshIndexData &data){
+        if(data.type != MeshIndexType::UnsignedShort)
+            return;
+        const auto &shortIndices = std::get<std::vector<unsigned short>>(data.indices);
+        std::vector<unsigned int> intIndices(shortIndices.begin(), shortIndices.end());
+        int indicesSize = sizeof(unsigned int)*intIndices.size();
+        data = MeshIndexData(std::move(intIndices), indicesSize, MeshIndexType::UnsignedInt);
+    };
+    promote(indicesData);
+    for(auto &&lod : lods)
+        promote(lod.indicesData);
+}
+
+std::shared_ptr<Mesh> Mesh::ExtractSubmesh(const unsigned int *indices, size_t indicesCount) const{
+    std::vector<unsigned int> remap(verticesCount, ~0u);
+    std::vector<unsigned int> vertices; // Source vertex of each submesh vertex
+    std::vector<unsigned int> submeshIndices(indicesCount);
+    for(size_t i = 0; i < indicesCount; i++){
+        unsigned int vertex = indices[i];
+        if(remap[vertex] == ~0u){
+            remap[vertex] = vertices.size();
+            vertices.push_back(vertex);
+        }
+        submeshIndices[i] = remap[vertex];
+    }
+    auto submesh = std::make_shared<Mesh>();
+    for(auto &&attributeData : attributesData){
+        const MeshAttribute &attribute = attributeData.attribute;
+        size_t attributeSize = attribute.AttributeDataSize();
+        AttributeBuffer buffer;
+        buffer.Resize(vertices.size() * attributeSize);
+        unsigned char *destination = buffer.MutableData();
+        for(size_t i = 0; i < vertices.size(); i++)
+            std::memcpy(destination + i * attributeSize, attributeData.data.Data() + vertices[i] * attributeData.stride, attributeSize);
+        submesh->PushAttributeData(attribute.name, attribute.format, attribute.type, attribute.normalized, std::move(buffer),
+        vertices.size(), attributeSize, attribute.interpretAsInt, attribute.alias);
+    }
+    if(vertices.size() <= 65536)
+        submesh->SetIndices(std::vector<unsigned short>(submeshIndices.begin(), submeshIndices.end()), topology);
+    else
+        submesh->SetIndices(std::move(submeshIndices), topology);
+    auto gatherValues = [&vertices](const auto &values){
+        std::decay_t<decltype(values)> gathered;
+        if(values.empty())
+            return gathered;
+        gathered.reserve(vertices.size());
+        for(unsigned int vertex : vertices)
+            gathered.push_back(values[vertex]);
+        return gathered;
+    };
+    submesh->skinJoints = gatherValues(skinJoints);
+    submesh->skinWeights = gatherValues(skinWeights);
+    for(auto &&target : morphTargets)
+        submesh->morphTargets.push_back(MorphTarget{gatherValues(target.positionDeltas), gatherValues(target.normalDeltas)});
+    submesh->morphWeights = morphWeights;
+    submesh->positionDequantization = positionDequantization;
+    submesh->quantizedPositions = quantizedPositions;
+    submesh->boundingSphere = boundingSphere; // Conservative
+    return submesh;
+}
+
+// Writes one value of a padded attribute. Colors are white, other attributes zero
+static void WriteDefaultAttributeValue(const MeshAttribute &attribute, unsigned char *value){
+    int elements = attribute.ScalarElementsCount();
+    int componentSize = attribute.AttributeDataSize() / elements;
+    for(int c = 0; c < elements; c++){
+        bool one = attribute.alias == MeshAttributeAlias::Color;
+        unsigned char *component = value + c * componentSize;
+        std::memset(component, 0, componentSize);
+        if(!one)
+            continue;
+        switch(attribute.type){
+            case MeshAttributeType::Float:{ float v = 1.0f; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::Int:{ int v = attribute.normalized ? 2147483647 : 1; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::UnsignedInt:{ unsigned int v = attribute.normalized ? 4294967295u : 1u; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::Byte:{ char v = attribute.normalized ? 127 : 1; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::UnsignedByte:{ unsigned char v = attribute.normalized ? 255 : 1; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::Short:{ short v = attribute.normalized ? 32767 : 1; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::UnsignedShort:{ unsigned short v = attribute.normalized ? 65535 : 1; std::memcpy(component, &v, sizeof(v)); break; }
+            case MeshAttributeType::None: break;
+        }
+    }
+}
+
+bool Mesh::ConformToLayout(const MeshLayout &targetLayout){
+    auto findAttribute = [this](MeshAttributeAlias alias){
+        return std::find_if(attributesData.begin(), attributesData.end(), [alias](const MeshAttributeData &attributeData){
+            return attributeData.attribute.alias == alias;
+        });
+    };
+    size_t matchedCount = 0;
+    for(auto &&attribute : targetLayout.attributes){
+        if(attribute.alias == MeshAttributeAlias::None)
+            return false;
+        auto it = findAttribute(attribute.alias);
+        if(it == attributesData.end())
+            continue;
+        if(!(it->attribute == attribute))
+            return false;
+        matchedCount++;
+    }
+    if(matchedCount != attributesData.size())
+        return false;
+    std::vector<MeshAttributeData> conformed;
+    conformed.reserve(targetLayout.attributes.size());
+    for(auto &&attribute : targetLayout.attributes){
+        auto it = findAttribute(attribute.alias);
+        if(it != attributesData.end()){
+            conformed.push_back(std::move(*it));
+            continue;
+        }
+        size_t attributeSize = attribute.AttributeDataSize();
+        AttributeBuffer buffer;
+        buffer.Resize(verticesCount * attributeSize);
+        unsigned char *values = buffer.MutableData();
+        if(verticesCount > 0){
+            WriteDefaultAttributeValue(attribute, values);
+            for(int v = 1; v < verticesCount; v++)
+                std::memcpy(values + v * attributeSize, values, attributeSize);
+        }
+        conformed.emplace_back(std::move(buffer), attributeSize * verticesCount, attributeSize, attribute);
+    }
+    attributesData = std::move(conformed);
+    layout.attributes.clear();
+    for(auto &&attributeData : attributesData)
+        layout.attributes.push_back(attributeData.attribute);
+    return true;
+}
+
+bool Mesh::UpdateAttribute(int attributeIndex, int firstVertex, const void *data, int count){
+    if(attributeIndex < 0 || attributeIndex >= static_cast<int>(attributesData.size()) || firstVertex < 0 || count < 0 ||
+    firstVertex + count > verticesCount)
+        return false;
+    size_t attributeSize = attributesData[attributeIndex].attribute.AttributeDataSize();
+    std::memcpy(GetMutableAttributeData(attributeIndex) + static_cast<size_t>(firstVertex) * attributeSize, data,
+    static_cast<size_t>(count) * attributeSize);
+    dirtyVertices.Mark(firstVertex, count);
+    return true;
+}
+
+unsigned char *Mesh::GetMutableAttributeData(int attributeIndex){
+    MeshAttributeData &attributeData = attributesData[attributeIndex];
+    if(!attributeData.IsPacked()){
+        MeshAttributeData packed;
+        packed.attribute = attributeData.attribute;
+        packed.Append(attributeData);
+        attributeData = std::move(packed);
+    }
+    return attributeData.data.MutableData();
+}
+
+void Mesh::ResizeVertices(int newVerticesCount){
+    if(newVerticesCount < 0 || newVerticesCount == verticesCount)
+        return;
+    for(int i = 0; i < static_cast<int>(attributesData.size()); i++){
+        GetMutableAttributeData(i);
+        MeshAttributeData &attributeData = attributesData[i];
+        size_t attributeSize = attributeData.attribute.AttributeDataSize();
+        size_t oldSize = attributeData.data.Size();
+        attributeData.data.Resize(static_cast<size_t>(newVerticesCount) * attributeSize);
+        if(attributeData.data.Size() > oldSize)
+            std::memset(attributeData.data.MutableData() + oldSize, 0, attributeData.data.Size() - oldSize);
+        attributeData.dataSize = static_cast<int>(attributeData.data.Size());
+    }
+    // New vertices follow first joint, without morph offsets
+    if(!skinJoints.empty()){
+        skinJoints.resize(newVerticesCount, glm::u8vec4(0));
+        skinWeights.resize(newVerticesCount, glm::u8vec4(255, 0, 0, 0));
+    }
+    for(auto &&target : morphTargets){
+        target.positionDeltas.resize(newVerticesCount, glm::vec3(0.0f));
+        if(!target.normalDeltas.empty())
+            target.normalDeltas.resize(newVerticesCount, glm::vec3(0.0f));
+    }
+    if(newVerticesCount > verticesCount)
+        dirtyVertices.Mark(verticesCount, newVerticesCount - verticesCount);
+    verticesCount = newVerticesCount;
+}
+
+bool Mesh::UpdateIndices(unsigned int firstIndex, const unsigned int *indices, size_t count){
+    if(indicesData.type == MeshIndexType::UnsignedShort &&
+    std::any_of(indices, indices + count, [](unsigned int index){ return index > 0xFFFF; }))
+        return false;
+    if(indicesData.type == MeshIndexType::None){
+        indicesData.indices = std::vector<unsigned int>();
+        indicesData.type = MeshIndexType::UnsignedInt;
+    }
+    if(firstIndex + count > GetIndicesCount())
+        ResizeIndices(firstIndex + count);
+    std::visit([&](auto &&meshIndices){
+        std::copy(indices, indices + count, meshIndices.begin() + firstIndex);
+    }, indicesData.indices);
+    meshlets.clear();
+    dirtyIndices.Mark(firstIndex, count);
+    return true;
+}
+
+void Mesh::ResizeIndices(unsigned int newIndicesCount){
+    if(indicesData.type == MeshIndexType::None){
+        indicesData.indices = std::vector<unsigned int>();
+        indicesData.type = MeshIndexType::UnsignedInt;
+    }
+    unsigned int indicesCount = GetIndicesCount();
+    std::visit([newIndicesCount](auto &&meshIndices){
+        meshIndices.resize(newIndicesCount, 0);
+    }, indicesData.indices);
+    indicesData.indicesSize = newIndicesCount * GetIndicesTypeSize(indicesData.type);
+    if(newIndicesCount > indicesCount)
+        dirtyIndices.Mark(indicesCount, newIndicesCount - indicesCount);
+    meshlets.clear();
+}
+
+void Mesh::MarkVerticesDirty(int firstVertex, int count){
+    dirtyVertices.Mark(firstVertex, count);
+}
+
+void Mesh::MarkIndicesDirty(unsigned int firstIndex, unsigned int count){
+    dirtyIndices.Mark(firstIndex, count);
+}
+
+const DirtyRanges &Mesh::GetDirtyVertices() const{
+    return dirtyVertices;
+}
+
+const DirtyRanges &Mesh::GetDirtyIndices() const{
+    return dirtyIndices;
+}
+
+void Mesh::ClearDirtyRanges(){
+    dirtyVertices.Clear();
+    dirtyIndices.Clear();
+}
+
+void Mesh::PushLOD(const std::vector<unsigned int> &indices, float error){
+    MeshLOD lod;
+    if(indicesData.type == MeshIndexType::UnsignedShort)
+        lod.indicesData = MeshIndexData(std::vector<unsigned short>(indices.begin(), indices.end()), sizeof(unsigned short)*indices.size(), MeshIndexType::UnsignedShort);
+    else
+        lod.indicesData = MeshIndexData(std::vector<unsigned int>(indices), sizeof(unsigned int)*indices.size(), MeshIndexType::UnsignedInt);
+    lod.indicesCount = indices.size();
+    lod.error = error;
+    lods.push_back(std::move(lod));
+}
+
+void Mesh::ClearLODs(){
+    lods.clear();
+}
+
+int Mesh::GetLODsCount() const{
+    return lods.size();
+}
+
+const MeshLOD &Mesh::GetLOD(int level) const{
+    return lods[level];
+}
+
+void Mesh::SetMeshlets(std::vector<Meshlet> &&meshlets){
+    this->meshlets = std::move(meshlets);
+}
+
+const std::vector<Meshlet> &Mesh::GetMeshlets() const{
+    return meshlets;
+}
+
+void Mesh::SetBoundingSphere(const glm::vec4 &sphere){
+    boundingSphere = sphere;
+}
+
+const glm::vec4 &Mesh::GetBoundingSphere() const{
+    return boundingSphere;
+}
+
 int Mesh::GetAttributesCount() const{
     return attributesData.size();
 }
@@ -295,3 +850,57 @@ MeshIndexType Mesh::GetIndicesType() const{
 int Mesh::GetVerticesCount() const{
     return verticesCount;
 }
+
+bool Mesh::HasQuantizedPositions() const{
+    return quantizedPositions;
+}
+
+const glm::mat4 &Mesh::GetPositionDequantization() const{
+    return positionDequantization;
+}
+
+bool Mesh::SetSkinInfluences(std::vector<glm::u8vec4> &&joints, std::vector<glm::u8vec4> &&weights){
+    if(joints.size() != static_cast<size_t>(verticesCount) || weights.size() != joints.size())
+        return false;
+    skinJoints = std::move(joints);
+    skinWeights = std::move(weights);
+    return true;
+}
+
+bool Mesh::PushMorphTarget(MorphTarget &&target){
+    if(target.positionDeltas.size() != static_cast<size_t>(verticesCount) ||
+    (!target.normalDeltas.empty() && target.normalDeltas.size() != target.positionDeltas.size()))
+        return false;
+    morphTargets.push_back(std::move(target));
+    morphWeights.resize(morphTargets.size(), 0.0f);
+    return true;
+}
+
+void Mesh::SetMorphWeights(const std::vector<float> &weights){
+    morphWeights = weights;
+    morphWeights.resize(morphTargets.size(), 0.0f);
+}
+
+const std::vector<glm::u8vec4> &Mesh::GetSkinJoints() const{
+    return skinJoints;
+}
+
+const std::vector<glm::u8vec4> &Mesh::GetSkinWeights() const{
+    return skinWeights;
+}
+
+const std::vector<MorphTarget> &Mesh::GetMorphTargets() const{
+    return morphTargets;
+}
+
+const std::vector<float> &Mesh::GetMorphWeights() const{
+    return morphWeights;
+}
+
+bool Mesh::IsSkinned() const{
+    return !skinJoints.empty();
+}
+
+bool Mesh::IsDeformable() const{
+    return IsSkinned() || !morphTargets.empty();
+}
@@ -3,6 +3,9 @@
 #include <vector>
 #include <string>
 #include <variant>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 enum class MeshTopology{
     Triangles,
@@ -19,8 +22,10 @@ enum class MeshAttributeType{
 };
 
 // Purpose of attribute for standard render operations
+// QTangent is a quaternion encoding normal, tangent and bitangent (handedness in sign of w)
 enum class MeshAttributeAlias{
-    None = 0, Position, TexCoord0, TexCoord1, TexCoord2, TexCoord3, TexCoord4, TexCoord5, TexCoord6, TexCoord7, Normal, Tangent, Bitangent, Color
+    None = 0, Position, TexCoord0, TexCoord1, TexCoord2, TexCoord3, TexCoord4, TexCoord5, TexCoord6, TexCoord7, Normal, Tangent, Bitangent, Color,
+    QTangent
 };
 
 
@@ -108,28 +113,77 @@ struct MeshLayout{
     }
 };
 
+// Raw bytes of attribute values. Owned bytes are 16 bytes aligned and copied with the buffer.
+// Adopted bytes reference external memory (mapped files, loader buffers) kept alive by their owner,
+// and are only copied to owned storage when modified
+class AttributeBuffer{
+private:
+    struct AlignedDeleter{
+        void operator()(unsigned char *bytes) const;
+    };
+    std::unique_ptr<unsigned char[], AlignedDeleter> ownedBytes;
+    std::shared_ptr<const void> externalOwner;
+    const unsigned char *bytes = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    void Reallocate(size_t newCapacity);
+public:
+    static const size_t alignment = 16;
+    AttributeBuffer() = default;
+    AttributeBuffer(const AttributeBuffer &buffer);
+    AttributeBuffer(AttributeBuffer &&buffer) noexcept;
+    AttributeBuffer &operator=(const AttributeBuffer &buffer);
+    AttributeBuffer &operator=(AttributeBuffer &&buffer) noexcept;
+    void Assign(const void *data, size_t size);
+    // References data without copy. Owner keeps data alive while the buffer (or a copy of it) is used
+    void Adopt(std::shared_ptr<const void> owner, const void *data, size_t size);
+    void Reserve(size_t newCapacity);
+    // New bytes are not initialized
+    void Resize(size_t newSize);
+    void Append(const void *data, size_t dataSize);
+    const unsigned char *Data() const;
+    unsigned char *MutableData();
+    size_t Size() const;
+    bool IsAdopted() const;
+};
+
+// Read only view of attribute values, with stride in bytes between vertices
+template <typename T>
+struct AttributeView{
+    const unsigned char *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    const T *operator[](size_t vertex) const{
+        return reinterpret_cast<const T*>(data + vertex * stride);
+    }
+};
+
 struct MeshAttributeData{
-    std::variant<std::vector<float>, std::vector<int>, std::vector<unsigned int>, std::vector<char>, 
-    std::vector<unsigned char>, std::vector<short>, std::vector<unsigned short>> data;
-    //Attribute data size in bytes
+    AttributeBuffer data;
+    // Packed attribute data size in bytes (attribute size * vertices count)
     int dataSize = 0;
+    // Bytes between vertices in data. It is the attribute size, except for adopted interleaved data
+    int stride = 0;
     MeshAttribute attribute;
 
     MeshAttributeData() = default;
-    MeshAttributeData(const std::vector<float> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<int> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<unsigned int> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<char> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<unsigned char> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<short> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
-    MeshAttributeData(const std::vector<unsigned short> &&data, int dataSize, const MeshAttribute &attribute):
-    data(data), dataSize(dataSize), attribute(attribute){}
+    MeshAttributeData(AttributeBuffer &&data, int dataSize, int stride, const MeshAttribute &attribute):
+    data(std::move(data)), dataSize(dataSize), stride(stride), attribute(attribute){}
+    bool IsPacked() const{
+        return stride == attribute.AttributeDataSize();
+    }
+    size_t VerticesCount() const{
+        int attributeSize = attribute.AttributeDataSize();
+        return attributeSize > 0 ? dataSize / attributeSize : 0;
+    }
+    template <typename T>
+    AttributeView<T> View() const{
+        return AttributeView<T>{data.Data(), VerticesCount(), static_cast<size_t>(stride)};
+    }
+    // Appends values of attribute data with the same attribute, packing interleaved data
+    void Append(const MeshAttributeData &attributeData);
+    // Packed values with same content, regardless of storage
+    bool HasSameData(const MeshAttributeData &attributeData) const;
 };
 
 struct MeshIndexData{
@@ -144,19 +198,80 @@ struct MeshIndexData{
     indices(indices), indicesSize(indicesSize), type(type){}
 };
 
+// Simplified index buffer of a mesh. It references vertices of the full detail mesh
+struct MeshLOD{
+    MeshIndexData indicesData;
+    unsigned int indicesCount = 0;
+    // Simplification error relative to bounding sphere radius
+    float error = 0.0f;
+};
+
+// Cluster of mesh triangles, contiguous in mesh indices, with bounds for culling in mesh space
+struct Meshlet{
+    unsigned int firstIndex = 0;
+    unsigned int indicesCount = 0;
+    glm::vec4 boundingSphere = glm::vec4(0.0f); // Center and radius
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    // Normal cone axis and cutoff. Cluster is back facing when view direction to apex is inside the cone.
+    // Cutoff 1 disables cone test
+    glm::vec4 cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+};
+
+// Position and normal offsets of a morph target for every vertex
+struct MorphTarget{
+    std::vector<glm::vec3> positionDeltas;
+    std::vector<glm::vec3> normalDeltas; // Empty when target does not change normals
+};
+
+// Ranges of elements changed since last upload, sorted and merged. Above maxRanges, ranges separated by the
+// smallest gaps are merged, so uploads stay few and large
+class DirtyRanges{
+public:
+    struct Range{
+        size_t first = 0;
+        size_t end = 0; // One past last element
+    };
+    static const size_t maxRanges = 16;
+    void Mark(size_t first, size_t count);
+    void Clear();
+    bool IsEmpty() const;
+    // Elements count of all ranges
+    size_t ElementsCount() const;
+    const std::vector<Range> &GetRanges() const;
+private:
+    std::vector<Range> ranges;
+};
+
 class Mesh{
 private:
     MeshIndexData indicesData;
+    std::vector<MeshLOD> lods;
+    std::vector<Meshlet> meshlets;
+    // Mesh space bounding sphere: center in xyz and radius in w
+    glm::vec4 boundingSphere = glm::vec4(0.0f);
     MeshTopology topology = MeshTopology::Triangles;
     std::vector<MeshAttributeData> attributesData;
     int verticesCount = 0;
     MeshLayout layout;
+    // Transform from quantized positions in [0, 1] to mesh space. Identity for float positions
+    glm::mat4 positionDequantization = glm::mat4(1.0f);
+    bool quantizedPositions = false;
+    // Changes since last upload, used to stream dynamic meshes
+    DirtyRanges dirtyVertices;
+    DirtyRanges dirtyIndices;
+    // Skin influences of each vertex: four joints of the skin and their unorm8 weights summing 255
+    std::vector<glm::u8vec4> skinJoints;
+    std::vector<glm::u8vec4> skinWeights;
+    std::vector<MorphTarget> morphTargets;
+    std::vector<float> morphWeights; // Rest weights of morph targets
     template <typename T>
     bool PushAttributeBase(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized, 
     std::vector<T> &&data, bool interpretAsInt, MeshAttributeAlias alias);
     template <typename T>
     bool PushAttributeBase(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized, 
     const std::vector<T> &data, bool interpretAsInt, MeshAttributeAlias alias);
+    bool PushAttributeData(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized,
+    AttributeBuffer &&data, size_t verticesCount, size_t stride, bool interpretAsInt, MeshAttributeAlias alias);
     // Layout can only contains one alias or one attribute purpose
     bool CheckIfAliasExists(MeshAttributeAlias alias);
 public:
@@ -180,8 +295,15 @@ public:
     bool PushAttribute(const std::string &name, MeshAttributeFormat format, bool normalized, std::vector<short> &&data, bool interpretAsInt = false, MeshAttributeAlias alias = MeshAttributeAlias::None);
     bool PushAttribute(const std::string &name, MeshAttributeFormat format, bool normalized, const std::vector<unsigned short> &data, bool interpretAsInt = false, MeshAttributeAlias alias = MeshAttributeAlias::None);
     bool PushAttribute(const std::string &name, MeshAttributeFormat format, bool normalized, std::vector<unsigned short> &&data, bool interpretAsInt = false, MeshAttributeAlias alias = MeshAttributeAlias::None);
+    // Pushes attribute referencing external data without copy. Stride is the bytes between vertices
+    // and owner keeps data alive while the mesh uses it
+    bool AdoptAttribute(const std::string &name, MeshAttributeFormat format, MeshAttributeType type, bool normalized,
+    std::shared_ptr<const void> owner, const void *data, size_t verticesCount, size_t stride, bool interpretAsInt = false,
+    MeshAttributeAlias alias = MeshAttributeAlias::None);
     // Standard specific attributes push functions
     bool PushAttributePosition(const std::vector<float> &positions);
+    // Positions quantized in unorm16x4 relative to bounds: position = offset + value * scale
+    bool PushAttributePosition(const std::vector<unsigned short> &positions, const glm::vec3 &offset, const glm::vec3 &scale);
     // You can pass a vector of floats or unsigned shorts for tex coordinates
     // It is assumed that using unsigned shorts the attribute is also normalized
     bool PushAttributeTexCoord0(const std::vector<float> &texCoords0);
@@ -204,6 +326,8 @@ public:
     // It is assumed that using shorts the attribute is also normalized
     bool PushAttributeNormal(const std::vector<float> &normals);
     bool PushAttributeNormal(const std::vector<short> &normals);
+    // Octahedral encoded normals (snorm16x2)
+    bool PushAttributeNormalOctahedral(const std::vector<short> &normals);
     // You can pass a vector of floats or shorts for tangents
     // It is assumed that using shorts the attribute is also normalized
     bool PushAttributeTangent(const std::vector<float> &tangents);
@@ -213,6 +337,56 @@ public:
     bool PushAttributeBitangent(const std::vector<float> &bitangents);
     bool PushAttributeBitangent(const std::vector<short> &bitangents);
     bool PushAttributeColor(const std::vector<unsigned char> &colors);
+    // Tangent frames as quaternions (snorm16x4). Replaces normal, tangent and bitangent attributes
+    bool PushAttributeQTangent(const std::vector<short> &qTangents);
+    // Skin influences and morph targets are not vertex attributes. Skinning reads them and writes deformed
+    // float positions, normals, tangents and bitangents of each object in place of its attributes
+    bool SetSkinInfluences(std::vector<glm::u8vec4> &&joints, std::vector<glm::u8vec4> &&weights);
+    bool PushMorphTarget(MorphTarget &&target);
+    void SetMorphWeights(const std::vector<float> &weights);
+    const std::vector<glm::u8vec4> &GetSkinJoints() const;
+    const std::vector<glm::u8vec4> &GetSkinWeights() const;
+    const std::vector<MorphTarget> &GetMorphTargets() const;
+    const std::vector<float> &GetMorphWeights() const;
+    bool IsSkinned() const;
+    bool IsDeformable() const;
+    // Reorders vertices of all attributes: old vertex i becomes remap[i]. Vertices mapped to ~0u are dropped.
+    // Indices are not changed
+    void RemapVertices(const std::vector<unsigned int> &remap, int newVerticesCount);
+    // Converts 16 bits indices of mesh and levels of detail to 32 bits. Meshlets are kept
+    void PromoteIndices();
+    // Builds a mesh with vertices referenced by indices, in order of first use. Indices are 16 bits
+    // when vertices fit. Levels of detail and meshlets are not copied
+    std::shared_ptr<Mesh> ExtractSubmesh(const unsigned int *indices, size_t indicesCount) const;
+    // Reorders attributes as layout and adds its missing attributes filled with defaults (zero, unit X tangent,
+    // unit Y bitangent, opaque white color). Fails without changes if an attribute of mesh is not in layout
+    bool ConformToLayout(const MeshLayout &targetLayout);
+    // Writes packed values of attribute from first vertex and marks them dirty. Vertices must exist
+    bool UpdateAttribute(int attributeIndex, int firstVertex, const void *data, int count);
+    // Packed values of attribute for edits in place. Changed vertices must be marked dirty
+    unsigned char *GetMutableAttributeData(int attributeIndex);
+    // Changes vertices count of all attributes keeping first vertices. New vertices are zero and dirty
+    void ResizeVertices(int newVerticesCount);
+    // Writes indices from first index, growing indices when needed, and marks them dirty.
+    // Fails when a value does not fit in 16 bits indices
+    bool UpdateIndices(unsigned int firstIndex, const unsigned int *indices, size_t count);
+    // Changes indices count keeping first indices. New indices are zero and dirty
+    void ResizeIndices(unsigned int newIndicesCount);
+    void MarkVerticesDirty(int firstVertex, int count);
+    void MarkIndicesDirty(unsigned int firstIndex, unsigned int count);
+    const DirtyRanges &GetDirtyVertices() const;
+    const DirtyRanges &GetDirtyIndices() const;
+    void ClearDirtyRanges();
+    // Pushes next coarser level of detail. Indices are stored with the same type of mesh indices
+    void PushLOD(const std::vector<unsigned int> &indices, float error);
+    void ClearLODs();
+    int GetLODsCount() const;
+    const MeshLOD &GetLOD(int level) const;
+    // Meshlets are cleared when indices are set
+    void SetMeshlets(std::vector<Meshlet> &&meshlets);
+    const std::vector<Meshlet> &GetMeshlets() const;
+    void SetBoundingSphere(const glm::vec4 &sphere);
+    const glm::vec4 &GetBoundingSphere() const;
     int GetAttributesCount() const;
     std::vector<int> GetAttributesSizes() const;
     std::vector<int> GetAttributesDatasSizes() const;
@@ -226,5 +400,7 @@ public:
     MeshTopology GetTopology() const;
     MeshIndexType GetIndicesType() const;
     int GetVerticesCount() const;
+    bool HasQuantizedPositions() const;
+    const glm::mat4 &GetPositionDequantization() const;
 };
 #endif
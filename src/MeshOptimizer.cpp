@@ -0,0 +1,429 @@
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <glm/glm.hpp>
+
+// Meshes are left handed with the winding kept from right handed sources (Z mirrored at import),
+// so the outward face normal is cross(p2 - p0, p1 - p0)
+static glm::vec3 OutwardNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+{
+    return glm::cross(p2 - p0, p1 - p0);
+}
+
+float MeshOptimizer::VertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    const float cacheDecayPower = 1.5f;
+    const float lastTriangleScore = 0.75f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+    if(remainingTriangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if(cachePosition >= 0){
+        if(cachePosition < 3){ // Vertices of last triangle get a fixed score, so the next one does not just reuse its edge
+            score = lastTriangleScore;
+        } else {
+            float scaler = 1.0f / (vertexCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+        }
+    }
+    // Vertices with few remaining triangles are preferred, so they leave the working set early
+    score += valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+    return score;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int> &indices, size_t verticesCount)
+{
+    size_t trianglesCount = indices.size() / 3;
+    if(trianglesCount == 0)
+        return;
+    // Triangles adjacent to each vertex, packed in a single array
+    std::vector<unsigned int> remaining(verticesCount, 0);
+    for(size_t i = 0; i < 3 * trianglesCount; i++)
+        remaining[indices[i]]++;
+    std::vector<unsigned int> adjacencyOffsets(verticesCount + 1, 0);
+    for(size_t v = 0; v < verticesCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(adjacencyOffsets.back());
+    std::vector<unsigned int> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for(size_t t = 0; t < trianglesCount; t++){
+        for(int k = 0; k < 3; k++)
+            adjacency[fillOffsets[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePositions(verticesCount, -1);
+    std::vector<float> vertexScores(verticesCount);
+    for(size_t v = 0; v < verticesCount; v++)
+        vertexScores[v] = VertexScore(-1, remaining[v]);
+    std::vector<bool> emitted(trianglesCount, false);
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    cache.reserve(vertexCacheSize + 3);
+    newCache.reserve(vertexCacheSize + 3);
+
+    const size_t noTriangle = std::numeric_limits<size_t>::max();
+    size_t bestTriangle = noTriangle;
+    size_t scanCursor = 0;
+    for(size_t step = 0; step < trianglesCount; step++){
+        if(bestTriangle == noTriangle){
+            // No candidate adjacent to cache. Restart from next triangle in original order
+            while(emitted[scanCursor])
+                scanCursor++;
+            bestTriangle = scanCursor;
+        }
+        emitted[bestTriangle] = true;
+        const unsigned int *triangle = &indices[3 * bestTriangle];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        newCache.clear();
+        for(int k = 0; k < 3; k++){
+            unsigned int vertex = triangle[k];
+            auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+            auto end = begin + remaining[vertex];
+            auto it = std::find(begin, end, static_cast<unsigned int>(bestTriangle));
+            if(it != end){
+                std::iter_swap(it, end - 1);
+                remaining[vertex]--;
+            }
+            if(std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+                newCache.push_back(vertex);
+        }
+        for(unsigned int vertex : cache){
+            if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                newCache.push_back(vertex);
+        }
+        // Vertices pushed beyond cache size are evicted
+        for(size_t i = 0; i < newCache.size(); i++){
+            unsigned int vertex = newCache[i];
+            cachePositions[vertex] = i < vertexCacheSize ? static_cast<int>(i) : -1;
+            vertexScores[vertex] = VertexScore(cachePositions[vertex], remaining[vertex]);
+        }
+        if(newCache.size() > vertexCacheSize)
+            newCache.resize(vertexCacheSize);
+        std::swap(cache, newCache);
+
+        // Next triangle is the best scored one among the ones using cached vertices
+        bestTriangle = noTriangle;
+        float bestScore = -1.0f;
+        for(unsigned int vertex : cache){
+            for(unsigned int a = 0; a < remaining[vertex]; a++){
+                unsigned int candidate = adjacency[adjacencyOffsets[vertex] + a];
+                const unsigned int *candidateTriangle = &indices[3 * candidate];
+                float score = vertexScores[candidateTriangle[0]] + vertexScores[candidateTriangle[1]] + vertexScores[candidateTriangle[2]];
+                if(score > bestScore){
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions, float threshold)
+{
+    size_t trianglesCount = indices.size() / 3;
+    size_t verticesCount = positions.size() / 3;
+    if(trianglesCount == 0)
+        return;
+    // FIFO cache simulation with timestamps: vertex is cached when less than cache size misses happened since its load
+    std::vector<unsigned int> timestamps(verticesCount, 0);
+    unsigned int time = analyzerCacheSize + 1;
+    auto simulateTriangle = [&](size_t t){
+        int misses = 0;
+        for(int k = 0; k < 3; k++){
+            unsigned int vertex = indices[3 * t + k];
+            if(time - timestamps[vertex] > static_cast<unsigned int>(analyzerCacheSize)){
+                timestamps[vertex] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    // Hard boundaries are triangles missing all vertices, where optimized order already restarted
+    std::vector<size_t> hardClusters;
+    for(size_t t = 0; t < trianglesCount; t++){
+        if(simulateTriangle(t) == 3)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(trianglesCount);
+    if(hardClusters.front() != 0)
+        hardClusters.insert(hardClusters.begin(), 0);
+
+    // Soft boundaries split hard clusters where cache efficiency so far is close to the whole cluster one
+    std::vector<size_t> clusters;
+    for(size_t c = 0; c + 1 < hardClusters.size(); c++){
+        size_t begin = hardClusters[c];
+        size_t end = hardClusters[c + 1];
+        // Advancing time past cache size flushes the simulated cache
+        time += analyzerCacheSize + 1;
+        int clusterMisses = 0;
+        for(size_t t = begin; t < end; t++)
+            clusterMisses += simulateTriangle(t);
+        float clusterACMR = static_cast<float>(clusterMisses) / (end - begin);
+
+        time += analyzerCacheSize + 1;
+        clusters.push_back(begin);
+        int runningMisses = 0;
+        size_t runningTriangles = 0;
+        for(size_t t = begin; t < end; t++){
+            runningMisses += simulateTriangle(t);
+            runningTriangles++;
+            if(t + 1 < end && static_cast<float>(runningMisses) / runningTriangles <= threshold * clusterACMR){
+                clusters.push_back(t + 1);
+                time += analyzerCacheSize + 1;
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    clusters.push_back(trianglesCount);
+
+    // Clusters facing away from mesh center are drawn first, as they tend to occlude the inner ones
+    auto position = [&positions](unsigned int vertex){
+        return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]);
+    };
+    size_t clustersCount = clusters.size() - 1;
+    std::vector<glm::vec3> clustersCentroids(clustersCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clustersNormals(clustersCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for(size_t c = 0; c < clustersCount; c++){
+        float clusterArea = 0.0f;
+        for(size_t t = clusters[c]; t < clusters[c + 1]; t++){
+            glm::vec3 p0 = position(indices[3 * t]);
+            glm::vec3 p1 = position(indices[3 * t + 1]);
+            glm::vec3 p2 = position(indices[3 * t + 2]);
+            glm::vec3 normal = OutwardNormal(p0, p1, p2);
+            float area = glm::length(normal);
+            clustersCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clustersNormals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clustersCentroids[c];
+        meshArea += clusterArea;
+        clustersCentroids[c] = clusterArea > 0.0f ? clustersCentroids[c] / clusterArea : position(indices[3 * clusters[c]]);
+        float normalLength = glm::length(clustersNormals[c]);
+        clustersNormals[c] = normalLength > 0.0f ? clustersNormals[c] / normalLength : glm::vec3(0.0f);
+    }
+    if(meshArea > 0.0f)
+        meshCentroid /= meshArea;
+    std::vector<float> sortKeys(clustersCount);
+    for(size_t c = 0; c < clustersCount; c++)
+        sortKeys[c] = glm::dot(clustersCentroids[c] - meshCentroid, clustersNormals[c]);
+    std::vector<size_t> order(clustersCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b){
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for(size_t c : order)
+        output.insert(output.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+size_t MeshOptimizer::OptimizeVertexFetchRemap(std::vector<unsigned int> &indices, size_t verticesCount, std::vector<unsigned int> &remap)
+{
+    const unsigned int unused = ~0u;
+    remap.assign(verticesCount, unused);
+    unsigned int nextVertex = 0;
+    for(unsigned int &index : indices){
+        if(remap[index] == unused)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    return nextVertex;
+}
+
+void MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t verticesCount, float &acmr, float &atvr)
+{
+    size_t trianglesCount = indices.size() / 3;
+    std::vector<unsigned int> timestamps(verticesCount, 0);
+    std::vector<bool> referenced(verticesCount, false);
+    unsigned int time = analyzerCacheSize + 1;
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for(size_t i = 0; i < 3 * trianglesCount; i++){
+        unsigned int vertex = indices[i];
+        if(time - timestamps[vertex] > static_cast<unsigned int>(analyzerCacheSize)){
+            timestamps[vertex] = time++;
+            misses++;
+        }
+        if(!referenced[vertex]){
+            referenced[vertex] = true;
+            uniqueVertices++;
+        }
+    }
+    acmr = trianglesCount > 0 ? static_cast<float>(misses) / trianglesCount : 0.0f;
+    atvr = uniqueVertices > 0 ? static_cast<float>(misses) / uniqueVertices : 0.0f;
+}
+
+float MeshOptimizer::AnalyzeOverdraw(const std::vector<unsigned int> &indices, const std::vector<float> &positions)
+{
+    size_t trianglesCount = indices.size() / 3;
+    size_t verticesCount = positions.size() / 3;
+    if(trianglesCount == 0 || verticesCount == 0)
+        return 0.0f;
+    glm::vec3 minBounds(std::numeric_limits<float>::max());
+    glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
+    for(size_t v = 0; v < verticesCount; v++){
+        glm::vec3 position(positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]);
+        minBounds = glm::min(minBounds, position);
+        maxBounds = glm::max(maxBounds, position);
+    }
+    glm::vec3 extent = maxBounds - minBounds;
+    float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+    if(maxExtent <= 0.0f)
+        return 0.0f;
+    float scale = overdrawGridSize / maxExtent;
+
+    // Orthographic rasterization from both sides of each axis, in draw order, with depth test
+    std::vector<float> depthBuffer(overdrawGridSize * overdrawGridSize);
+    size_t shaded = 0;
+    size_t covered = 0;
+    for(int axis = 0; axis < 3; axis++){
+        int uAxis = (axis + 1) % 3;
+        int vAxis = (axis + 2) % 3;
+        for(float direction : {1.0f, -1.0f}){
+            std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::max());
+            for(size_t t = 0; t < trianglesCount; t++){
+                glm::vec3 p[3];
+                for(int k = 0; k < 3; k++){
+                    unsigned int vertex = indices[3 * t + k];
+                    p[k] = (glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]) - minBounds) * scale;
+                }
+                // Camera is at the direction side of axis, so only triangles facing it are rasterized
+                if(OutwardNormal(p[0], p[1], p[2])[axis] * direction <= 0.0f)
+                    continue;
+                glm::vec2 s0(p[0][uAxis], p[0][vAxis]);
+                glm::vec2 s1(p[1][uAxis], p[1][vAxis]);
+                glm::vec2 s2(p[2][uAxis], p[2][vAxis]);
+                float d0 = -direction * p[0][axis];
+                float d1 = -direction * p[1][axis];
+                float d2 = -direction * p[2][axis];
+                auto edge = [](const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c){
+                    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+                };
+                float area = edge(s0, s1, s2);
+                if(std::abs(area) < 1e-8f)
+                    continue;
+                int minX = std::max(0, static_cast<int>(std::floor(std::min(s0.x, std::min(s1.x, s2.x)))));
+                int maxX = std::min(overdrawGridSize - 1, static_cast<int>(std::ceil(std::max(s0.x, std::max(s1.x, s2.x)))));
+                int minY = std::max(0, static_cast<int>(std::floor(std::min(s0.y, std::min(s1.y, s2.y)))));
+                int maxY = std::min(overdrawGridSize - 1, static_cast<int>(std::ceil(std::max(s0.y, std::max(s1.y, s2.y)))));
+                for(int y = minY; y <= maxY; y++){
+                    for(int x = minX; x <= maxX; x++){
+                        glm::vec2 sample(x + 0.5f, y + 0.5f);
+                        float w0 = edge(s1, s2, sample) / area;
+                        float w1 = edge(s2, s0, sample) / area;
+                        float w2 = edge(s0, s1, sample) / area;
+                        if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                            continue;
+                        float depth = w0 * d0 + w1 * d1 + w2 * d2;
+                        float &stored = depthBuffer[y * overdrawGridSize + x];
+                        if(depth < stored){
+                            stored = depth;
+                            shaded++;
+                        }
+                    }
+                }
+            }
+            covered += std::count_if(depthBuffer.begin(), depthBuffer.end(), [](float depth){
+                return depth != std::numeric_limits<float>::max();
+            });
+        }
+    }
+    return covered > 0 ? static_cast<float>(shaded) / covered : 0.0f;
+}
+
+bool MeshOptimizer::ReadIndices(Mesh &mesh, std::vector<unsigned int> &indices)
+{
+    const MeshIndexData &indicesData = mesh.GetIndices();
+    if(indicesData.type == MeshIndexType::None)
+        return false;
+    std::visit([&indices](auto &&values){
+        indices.assign(values.begin(), values.end());
+    }, indicesData.indices);
+    size_t verticesCount = mesh.GetVerticesCount();
+    return std::all_of(indices.begin(), indices.end(), [verticesCount](unsigned int index){
+        return index < verticesCount;
+    });
+}
+
+void MeshOptimizer::WriteIndices(Mesh &mesh, const std::vector<unsigned int> &indices)
+{
+    if(mesh.GetIndicesType() == MeshIndexType::UnsignedShort)
+        mesh.SetIndices(std::vector<unsigned short>(indices.begin(), indices.end()), mesh.GetTopology());
+    else
+        mesh.SetIndices(std::vector<unsigned int>(indices), mesh.GetTopology());
+}
+
+bool MeshOptimizer::ReadPositions(Mesh &mesh, std::vector<float> &positions)
+{
+    for(auto &&attributeData : mesh.GetAttributesDatas()){
+        const MeshAttribute &attribute = attributeData.attribute;
+        if(attribute.alias != MeshAttributeAlias::Position)
+            continue;
+        size_t verticesCount = mesh.GetVerticesCount();
+        int elements = attribute.ScalarElementsCount();
+        if(attribute.type == MeshAttributeType::Float && elements >= 3){
+            auto values = attributeData.View<float>();
+            positions.resize(3 * verticesCount);
+            for(size_t v = 0; v < verticesCount; v++)
+                std::copy_n(values[v], 3, &positions[3 * v]);
+            return true;
+        }
+        if(attribute.type == MeshAttributeType::UnsignedShort && attribute.normalized && elements >= 3){
+            auto values = attributeData.View<unsigned short>();
+            const glm::mat4 &dequantization = mesh.GetPositionDequantization();
+            positions.resize(3 * verticesCount);
+            for(size_t v = 0; v < verticesCount; v++){
+                glm::vec4 quantized(values[v][0] / 65535.0f, values[v][1] / 65535.0f, values[v][2] / 65535.0f, 1.0f);
+                glm::vec3 position = glm::vec3(dequantization * quantized);
+                std::copy_n(&position[0], 3, &positions[3 * v]);
+            }
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+bool MeshOptimizer::Optimize(Mesh &mesh)
+{
+    if(mesh.GetTopology() != MeshTopology::Triangles)
+        return false;
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    if(!ReadIndices(mesh, indices) || !ReadPositions(mesh, positions))
+        return false;
+    size_t verticesCount = mesh.GetVerticesCount();
+    OptimizeVertexCache(indices, verticesCount);
+    OptimizeOverdraw(indices, positions);
+    std::vector<unsigned int> remap;
+    size_t usedVerticesCount = OptimizeVertexFetchRemap(indices, verticesCount, remap);
+    mesh.RemapVertices(remap, static_cast<int>(usedVerticesCount));
+    WriteIndices(mesh, indices);
+    return true;
+}
+
+MeshOptimizationStats MeshOptimizer::Analyze(Mesh &mesh, bool includeOverdraw)
+{
+    MeshOptimizationStats stats;
+    std::vector<unsigned int> indices;
+    if(mesh.GetTopology() != MeshTopology::Triangles || !ReadIndices(mesh, indices))
+        return stats;
+    stats.trianglesCount = indices.size() / 3;
+    stats.verticesCount = mesh.GetVerticesCount();
+    AnalyzeVertexCache(indices, stats.verticesCount, stats.acmr, stats.atvr);
+    std::vector<float> positions;
+    if(includeOverdraw && ReadPositions(mesh, positions))
+        stats.overdraw = AnalyzeOverdraw(indices, positions);
+    return stats;
+}
@@ -0,0 +1,43 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+#include <vector>
+#include "Mesh.hpp"
+
+// Vertex cache (ACMR/ATVR) and overdraw metrics of a mesh
+struct MeshOptimizationStats{
+    size_t trianglesCount = 0;
+    size_t verticesCount = 0;
+    float acmr = 0.0f; // Average cache miss ratio: transformed vertices per triangle
+    float atvr = 0.0f; // Average transform to vertex ratio: transformed vertices per unique vertex
+    float overdraw = 0.0f; // Shaded pixels per covered pixel, averaged over six axis aligned views
+};
+
+// Reorders triangles and vertices of indexed triangle meshes for GPU efficiency:
+// post-transform cache locality (Forsyth), view independent overdraw and vertex fetch locality
+class MeshOptimizer{
+private:
+    static const int vertexCacheSize = 32; // Cache size used for vertex scoring
+    static const int analyzerCacheSize = 16; // FIFO cache size used for statistics
+    static const int overdrawGridSize = 256;
+    static float VertexScore(int cachePosition, unsigned int remainingTriangles);
+public:
+    // Sets triangle indices keeping the mesh indices type
+    static void WriteIndices(Mesh &mesh, const std::vector<unsigned int> &indices);
+    // Indices widened to unsigned int. Fails if an index is out of vertices range
+    static bool ReadIndices(Mesh &mesh, std::vector<unsigned int> &indices);
+    // Positions as floats, dequantizing compressed positions
+    static bool ReadPositions(Mesh &mesh, std::vector<float> &positions);
+    static void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t verticesCount);
+    // Splits triangles into clusters at cache boundaries and sorts them to draw outer surfaces first.
+    // Clusters are only split where running ACMR stays below threshold times cluster ACMR
+    static void OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions, float threshold = 1.05f);
+    // Builds remap table of vertices in first use order and rewrites indices. Returns used vertices count.
+    // Unused vertices are mapped to ~0u
+    static size_t OptimizeVertexFetchRemap(std::vector<unsigned int> &indices, size_t verticesCount, std::vector<unsigned int> &remap);
+    static void AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t verticesCount, float &acmr, float &atvr);
+    static float AnalyzeOverdraw(const std::vector<unsigned int> &indices, const std::vector<float> &positions);
+    // Runs all steps in mesh. Only triangle meshes are optimized
+    static bool Optimize(Mesh &mesh);
+    static MeshOptimizationStats Analyze(Mesh &mesh, bool includeOverdraw = true);
+};
+#endif
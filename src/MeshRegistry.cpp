@@ -0,0 +1,191 @@
+#include "MeshRegistry.hpp"
+#include <cstring>
+
+static const uint64_t prime1 = 11400714785074694791ULL;
+static const uint64_t prime2 = 14029467366897019727ULL;
+static const uint64_t prime3 = 1609587929392839161ULL;
+static const uint64_t prime4 = 9650029242287828579ULL;
+static const uint64_t prime5 = 2870177450012600261ULL;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Read64(const unsigned char *bytes)
+{
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const unsigned char *bytes)
+{
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * prime2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * prime1;
+}
+
+static inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= Round(0, value);
+    return accumulator * prime1 + prime4;
+}
+
+uint64_t MeshRegistry::HashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    const unsigned char *end = bytes + size;
+    uint64_t hash;
+    if(size >= 32){
+        // Four independent lanes over 32 bytes stripes
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        const unsigned char *limit = end - 32;
+        do{
+            v1 = Round(v1, Read64(bytes)); bytes += 8;
+            v2 = Round(v2, Read64(bytes)); bytes += 8;
+            v3 = Round(v3, Read64(bytes)); bytes += 8;
+            v4 = Round(v4, Read64(bytes)); bytes += 8;
+        } while(bytes <= limit);
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = seed + prime5;
+    }
+    hash += static_cast<uint64_t>(size);
+    for(; bytes + 8 <= end; bytes += 8){
+        hash ^= Round(0, Read64(bytes));
+        hash = RotateLeft(hash, 27) * prime1 + prime4;
+    }
+    if(bytes + 4 <= end){
+        hash ^= static_cast<uint64_t>(Read32(bytes)) * prime1;
+        hash = RotateLeft(hash, 23) * prime2 + prime3;
+        bytes += 4;
+    }
+    for(; bytes < end; bytes++){
+        hash ^= (*bytes) * prime5;
+        hash = RotateLeft(hash, 11) * prime1;
+    }
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t MeshRegistry::Hash(Mesh &mesh)
+{
+    int header[3] = {static_cast<int>(mesh.GetTopology()), static_cast<int>(mesh.GetIndicesType()), mesh.GetVerticesCount()};
+    uint64_t hash = HashBytes(header, sizeof(header));
+    for(auto &&attributeData : mesh.GetAttributesDatas()){
+        const MeshAttribute &attribute = attributeData.attribute;
+        int attributeHeader[5] = {static_cast<int>(attribute.type), static_cast<int>(attribute.format), static_cast<int>(attribute.alias),
+        attribute.normalized, attribute.interpretAsInt};
+        hash = HashBytes(attributeHeader, sizeof(attributeHeader), hash);
+        if(attributeData.IsPacked()){
+            hash = HashBytes(attributeData.data.Data(), attributeData.dataSize, hash);
+        } else { // Interleaved data is packed first, so hash depends only on values
+            MeshAttributeData packed;
+            packed.attribute = attribute;
+            packed.Append(attributeData);
+            hash = HashBytes(packed.data.Data(), packed.dataSize, hash);
+        }
+    }
+    auto hashIndices = [&hash](const MeshIndexData &indicesData){
+        std::visit([&hash](auto &&indices){
+            hash = HashBytes(indices.data(), indices.size() * sizeof(indices[0]), hash);
+        }, indicesData.indices);
+    };
+    hashIndices(mesh.GetIndices());
+    for(int level = 0; level < mesh.GetLODsCount(); level++)
+        hashIndices(mesh.GetLOD(level).indicesData);
+    return HashBytes(&mesh.GetPositionDequantization(), sizeof(glm::mat4), hash);
+}
+
+size_t MeshRegistry::GeometrySize(Mesh &mesh)
+{
+    size_t size = mesh.GetTotalAttributesDataSize() + mesh.GetIndicesSize();
+    for(int level = 0; level < mesh.GetLODsCount(); level++)
+        size += mesh.GetLOD(level).indicesData.indicesSize;
+    return size;
+}
+
+bool MeshRegistry::IsSameGeometry(Mesh &a, Mesh &b)
+{
+    if(a.GetTopology() != b.GetTopology() || a.GetVerticesCount() != b.GetVerticesCount() ||
+    a.GetAttributesCount() != b.GetAttributesCount() || a.GetLODsCount() != b.GetLODsCount() ||
+    a.GetPositionDequantization() != b.GetPositionDequantization())
+        return false;
+    const auto &attributesA = a.GetAttributesDatas();
+    const auto &attributesB = b.GetAttributesDatas();
+    for(size_t i = 0; i < attributesA.size(); i++){
+        if(!(attributesA[i].attribute == attributesB[i].attribute) || attributesA[i].attribute.alias != attributesB[i].attribute.alias ||
+        !attributesA[i].HasSameData(attributesB[i]))
+            return false;
+    }
+    if(a.GetIndices().indices != b.GetIndices().indices)
+        return false;
+    if(a.GetSkinJoints() != b.GetSkinJoints() || a.GetSkinWeights() != b.GetSkinWeights() ||
+    a.GetMorphTargets().size() != b.GetMorphTargets().size() || a.GetMorphWeights() != b.GetMorphWeights())
+        return false;
+    for(size_t i = 0; i < a.GetMorphTargets().size(); i++){
+        if(a.GetMorphTargets()[i].positionDeltas != b.GetMorphTargets()[i].positionDeltas ||
+        a.GetMorphTargets()[i].normalDeltas != b.GetMorphTargets()[i].normalDeltas)
+            return false;
+    }
+    for(int level = 0; level < a.GetLODsCount(); level++){
+        if(a.GetLOD(level).indicesData.indices != b.GetLOD(level).indicesData.indices)
+            return false;
+    }
+    return true;
+}
+
+Ref<Mesh> MeshRegistry::Register(const Ref<Mesh> &mesh, uint64_t hash)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto &candidates = meshes[hash];
+    for(auto &&candidate : candidates){
+        if(candidate == mesh)
+            return candidate;
+        if(IsSameGeometry(*candidate, *mesh)){
+            duplicatesCount++;
+            savedBytes += GeometrySize(*mesh);
+            return candidate;
+        }
+    }
+    candidates.push_back(mesh);
+    registeredCount++;
+    return mesh;
+}
+
+size_t MeshRegistry::GetRegisteredCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return registeredCount;
+}
+
+size_t MeshRegistry::GetDuplicatesCount()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return duplicatesCount;
+}
+
+size_t MeshRegistry::GetSavedBytes()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return savedBytes;
+}
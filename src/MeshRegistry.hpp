@@ -0,0 +1,34 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Base.hpp"
+#include "Mesh.hpp"
+
+// Geometry registry that collapses meshes with identical content to a single shared Mesh, so the renderer
+// uploads them once and draws them as instances. It can be shared by models loaded in parallel
+class MeshRegistry{
+private:
+    std::mutex registryMutex;
+    // Content hash to registered meshes. Meshes with same hash are compared, so collisions are harmless
+    std::unordered_map<uint64_t, std::vector<Ref<Mesh>>> meshes;
+    size_t registeredCount = 0;
+    size_t duplicatesCount = 0;
+    size_t savedBytes = 0;
+    static bool IsSameGeometry(Mesh &a, Mesh &b);
+public:
+    // XXH64 of bytes
+    static uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 0);
+    // Hash of layout, topology, attributes, indices, levels of detail and dequantization of mesh
+    static uint64_t Hash(Mesh &mesh);
+    static size_t GeometrySize(Mesh &mesh);
+    // Returns registered mesh with same geometry of mesh, or registers mesh and returns it
+    Ref<Mesh> Register(const Ref<Mesh> &mesh, uint64_t hash);
+    size_t GetRegisteredCount();
+    size_t GetDuplicatesCount();
+    // Attributes and indices bytes of duplicated meshes
+    size_t GetSavedBytes();
+};
+#endif
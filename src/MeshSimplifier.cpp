@@ -0,0 +1,325 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+void MeshSimplifier::Quadric::AddPlane(const double *normal, double distance, double planeWeight)
+{
+    a00 += planeWeight * normal[0] * normal[0];
+    a01 += planeWeight * normal[0] * normal[1];
+    a02 += planeWeight * normal[0] * normal[2];
+    a11 += planeWeight * normal[1] * normal[1];
+    a12 += planeWeight * normal[1] * normal[2];
+    a22 += planeWeight * normal[2] * normal[2];
+    b0 += planeWeight * normal[0] * distance;
+    b1 += planeWeight * normal[1] * distance;
+    b2 += planeWeight * normal[2] * distance;
+    c += planeWeight * distance * distance;
+    weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric &quadric)
+{
+    a00 += quadric.a00; a01 += quadric.a01; a02 += quadric.a02;
+    a11 += quadric.a11; a12 += quadric.a12; a22 += quadric.a22;
+    b0 += quadric.b0; b1 += quadric.b1; b2 += quadric.b2;
+    c += quadric.c;
+    weight += quadric.weight;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const double *point) const
+{
+    double x = point[0], y = point[1], z = point[2];
+    double result = a00 * x * x + a11 * y * y + a22 * z * z
+    + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+    + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return weight > 0.0 ? std::abs(result) / weight : 0.0;
+}
+
+float MeshSimplifier::Simplify(std::vector<unsigned int> &indices, const std::vector<float> &positions,
+const std::vector<float> &attributes, int attributesStride, size_t targetIndicesCount, float targetError)
+{
+    size_t verticesCount = positions.size() / 3;
+    if(verticesCount == 0 || indices.size() <= targetIndicesCount)
+        return 0.0f;
+    // Positions are normalized by bounding radius, so errors are relative to mesh size
+    double minBounds[3] = {positions[0], positions[1], positions[2]};
+    double maxBounds[3] = {positions[0], positions[1], positions[2]};
+    for(size_t v = 0; v < verticesCount; v++){
+        for(int k = 0; k < 3; k++){
+            minBounds[k] = std::min(minBounds[k], static_cast<double>(positions[3 * v + k]));
+            maxBounds[k] = std::max(maxBounds[k], static_cast<double>(positions[3 * v + k]));
+        }
+    }
+    double radius = 0.5 * std::sqrt((maxBounds[0] - minBounds[0]) * (maxBounds[0] - minBounds[0]) +
+    (maxBounds[1] - minBounds[1]) * (maxBounds[1] - minBounds[1]) + (maxBounds[2] - minBounds[2]) * (maxBounds[2] - minBounds[2]));
+    double inverseRadius = radius > 0.0 ? 1.0 / radius : 1.0;
+    std::vector<double> points(3 * verticesCount);
+    for(size_t v = 0; v < verticesCount; v++){
+        for(int k = 0; k < 3; k++)
+            points[3 * v + k] = (positions[3 * v + k] - 0.5 * (minBounds[k] + maxBounds[k])) * inverseRadius;
+    }
+    auto triangleNormal = [&points](unsigned int i0, unsigned int i1, unsigned int i2, double *normal){
+        const double *p0 = &points[3 * i0];
+        const double *p1 = &points[3 * i1];
+        const double *p2 = &points[3 * i2];
+        double e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        double e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    };
+
+    // Plane quadrics weighted by triangle area
+    std::vector<Quadric> quadrics(verticesCount);
+    for(size_t t = 0; t < indices.size() / 3; t++){
+        const unsigned int *triangle = &indices[3 * t];
+        double normal[3];
+        triangleNormal(triangle[0], triangle[1], triangle[2], normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(length <= 0.0)
+            continue;
+        for(double &component : normal)
+            component /= length;
+        const double *p0 = &points[3 * triangle[0]];
+        double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+        for(int k = 0; k < 3; k++)
+            quadrics[triangle[k]].AddPlane(normal, distance, 0.5 * length);
+    }
+
+    // Edges used by only one triangle are open borders or attribute seams, and more than two are non manifold
+    std::vector<bool> locked(verticesCount, false);
+    {
+        std::unordered_map<uint64_t, int> edgesUses;
+        edgesUses.reserve(indices.size());
+        for(size_t i = 0; i < indices.size(); i += 3){
+            for(int k = 0; k < 3; k++){
+                uint64_t a = indices[i + k];
+                uint64_t b = indices[i + (k + 1) % 3];
+                edgesUses[std::min(a, b) << 32 | std::max(a, b)]++;
+            }
+        }
+        for(auto &&[edge, uses] : edgesUses){
+            if(uses != 2){
+                locked[edge >> 32] = true;
+                locked[edge & 0xffffffffu] = true;
+            }
+        }
+    }
+
+    struct Collapse{
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+    double maxCost = static_cast<double>(targetError) * targetError;
+    double resultCost = 0.0;
+    std::vector<unsigned int> adjacencyOffsets(verticesCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(verticesCount);
+    std::vector<bool> touched(verticesCount);
+    std::vector<Collapse> collapses;
+    for(int pass = 0; pass < maxPasses && indices.size() > targetIndicesCount; pass++){
+        size_t trianglesCount = indices.size() / 3;
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for(unsigned int index : indices)
+            adjacencyOffsets[index + 1]++;
+        for(size_t v = 0; v < verticesCount; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(indices.size());
+        {
+            std::vector<unsigned int> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(size_t t = 0; t < trianglesCount; t++){
+                for(int k = 0; k < 3; k++)
+                    adjacency[fillOffsets[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+            }
+        }
+
+        // Interior edges appear in both directions, so each one is evaluated once
+        collapses.clear();
+        for(size_t i = 0; i < indices.size(); i += 3){
+            for(int k = 0; k < 3; k++){
+                unsigned int a = indices[i + k];
+                unsigned int b = indices[i + (k + 1) % 3];
+                if(a > b || (locked[a] && locked[b]))
+                    continue;
+                Quadric quadric = quadrics[a];
+                quadric.Add(quadrics[b]);
+                double attributesCost = 0.0;
+                for(int e = 0; e < attributesStride; e++){
+                    double difference = attributes[a * attributesStride + e] - attributes[b * attributesStride + e];
+                    attributesCost += difference * difference;
+                }
+                double costToB = locked[a] ? HUGE_VAL : quadric.Evaluate(&points[3 * b]);
+                double costToA = locked[b] ? HUGE_VAL : quadric.Evaluate(&points[3 * a]);
+                if(costToB <= costToA)
+                    collapses.push_back({a, b, costToB + attributesCost});
+                else
+                    collapses.push_back({b, a, costToA + attributesCost});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y){
+            return x.cost < y.cost;
+        });
+
+        for(size_t v = 0; v < verticesCount; v++)
+            remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t trianglesToRemove = trianglesCount - targetIndicesCount / 3;
+        size_t removedTriangles = 0;
+        size_t collapsesCount = 0;
+        for(const Collapse &collapse : collapses){
+            if(collapse.cost > maxCost || removedTriangles >= trianglesToRemove)
+                break;
+            if(touched[collapse.from] || touched[collapse.to])
+                continue;
+            // Collapse is rejected if a remaining triangle around source vertex flips
+            bool flips = false;
+            size_t collapsedTriangles = 0;
+            for(unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++){
+                const unsigned int *triangle = &indices[3 * adjacency[a]];
+                if(triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to){
+                    collapsedTriangles++;
+                    continue;
+                }
+                int corner = triangle[0] == collapse.from ? 0 : (triangle[1] == collapse.from ? 1 : 2);
+                unsigned int i1 = triangle[(corner + 1) % 3];
+                unsigned int i2 = triangle[(corner + 2) % 3];
+                double before[3], after[3];
+                triangleNormal(collapse.from, i1, i2, before);
+                triangleNormal(collapse.to, i1, i2, after);
+                double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                double afterLength = after[0] * after[0] + after[1] * after[1] + after[2] * after[2];
+                if(dot <= 0.0 || afterLength <= 0.0)
+                    flips = true;
+            }
+            if(flips)
+                continue;
+            // Vertices of triangles around source vertex change, so they wait for next pass
+            for(unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++){
+                const unsigned int *triangle = &indices[3 * adjacency[a]];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            resultCost = std::max(resultCost, collapse.cost);
+            removedTriangles += collapsedTriangles;
+            collapsesCount++;
+        }
+        if(collapsesCount == 0)
+            break;
+
+        // Applies collapses and removes degenerated triangles
+        size_t writeIndex = 0;
+        for(size_t i = 0; i < indices.size(); i += 3){
+            unsigned int i0 = remap[indices[i]];
+            unsigned int i1 = remap[indices[i + 1]];
+            unsigned int i2 = remap[indices[i + 2]];
+            if(i0 == i1 || i1 == i2 || i0 == i2)
+                continue;
+            indices[writeIndex++] = i0;
+            indices[writeIndex++] = i1;
+            indices[writeIndex++] = i2;
+        }
+        indices.resize(writeIndex);
+    }
+    return static_cast<float>(std::sqrt(resultCost));
+}
+
+void MeshSimplifier::ReadAttributes(Mesh &mesh, std::vector<float> &attributes, int &attributesStride)
+{
+    size_t verticesCount = mesh.GetVerticesCount();
+    std::vector<std::pair<std::vector<float>, int>> streams;
+    for(auto &&attributeData : mesh.GetAttributesDatas()){
+        const MeshAttribute &attribute = attributeData.attribute;
+        int elements = attribute.ScalarElementsCount();
+        if(attribute.alias == MeshAttributeAlias::Normal && elements >= 3){
+            std::vector<float> normals(3 * verticesCount);
+            if(attribute.type == MeshAttributeType::Float){
+                auto values = attributeData.View<float>();
+                for(size_t v = 0; v < verticesCount; v++)
+                    for(int k = 0; k < 3; k++)
+                        normals[3 * v + k] = values[v][k] * normalWeight;
+            } else if(attribute.type == MeshAttributeType::Short && attribute.normalized){
+                auto values = attributeData.View<short>();
+                for(size_t v = 0; v < verticesCount; v++)
+                    for(int k = 0; k < 3; k++)
+                        normals[3 * v + k] = std::max(values[v][k] / 32767.0f, -1.0f) * normalWeight;
+            } else {
+                continue;
+            }
+            streams.emplace_back(std::move(normals), 3);
+        } else if(attribute.alias == MeshAttributeAlias::TexCoord0 && elements == 2){
+            std::vector<float> texCoords(2 * verticesCount);
+            if(attribute.type == MeshAttributeType::Float){
+                auto values = attributeData.View<float>();
+                for(size_t v = 0; v < verticesCount; v++)
+                    for(int k = 0; k < 2; k++)
+                        texCoords[2 * v + k] = values[v][k] * texCoordWeight;
+            } else if(attribute.type == MeshAttributeType::UnsignedShort && attribute.normalized){
+                auto values = attributeData.View<unsigned short>();
+                for(size_t v = 0; v < verticesCount; v++)
+                    for(int k = 0; k < 2; k++)
+                        texCoords[2 * v + k] = values[v][k] / 65535.0f * texCoordWeight;
+            } else {
+                continue;
+            }
+            streams.emplace_back(std::move(texCoords), 2);
+        }
+    }
+    attributesStride = 0;
+    for(auto &&stream : streams)
+        attributesStride += stream.second;
+    attributes.resize(verticesCount * attributesStride);
+    int offset = 0;
+    for(auto &&[values, elements] : streams){
+        for(size_t v = 0; v < verticesCount; v++)
+            std::copy_n(&values[v * elements], elements, &attributes[v * attributesStride + offset]);
+        offset += elements;
+    }
+}
+
+int MeshSimplifier::BuildLODs(Mesh &mesh, int lodsCount, float targetError)
+{
+    mesh.ClearLODs();
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    if(mesh.GetTopology() != MeshTopology::Triangles || !MeshOptimizer::ReadIndices(mesh, indices) ||
+    !MeshOptimizer::ReadPositions(mesh, positions) || indices.empty())
+        return 0;
+    // Bounding sphere centered in bounds, which is enough for selection of levels
+    glm::vec3 minBounds(positions[0], positions[1], positions[2]);
+    glm::vec3 maxBounds = minBounds;
+    for(size_t i = 0; i < positions.size(); i += 3){
+        glm::vec3 position(positions[i], positions[i + 1], positions[i + 2]);
+        minBounds = glm::min(minBounds, position);
+        maxBounds = glm::max(maxBounds, position);
+    }
+    glm::vec3 center = 0.5f * (minBounds + maxBounds);
+    float radius = 0.0f;
+    for(size_t i = 0; i < positions.size(); i += 3)
+        radius = std::max(radius, glm::length(glm::vec3(positions[i], positions[i + 1], positions[i + 2]) - center));
+    mesh.SetBoundingSphere(glm::vec4(center, radius));
+
+    std::vector<float> attributes;
+    int attributesStride = 0;
+    ReadAttributes(mesh, attributes, attributesStride);
+    // Simplification errors are relative to half bounds diagonal, which is rescaled to sphere radius
+    float errorScale = radius > 0.0f ? 0.5f * glm::length(maxBounds - minBounds) / radius : 1.0f;
+    float error = 0.0f;
+    for(int level = 0; level < lodsCount && error < targetError; level++){
+        size_t previousIndicesCount = indices.size();
+        size_t targetIndicesCount = (previousIndicesCount / 6) * 3;
+        float levelError = MeshSimplifier::Simplify(indices, positions, attributes, attributesStride, targetIndicesCount,
+        (targetError - error) / errorScale);
+        // Stops when borders or error budget prevent meaningful reduction
+        if(indices.empty() || indices.size() > previousIndicesCount * 0.9)
+            break;
+        error += levelError * errorScale;
+        MeshOptimizer::OptimizeVertexCache(indices, mesh.GetVerticesCount());
+        mesh.PushLOD(indices, error);
+    }
+    return mesh.GetLODsCount();
+}
@@ -0,0 +1,35 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+#include <vector>
+#include "Mesh.hpp"
+
+// Quadric error metric simplification by collapsing edges onto existing vertices, so simplified
+// index buffers share the vertices of the source mesh. Vertices on open, seam or non manifold edges are locked
+class MeshSimplifier{
+private:
+    // Symmetric 4x4 plane quadric with accumulated area weight
+    struct Quadric{
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0, weight = 0.0;
+        void AddPlane(const double *normal, double distance, double planeWeight);
+        void Add(const Quadric &quadric);
+        // Mean squared distance of point to accumulated planes
+        double Evaluate(const double *point) const;
+    };
+    static const int maxPasses = 100;
+    // Weights of attributes in collapse error, relative to squared distances in mesh radius units
+    static constexpr float normalWeight = 0.05f;
+    static constexpr float texCoordWeight = 0.05f;
+    // Weighted normals and texture coordinates per vertex. Compressed normal formats are not read
+    static void ReadAttributes(Mesh &mesh, std::vector<float> &attributes, int &attributesStride);
+public:
+    static const int maxLODsCount = 4;
+    // Simplifies indices until target indices count is reached or collapses exceed target error, relative
+    // to positions bounding radius. Attributes are optional (stride 0). Returns reached error
+    static float Simplify(std::vector<unsigned int> &indices, const std::vector<float> &positions,
+    const std::vector<float> &attributes, int attributesStride, size_t targetIndicesCount, float targetError);
+    // Builds a chain of LODs, each with about half triangles of previous level, while accumulated error is
+    // below target error. Also sets mesh bounding sphere. Returns LODs count
+    static int BuildLODs(Mesh &mesh, int lodsCount = maxLODsCount, float targetError = 0.1f);
+};
+#endif
@@ -0,0 +1,120 @@
+#include "MeshletBuilder.hpp"
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+void MeshletBuilder::BuildMeshlets(const std::vector<unsigned int> &indices, size_t verticesCount, std::vector<Meshlet> &meshlets,
+int meshletMaxVertices, int meshletMaxTriangles)
+{
+    meshlets.clear();
+    // Meshlet that last used each vertex
+    std::vector<unsigned int> vertexMeshlet(verticesCount, ~0u);
+    Meshlet meshlet;
+    int meshletVertices = 0;
+    for(size_t i = 0; i + 2 < indices.size(); i += 3){
+        unsigned int meshletIndex = meshlets.size();
+        int newVertices = 0;
+        for(int k = 0; k < 3; k++){
+            bool repeated = (k > 0 && indices[i + k] == indices[i]) || (k > 1 && indices[i + k] == indices[i + 1]);
+            if(vertexMeshlet[indices[i + k]] != meshletIndex && !repeated)
+                newVertices++;
+        }
+        if(meshletVertices + newVertices > meshletMaxVertices || static_cast<int>(meshlet.indicesCount / 3) >= meshletMaxTriangles){
+            meshlets.push_back(meshlet);
+            meshletIndex++;
+            meshlet.firstIndex = i;
+            meshlet.indicesCount = 0;
+            meshletVertices = 0;
+        }
+        for(int k = 0; k < 3; k++){
+            if(vertexMeshlet[indices[i + k]] != meshletIndex){
+                vertexMeshlet[indices[i + k]] = meshletIndex;
+                meshletVertices++;
+            }
+        }
+        meshlet.indicesCount += 3;
+    }
+    if(meshlet.indicesCount > 0)
+        meshlets.push_back(meshlet);
+}
+
+void MeshletBuilder::ComputeBounds(Meshlet &meshlet, const std::vector<unsigned int> &indices, const std::vector<float> &positions)
+{
+    auto position = [&positions](unsigned int vertex){
+        return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]);
+    };
+    unsigned int begin = meshlet.firstIndex;
+    unsigned int end = meshlet.firstIndex + meshlet.indicesCount;
+    glm::vec3 minBounds = position(indices[begin]);
+    glm::vec3 maxBounds = minBounds;
+    for(unsigned int i = begin; i < end; i++){
+        minBounds = glm::min(minBounds, position(indices[i]));
+        maxBounds = glm::max(maxBounds, position(indices[i]));
+    }
+    glm::vec3 center = 0.5f * (minBounds + maxBounds);
+    float radius = 0.0f;
+    for(unsigned int i = begin; i < end; i++)
+        radius = std::max(radius, glm::length(position(indices[i]) - center));
+    meshlet.boundingSphere = glm::vec4(center, radius);
+
+    // Normal cone from outward normals of left handed meshes: cross(p2 - p0, p1 - p0)
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indicesCount / 3);
+    glm::vec3 axis(0.0f);
+    for(unsigned int i = begin; i < end; i += 3){
+        glm::vec3 p0 = position(indices[i]);
+        glm::vec3 normal = glm::cross(position(indices[i + 2]) - p0, position(indices[i + 1]) - p0);
+        float area = glm::length(normal);
+        if(area <= 0.0f)
+            continue;
+        normals.push_back(normal / area);
+        axis += normals.back();
+    }
+    meshlet.coneApex = center;
+    meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    float axisLength = glm::length(axis);
+    if(normals.empty() || axisLength <= 0.0f)
+        return;
+    axis /= axisLength;
+    float minDot = 1.0f;
+    for(const glm::vec3 &normal : normals)
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    // Wide cones would never cull and make apex unstable
+    if(minDot <= 0.1f)
+        return;
+    // Apex is the point on axis behind every triangle plane
+    float maxT = 0.0f;
+    size_t normalIndex = 0;
+    for(unsigned int i = begin; i < end; i += 3){
+        glm::vec3 p0 = position(indices[i]);
+        glm::vec3 normal = glm::cross(position(indices[i + 2]) - p0, position(indices[i + 1]) - p0);
+        if(glm::length(normal) <= 0.0f)
+            continue;
+        const glm::vec3 &unitNormal = normals[normalIndex++];
+        maxT = std::max(maxT, glm::dot(center - p0, unitNormal) / glm::dot(axis, unitNormal));
+    }
+    meshlet.coneApex = center - axis * maxT;
+    meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+int MeshletBuilder::Build(Mesh &mesh, bool optimized)
+{
+    std::vector<unsigned int> indices;
+    std::vector<float> positions;
+    if(mesh.GetTopology() != MeshTopology::Triangles || !MeshOptimizer::ReadIndices(mesh, indices) ||
+    !MeshOptimizer::ReadPositions(mesh, positions) || indices.empty())
+        return 0;
+    // Cache ordered triangles are spatially coherent, so sequential grouping gives compact meshlets. Overdraw
+    // ordering moves whole cache ordered clusters, so optimized meshes already are
+    if(!optimized)
+        MeshOptimizer::OptimizeVertexCache(indices, mesh.GetVerticesCount());
+    std::vector<Meshlet> meshlets;
+    BuildMeshlets(indices, mesh.GetVerticesCount(), meshlets);
+    for(Meshlet &meshlet : meshlets)
+        ComputeBounds(meshlet, indices, positions);
+    if(!optimized)
+        MeshOptimizer::WriteIndices(mesh, indices);
+    int meshletsCount = meshlets.size();
+    mesh.SetMeshlets(std::move(meshlets));
+    return meshletsCount;
+}
@@ -0,0 +1,20 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+#include <vector>
+#include "Mesh.hpp"
+
+// Splits triangle meshes into meshlets with bounding spheres and normal cones for cluster culling.
+// Mesh triangles are reordered so each meshlet is a contiguous range of mesh indices
+class MeshletBuilder{
+public:
+    static const int maxVertices = 64;
+    static const int maxTriangles = 124;
+    // Groups triangles in order, starting a new meshlet when vertices or triangles limits are reached
+    static void BuildMeshlets(const std::vector<unsigned int> &indices, size_t verticesCount, std::vector<Meshlet> &meshlets,
+    int meshletMaxVertices = maxVertices, int meshletMaxTriangles = maxTriangles);
+    static void ComputeBounds(Meshlet &meshlet, const std::vector<unsigned int> &indices, const std::vector<float> &positions);
+    // Returns meshlets count. Only triangle meshes are split. Triangles of optimized meshes keep their order, so
+    // overdraw ordering of MeshOptimizer is not undone
+    static int Build(Mesh &mesh, bool optimized = false);
+};
+#endif
@@ -0,0 +1,279 @@
+#include "MipmapGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+const float MipmapGenerator::kaiserAlpha = 4.0f;
+const float MipmapGenerator::kaiserRadius = 3.0f;
+const int MipmapGenerator::linearToSRGBTableSize = 1 << 14;
+
+const std::vector<float> &MipmapGenerator::SRGBToLinearTable()
+{
+    static const std::vector<float> table = [](){
+        std::vector<float> values(256);
+        for(int i = 0; i < 256; i++){
+            float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table;
+}
+
+const std::vector<unsigned char> &MipmapGenerator::LinearToSRGBTable()
+{
+    static const std::vector<unsigned char> table = [](){
+        std::vector<unsigned char> values(linearToSRGBTableSize);
+        for(int i = 0; i < linearToSRGBTableSize; i++){
+            float c = i / static_cast<float>(linearToSRGBTableSize - 1);
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            values[i] = static_cast<unsigned char>(std::clamp(std::round(s * 255.0f), 0.0f, 255.0f));
+        }
+        return values;
+    }();
+    return table;
+}
+
+float MipmapGenerator::BesselI0(float x)
+{
+    // Power series of modified Bessel function of first kind, order 0
+    float sum = 1.0f;
+    float term = 1.0f;
+    float halfX = x * 0.5f;
+    for(int k = 1; k < 32; k++){
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if(term < sum * 1e-8f)
+            break;
+    }
+    return sum;
+}
+
+float MipmapGenerator::KaiserWeight(float distance)
+{
+    // Windowed sinc. Distance is given in destination texels
+    float t = distance / kaiserRadius;
+    if(std::abs(t) >= 1.0f)
+        return 0.0f;
+    float sinc = distance == 0.0f ? 1.0f : std::sin(glm::pi<float>() * distance) / (glm::pi<float>() * distance);
+    float window = BesselI0(kaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(kaiserAlpha);
+    return sinc * window;
+}
+
+MipmapGenerator::AxisTaps MipmapGenerator::ComputeAxisTaps(int srcSize, int dstSize, MipmapFilter filter)
+{
+    AxisTaps taps;
+    float scale = srcSize / static_cast<float>(dstSize);
+    float support = (filter == MipmapFilter::Box ? 0.5f : kaiserRadius) * scale;
+    taps.tapsCount = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+    taps.indices = std::vector<int>(dstSize * taps.tapsCount, 0);
+    taps.weights = std::vector<float>(dstSize * taps.tapsCount, 0.0f);
+
+    for(int i = 0; i < dstSize; i++){
+        float center = (i + 0.5f) * scale;
+        int first = static_cast<int>(std::floor(center - support));
+        float weightsSum = 0.0f;
+        for(int k = 0; k < taps.tapsCount; k++){
+            int s = first + k;
+            float weight = 0.0f;
+            if(filter == MipmapFilter::Box){
+                // Coverage of source texel inside destination footprint
+                float low = center - support;
+                float high = center + support;
+                weight = std::max(0.0f, std::min(static_cast<float>(s + 1), high) - std::max(static_cast<float>(s), low));
+            } else {
+                weight = KaiserWeight((s + 0.5f - center) / scale);
+            }
+            // Textures use repeat wrapping, so filter footprint wraps around borders
+            taps.indices[i * taps.tapsCount + k] = ((s % srcSize) + srcSize) % srcSize;
+            taps.weights[i * taps.tapsCount + k] = weight;
+            weightsSum += weight;
+        }
+        for(int k = 0; k < taps.tapsCount; k++){
+            taps.weights[i * taps.tapsCount + k] /= weightsSum;
+        }
+    }
+    return taps;
+}
+
+void MipmapGenerator::DecodeLevel(const unsigned char *src, int width, int height, int channels, bool isSRGB, std::vector<float> &dst)
+{
+    const auto &toLinear = SRGBToLinearTable();
+    dst.resize(static_cast<size_t>(width) * height * 4);
+    tbb::parallel_for(tbb::blocked_range<int>(0, height), [&](const tbb::blocked_range<int> &rows){
+        for(int y = rows.begin(); y < rows.end(); y++){
+            const unsigned char *srcRow = src + static_cast<size_t>(y) * width * channels;
+            float *dstRow = dst.data() + static_cast<size_t>(y) * width * 4;
+            for(int x = 0; x < width; x++){
+                float *texel = dstRow + x * 4;
+                texel[0] = texel[1] = texel[2] = 0.0f;
+                texel[3] = 1.0f;
+                for(int c = 0; c < channels; c++){
+                    unsigned char value = srcRow[x * channels + c];
+                    // Alpha is always stored linearly
+                    texel[c] = isSRGB && c < 3 ? toLinear[value] : value / 255.0f;
+                }
+            }
+        }
+    });
+}
+
+void MipmapGenerator::EncodeLevel(const std::vector<float> &src, int width, int height, int channels, bool isSRGB, unsigned char *dst)
+{
+    const auto &toSRGB = LinearToSRGBTable();
+    tbb::parallel_for(tbb::blocked_range<int>(0, height), [&](const tbb::blocked_range<int> &rows){
+        for(int y = rows.begin(); y < rows.end(); y++){
+            const float *srcRow = src.data() + static_cast<size_t>(y) * width * 4;
+            unsigned char *dstRow = dst + static_cast<size_t>(y) * width * channels;
+            for(int x = 0; x < width; x++){
+                const float *texel = srcRow + x * 4;
+                for(int c = 0; c < channels; c++){
+                    // Kaiser filter may overshoot, so values are clamped before quantization
+                    float value = std::clamp(texel[c], 0.0f, 1.0f);
+                    if(isSRGB && c < 3)
+                        dstRow[x * channels + c] = toSRGB[static_cast<int>(value * (linearToSRGBTableSize - 1) + 0.5f)];
+                    else
+                        dstRow[x * channels + c] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+                }
+            }
+        }
+    });
+}
+
+void MipmapGenerator::DownsampleBox2x(const std::vector<float> &src, int srcWidth, int srcHeight, std::vector<float> &dst)
+{
+    int dstWidth = srcWidth / 2;
+    int dstHeight = srcHeight / 2;
+    dst.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+    tbb::parallel_for(tbb::blocked_range<int>(0, dstHeight), [&](const tbb::blocked_range<int> &rows){
+        for(int y = rows.begin(); y < rows.end(); y++){
+            const float *row0 = src.data() + static_cast<size_t>(2 * y) * srcWidth * 4;
+            const float *row1 = row0 + static_cast<size_t>(srcWidth) * 4;
+            float *dstRow = dst.data() + static_cast<size_t>(y) * dstWidth * 4;
+            int x = 0;
+#ifdef __AVX__
+            // Two destination texels (four source texels per row) for each iteration
+            const __m256 quarter = _mm256_set1_ps(0.25f);
+            for(; x + 2 <= dstWidth; x += 2){
+                __m256 a01 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+                __m256 a23 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+                __m256 even = _mm256_permute2f128_ps(a01, a23, 0x20);
+                __m256 odd = _mm256_permute2f128_ps(a01, a23, 0x31);
+                _mm256_storeu_ps(dstRow + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter));
+            }
+#endif
+            for(; x < dstWidth; x++){
+                for(int c = 0; c < 4; c++){
+                    dstRow[x * 4 + c] = 0.25f * (row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c]);
+                }
+            }
+        }
+    });
+}
+
+void MipmapGenerator::DownsampleSeparable(const std::vector<float> &src, int srcWidth, int srcHeight,
+std::vector<float> &dst, int dstWidth, int dstHeight, MipmapFilter filter)
+{
+    AxisTaps horizontalTaps = ComputeAxisTaps(srcWidth, dstWidth, filter);
+    AxisTaps verticalTaps = ComputeAxisTaps(srcHeight, dstHeight, filter);
+    // Horizontal pass: srcWidth x srcHeight -> dstWidth x srcHeight
+    std::vector<float> temp(static_cast<size_t>(dstWidth) * srcHeight * 4);
+    tbb::parallel_for(tbb::blocked_range<int>(0, srcHeight), [&](const tbb::blocked_range<int> &rows){
+        for(int y = rows.begin(); y < rows.end(); y++){
+            const float *srcRow = src.data() + static_cast<size_t>(y) * srcWidth * 4;
+            float *tempRow = temp.data() + static_cast<size_t>(y) * dstWidth * 4;
+            for(int x = 0; x < dstWidth; x++){
+                const int *indices = horizontalTaps.indices.data() + x * horizontalTaps.tapsCount;
+                const float *weights = horizontalTaps.weights.data() + x * horizontalTaps.tapsCount;
+#ifdef __AVX__
+                __m128 acc = _mm_setzero_ps();
+                for(int k = 0; k < horizontalTaps.tapsCount; k++){
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(srcRow + indices[k] * 4), _mm_set1_ps(weights[k])));
+                }
+                _mm_storeu_ps(tempRow + x * 4, acc);
+#else
+                float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                for(int k = 0; k < horizontalTaps.tapsCount; k++){
+                    for(int c = 0; c < 4; c++)
+                        acc[c] += srcRow[indices[k] * 4 + c] * weights[k];
+                }
+                std::copy(acc, acc + 4, tempRow + x * 4);
+#endif
+            }
+        }
+    });
+    // Vertical pass: dstWidth x srcHeight -> dstWidth x dstHeight. Rows are accumulated entirely
+    dst.assign(static_cast<size_t>(dstWidth) * dstHeight * 4, 0.0f);
+    int rowFloats = dstWidth * 4;
+    tbb::parallel_for(tbb::blocked_range<int>(0, dstHeight), [&](const tbb::blocked_range<int> &rows){
+        for(int y = rows.begin(); y < rows.end(); y++){
+            float *dstRow = dst.data() + static_cast<size_t>(y) * rowFloats;
+            for(int k = 0; k < verticalTaps.tapsCount; k++){
+                float weight = verticalTaps.weights[y * verticalTaps.tapsCount + k];
+                if(weight == 0.0f)
+                    continue;
+                const float *tempRow = temp.data() + static_cast<size_t>(verticalTaps.indices[y * verticalTaps.tapsCount + k]) * rowFloats;
+                int i = 0;
+#ifdef __AVX__
+                __m256 w = _mm256_set1_ps(weight);
+                for(; i + 8 <= rowFloats; i += 8){
+                    __m256 acc = _mm256_loadu_ps(dstRow + i);
+                    _mm256_storeu_ps(dstRow + i, _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(tempRow + i), w)));
+                }
+#endif
+                for(; i < rowFloats; i++){
+                    dstRow[i] += tempRow[i] * weight;
+                }
+            }
+        }
+    });
+}
+
+bool MipmapGenerator::IsFormatSupported(gli::format format)
+{
+    switch(format){
+        case gli::FORMAT_R8_UNORM_PACK8:
+        case gli::FORMAT_RG8_UNORM_PACK8:
+        case gli::FORMAT_RGB8_UNORM_PACK8:
+        case gli::FORMAT_RGB8_SRGB_PACK8:
+        case gli::FORMAT_RGBA8_UNORM_PACK8:
+        case gli::FORMAT_RGBA8_SRGB_PACK8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MipmapGenerator::Generate(gli::texture2d &texture, MipmapFilter filter)
+{
+    if(texture.empty() || !IsFormatSupported(texture.format()))
+        return false;
+
+    int channels = static_cast<int>(gli::component_count(texture.format()));
+    bool isSRGB = gli::is_srgb(texture.format());
+    int width = texture.extent(0).x;
+    int height = texture.extent(0).y;
+    // Previous level is kept in float, so each level is quantized only once
+    std::vector<float> current;
+    std::vector<float> next;
+    DecodeLevel(static_cast<const unsigned char*>(texture.data(0, 0, 0)), width, height, channels, isSRGB, current);
+
+    for(size_t level = 1; level < texture.levels(); level++){
+        int nextWidth = texture.extent(level).x;
+        int nextHeight = texture.extent(level).y;
+        if(filter == MipmapFilter::Box && width == nextWidth * 2 && height == nextHeight * 2)
+            DownsampleBox2x(current, width, height, next);
+        else
+            DownsampleSeparable(current, width, height, next, nextWidth, nextHeight, filter);
+        EncodeLevel(next, nextWidth, nextHeight, channels, isSRGB, static_cast<unsigned char*>(texture.data(0, 0, level)));
+        std::swap(current, next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+#include <gli/gli.hpp>
+#include <vector>
+
+enum class MipmapFilter{
+    Box,
+    Kaiser
+};
+
+// Builds mip chains on CPU for 8 bit per channel formats. Filtering is done in linear space,
+// so sRGB images are decoded before downsampling and encoded back only when a level is written
+class MipmapGenerator{
+private:
+    // Separable filter weights for one axis. Each destination texel has tapsCount taps
+    struct AxisTaps{
+        int tapsCount = 0;
+        std::vector<int> indices;
+        std::vector<float> weights;
+    };
+    static const float kaiserAlpha;
+    static const float kaiserRadius; // In destination texels
+    static const int linearToSRGBTableSize;
+    static const std::vector<float> &SRGBToLinearTable();
+    static const std::vector<unsigned char> &LinearToSRGBTable();
+    static float BesselI0(float x);
+    static float KaiserWeight(float distance);
+    static AxisTaps ComputeAxisTaps(int srcSize, int dstSize, MipmapFilter filter);
+    // Level data is expanded to RGBA float (4 floats per texel) in linear space
+    static void DecodeLevel(const unsigned char *src, int width, int height, int channels, bool isSRGB, std::vector<float> &dst);
+    static void EncodeLevel(const std::vector<float> &src, int width, int height, int channels, bool isSRGB, unsigned char *dst);
+    // Fast path for even dimensions with box filter
+    static void DownsampleBox2x(const std::vector<float> &src, int srcWidth, int srcHeight, std::vector<float> &dst);
+    static void DownsampleSeparable(const std::vector<float> &src, int srcWidth, int srcHeight,
+    std::vector<float> &dst, int dstWidth, int dstHeight, MipmapFilter filter);
+public:
+    static bool IsFormatSupported(gli::format format);
+    // Fills every level after the base level of texture. Returns false for unsupported formats
+    static bool Generate(gli::texture2d &texture, MipmapFilter filter = MipmapFilter::Box);
+};
+#endif
@@ -1,9 +1,19 @@
 #include "Model.hpp"
 #include "ShaderStandard.hpp"
 #include "Constants.hpp"
+#include "GLTFLoader.hpp"
+#include "AttributeQuantizer.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
 #include <stb/stb_image.h>
 #include <gli/gli.hpp>
-#include <variant>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+#include <numeric>
+#include <chrono>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <fmt/core.h>
 
 void Model::processNode(aiNode *node, const aiScene *scene, const aiMatrix4x4 &parentTransform)
@@ -29,7 +39,14 @@ void Model::processNode(aiNode *node, const aiScene *scene, const aiMatrix4x4 &p
         scale *= this->scale;
         TransformComponent transform(position, rotation, scale);
 
-        components.emplace_back(MeshRendererComponent(myMesh, myMaterial), transform);
+        MeshRendererComponent meshRenderer(myMesh, myMaterial);
+        if(animator && myMesh->IsDeformable()){
+            meshRenderer.animator = animator;
+            meshRenderer.animatorNode = skeletonNodes.at(node);
+            if(myMesh->IsSkinned())
+                meshRenderer.skin = processSkin(mesh);
+        }
+        components.emplace_back(std::move(meshRenderer), transform);
     }
 
     // Processa os filhos recursivamente
@@ -40,171 +57,349 @@ void Model::processNode(aiNode *node, const aiScene *scene, const aiMatrix4x4 &p
 
 Ref<Mesh> Model::processMesh(aiMesh *mesh)
 {
+    static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "aiVector3D must be tightly packed floats");
+    static_assert(sizeof(aiColor4D) == 4 * sizeof(float), "aiColor4D must be tightly packed floats");
     Ref<Mesh> meshData = CreateRef<Mesh>();
     std::vector<float> vertices;
+    std::vector<unsigned short> verticesQuantized;
     std::vector<short> normals;
-    std::variant<std::vector<float>, std::vector<unsigned short>> texCoords0 = std::vector<unsigned short>();
+    std::vector<short> qTangents;
+    std::vector<float> texCoords0Float;
+    std::vector<unsigned short> texCoords0Unorm;
     std::vector<short> tangents;
     std::vector<short> bitangents;
     std::vector<unsigned char> colors;
-    std::variant<std::vector<unsigned int>, std::vector<unsigned short>> indices;
+    std::vector<float> normalsFloat;
+    std::vector<float> tangentsFloat;
+    std::vector<float> bitangentsFloat;
 
-    size_t verticesVec2Size = 2 * mesh->mNumVertices;
-    size_t verticesVec3Size = 3 * mesh->mNumVertices;
-    size_t verticesVec4Size = 4 * mesh->mNumVertices;
+    size_t verticesCount = mesh->mNumVertices;
+    size_t verticesVec2Size = 2 * verticesCount;
+    size_t verticesVec3Size = 3 * verticesCount;
+    size_t verticesVec4Size = 4 * verticesCount;
 
     bool hasNormals = mesh->HasNormals();
     bool hasTexCoords0 = mesh->HasTextureCoords(0);
     bool hasTangentsAndBitangents = mesh->HasTangentsAndBitangents();
     bool hasColors = mesh->HasVertexColors(0);
-
-    // Vectors initilization
-    vertices.resize(verticesVec3Size);
-    if(hasNormals)
-        normals.resize(verticesVec3Size);
-
-    if(hasTangentsAndBitangents){
-        tangents.resize(verticesVec3Size);
-        bitangents.resize(verticesVec3Size);
+    // Skinning writes whole floats, so deformable meshes keep float positions and tangent frames
+    bool deformable = (mesh->HasBones() && mesh->mNumBones <= 256) || mesh->mNumAnimMeshes > 0;
+    bool compress = vertexCompressionFlag && !deformable;
+    // Compressed tangent frame uses a QTangent when available, otherwise octahedral normals
+    bool useQTangents = compress && hasNormals && hasTangentsAndBitangents;
+    bool useOctahedralNormals = compress && hasNormals && !hasTangentsAndBitangents;
+    glm::vec3 boundsOffset(0.0f);
+    glm::vec3 boundsScale(1.0f);
+    if(compress && verticesCount > 0){
+        glm::vec3 minValues, maxValues;
+        AttributeQuantizer::MinMax(&mesh->mVertices[0].x, verticesCount, 3, &minValues.x, &maxValues.x);
+        boundsOffset = minValues;
+        boundsScale = maxValues - minValues;
     }
 
-    if(hasColors){
-        colors.resize(verticesVec4Size);
+    // If mesh uses tex coords outside [-1, 1] boundary, store them as float for correct interpolating on fragment shader
+    bool texCoordsAsFloat = false;
+    if(hasTexCoords0){
+        float minValues[3], maxValues[3];
+        AttributeQuantizer::MinMax(&mesh->mTextureCoords[0][0].x, verticesCount, 3, minValues, maxValues);
+        texCoordsAsFloat = minValues[0] < -1.0f || minValues[1] < -1.0f || maxValues[0] > 1.0f || maxValues[1] > 1.0f;
     }
-    // This is loop check if mesh uses tex coords outside [0, 1] boundary
-    // If this is true, store tex coords as float for correct interpolating on fragment shader
-    for(unsigned int i = 0; i < mesh->mNumVertices; i++){
-        if(std::abs(mesh->mTextureCoords[0][i].x) > 1.0f || std::abs(mesh->mTextureCoords[0][i].y) > 1.0f){
-            texCoords0 = std::vector<float>();
-            break;
+
+    // Vectors initilization
+    if(compress)
+        verticesQuantized.resize(verticesVec4Size);
+    else
+        vertices.resize(verticesVec3Size);
+    if(texCoordsAsFloat)
+        texCoords0Float.resize(verticesVec2Size);
+    else
+        texCoords0Unorm.resize(verticesVec2Size); // Zero when mesh has no tex coords
+    if(useQTangents){
+        qTangents.resize(verticesVec4Size);
+    } else if(useOctahedralNormals){
+        normals.resize(verticesVec2Size);
+    } else if(deformable){
+        if(hasNormals)
+            normalsFloat.resize(verticesVec3Size);
+        if(hasTangentsAndBitangents){
+            tangentsFloat.resize(verticesVec3Size);
+            bitangentsFloat.resize(verticesVec3Size);
+        }
+    } else {
+        if(hasNormals)
+            normals.resize(verticesVec3Size);
+        if(hasTangentsAndBitangents){
+            tangents.resize(verticesVec3Size);
+            bitangents.resize(verticesVec3Size);
         }
     }
-    std::visit([verticesVec2Size](auto&& value){
-        value.resize(verticesVec2Size);
-    }, texCoords0);
-    //////
+    if(hasColors)
+        colors.resize(verticesVec4Size);
+
+    // Vertices are converted in chunks, each one running the vectorized kernels over contiguous assimp arrays
+    const size_t chunkSize = 16384;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, verticesCount, chunkSize), [&](const tbb::blocked_range<size_t> &range){
+        size_t begin = range.begin();
+        size_t count = range.size();
+        if(compress)
+            AttributeQuantizer::PositionsToUnorm16(&mesh->mVertices[begin].x, count, &boundsOffset.x, &boundsScale.x, &verticesQuantized[4 * begin]);
+        else
+            std::memcpy(&vertices[3 * begin], &mesh->mVertices[begin], 3 * count * sizeof(float));
+        if(useQTangents)
+            AttributeQuantizer::TangentFramesToQTangents(&mesh->mNormals[begin].x, &mesh->mTangents[begin].x, &mesh->mBitangents[begin].x, count, &qTangents[4 * begin]);
+        else if(useOctahedralNormals)
+            AttributeQuantizer::NormalsToOctahedral(&mesh->mNormals[begin].x, count, &normals[2 * begin]);
+        else if(deformable && hasNormals)
+            std::memcpy(&normalsFloat[3 * begin], &mesh->mNormals[begin], 3 * count * sizeof(float));
+        else if(hasNormals)
+            AttributeQuantizer::FloatToSnorm16(&mesh->mNormals[begin].x, 3 * count, &normals[3 * begin]);
+        if(hasTexCoords0){
+            if(texCoordsAsFloat){
+                for(size_t i = begin; i < range.end(); i++){
+                    texCoords0Float[2 * i] = mesh->mTextureCoords[0][i].x;
+                    texCoords0Float[2 * i + 1] = mesh->mTextureCoords[0][i].y;
+                }
+            } else {
+                AttributeQuantizer::Float2ToUnorm16(&mesh->mTextureCoords[0][begin].x, count, 3, &texCoords0Unorm[2 * begin]);
+            }
+        }
+        if(hasTangentsAndBitangents && deformable){
+            std::memcpy(&tangentsFloat[3 * begin], &mesh->mTangents[begin], 3 * count * sizeof(float));
+            std::memcpy(&bitangentsFloat[3 * begin], &mesh->mBitangents[begin], 3 * count * sizeof(float));
+        } else if(hasTangentsAndBitangents && !useQTangents){
+            AttributeQuantizer::FloatToSnorm16(&mesh->mTangents[begin].x, 3 * count, &tangents[3 * begin]);
+            AttributeQuantizer::FloatToSnorm16(&mesh->mBitangents[begin].x, 3 * count, &bitangents[3 * begin]);
+        }
+        if(hasColors)
+            AttributeQuantizer::FloatToUnorm8(&mesh->mColors[0][begin].r, 4 * count, &colors[4 * begin]);
+    });
 
     // This check if maxIndex <= 65535, allowing to unsigned short for indices
     unsigned int maxIndex = 0;
-    unsigned int totalNumIndices = 0;
-    // Iterar por todas as faces da malha
+    size_t totalNumIndices = 0;
     for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
         const aiFace& face = mesh->mFaces[i];
         totalNumIndices += face.mNumIndices;
-        // Iterar pelos índices da face atual
         for (unsigned int j = 0; j < face.mNumIndices; ++j) {
             maxIndex = std::max(maxIndex, face.mIndices[j]);
         }
     }
+    auto copyIndices = [mesh, totalNumIndices](auto &indices){
+        using T = typename std::decay<decltype(indices)>::type::value_type;
+        indices.resize(totalNumIndices);
+        size_t offset = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+            const aiFace& face = mesh->mFaces[i];
+            for (unsigned int j = 0; j < face.mNumIndices; j++) {
+                indices[offset++] = static_cast<T>(face.mIndices[j]);
+            }
+        }
+    };
+
+    if(compress)
+        meshData->PushAttributePosition(verticesQuantized, boundsOffset, boundsScale);
+    else
+        meshData->PushAttributePosition(vertices);
+    if(texCoordsAsFloat)
+        meshData->PushAttributeTexCoord0(texCoords0Float);
+    else
+        meshData->PushAttributeTexCoord0(texCoords0Unorm);
+    if(useQTangents){
+        meshData->PushAttributeQTangent(qTangents);
+    } else if(useOctahedralNormals){
+        meshData->PushAttributeNormalOctahedral(normals);
+    } else if(deformable){
+        if(hasNormals)
+            meshData->PushAttributeNormal(normalsFloat);
+        if(hasTangentsAndBitangents){
+            meshData->PushAttributeTangent(tangentsFloat);
+            meshData->PushAttributeBitangent(bitangentsFloat);
+        }
+    } else {
+        if(hasNormals)
+            meshData->PushAttributeNormal(normals);
+        if(hasTangentsAndBitangents){
+            meshData->PushAttributeTangent(tangents);
+            meshData->PushAttributeBitangent(bitangents);
+        }
+    }
+    if(hasColors)
+        meshData->PushAttributeColor(colors);
     if(maxIndex <= 65535){
-        indices = std::vector<unsigned short>();
+        std::vector<unsigned short> indices;
+        copyIndices(indices);
+        meshData->SetIndices(indices, MeshTopology::Triangles);
     } else {
-        indices = std::vector<unsigned int>();
+        std::vector<unsigned int> indices;
+        copyIndices(indices);
+        meshData->SetIndices(indices, MeshTopology::Triangles);
     }
-    std::visit([totalNumIndices](auto&& value){
-        value.reserve(totalNumIndices);
-    }, indices);
-    //////
-
-    // Processa os vértices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        size_t vertexIndex = 3 * i;
-        size_t normalIndex = 3 * i;
-        size_t texCoordIndex = 2 * i;
-        size_t tangentBitangentIndex = 3 * i;
-        size_t colorIndex = 4 * i;
-
-        vertices[vertexIndex] = mesh->mVertices[i].x;
-        vertices[vertexIndex + 1] = mesh->mVertices[i].y;
-        vertices[vertexIndex + 2] = mesh->mVertices[i].z;
-
-        if(hasNormals){
-            int normalIntX = std::round(mesh->mNormals[i].x * 32768.0f);
-            int normalIntY = std::round(mesh->mNormals[i].y * 32768.0f);
-            int normalIntZ = std::round(mesh->mNormals[i].z * 32768.0f);
-            normals[normalIndex] = static_cast<short>(std::clamp(normalIntX, -32768, 32767));
-            normals[normalIndex + 1] = static_cast<short>(std::clamp(normalIntY, -32768, 32767));
-            normals[normalIndex + 2] = static_cast<short>(std::clamp(normalIntZ, -32768, 32767));
-        }
-
-        if (hasTexCoords0){
-            float texCoordX = mesh->mTextureCoords[0][i].x;
-            float texCoordY = mesh->mTextureCoords[0][i].y;
-            auto updateTexCoords = [texCoordX, texCoordY, texCoordIndex](auto& texCoords) {
-                using T = typename std::decay<decltype(texCoords)>::type::value_type;
-                if constexpr (std::is_same_v<T, float>) {
-                    texCoords[texCoordIndex] = texCoordX;
-                    texCoords[texCoordIndex + 1] = texCoordY;
-                } else if constexpr (std::is_same_v<T, unsigned short>) {
-                    texCoords[texCoordIndex] = static_cast<unsigned short>(std::round(texCoordX * 65535.0f));
-                    texCoords[texCoordIndex + 1] = static_cast<unsigned short>(std::round(texCoordY * 65535.0f));
-                }
-            };
-            std::visit(updateTexCoords, texCoords0);
-
-        } else {
-            auto updateTexCoords = [texCoordIndex](auto& texCoords) {
-                using T = typename std::decay<decltype(texCoords)>::type::value_type;
-                if constexpr (std::is_same_v<T, float>) {
-                    texCoords[texCoordIndex] = 0.0f;
-                    texCoords[texCoordIndex + 1] = 0.0f;
-                } else if constexpr (std::is_same_v<T, unsigned short>) {
-                    texCoords[texCoordIndex] = 0x00;
-                    texCoords[texCoordIndex + 1] = 0x00;
+    if(mesh->HasBones() && mesh->mNumBones > 256)
+        std::cout << "Meshes with more than 256 bones are not supported - Using bind pose\n";
+    if(deformable && mesh->HasBones() && mesh->mNumBones <= 256){
+        // Influences are limited to 4 by aiProcess_LimitBoneWeights. Joints are indices of mesh bones
+        std::vector<float> influenceWeights(verticesVec4Size, 0.0f);
+        std::vector<glm::u8vec4> joints(verticesCount, glm::u8vec4(0));
+        std::vector<glm::u8vec4> weights(verticesCount);
+        for(unsigned int b = 0; b < mesh->mNumBones; b++){
+            const aiBone *bone = mesh->mBones[b];
+            for(unsigned int w = 0; w < bone->mNumWeights; w++){
+                const aiVertexWeight &vertexWeight = bone->mWeights[w];
+                float *vertexWeights = &influenceWeights[4 * vertexWeight.mVertexId];
+                // Replaces the smallest influence when vertex has more than 4
+                int slot = std::min_element(vertexWeights, vertexWeights + 4) - vertexWeights;
+                if(vertexWeights[slot] < vertexWeight.mWeight){
+                    vertexWeights[slot] = vertexWeight.mWeight;
+                    joints[vertexWeight.mVertexId][slot] = static_cast<unsigned char>(b);
                 }
-            };
-            std::visit(updateTexCoords, texCoords0);
+            }
         }
-        if(hasTangentsAndBitangents){
-            int tangentIntX = std::round(mesh->mTangents[i].x * 32768.0f);
-            int tangentIntY = std::round(mesh->mTangents[i].y * 32768.0f);
-            int tangentIntZ = std::round(mesh->mTangents[i].z * 32768.0f);
-            tangents[tangentBitangentIndex] = static_cast<short>(std::clamp(tangentIntX, -32768, 32767));
-            tangents[tangentBitangentIndex + 1] = static_cast<short>(std::clamp(tangentIntY, -32768, 32767));
-            tangents[tangentBitangentIndex + 2] = static_cast<short>(std::clamp(tangentIntZ, -32768, 32767));
-
-            int bitangentIntX = std::round(mesh->mBitangents[i].x * 32768.0f);
-            int bitangentIntY = std::round(mesh->mBitangents[i].y * 32768.0f);
-            int bitangentIntZ = std::round(mesh->mBitangents[i].z * 32768.0f);
-            bitangents[tangentBitangentIndex] = static_cast<short>(std::clamp(bitangentIntX, -32768, 32767));
-            bitangents[tangentBitangentIndex + 1] = static_cast<short>(std::clamp(bitangentIntY, -32768, 32767));
-            bitangents[tangentBitangentIndex + 2] = static_cast<short>(std::clamp(bitangentIntZ, -32768, 32767));
+        AttributeQuantizer::WeightsToUnorm8(influenceWeights.data(), verticesCount, reinterpret_cast<unsigned char*>(weights.data()));
+        meshData->SetSkinInfluences(std::move(joints), std::move(weights));
+    }
+    for(unsigned int t = 0; t < mesh->mNumAnimMeshes; t++){
+        // Assimp stores morph targets as whole vertices, converted to deltas from base mesh
+        const aiAnimMesh *animMesh = mesh->mAnimMeshes[t];
+        MorphTarget target;
+        if(animMesh->HasPositions()){
+            target.positionDeltas.resize(verticesCount);
+            for(size_t i = 0; i < verticesCount; i++){
+                const aiVector3D delta = animMesh->mVertices[i] - mesh->mVertices[i];
+                target.positionDeltas[i] = glm::vec3(delta.x, delta.y, delta.z);
+            }
         }
-        if(hasColors){
-            colors[colorIndex] = mesh->mColors[0][i].r;
-            colors[colorIndex + 1] = mesh->mColors[0][i].g;
-            colors[colorIndex + 2] = mesh->mColors[0][i].b;
-            colors[colorIndex + 3] = mesh->mColors[0][i].a;
+        if(animMesh->HasNormals() && hasNormals){
+            target.normalDeltas.resize(verticesCount);
+            for(size_t i = 0; i < verticesCount; i++){
+                const aiVector3D delta = animMesh->mNormals[i] - mesh->mNormals[i];
+                target.normalDeltas[i] = glm::vec3(delta.x, delta.y, delta.z);
+            }
         }
+        meshData->PushMorphTarget(std::move(target));
+    }
+    if(mesh->mNumAnimMeshes > 0){
+        std::vector<float> morphWeights(mesh->mNumAnimMeshes);
+        for(unsigned int t = 0; t < mesh->mNumAnimMeshes; t++)
+            morphWeights[t] = mesh->mAnimMeshes[t]->mWeight;
+        meshData->SetMorphWeights(morphWeights);
     }
 
-    // Processa os índices
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        const aiFace& face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            std::visit([face, j](auto&& value){
-                value.push_back((face.mIndices[j]));
-            }, indices);
-        }
+    return meshData;
+}
+
+void Model::buildSkeleton(const aiScene *scene)
+{
+    skeleton = CreateRef<Skeleton>();
+    skeletonNodes.clear();
+    // Depth first traversal, so parents are added before children. Pairs of node and parent in skeleton
+    std::vector<std::pair<const aiNode*, int>> stack{{scene->mRootNode, -1}};
+    while(!stack.empty()){
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+        SkeletonNode skeletonNode;
+        skeletonNode.name = node->mName.C_Str();
+        skeletonNode.parent = parent;
+        aiVector3D aiScaling;
+        aiQuaternion aiRotation;
+        aiVector3D aiPosition;
+        node->mTransformation.Decompose(aiScaling, aiRotation, aiPosition);
+        skeletonNode.translation = glm::vec3(aiPosition.x, aiPosition.y, aiPosition.z);
+        skeletonNode.rotation = glm::quat(aiRotation.w, aiRotation.x, aiRotation.y, aiRotation.z);
+        skeletonNode.scale = glm::vec3(aiScaling.x, aiScaling.y, aiScaling.z);
+        int index = skeleton->AddNode(skeletonNode);
+        skeletonNodes[node] = index;
+        for(unsigned int i = node->mNumChildren; i > 0; i--)
+            stack.emplace_back(node->mChildren[i - 1], index);
     }
+}
 
-    meshData->PushAttributePosition(vertices);
-    std::visit([&meshData](auto&& value){
-        meshData->PushAttributeTexCoord0(value);
-    }, texCoords0);
-    if(hasNormals)
-        meshData->PushAttributeNormal(normals);
-    if(hasTangentsAndBitangents){
-        meshData->PushAttributeTangent(tangents);
-        meshData->PushAttributeBitangent(bitangents);
+Ref<Skin> Model::processSkin(aiMesh *mesh) const
+{
+    Ref<Skin> skin = CreateRef<Skin>();
+    for(unsigned int b = 0; b < mesh->mNumBones; b++){
+        const aiBone *bone = mesh->mBones[b];
+        const aiNode *node = scene->mRootNode->FindNode(bone->mName);
+        auto skeletonNode = node ? skeletonNodes.find(node) : skeletonNodes.end();
+        skin->joints.push_back(skeletonNode != skeletonNodes.end() ? skeletonNode->second : -1);
+        // Assimp matrices are row major
+        const aiMatrix4x4 &offset = bone->mOffsetMatrix;
+        skin->inverseBindMatrices.push_back(glm::transpose(glm::make_mat4(&offset.a1)));
+    }
+    return skin;
+}
+
+void Model::processAnimations(const aiScene *scene)
+{
+    auto findNode = [this, scene](const aiString &name){
+        const aiNode *node = scene->mRootNode->FindNode(name);
+        auto skeletonNode = node ? skeletonNodes.find(node) : skeletonNodes.end();
+        return skeletonNode != skeletonNodes.end() ? skeletonNode->second : -1;
+    };
+    for(unsigned int a = 0; a < scene->mNumAnimations; a++){
+        const aiAnimation *animation = scene->mAnimations[a];
+        // Key times are in ticks
+        double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+        AnimationClip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = static_cast<float>(animation->mDuration / ticksPerSecond);
+        auto pushChannel = [&](int node, AnimationPath path, AnimationChannel &&channel){
+            channel.node = node;
+            channel.path = path;
+            if(!channel.times.empty())
+                clip.channels.push_back(std::move(channel));
+        };
+        for(unsigned int c = 0; c < animation->mNumChannels; c++){
+            const aiNodeAnim *nodeAnimation = animation->mChannels[c];
+            int node = findNode(nodeAnimation->mNodeName);
+            if(node < 0)
+                continue;
+            AnimationChannel translation;
+            for(unsigned int k = 0; k < nodeAnimation->mNumPositionKeys; k++){
+                const aiVectorKey &key = nodeAnimation->mPositionKeys[k];
+                translation.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                translation.values.insert(translation.values.end(), {key.mValue.x, key.mValue.y, key.mValue.z});
+            }
+            pushChannel(node, AnimationPath::Translation, std::move(translation));
+            AnimationChannel rotation;
+            for(unsigned int k = 0; k < nodeAnimation->mNumRotationKeys; k++){
+                const aiQuatKey &key = nodeAnimation->mRotationKeys[k];
+                rotation.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                rotation.values.insert(rotation.values.end(), {key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w});
+            }
+            pushChannel(node, AnimationPath::Rotation, std::move(rotation));
+            AnimationChannel scaling;
+            for(unsigned int k = 0; k < nodeAnimation->mNumScalingKeys; k++){
+                const aiVectorKey &key = nodeAnimation->mScalingKeys[k];
+                scaling.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                scaling.values.insert(scaling.values.end(), {key.mValue.x, key.mValue.y, key.mValue.z});
+            }
+            pushChannel(node, AnimationPath::Scale, std::move(scaling));
+        }
+        for(unsigned int c = 0; c < animation->mNumMorphMeshChannels; c++){
+            // Morph keys list pairs of target and weight. Targets not listed in a key have zero weight
+            const aiMeshMorphAnim *morphAnimation = animation->mMorphMeshChannels[c];
+            int node = findNode(morphAnimation->mName);
+            if(node < 0)
+                continue;
+            unsigned int targetsCount = 0;
+            for(unsigned int k = 0; k < morphAnimation->mNumKeys; k++){
+                const aiMeshMorphKey &key = morphAnimation->mKeys[k];
+                for(unsigned int v = 0; v < key.mNumValuesAndWeights; v++)
+                    targetsCount = std::max(targetsCount, key.mValues[v] + 1);
+            }
+            AnimationChannel weights;
+            weights.values.resize(morphAnimation->mNumKeys * targetsCount, 0.0f);
+            for(unsigned int k = 0; k < morphAnimation->mNumKeys; k++){
+                const aiMeshMorphKey &key = morphAnimation->mKeys[k];
+                weights.times.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                for(unsigned int v = 0; v < key.mNumValuesAndWeights; v++)
+                    weights.values[k * targetsCount + key.mValues[v]] = static_cast<float>(key.mWeights[v]);
+            }
+            if(targetsCount > 0)
+                pushChannel(node, AnimationPath::MorphWeights, std::move(weights));
+        }
+        skeleton->AddClip(std::move(clip));
     }
-    if(hasColors)
-        meshData->PushAttributeColor(colors);
-    std::visit([&meshData](auto&& value){
-        meshData->SetIndices(value, MeshTopology::Triangles);
-    }, indices);
-    
-    return meshData;
 }
 
 Ref<Material> Model::processMaterial(aiMaterial *material)
@@ -241,6 +436,19 @@ Ref<Material> Model::processMaterial(aiMaterial *material)
         materialData->SetParameterVector4(Constants::ShaderStandard::specularUniformName, specularFactor*glm::vec4(specularColor.r,specularColor.g,specularColor.b,specularColor.b));
     }
     materialData->SetFlag(Constants::ShaderStandard::lightingName, useLighting);
+    { // Alpha mode. glTF alpha mode key is read by name, as its header differs between Assimp versions
+        aiString alphaMode;
+        float opacity = 1.0f;
+        material->Get(AI_MATKEY_OPACITY, opacity);
+        bool transparent = opacity < 1.0f;
+        bool masked = material->GetTextureCount(aiTextureType_OPACITY) > 0;
+        if(AI_SUCCESS == material->Get("$mat.gltf.alphaMode", 0, 0, alphaMode)){
+            transparent = std::strcmp(alphaMode.C_Str(), "BLEND") == 0;
+            masked = std::strcmp(alphaMode.C_Str(), "MASK") == 0;
+        }
+        materialData->SetFlag(Constants::ShaderStandard::alphaMaskName, masked && !transparent);
+        materialData->SetFlag(Constants::ShaderStandard::transparentName, transparent);
+    }
     return materialData;
 }
 
@@ -349,13 +557,32 @@ bool Model::Load(const std::string &path, Ref<ShaderStandard> defaultShader, boo
 {
     this->defaultShader = defaultShader;
     this->useLighting = useLighting;
+    format = path.substr(path.find_last_of('.') + 1);
+    directory = path.substr(0, path.find_last_of('/'));
+    if(nativeGLTFLoaderFlag && (format == "gltf" || format == "glb")){
+        GLTFLoader loader;
+        if(loader.Load(path, defaultShader, useLighting, flipUVs, scale, vertexCompressionFlag)){
+            components = std::move(loader.GetComponents());
+            if(meshOptimizationFlag)
+                optimizeMeshes(path);
+            if(meshletGenerationFlag)
+                generateMeshlets(path);
+            if(lodGenerationFlag)
+                generateLODs(path);
+            if(meshRegistry)
+                deduplicateMeshes(path);
+            return true;
+        }
+        std::cout << "glTF nativo não suportado para " << path << " - Usando Assimp\n";
+    }
     Assimp::Importer importer;
     
     unsigned int flags = aiProcess_Triangulate |
         aiProcess_MakeLeftHanded |
         aiProcess_GenSmoothNormals |
         aiProcess_CalcTangentSpace |
-        aiProcess_JoinIdenticalVertices;
+        aiProcess_JoinIdenticalVertices |
+        aiProcess_LimitBoneWeights;
     if(flipUVs)
         flags |= aiProcess_FlipUVs;
     // Carrega o modelo com pós-processamento
@@ -369,20 +596,213 @@ bool Model::Load(const std::string &path, Ref<ShaderStandard> defaultShader, boo
         return false;
     }
     this->scene = scene;
-    format = path.substr(path.find_last_of('.') + 1);
-    directory = path.substr(0, path.find_last_of('/'));
+    // Skinned and morphed meshes are posed by an animator of the whole node hierarchy
+    bool deformable = scene->mNumAnimations > 0;
+    for(unsigned int i = 0; i < scene->mNumMeshes && !deformable; i++)
+        deformable = scene->mMeshes[i]->HasBones() || scene->mMeshes[i]->mNumAnimMeshes > 0;
+    if(deformable){
+        buildSkeleton(scene);
+        processAnimations(scene);
+        animator = CreateRef<Animator>(skeleton);
+    }
     // Processa o nó raiz da cena
+    auto start = std::chrono::high_resolution_clock::now();
     processNode(scene->mRootNode, scene, aiMatrix4x4());
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    fmt::print("Time to process meshes of {0}: {1} (μs)\n", path, duration.count());
+    if(meshOptimizationFlag)
+        optimizeMeshes(path);
+    if(meshletGenerationFlag)
+        generateMeshlets(path);
+    if(lodGenerationFlag)
+        generateLODs(path);
+    if(meshRegistry)
+        deduplicateMeshes(path);
 
     return true;
 }
 
+std::vector<Mesh*> Model::uniqueMeshes() const
+{
+    std::vector<Mesh*> meshes;
+    for(auto &&component : components){
+        Mesh *mesh = component.first.mesh.Get();
+        if(mesh && std::find(meshes.begin(), meshes.end(), mesh) == meshes.end())
+            meshes.push_back(mesh);
+    }
+    return meshes;
+}
+
+void Model::optimizeMeshes(const std::string &path)
+{
+    std::vector<Mesh*> meshes = uniqueMeshes();
+    std::vector<MeshOptimizationStats> before(meshes.size());
+    std::vector<MeshOptimizationStats> after(meshes.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size(), 1), [&](const tbb::blocked_range<size_t> &range){
+        for(size_t i = range.begin(); i != range.end(); i++){
+            before[i] = MeshOptimizer::Analyze(*meshes[i]);
+            MeshOptimizer::Optimize(*meshes[i]);
+            after[i] = MeshOptimizer::Analyze(*meshes[i]);
+        }
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    // Statistics weighted by triangles count
+    size_t trianglesCount = 0;
+    float acmrBefore = 0.0f, atvrBefore = 0.0f, overdrawBefore = 0.0f;
+    float acmrAfter = 0.0f, atvrAfter = 0.0f, overdrawAfter = 0.0f;
+    for(size_t i = 0; i < meshes.size(); i++){
+        float weight = static_cast<float>(before[i].trianglesCount);
+        trianglesCount += before[i].trianglesCount;
+        acmrBefore += before[i].acmr * weight;
+        atvrBefore += before[i].atvr * weight;
+        overdrawBefore += before[i].overdraw * weight;
+        acmrAfter += after[i].acmr * weight;
+        atvrAfter += after[i].atvr * weight;
+        overdrawAfter += after[i].overdraw * weight;
+    }
+    if(trianglesCount == 0)
+        return;
+    float inverseCount = 1.0f / trianglesCount;
+    fmt::print("Mesh optimization of {0} ({1} meshes, {2} triangles):\n", path, meshes.size(), trianglesCount);
+    fmt::print("  ACMR: {0:.3f} -> {1:.3f}\n", acmrBefore * inverseCount, acmrAfter * inverseCount);
+    fmt::print("  ATVR: {0:.3f} -> {1:.3f}\n", atvrBefore * inverseCount, atvrAfter * inverseCount);
+    fmt::print("  Overdraw: {0:.3f} -> {1:.3f}\n", overdrawBefore * inverseCount, overdrawAfter * inverseCount);
+    fmt::print("Time to optimize meshes of {0}: {1} (μs)\n", path, duration.count());
+}
+
+void Model::generateMeshlets(const std::string &path)
+{
+    std::vector<Mesh*> meshes = uniqueMeshes();
+    std::vector<int> meshletsCounts(meshes.size(), 0);
+    auto start = std::chrono::high_resolution_clock::now();
+    // Cluster bounds would be of bind pose, so deformable meshes are drawn whole
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size(), 1), [&](const tbb::blocked_range<size_t> &range){
+        for(size_t i = range.begin(); i != range.end(); i++){
+            if(!meshes[i]->IsDeformable())
+                meshletsCounts[i] = MeshletBuilder::Build(*meshes[i], meshOptimizationFlag);
+        }
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    int meshletsCount = std::accumulate(meshletsCounts.begin(), meshletsCounts.end(), 0);
+    fmt::print("Meshlets of {0}: {1}\n", path, meshletsCount);
+    fmt::print("Time to generate meshlets of {0}: {1} (μs)\n", path, duration.count());
+}
+
+void Model::generateLODs(const std::string &path)
+{
+    std::vector<Mesh*> meshes = uniqueMeshes();
+    auto start = std::chrono::high_resolution_clock::now();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size(), 1), [&](const tbb::blocked_range<size_t> &range){
+        for(size_t i = range.begin(); i != range.end(); i++)
+            MeshSimplifier::BuildLODs(*meshes[i]);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    // Triangles count of each level summed over meshes. Meshes without a level contribute with their coarsest one
+    std::vector<size_t> levelsTriangles(MeshSimplifier::maxLODsCount + 1, 0);
+    for(Mesh *mesh : meshes){
+        for(size_t level = 0; level < levelsTriangles.size(); level++){
+            int lod = std::min(static_cast<int>(level), mesh->GetLODsCount());
+            levelsTriangles[level] += (lod == 0 ? mesh->GetIndicesCount() : mesh->GetLOD(lod - 1).indicesCount) / 3;
+        }
+    }
+    fmt::print("Levels of detail of {0}:", path);
+    for(size_t level = 0; level < levelsTriangles.size(); level++)
+        fmt::print(" LOD{0} {1}", level, levelsTriangles[level]);
+    fmt::print(" (triangles)\n");
+    fmt::print("Time to generate levels of detail of {0}: {1} (μs)\n", path, duration.count());
+}
+
+void Model::deduplicateMeshes(const std::string &path)
+{
+    std::vector<Ref<Mesh>> meshes;
+    for(auto &&component : components){
+        const Ref<Mesh> &mesh = component.first.mesh.Object();
+        if(mesh && std::find(meshes.begin(), meshes.end(), mesh) == meshes.end())
+            meshes.push_back(mesh);
+    }
+    std::vector<uint64_t> hashes(meshes.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, meshes.size(), 1), [&](const tbb::blocked_range<size_t> &range){
+        for(size_t i = range.begin(); i != range.end(); i++)
+            hashes[i] = MeshRegistry::Hash(*meshes[i]);
+    });
+    // Registration is sequential so meshes of this model are compared in a deterministic order
+    std::unordered_map<Mesh*, Ref<Mesh>> replacements;
+    size_t savedBytes = 0;
+    for(size_t i = 0; i < meshes.size(); i++){
+        Ref<Mesh> registered = meshRegistry->Register(meshes[i], hashes[i]);
+        if(registered != meshes[i]){
+            savedBytes += MeshRegistry::GeometrySize(*meshes[i]);
+            replacements[meshes[i].get()] = registered;
+        }
+    }
+    std::vector<Resource<Mesh>> replaced;
+    for(auto &&component : components){
+        auto replacement = replacements.find(component.first.mesh.Get());
+        if(replacement != replacements.end()){
+            replaced.push_back(component.first.mesh);
+            component.first.mesh = Resource<Mesh>(replacement->second);
+        }
+    }
+    // Duplicated meshes are only referenced by this model, so they leave meshes pool
+    for(auto &&resource : replaced)
+        resource.Release();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    fmt::print("Duplicated meshes of {0}: {1} of {2} ({3} KB saved)\n", path, replacements.size(), meshes.size(),
+    savedBytes / 1024);
+    fmt::print("Time to deduplicate meshes of {0}: {1} (μs)\n", path, duration.count());
+}
+
 const std::vector<std::pair<MeshRendererComponent, TransformComponent>> &Model::GetComponents() const
 {
     return components;
 }
 
+void Model::ReleaseResources()
+{
+    for(auto &&component : components){
+        component.first.mesh.Release();
+        component.first.material.Release();
+    }
+}
+
 void Model::SetScale(float scale)
 {
     this->scale = scale;
 }
+
+void Model::SetNativeGLTFLoaderState(bool nativeLoader)
+{
+    this->nativeGLTFLoaderFlag = nativeLoader;
+}
+
+void Model::SetVertexCompressionState(bool compress)
+{
+    this->vertexCompressionFlag = compress;
+}
+
+void Model::SetMeshOptimizationState(bool optimize)
+{
+    this->meshOptimizationFlag = optimize;
+}
+
+void Model::SetLODGenerationState(bool generateLODs)
+{
+    this->lodGenerationFlag = generateLODs;
+}
+
+void Model::SetMeshletGenerationState(bool generateMeshlets)
+{
+    this->meshletGenerationFlag = generateMeshlets;
+}
+
+void Model::SetMeshRegistry(MeshRegistry *meshRegistry)
+{
+    this->meshRegistry = meshRegistry;
+}
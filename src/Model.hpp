@@ -6,6 +6,7 @@
 #include <vector>
 #include "ShaderStandard.hpp"
 #include "Components.hpp"
+#include "MeshRegistry.hpp"
 class Model{
 private:
     Ref<ShaderStandard> defaultShader; // Default shader model
@@ -16,15 +17,49 @@ private:
     bool useLighting = true;
     std::vector<std::pair<MeshRendererComponent, TransformComponent>> components;
     float scale = 1.0f;
+    // glTF files are loaded by GLTFLoader. Assimp is used for other formats or as fallback
+    bool nativeGLTFLoaderFlag = true;
+    // Store meshes with quantized positions and octahedral normals or QTangents
+    bool vertexCompressionFlag = false;
+    // Reorder triangles and vertices of loaded meshes for vertex cache, overdraw and vertex fetch
+    bool meshOptimizationFlag = false;
+    // Build simplified levels of detail of loaded meshes
+    bool lodGenerationFlag = false;
+    // Split loaded meshes into meshlets for cluster culling
+    bool meshletGenerationFlag = false;
+    // Meshes with same content of a registered mesh are replaced by it. Registry is not owned by model
+    MeshRegistry *meshRegistry = nullptr;
+    // Node hierarchy posed by animator, built when scene has bones or morph targets
+    Ref<Skeleton> skeleton;
+    Ref<Animator> animator;
+    std::unordered_map<const aiNode*, int> skeletonNodes;
     void processNode(aiNode *node, const aiScene *scene, const aiMatrix4x4& parentTransform);
     Ref<Mesh> processMesh(aiMesh *mesh);
+    void buildSkeleton(const aiScene *scene);
+    Ref<Skin> processSkin(aiMesh *mesh) const;
+    void processAnimations(const aiScene *scene);
     Ref<Material> processMaterial(aiMaterial *material);
     Ref<Texture> loadMaterialTexture(aiMaterial *material, aiTextureType type);
+    // Meshes can be shared by many components
+    std::vector<Mesh*> uniqueMeshes() const;
+    void optimizeMeshes(const std::string &path);
+    void generateLODs(const std::string &path);
+    void generateMeshlets(const std::string &path);
+    void deduplicateMeshes(const std::string &path);
 public:
     bool Load(const std::string &path, Ref<ShaderStandard> defaultShader, bool useLighting = true,
     bool flipUVs = false);
     const std::vector<std::pair<MeshRendererComponent, TransformComponent>> &GetComponents() const;
+    // Releases meshes and materials of components from their pools. Meshes shared with other models by a
+    // registry are released too, so it's only for models whose components are not in use
+    void ReleaseResources();
     // This is used to adjust scaling in some models with dimensions out of proportion for the scene
     void SetScale(float scale);
+    void SetNativeGLTFLoaderState(bool nativeLoader);
+    void SetVertexCompressionState(bool compress);
+    void SetMeshOptimizationState(bool optimize);
+    void SetLODGenerationState(bool generateLODs);
+    void SetMeshletGenerationState(bool generateMeshlets);
+    void SetMeshRegistry(MeshRegistry *meshRegistry);
 };
 #endif
\ No newline at end of file
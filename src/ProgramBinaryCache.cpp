@@ -0,0 +1,191 @@
+#include "ProgramBinaryCache.hpp"
+#include "MeshRegistry.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+bool ProgramBinaryCache::enabled = false;
+std::string ProgramBinaryCache::directory = std::string();
+size_t ProgramBinaryCache::maxBytes = 0;
+uint64_t ProgramBinaryCache::driverHash = 0;
+ProgramBinaryCacheCounters ProgramBinaryCache::counters;
+
+// Header of cache files, followed by binary bytes
+struct ProgramBinaryHeader{
+    uint32_t magic = 0x42503347; // "G3PB"
+    uint32_t version = 1;
+    uint64_t key = 0;
+    uint32_t format = 0;
+    uint32_t size = 0;
+};
+
+bool ProgramBinaryCache::Initialize(const std::string &directory, size_t maxBytes)
+{
+    enabled = false;
+    GLint formatsCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount);
+    if(formatsCount <= 0){
+        std::cout << "Driver has no program binary formats - Program binary cache disabled\n";
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if(error){
+        std::cout << "Program binary cache directory " << directory << " not created - " << error.message() << "\n";
+        return false;
+    }
+    std::string identity;
+    for(GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}){
+        const GLubyte *value = glGetString(name);
+        if(value)
+            identity += reinterpret_cast<const char*>(value);
+        identity += '\n';
+    }
+    std::vector<GLint> formats(formatsCount);
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+    driverHash = MeshRegistry::HashBytes(identity.data(), identity.size());
+    driverHash = MeshRegistry::HashBytes(formats.data(), formats.size() * sizeof(GLint), driverHash);
+    ProgramBinaryCache::directory = directory;
+    ProgramBinaryCache::maxBytes = maxBytes;
+    enabled = true;
+    return true;
+}
+
+bool ProgramBinaryCache::IsEnabled()
+{
+    return enabled;
+}
+
+uint64_t ProgramBinaryCache::Key(const std::vector<std::pair<GLenum, std::string>> &sources)
+{
+    uint64_t key = driverHash;
+    for(auto &&source : sources){
+        uint32_t shaderType = source.first;
+        key = MeshRegistry::HashBytes(&shaderType, sizeof(shaderType), key);
+        key = MeshRegistry::HashBytes(source.second.data(), source.second.size(), key);
+    }
+    // Zero means no key for programs
+    return key != 0 ? key : 1;
+}
+
+std::string ProgramBinaryCache::FilePath(uint64_t key)
+{
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool ProgramBinaryCache::Load(uint64_t key, GL::ShaderGL &program)
+{
+    if(!enabled)
+        return false;
+    std::string path = FilePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        counters.misses++;
+        return false;
+    }
+    ProgramBinaryHeader expected;
+    ProgramBinaryHeader header;
+    std::vector<unsigned char> binary;
+    bool valid = false;
+    if(file.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == expected.magic &&
+    header.version == expected.version && header.key == key && header.size > 0){
+        binary.resize(header.size);
+        valid = static_cast<bool>(file.read(reinterpret_cast<char*>(binary.data()), binary.size()));
+    }
+    file.close();
+    if(!valid || !program.LoadBinary(header.format, binary)){
+        // Truncated files and binaries rejected by driver are dropped, so program is linked and stored again
+        counters.rejected++;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    // Write time orders binaries by last use for eviction
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    counters.hits++;
+    return true;
+}
+
+bool ProgramBinaryCache::Store(GL::ShaderGL &program)
+{
+    uint64_t key = program.GetBinaryKey();
+    if(!enabled || key == 0)
+        return false;
+    program.SetBinaryKey(0);
+    GLenum format = GL_NONE;
+    std::vector<unsigned char> binary;
+    if(!program.GetBinary(format, binary))
+        return false;
+    ProgramBinaryHeader header;
+    header.key = key;
+    header.format = format;
+    header.size = binary.size();
+    // Written to a temporary file then renamed, so readers never see a partial binary
+    std::string path = FilePath(key);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(reinterpret_cast<const char*>(binary.data()), binary.size())){
+            std::cout << "Program binary not written to " << temporaryPath << "\n";
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if(error){
+        std::cout << "Program binary not stored - " << error.message() << "\n";
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    counters.stored++;
+    Evict();
+    return true;
+}
+
+void ProgramBinaryCache::Evict()
+{
+    struct CacheFile{
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<CacheFile> files;
+    uintmax_t totalSize = 0;
+    std::error_code error;
+    for(auto &&entry : std::filesystem::directory_iterator(directory, error)){
+        if(!entry.is_regular_file(error) || entry.path().extension() != ".bin")
+            continue;
+        CacheFile file{entry.path(), entry.last_write_time(error), entry.file_size(error)};
+        if(error)
+            continue;
+        totalSize += file.size;
+        files.push_back(std::move(file));
+    }
+    if(totalSize <= maxBytes)
+        return;
+    std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b){
+        return a.time < b.time;
+    });
+    for(auto &&file : files){
+        if(totalSize <= maxBytes)
+            break;
+        if(std::filesystem::remove(file.path, error)){
+            totalSize -= file.size;
+            counters.evicted++;
+        }
+    }
+}
+
+const ProgramBinaryCacheCounters &ProgramBinaryCache::GetCounters()
+{
+    return counters;
+}
@@ -0,0 +1,47 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "GLObjects.hpp"
+
+struct ProgramBinaryCacheCounters{
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t rejected = 0; // Binaries found but not accepted by driver
+    size_t stored = 0;
+    size_t evicted = 0;
+};
+
+// On disk cache of linked programs binaries. Binaries are keyed by the sources of every stage and the driver
+// identity, so a driver update or a changed source never loads a stale binary
+class ProgramBinaryCache {
+public:
+    // Needs a current context. Cache stays disabled when driver exposes no binary format
+    static bool Initialize(const std::string &directory, size_t maxBytes);
+    static bool IsEnabled();
+    // Key of sources as shader type and GLSL source of each stage
+    static uint64_t Key(const std::vector<std::pair<GLenum, std::string>> &sources);
+    // Loads binary of key into program. Returns false on misses and rejected binaries
+    static bool Load(uint64_t key, GL::ShaderGL &program);
+    // Writes binary of linked program with its binary key, once. Evicts least recently used binaries
+    // when cache exceeds its size
+    static bool Store(GL::ShaderGL &program);
+    static const ProgramBinaryCacheCounters &GetCounters();
+
+private:
+    ProgramBinaryCache();
+    static std::string FilePath(uint64_t key);
+    static void Evict();
+
+    static bool enabled;
+    static std::string directory;
+    static size_t maxBytes;
+    // Hash of vendor, renderer, version and binary formats of driver
+    static uint64_t driverHash;
+    static ProgramBinaryCacheCounters counters;
+};
+
+#endif
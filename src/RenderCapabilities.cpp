@@ -27,6 +27,7 @@ int RenderCapabilities::maxVertexAttributes = 0;
 int RenderCapabilities::maxVertexOutputComponents = 0;
 int RenderCapabilities::maxGeometryInputComponents = 0;
 int RenderCapabilities::maxGeometryOutputComponents = 0;
+bool RenderCapabilities::parallelShaderCompile = false;
 
 
 void RenderCapabilities::Initialize() {
@@ -92,6 +93,8 @@ void RenderCapabilities::Initialize() {
     glGetIntegerv(GL_MAX_VERTEX_OUTPUT_COMPONENTS, &maxVertexOutputComponents);
     glGetIntegerv(GL_MAX_GEOMETRY_INPUT_COMPONENTS, &maxGeometryInputComponents);
     glGetIntegerv(GL_MAX_GEOMETRY_OUTPUT_COMPONENTS, &maxGeometryOutputComponents);
+    // KHR and ARB variants share the completion status query
+    parallelShaderCompile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
 
     initialized = true;
 }
@@ -145,3 +148,8 @@ int RenderCapabilities::GetMaxVertexOutputComponents()
 {
     return maxVertexOutputComponents;
 }
+
+bool RenderCapabilities::HasParallelShaderCompile()
+{
+    return parallelShaderCompile;
+}
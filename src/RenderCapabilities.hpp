@@ -19,6 +19,7 @@ public:
     static int GetMaxTextureImageUnits();
     static int GetMaxVertexAttributes();
     static int GetMaxVertexOutputComponents();
+    static bool HasParallelShaderCompile();
 
 private:
     RenderCapabilities();
@@ -58,6 +59,8 @@ private:
     static int maxVertexOutputComponents;
     static int maxGeometryInputComponents;
     static int maxGeometryOutputComponents;
+    //Extensions
+    static bool parallelShaderCompile;
 };
 
 #endif
@@ -1,12 +1,19 @@
 #include "Renderer.hpp"
 #include "RenderCapabilities.hpp"
+#include "ProgramBinaryCache.hpp"
 #include "ShaderStandard.hpp"
 #include "Constants.hpp"
 #include "Texture.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
 #include <cstring>
 #include <chrono>
+#include <climits>
 #include <tbb/parallel_for.h>
 #include <fmt/core.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 // Implementation for StructArray
 size_t StructArray::alignOffset(size_t offset, size_t alignment) {
     return (offset + alignment - 1) & ~(alignment - 1);
@@ -68,6 +75,22 @@ const std::vector<char> &StructArray::GetData() const{
 ////
 
 
+void Renderer::ClusterBounds::PushMeshlet(const Meshlet &meshlet, unsigned int firstIndex){
+    centersX.push_back(meshlet.boundingSphere.x);
+    centersY.push_back(meshlet.boundingSphere.y);
+    centersZ.push_back(meshlet.boundingSphere.z);
+    radii.push_back(meshlet.boundingSphere.w);
+    apexesX.push_back(meshlet.coneApex.x);
+    apexesY.push_back(meshlet.coneApex.y);
+    apexesZ.push_back(meshlet.coneApex.z);
+    axesX.push_back(meshlet.cone.x);
+    axesY.push_back(meshlet.cone.y);
+    axesZ.push_back(meshlet.cone.z);
+    cutoffs.push_back(meshlet.cone.w);
+    firstIndices.push_back(firstIndex);
+    counts.push_back(meshlet.indicesCount);
+}
+
 GLenum Renderer::GetDrawMode(MeshTopology topology){
     switch(topology){
         case MeshTopology::Lines: return GL_LINES;
@@ -97,6 +120,20 @@ void Renderer::BufferSubDataNormalMatrices(RenderGroup &renderGroup){
     glNamedBufferSubData(renderGroup.normalMatricesUniformBuffer.name, 0, sizeof(glm::mat4)*renderGroup.normalMatrices.size(), renderGroup.normalMatrices.data());
 }
 
+void Renderer::PushTextureLevels(GL::TextureGL &textureArray, const Texture &texture, int layer, bool isCompressed, bool forceSRGB){
+    // Texture may have more levels than array storage when other textures in array have shorter chains
+    int levels = std::min(static_cast<int>(textureArray.GetLevels()), texture.GetLevelsCount());
+    for(int level = 0; level < levels; level++){
+        auto dimensions = texture.GetDimensions(level);
+        if(!isCompressed)
+            textureArray.PushData3DLayer(dimensions.x, dimensions.y, layer, Texture::GliClientFormatToGLenum(texture.GetFormat()),
+            Texture::GliTypeToGLenum(texture.GetFormat()), texture.GetLevelData(level), level);
+        else
+            textureArray.PushCompressedData3DLayer(dimensions.x, dimensions.y, layer, Texture::GliInternalFormatToGLenum(texture.GetFormat(), forceSRGB),
+            texture.GetLevelSize(level), texture.GetLevelData(level), level);
+    }
+}
+
 void Renderer::SetRenderGroupLayout(const RenderGroup &renderGroup, const MeshLayout &layout){
     int relativeOffset = 0;
     // This indexer is used when not interleaved vertex data
@@ -132,6 +169,7 @@ void Renderer::SetRenderGroupLayout(const RenderGroup &renderGroup, const MeshLa
             case MeshAttributeAlias::TexCoord5: location = Constants::ShaderStandard::texCoord5AttribLocation; break;
             case MeshAttributeAlias::TexCoord6: location = Constants::ShaderStandard::texCoord6AttribLocation; break;
             case MeshAttributeAlias::TexCoord7: location = Constants::ShaderStandard::texCoord7AttribLocation; break;
+            case MeshAttributeAlias::QTangent: location = Constants::ShaderStandard::qTangentAttribLocation; break;
             case MeshAttributeAlias::None: location = bindingPoint; break;
         }
         for(int i = location; i < location + locations; i++){
@@ -159,6 +197,334 @@ void Renderer::BindRenderGroupAttributesBuffers(RenderGroup &renderGroup, const
     glVertexArrayElementBuffer(renderGroup.vao.GetHandle(), renderGroup.indicesBuffer.name);
 }
 
+bool Renderer::BuildShaderModel(Material &material, const MeshLayout &meshLayout, MeshIndexType indicesType, ShaderStandard &shader,
+bool vertexPulling){
+    auto shaderCast = dynamic_cast<ShaderStandard*>(material.GetShader().get());
+    if(!shaderCast)
+        return false;
+    shader = *shaderCast;
+    for(auto &&layoutAttribute : meshLayout.attributes){
+        MeshAttribute attribute = layoutAttribute;
+        if(vertexPulling){ // Formats are decoded in shader by object layouts
+            attribute = MeshAttribute();
+            attribute.alias = layoutAttribute.alias;
+        }
+        MeshAttributeAlias alias = attribute.alias;
+        switch(alias){
+            case MeshAttributeAlias::None: break;
+            case MeshAttributeAlias::Position: shader.EnableAttribPosition(attribute); break;
+            case MeshAttributeAlias::TexCoord0:shader.EnableAttribTexCoord_0(attribute); break;
+            case MeshAttributeAlias::TexCoord1:shader.EnableAttribTexCoord_1(attribute); break;
+            case MeshAttributeAlias::TexCoord2:shader.EnableAttribTexCoord_2(attribute); break;
+            case MeshAttributeAlias::TexCoord3:shader.EnableAttribTexCoord_3(attribute); break;
+            case MeshAttributeAlias::TexCoord4:shader.EnableAttribTexCoord_4(attribute); break;
+            case MeshAttributeAlias::TexCoord5:shader.EnableAttribTexCoord_5(attribute); break;
+            case MeshAttributeAlias::TexCoord6:shader.EnableAttribTexCoord_6(attribute); break;
+            case MeshAttributeAlias::TexCoord7:shader.EnableAttribTexCoord_7(attribute); break;
+            case MeshAttributeAlias::Normal: shader.EnableAttribNormal(attribute); break;
+            case MeshAttributeAlias::Tangent:shader.EnableAttribTangent(attribute); break;
+            case MeshAttributeAlias::Bitangent:shader.EnableAttribBiTangent(attribute); break;
+            case MeshAttributeAlias::Color:shader.EnableAttribColor(attribute); break;
+            case MeshAttributeAlias::QTangent:shader.EnableAttribQTangent(attribute); break;
+        }
+    }
+    auto materialMaps = material.GetMapParameters();
+    for(auto &&materialMap : materialMaps){
+        if(std::get<Ref<Texture>>(materialMap.second.data) == Ref<Texture>(nullptr))
+            continue; // Parameter contain no map
+
+        if(materialMap.first == Constants::ShaderStandard::diffuseMapName){
+            shader.ActivateDiffuseMap();
+        } else if(materialMap.first == Constants::ShaderStandard::specularMapName){
+            shader.ActivateSpecularMap();
+        } else if(materialMap.first == Constants::ShaderStandard::normalMapName){
+            shader.ActivateNormalMap();
+        }
+    }
+
+    shader.UseDiffuseUniform();
+    shader.UseSpecularUniform();
+
+    auto materialFlags = material.GetFlags();
+    for(auto &&flag : materialFlags){
+        if(!flag.second)
+            continue; // Not activate module related to flag
+        if(flag.first == Constants::ShaderStandard::lightingName)
+            shader.ActivateLighting();
+        else if(flag.first == Constants::ShaderStandard::alphaMaskName)
+            shader.ActivateAlphaMask();
+        else if(flag.first == Constants::ShaderStandard::transparentName)
+            shader.ActivateTransparency();
+    }
+    if(vertexPulling)
+        shader.ActivateVertexPulling();
+    shader.SetIndexType(indicesType);
+    return true;
+}
+
+bool Renderer::BuildVariantKey(Material &material, const MeshLayout &meshLayout, MeshIndexType indicesType, ShaderVariantKey &key,
+bool vertexPulling){
+    // Same features of BuildShaderModel, with names interned once
+    static const int diffuseUniformBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Uniform, Constants::ShaderStandard::diffuseUniformName);
+    static const int specularUniformBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Uniform, Constants::ShaderStandard::specularUniformName);
+    static const int vertexPullingBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::vertexPullingName);
+    if(!dynamic_cast<ShaderStandard*>(material.GetShader().get()))
+        return false;
+    key = material.GetVariantKey();
+    for(auto &&layoutAttribute : meshLayout.attributes){
+        if(vertexPulling){ // Formats are decoded in shader by object layouts
+            MeshAttribute attribute;
+            attribute.alias = layoutAttribute.alias;
+            key.SetAttribute(attribute);
+        } else {
+            key.SetAttribute(layoutAttribute);
+        }
+    }
+    key.SetFeatureBit(diffuseUniformBit);
+    key.SetFeatureBit(specularUniformBit);
+    // Pulling is chosen by renderer, not by material flag
+    key.ClearFeatureBit(vertexPullingBit);
+    if(vertexPulling)
+        key.SetFeatureBit(vertexPullingBit);
+    key.SetIndexType(indicesType);
+    return true;
+}
+
+// Attributes whose constant values don't change shading. Tangents are never padded, as they enable lighting and
+// normal mapping, and tex coords only when materials have no maps to sample with them
+static bool IsPaddableAlias(MeshAttributeAlias alias, bool padTexCoords){
+    switch(alias){
+        case MeshAttributeAlias::TexCoord0: case MeshAttributeAlias::TexCoord1: case MeshAttributeAlias::TexCoord2:
+        case MeshAttributeAlias::TexCoord3: case MeshAttributeAlias::TexCoord4: case MeshAttributeAlias::TexCoord5:
+        case MeshAttributeAlias::TexCoord6: case MeshAttributeAlias::TexCoord7: return padTexCoords;
+        case MeshAttributeAlias::Color: return true;
+        default: return false;
+    }
+}
+
+// Layouts are the same when attributes and their purposes match
+static bool IsSameLayout(const MeshLayout &a, const MeshLayout &b){
+    if(a.attributes.size() != b.attributes.size())
+        return false;
+    for(size_t i = 0; i < a.attributes.size(); i++){
+        if(!(a.attributes[i] == b.attributes[i]) || a.attributes[i].alias != b.attributes[i].alias)
+            return false;
+    }
+    return true;
+}
+
+static int LayoutVertexSize(const MeshLayout &layout){
+    int size = 0;
+    for(auto &&attribute : layout.attributes)
+        size += attribute.AttributeDataSize();
+    return size;
+}
+
+// Bytes per vertex added when layout is padded to target, or -1 when target is not layout with paddable attributes added
+static int PaddingVertexSize(const MeshLayout &layout, const MeshLayout &target, bool padTexCoords){
+    if(target.attributes.size() <= layout.attributes.size())
+        return -1;
+    for(auto &&attribute : layout.attributes){
+        auto it = std::find_if(target.attributes.begin(), target.attributes.end(), [&attribute](const MeshAttribute &targetAttribute){
+            return targetAttribute.alias == attribute.alias;
+        });
+        if(attribute.alias == MeshAttributeAlias::None || it == target.attributes.end() || !(*it == attribute))
+            return -1;
+    }
+    int size = 0;
+    for(auto &&attribute : target.attributes){
+        auto it = std::find_if(layout.attributes.begin(), layout.attributes.end(), [&attribute](const MeshAttribute &layoutAttribute){
+            return layoutAttribute.alias == attribute.alias;
+        });
+        if(it != layout.attributes.end())
+            continue;
+        if(!IsPaddableAlias(attribute.alias, padTexCoords))
+            return -1;
+        size += attribute.AttributeDataSize();
+    }
+    return size;
+}
+
+void Renderer::PlanRenderGroups(std::vector<Renderable> &renderables){
+    auto planBegin = std::chrono::high_resolution_clock::now();
+    auto countShaderModels = [this, &renderables](){
+        std::unordered_set<ShaderVariantKey, ShaderVariantKeyHash> shaderModels;
+        for(auto &&renderable : renderables){
+            auto &meshRenderer = renderable.first.get();
+            ShaderVariantKey key;
+            if(BuildVariantKey(*meshRenderer.material, meshRenderer.mesh->GetLayout(), meshRenderer.mesh->GetIndicesType(), key,
+            vertexPullingFlag && !meshRenderer.isDynamic && !IsDeformed(meshRenderer)))
+                shaderModels.insert(key);
+        }
+        return shaderModels.size();
+    };
+    size_t groupsBefore = countShaderModels();
+    int64_t addedBytes = 0;
+    size_t paddedCount = 0, promotedCount = 0, splitCount = 0, partsCount = 0;
+
+    if(renderGroupPlanOptions.padAttributes){
+        // Meshes of renderables whose shader models only differ by mesh layout
+        struct MaterialClass{
+            std::vector<Mesh*> meshes;
+            bool hasMaps = false;
+        };
+        std::unordered_map<ShaderVariantKey, MaterialClass, ShaderVariantKeyHash> materialClasses;
+        for(auto &&renderable : renderables){
+            auto &meshRenderer = renderable.first.get();
+            ShaderVariantKey key;
+            // Dynamic meshes have their own render groups, so they are not changed
+            if(meshRenderer.isDynamic || !BuildVariantKey(*meshRenderer.material, MeshLayout(), MeshIndexType::UnsignedInt, key))
+                continue;
+            auto &materialClass = materialClasses[key];
+            materialClass.hasMaps = materialClass.hasMaps || !meshRenderer.material->GetActivatedMapParameters().empty();
+            auto &meshes = materialClass.meshes;
+            if(std::find(meshes.begin(), meshes.end(), meshRenderer.mesh.Get()) == meshes.end())
+                meshes.push_back(meshRenderer.mesh.Get());
+        }
+        std::unordered_set<Mesh*> paddedMeshes;
+        for(auto &&materialClass : materialClasses){
+            std::vector<MeshLayout> layouts;
+            for(Mesh *mesh : materialClass.second.meshes){
+                auto it = std::find_if(layouts.begin(), layouts.end(), [mesh](const MeshLayout &layout){
+                    return IsSameLayout(layout, mesh->GetLayout());
+                });
+                if(it == layouts.end())
+                    layouts.push_back(mesh->GetLayout());
+            }
+            if(layouts.size() < 2)
+                continue;
+            // Each mesh is padded to the largest layout it fits, so nested layouts converge to one
+            for(Mesh *mesh : materialClass.second.meshes){
+                if(paddedMeshes.count(mesh) > 0)
+                    continue;
+                const MeshLayout *target = nullptr;
+                int targetPadding = 0;
+                float maxPadding = renderGroupPlanOptions.maxPaddingRatio * LayoutVertexSize(mesh->GetLayout());
+                for(auto &&layout : layouts){
+                    int padding = PaddingVertexSize(mesh->GetLayout(), layout, !materialClass.second.hasMaps);
+                    if(padding < 0 || padding > maxPadding)
+                        continue;
+                    if(!target || layout.attributes.size() > target->attributes.size()){
+                        target = &layout;
+                        targetPadding = padding;
+                    }
+                }
+                if(target && mesh->ConformToLayout(*target)){
+                    paddedMeshes.insert(mesh);
+                    paddedCount++;
+                    addedBytes += static_cast<int64_t>(targetPadding) * mesh->GetVerticesCount();
+                }
+            }
+        }
+    }
+
+    if(renderGroupPlanOptions.indexUnification != IndexUnification::Disabled){
+        // Renderables whose shader models only differ by index type
+        std::unordered_map<ShaderVariantKey, std::vector<size_t>, ShaderVariantKeyHash> layoutClasses;
+        for(size_t i = 0; i < renderables.size(); i++){
+            auto &meshRenderer = renderables[i].first.get();
+            ShaderVariantKey key;
+            if(!meshRenderer.isDynamic &&
+            BuildVariantKey(*meshRenderer.material, meshRenderer.mesh->GetLayout(), MeshIndexType::UnsignedInt, key,
+            vertexPullingFlag && !IsDeformed(meshRenderer)))
+                layoutClasses[key].push_back(i);
+        }
+        // Parts of split meshes, shared by every renderable of a mesh so they are still instanced
+        std::unordered_map<Mesh*, std::vector<Ref<Mesh>>> meshesParts;
+        for(auto &&layoutClass : layoutClasses){
+            std::vector<Mesh*> shortMeshes, intMeshes;
+            for(size_t i : layoutClass.second){
+                Mesh *mesh = renderables[i].first.get().mesh.Get();
+                auto &meshes = mesh->GetIndicesType() == MeshIndexType::UnsignedShort ? shortMeshes : intMeshes;
+                if(std::find(meshes.begin(), meshes.end(), mesh) == meshes.end())
+                    meshes.push_back(mesh);
+            }
+            if(shortMeshes.empty() || intMeshes.empty())
+                continue;
+            int64_t promotionBytes = 0;
+            for(Mesh *mesh : shortMeshes){
+                size_t indicesCount = mesh->GetIndicesCount();
+                for(int level = 0; level < mesh->GetLODsCount(); level++)
+                    indicesCount += mesh->GetLOD(level).indicesCount;
+                promotionBytes += 2 * static_cast<int64_t>(indicesCount);
+            }
+            // Parts are contiguous triangle ranges with up to 65536 vertices
+            bool splittable = std::all_of(intMeshes.begin(), intMeshes.end(), [](Mesh *mesh){
+                return mesh->GetTopology() == MeshTopology::Triangles && mesh->GetLODsCount() == 0 && mesh->GetMeshlets().empty();
+            });
+            IndexUnification mode = renderGroupPlanOptions.indexUnification;
+            std::unordered_map<Mesh*, std::pair<std::vector<unsigned int>, std::vector<Meshlet>>> partitions;
+            int64_t splitBytes = 0;
+            if(splittable && mode != IndexUnification::Promote){
+                for(Mesh *mesh : intMeshes){
+                    if(meshesParts.count(mesh) > 0)
+                        continue;
+                    auto &[indices, parts] = partitions[mesh];
+                    MeshOptimizer::ReadIndices(*mesh, indices);
+                    MeshletBuilder::BuildMeshlets(indices, mesh->GetVerticesCount(), parts, 65536, INT_MAX);
+                    // Vertices shared by parts are duplicated
+                    std::vector<unsigned int> vertexPart(mesh->GetVerticesCount(), ~0u);
+                    int64_t partsVerticesCount = 0;
+                    for(size_t p = 0; p < parts.size(); p++){
+                        for(unsigned int i = parts[p].firstIndex; i < parts[p].firstIndex + parts[p].indicesCount; i++){
+                            if(vertexPart[indices[i]] != p){
+                                vertexPart[indices[i]] = p;
+                                partsVerticesCount++;
+                            }
+                        }
+                    }
+                    splitBytes += (partsVerticesCount - mesh->GetVerticesCount()) * LayoutVertexSize(mesh->GetLayout())
+                    - 2 * static_cast<int64_t>(indices.size())
+                    + static_cast<int64_t>(parts.size() - 1) * renderGroupPlanOptions.drawCommandCost;
+                }
+            }
+            bool split = splittable && (mode == IndexUnification::Split ||
+            (mode == IndexUnification::Automatic && splitBytes < promotionBytes));
+            if(!split){
+                for(Mesh *mesh : shortMeshes){
+                    mesh->PromoteIndices();
+                    promotedCount++;
+                }
+                addedBytes += promotionBytes;
+                continue;
+            }
+            for(auto &&[mesh, partition] : partitions){
+                auto &parts = meshesParts[mesh];
+                for(auto &&part : partition.second)
+                    parts.push_back(mesh->ExtractSubmesh(partition.first.data() + part.firstIndex, part.indicesCount));
+                splitCount++;
+                partsCount += parts.size();
+            }
+            addedBytes += splitBytes;
+            for(size_t i : layoutClass.second){
+                MeshRendererComponent &meshRenderer = renderables[i].first.get();
+                auto partsIt = meshesParts.find(meshRenderer.mesh.Get());
+                if(partsIt == meshesParts.end())
+                    continue;
+                TransformComponent &transform = renderables[i].second.get();
+                Ref<Material> material = meshRenderer.material.Object();
+                for(size_t p = 0; p < partsIt->second.size(); p++){
+                    plannedMeshRenderers.emplace_back(partsIt->second[p], material);
+                    plannedMeshRenderers.back().animator = meshRenderer.animator;
+                    plannedMeshRenderers.back().skin = meshRenderer.skin;
+                    plannedMeshRenderers.back().animatorNode = meshRenderer.animatorNode;
+                    if(p == 0)
+                        renderables[i].first = plannedMeshRenderers.back();
+                    else
+                        renderables.emplace_back(plannedMeshRenderers.back(), transform);
+                }
+            }
+        }
+    }
+    auto planEnd = std::chrono::high_resolution_clock::now();
+    fmt::print("\nRender groups planning: {0} -> {1} shader groups\n", groupsBefore, countShaderModels());
+    fmt::print("Padded meshes: {0}, promoted to 32 bits indices: {1}, split to 16 bits indices: {2} ({3} parts)\n",
+    paddedCount, promotedCount, splitCount, partsCount);
+    fmt::print("Planning memory change: {0} KB\n", addedBytes / 1024);
+    fmt::print("Time to plan render groups: {0} (μs)\n",
+    std::chrono::duration_cast<std::chrono::microseconds>(planEnd-planBegin).count());
+}
+
 void Renderer::PrepareRenderGroups(entt::registry &registry){
     auto mapBegin = std::chrono::high_resolution_clock::now();
     auto renderableView = registry.view<MeshRendererComponent, TransformComponent>();
@@ -170,6 +536,17 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
         auto &transform = renderableView.get<TransformComponent>(entity);
         componentsPairs.emplace_back(meshRenderer, transform);
     }
+    if(std::any_of(componentsPairs.begin(), componentsPairs.end(), [](const Renderable &renderable){
+        return renderable.first.get().animator && renderable.first.get().mesh->IsDeformable();
+    })){
+        if(version < GLApiVersion::V430)
+            std::cout << "GPU skinning and morph targets need OpenGL 4.3 - Using bind pose\n";
+        else if(!deformationShader)
+            SetupDeformationShader();
+    }
+    if(renderGroupPlanningFlag)
+        PlanRenderGroups(componentsPairs);
+    lightsBuckets = lightsBucketsFlag ? LightsBuckets(CountLights(registry)) : glm::ivec3(-1);
     // Grouping steps
     // - Group by shader model (resultant of mesh layout and material activated properties)
     // - Split each group at maximum usage of one of these conditions: unique textures count equal max texture layers;
@@ -178,86 +555,84 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
     // - Group by all maps textures dimensions and compressed format
     std::vector<ShaderGroup> shaderGroups;
 
-    std::unordered_map<Shader, std::vector<Renderable>, ShaderHash> shaderModelMap; // Maps to shader models groups
-    std::unordered_map<Shader, ShaderCode, ShaderHash> shaderCodeCache; // Caches shader models to a already built shader code
-    for(auto &&x: componentsPairs){
-        auto &material = x.first.get().material;
-        auto &mesh = x.first.get().mesh;
-        auto shaderCast = dynamic_cast<ShaderStandard*>(x.first.get().material->GetShader().get());
-        if(!shaderCast)
+    auto variantsBegin = std::chrono::high_resolution_clock::now();
+    // Renderables sorted by variant key, so each shader model group is a run of equal keys
+    std::vector<std::pair<ShaderVariantKey, uint32_t>> variantKeys;
+    variantKeys.reserve(componentsPairs.size());
+    for(uint32_t i = 0; i < componentsPairs.size(); i++){
+        auto &meshRenderer = componentsPairs[i].first.get();
+        ShaderVariantKey key;
+        if(!BuildVariantKey(*meshRenderer.material, meshRenderer.mesh->GetLayout(), meshRenderer.mesh->GetIndicesType(), key,
+        vertexPullingFlag && !meshRenderer.isDynamic && !IsDeformed(meshRenderer)))
             continue; // Check if shader is a shader standard implementation
-        ShaderStandard shader = *shaderCast;
-        auto meshLayout = mesh->GetLayout();
-        for(auto &&attribute : meshLayout.attributes){
-            MeshAttributeAlias alias = attribute.alias;
-            switch(alias){
-                case MeshAttributeAlias::None: break;
-                case MeshAttributeAlias::Position: shader.EnableAttribPosition(attribute); break;
-                case MeshAttributeAlias::TexCoord0:shader.EnableAttribTexCoord_0(attribute); break;
-                case MeshAttributeAlias::TexCoord1:shader.EnableAttribTexCoord_1(attribute); break;
-                case MeshAttributeAlias::TexCoord2:shader.EnableAttribTexCoord_2(attribute); break;
-                case MeshAttributeAlias::TexCoord3:shader.EnableAttribTexCoord_3(attribute); break;
-                case MeshAttributeAlias::TexCoord4:shader.EnableAttribTexCoord_4(attribute); break;
-                case MeshAttributeAlias::TexCoord5:shader.EnableAttribTexCoord_5(attribute); break;
-                case MeshAttributeAlias::TexCoord6:shader.EnableAttribTexCoord_6(attribute); break;
-                case MeshAttributeAlias::TexCoord7:shader.EnableAttribTexCoord_7(attribute); break;
-                case MeshAttributeAlias::Normal: shader.EnableAttribNormal(attribute); break;
-                case MeshAttributeAlias::Tangent:shader.EnableAttribTangent(attribute); break;
-                case MeshAttributeAlias::Bitangent:shader.EnableAttribBiTangent(attribute); break;
-                case MeshAttributeAlias::Color:shader.EnableAttribColor(attribute); break;
-            }
-        }
-        auto materialMaps = material->GetMapParameters();
-        for(auto &&materialMap : materialMaps){
-            if(std::get<Ref<Texture>>(materialMap.second.data) == Ref<Texture>(nullptr))
-                continue; // Parameter contain no map
-
-            if(materialMap.first == Constants::ShaderStandard::diffuseMapName){
-                shader.ActivateDiffuseMap();
-            } else if(materialMap.first == Constants::ShaderStandard::specularMapName){
-                shader.ActivateSpecularMap();
-            } else if(materialMap.first == Constants::ShaderStandard::normalMapName){
-                shader.ActivateNormalMap();
+        variantKeys.emplace_back(WithLightsBuckets(key, lightsBuckets), i);
+    }
+    std::sort(variantKeys.begin(), variantKeys.end(), [](const auto &a, const auto &b){
+        return a.first < b.first || (a.first == b.first && a.second < b.second);
+    });
+    std::vector<std::pair<ShaderVariantKey, std::vector<Renderable>>> shaderModelMap; // Shader models groups
+    for(auto &&variantKey : variantKeys){
+        if(shaderModelMap.empty() || shaderModelMap.back().first != variantKey.first){
+            shaderModelMap.emplace_back(variantKey.first, std::vector<Renderable>());
+            // Model is only built for variants without processed code
+            auto &meshRenderer = componentsPairs[variantKey.second].first.get();
+            ShaderModelSource source{meshRenderer.material.Object(), meshRenderer.mesh->GetLayout(), meshRenderer.mesh->GetIndicesType(),
+            vertexPullingFlag && !meshRenderer.isDynamic && !IsDeformed(meshRenderer)};
+            if(shaderCodeCache.count(variantKey.first) == 0){
+                ShaderStandard shader;
+                BuildShaderModel(*source.material, source.layout, source.indicesType, shader, source.vertexPulling);
+                shader.SetLightsBuckets(lightsBuckets.x, lightsBuckets.y, lightsBuckets.z);
+                shaderCodeCache.emplace(variantKey.first, shader.ProcessCode());
             }
+            shaderModelSources.emplace(WithLightsBuckets(variantKey.first, glm::ivec3(-1)), std::move(source));
         }
-
-        shader.UseDiffuseUniform();
-        shader.UseSpecularUniform();
-
-        auto materialFlags = material->GetFlags();
-        for(auto &&flag : materialFlags){
-            if(!flag.second)
-                continue; // Not activate module related to flag
-            if(flag.first == Constants::ShaderStandard::lightingName)
-                shader.ActivateLighting();
-        }
-        shader.SetIndexType(mesh->GetIndicesType());
-
-        if(shaderModelMap.count(shader) == 0){
-            ShaderCode shaderCode = shader.ProcessCode();
-            shaderCodeCache[shader] = shaderCode;
+        shaderModelMap.back().second.push_back(std::move(componentsPairs[variantKey.second]));
+    }
+    auto variantsEnd = std::chrono::high_resolution_clock::now();
+    fmt::print("Shader variants: {0} for {1} objects, mapped in {2} (μs)\n", shaderModelMap.size(), variantKeys.size(),
+    std::chrono::duration_cast<std::chrono::microseconds>(variantsEnd-variantsBegin).count());
+    // Objects split by texture layers and mvps limits, indexed by split group. Split groups of a shader
+    // reuse its program
+    std::vector<std::vector<Renderable>> splitGroups;
+    // Program of each split group
+    std::vector<Ref<GL::ShaderGL>> splitGroupsShaders;
+    std::vector<ShaderVariantKey> splitGroupsKeys;
+    // Alias for objects mapped by split group index
+    using ShaderResourceMap = std::unordered_map<uint32_t, std::vector<Renderable>>;
+    // Program of each shader model. In parallel mode sources are generated on workers and every program is
+    // submitted before any is waited, so driver compiles them concurrently while groups are built
+    std::vector<Ref<GL::ShaderGL>> variantsShaders(shaderModelMap.size());
+    shadersBegin = std::chrono::high_resolution_clock::now();
+    if(parallelShaderCompileFlag){
+        std::vector<std::vector<std::pair<GLenum, std::string>>> variantsSources(shaderModelMap.size());
+        std::vector<char> sourcesGenerated(shaderModelMap.size(), 0);
+        tbb::parallel_for(size_t(0), shaderModelMap.size(), [&](size_t i){
+            sourcesGenerated[i] = shaderCodeCache.at(shaderModelMap[i].first).GenerateSources(variantsSources[i]);
+        });
+        auto sourcesEnd = std::chrono::high_resolution_clock::now();
+        for(size_t i = 0; i < shaderModelMap.size(); i++){
+            if(sourcesGenerated[i])
+                variantsShaders[i] = ShaderCode::CompileSources(variantsSources[i], false);
         }
-        shaderModelMap[shader].push_back(std::move(x));
+        auto submitEnd = std::chrono::high_resolution_clock::now();
+        fmt::print("Shader programs sources generated in {0} (μs), compile and link submitted in {1} (μs)\n",
+        std::chrono::duration_cast<std::chrono::microseconds>(sourcesEnd-shadersBegin).count(),
+        std::chrono::duration_cast<std::chrono::microseconds>(submitEnd-sourcesEnd).count());
+    } else {
+        for(size_t i = 0; i < shaderModelMap.size(); i++)
+            variantsShaders[i] = shaderCodeCache[shaderModelMap[i].first].Generate();
+        auto shadersEnd = std::chrono::high_resolution_clock::now();
+        fmt::print("Shader programs wall time: {0} (μs)\n",
+        std::chrono::duration_cast<std::chrono::microseconds>(shadersEnd-shadersBegin).count());
     }
-    // Maps to shader resource, a container for a reference of Shader Program Object with a UUID also
-    // This makes possible a reusing of the program along the objects groups
-    std::unordered_map<ResourceHandle, std::vector<Renderable>> shaderResourceMap;
-    // Alias for shader resource mapping
-    using ShaderResourceMap =  std::unordered_map<ResourceHandle, std::vector<Renderable>>;
-    // Caches the shader resource based on the UUID handle
-    std::unordered_map<ResourceHandle, GL::ShaderGLResource> shaderResourceCache;
-    int64_t generateTimeTotal = 0;
-    for(auto &&x : shaderModelMap){ // Group by while texture layers and mvps limits are not reached and then group by shader
+    for(size_t variantIndex = 0; variantIndex < shaderModelMap.size(); variantIndex++){ // Group by while texture layers and mvps limits are not reached and then group by shader
+        auto &x = shaderModelMap[variantIndex];
         if(x.second.empty())
             continue;
-        auto generateBegin = std::chrono::high_resolution_clock::now();
-        // Generate shader program and resource
-        GL::ShaderGLResource shaderGeneratedGlobal(shaderCodeCache[x.first].Generate());
-        if(!shaderGeneratedGlobal.object)
+        Ref<GL::ShaderGL> &shaderGenerated = variantsShaders[variantIndex];
+        if(!shaderGenerated)
             continue;
-        auto generateEnd = std::chrono::high_resolution_clock::now();
-        int64_t generateTime = std::chrono::duration_cast<std::chrono::microseconds>(generateEnd-generateBegin).count();
-        generateTimeTotal += generateTime;
+        variantsPrograms[x.first] = shaderGenerated;
 
         const size_t maxTextureArrayLayers = RenderCapabilities::GetMaxTextureArrayLayers();  // Máximo de texturas
         const size_t maxUBOMatrices = glm::min(
@@ -306,28 +681,13 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
         if (!currentGroup.empty()) {
             shaderGeneratedGroups.push_back(std::move(currentGroup));
         }
+        // Setting shaders binding points
+        if(!BindShaderBlocks(*shaderGenerated, shaderCodeCache[x.first]))
+            return; // No binding point available
         for(auto &&group : shaderGeneratedGroups){
-            GL::ShaderGLResource shaderGenerated(shaderGeneratedGlobal.object);
-            // Setting shaders binding points
-            for(auto &&bindingPurpose : shaderCodeCache[x.first].GetBindingsPurposes(ShaderStage::Vertex)){
-                std::optional<int> binding = AddUBOBindingPurpose(bindingPurpose.second);
-                if(!binding.has_value()){
-                    // No binding point available
-                    return;
-                }
-                shaderGenerated->SetBlockBinding(bindingPurpose.first, uboBindingsPurposes[bindingPurpose.second]);
-            }
-            for(auto &&bindingPurpose : shaderCodeCache[x.first].GetBindingsPurposes(ShaderStage::Fragment)){
-                std::optional<int> binding = AddUBOBindingPurpose(bindingPurpose.second);
-                if(!binding.has_value()){
-                    // No binding point available
-                    return;
-                }
-                shaderGenerated->SetBlockBinding(bindingPurpose.first, uboBindingsPurposes[bindingPurpose.second]);
-            }
-            auto &programGroup = shaderResourceMap[shaderGenerated.resourceHandle];
-            programGroup.insert(programGroup.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
-            shaderResourceCache[shaderGenerated.resourceHandle] = shaderGenerated;
+            splitGroups.push_back(std::move(group));
+            splitGroupsShaders.push_back(shaderGenerated);
+            splitGroupsKeys.push_back(x.first);
         }
     }
     // glm::ivec2 already have equal operator
@@ -375,8 +735,8 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
     // Maps based on same textures dimensions of each map and based on texture compression format
     std::unordered_map<TextureKey, ShaderResourceMap, TextureKeyHash> textureConformationMap;
 
-    for(auto &&group : shaderResourceMap){
-        for(auto &&x: group.second){
+    for(uint32_t splitGroup = 0; splitGroup < splitGroups.size(); splitGroup++){
+        for(auto &&x: splitGroups[splitGroup]){
             auto texParameters = x.first.get().material->GetActivatedMapParameters();
 
             TextureKey textureKey;
@@ -390,7 +750,7 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
                 textureKey.dimensions.push_back(glm::ivec2(dimensions.x, dimensions.y));
                 textureKey.formats.push_back(format);
             }
-            textureConformationMap[textureKey][group.first].push_back(std::move(x));
+            textureConformationMap[textureKey][splitGroup].push_back(std::move(x));
         }
     }
     {
@@ -405,23 +765,54 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
     for(auto &&map : textureConformationMap){
         for(auto &&group : map.second){
             ShaderGroup shaderGroup;
-            shaderGroup.shader = shaderResourceCache[group.first].object;
-            std::unordered_map<Mesh*, std::vector<Renderable>> groupMap;
+            shaderGroup.shader = splitGroupsShaders[group.first];
+            shaderGroup.variantKey = splitGroupsKeys[group.first];
+            // Dynamic and deformed meshes have programs without vertex pulling, so they never share a program with
+            // pulled meshes
+            shaderGroup.vertexPulling = vertexPullingFlag && std::none_of(group.second.begin(), group.second.end(),
+            [this](const Renderable &renderable){
+                return renderable.first.get().isDynamic || IsDeformed(renderable.first.get());
+            });
+            // Keyed by mesh handle, as a mesh has one handle in its pool
+            std::unordered_map<uint32_t, std::vector<Renderable>> groupMap;
             groupMap.reserve(group.second.size());
             int batchSize = 0; // Number of elements in batch group
             int instancesSize = 0; // Number of instances groups
             for(auto &&x : group.second){
-                if(groupMap[x.first.get().mesh.object.get()].size() == 0){
+                auto &meshGroup = groupMap[x.first.get().mesh.handle.value];
+                if(meshGroup.size() == 0){
                     batchSize++;
-                } else if(groupMap[x.first.get().mesh.object.get()].size() == 1){
+                } else if(meshGroup.size() == 1){
                     batchSize--; // Reverts when instances (duplied meshes) are found
                     instancesSize++; // Add instance group count when there is duplied mesh
                 }
-                groupMap[x.first.get().mesh.object.get()].push_back(std::move(x));
+                meshGroup.push_back(std::move(x));
             }
             shaderGroup.batchGroup.reserve(batchSize);
             shaderGroup.instancesGroups.reserve(instancesSize);
             for(auto &&x : groupMap){
+                // Each dynamic mesh gets its own group, so its growth never moves geometry of other meshes
+                if(std::any_of(x.second.begin(), x.second.end(), [](const Renderable &renderable){
+                    return renderable.first.get().isDynamic;
+                })){
+                    ShaderGroup dynamicGroup;
+                    dynamicGroup.shader = shaderGroup.shader;
+                    dynamicGroup.variantKey = shaderGroup.variantKey;
+                    dynamicGroup.isDynamic = true;
+                    if(x.second.size() >= 2)
+                        dynamicGroup.instancesGroups.push_back(std::move(x.second));
+                    else
+                        dynamicGroup.batchGroup = std::move(x.second);
+                    shaderGroups.push_back(std::move(dynamicGroup));
+                    continue;
+                }
+                // Deformed objects need their own vertices, so they are batched and never instanced
+                auto deformedBegin = std::stable_partition(x.second.begin(), x.second.end(), [this](const Renderable &renderable){
+                    return !IsDeformed(renderable.first.get());
+                });
+                shaderGroup.batchGroup.insert(shaderGroup.batchGroup.end(), std::make_move_iterator(deformedBegin),
+                std::make_move_iterator(x.second.end()));
+                x.second.erase(deformedBegin, x.second.end());
                 if(x.second.size() >= 2){
                     shaderGroup.instancesGroups.push_back(std::move(x.second));
                 } else {
@@ -432,7 +823,8 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
                     );
                 }
             }
-            shaderGroups.push_back(std::move(shaderGroup));
+            if(!shaderGroup.batchGroup.empty() || !shaderGroup.instancesGroups.empty())
+                shaderGroups.push_back(std::move(shaderGroup));
         }
     }
     // In the end, shaderGroups are groups which objects uses the same shader program (resultant of the
@@ -442,7 +834,16 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
     int64_t mapTimeTotal = std::chrono::duration_cast<std::chrono::microseconds>(mapEnd-mapBegin).count();
     // Print shader mapping time: time to batch the rendergroups with the shaders
     fmt::print("\nTime to shaders mapping: {0} (μs)\n", mapTimeTotal);
-    fmt::print("Time to generate shaders only: {0} (μs)\n", generateTimeTotal);
+    // Each instance group is drawn by a single command instead of one per object
+    size_t instancedObjectsCount = 0;
+    size_t instancedDrawsCount = 0;
+    for(auto &&shaderGroup : shaderGroups){
+        for(auto &&instanceGroup : shaderGroup.instancesGroups)
+            instancedObjectsCount += instanceGroup.size();
+        instancedDrawsCount += shaderGroup.instancesGroups.size();
+    }
+    fmt::print("Instanced objects: {0} in {1} draws ({2} draws saved)\n", instancedObjectsCount, instancedDrawsCount,
+    instancedObjectsCount - instancedDrawsCount);
     // Create needed render groups with VAO initialization
     renderGroups.resize(shaderGroups.size());
     std::vector<RenderGroupBuffers> renderGroupsBuffers(shaderGroups.size());
@@ -456,10 +857,31 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
 
     for(size_t i = 0; i < renderGroups.size(); i++){
         renderGroups[i].shader = shaderGroups[i].shader;
+        renderGroups[i].pendingShader = shaderGroups[i].shader;
+        renderGroups[i].variantKey = shaderGroups[i].variantKey;
+        renderGroups[i].alphaMode = GetAlphaMode(shaderGroups[i].variantKey);
         fmt::print("\n-- Building render group {0}\n",  i + 1);
         BuildRenderGroup(renderGroups[i], renderGroupsBuffers[i], shaderGroups[i]);
     }
+    pendingShadersCount = renderGroups.size();
+    reportShadersWallTime = parallelShaderCompileFlag;
+    // Masked groups write depth in prepass with a depth only variant, which discards the same fragments
+    size_t alphaModesCounts[3] = {0, 0, 0};
+    for(auto &&renderGroup : renderGroups){
+        alphaModesCounts[static_cast<int>(renderGroup.alphaMode)]++;
+        if(renderGroup.alphaMode != AlphaMode::Masked || !depthPassFlag)
+            continue;
+        renderGroup.pendingDepthShader = RequestVariantProgram(DepthOnlyKey(renderGroup.variantKey), glm::ivec3(-1));
+        if(renderGroup.pendingDepthShader)
+            pendingShadersCount++;
+    }
+    fmt::print("Render groups: {0} opaque, {1} masked, {2} transparent\n", alphaModesCounts[0], alphaModesCounts[1],
+    alphaModesCounts[2]);
 
+    // Light blocks are reserved even when no program uses them yet, as programs of other light buckets may
+    std::optional<int> pointLightsBinding = AddUBOBindingPurpose(Constants::ShaderStandard::pointLightsBinding);
+    std::optional<int> directionalLightsBinding = AddUBOBindingPurpose(Constants::ShaderStandard::directionalLightsBinding);
+    std::optional<int> spotLightsBinding = AddUBOBindingPurpose(Constants::ShaderStandard::spotLightsBinding);
     // Point Light
     {
         size_t maxSize = sizeof(PointLight)*Constants::ShaderStandard::maxPointLights;
@@ -468,7 +890,7 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
         pointLightUniformBuffer.name = pointLightUniformBufferName;
         pointLightUniformBuffer.bufferSize = maxSize;
         pointLightUniformBuffer.stride = sizeof(PointLight);
-        pointLightUniformBuffer.bindingPoint = uboBindingsPurposes[Constants::ShaderStandard::pointLightsBinding];
+        pointLightUniformBuffer.bindingPoint = pointLightsBinding.value_or(-1);
 
         glNamedBufferStorage(pointLightUniformBuffer.name, maxSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
     }
@@ -480,7 +902,7 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
         directionalLightUniformBuffer.name = directionalLightUniformBufferName;
         directionalLightUniformBuffer.bufferSize = maxSize;
         directionalLightUniformBuffer.stride = sizeof(DirectionalLight);
-        directionalLightUniformBuffer.bindingPoint = uboBindingsPurposes[Constants::ShaderStandard::directionalLightsBinding];
+        directionalLightUniformBuffer.bindingPoint = directionalLightsBinding.value_or(-1);
 
         glNamedBufferStorage(directionalLightUniformBuffer.name, maxSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
     }
@@ -492,13 +914,19 @@ void Renderer::PrepareRenderGroups(entt::registry &registry){
         spotLightUniformBuffer.name = spotLightUniformBufferName;
         spotLightUniformBuffer.bufferSize = sizeof(SpotLight)*spotLights.size();
         spotLightUniformBuffer.stride = sizeof(SpotLight);
-        spotLightUniformBuffer.bindingPoint = uboBindingsPurposes[Constants::ShaderStandard::spotLightsBinding];
+        spotLightUniformBuffer.bindingPoint = spotLightsBinding.value_or(-1);
 
         glNamedBufferStorage(spotLightUniformBuffer.name, maxSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
     }
-    glBindBufferBase(GL_UNIFORM_BUFFER, pointLightUniformBuffer.bindingPoint, pointLightUniformBuffer.name);
-    glBindBufferBase(GL_UNIFORM_BUFFER, directionalLightUniformBuffer.bindingPoint, directionalLightUniformBuffer.name);
-    glBindBufferBase(GL_UNIFORM_BUFFER, spotLightUniformBuffer.bindingPoint, spotLightUniformBuffer.name);
+    if(!pointLightsBinding.has_value() || !directionalLightsBinding.has_value() || !spotLightsBinding.has_value()){
+        // Binding 0 would alias a block of other purpose. Lit programs fail to bind their blocks too
+        std::cout << "No binding point available for light blocks - Lights are not bound and light buckets are disabled\n";
+        lightsBucketsFlag = false;
+        return;
+    }
+    glState.BindBufferBase(GL_UNIFORM_BUFFER, pointLightUniformBuffer.bindingPoint, pointLightUniformBuffer.name);
+    glState.BindBufferBase(GL_UNIFORM_BUFFER, directionalLightUniformBuffer.bindingPoint, directionalLightUniformBuffer.name);
+    glState.BindBufferBase(GL_UNIFORM_BUFFER, spotLightUniformBuffer.bindingPoint, spotLightUniformBuffer.name);
 }
 
 std::optional<int> Renderer::AddUBOBindingPurpose(const std::string &purpose){
@@ -567,7 +995,8 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
         meshGlobalTopology = instancesGroups[0][0].first.get().mesh->GetTopology();
         meshGlobalIndicesType = instancesGroups[0][0].first.get().mesh->GetIndicesType();
     } else if(instancesGroups.size() > 0 && instancesGroups[0].size() > 0){
-        if(!(batchGroup[0].first.get().mesh->GetLayout() == instancesGroups[0][0].first.get().mesh->GetLayout()) ||
+        // Layouts of meshes only need to match when attributes are fetched by VAO
+        if((!shaderGroup.vertexPulling && !(batchGroup[0].first.get().mesh->GetLayout() == instancesGroups[0][0].first.get().mesh->GetLayout())) ||
         !(batchGroup[0].first.get().mesh->GetTopology() == instancesGroups[0][0].first.get().mesh->GetTopology()) ||
         !(batchGroup[0].first.get().mesh->GetIndicesType() == instancesGroups[0][0].first.get().mesh->GetIndicesType())){
             return;
@@ -588,28 +1017,22 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
     int attributesCount = meshGlobalLayout.attributes.size();
 
     //Combines meshes attributes in a single data vector
-    renderGroupBuffers.attributesData = std::vector<MeshAttributeData>(attributesCount);
+    renderGroupBuffers.attributesData = std::vector<MeshAttributeData>(shaderGroup.vertexPulling ? 0 : attributesCount);
     auto &attributesBatchedChunks = renderGroupBuffers.attributesData;
     for(size_t i = 0; i < attributesBatchedChunks.size(); i++){
         attributesBatchedChunks[i].attribute = meshGlobalLayout.attributes[i];
-        switch(attributesBatchedChunks[i].attribute.type){
-            case MeshAttributeType::Float:
-            attributesBatchedChunks[i].data = std::vector<float>(); break;
-            case MeshAttributeType::Int:
-            attributesBatchedChunks[i].data = std::vector<int>(); break;
-            case MeshAttributeType::UnsignedInt:
-            attributesBatchedChunks[i].data = std::vector<unsigned int>(); break;
-            case MeshAttributeType::Byte:
-            attributesBatchedChunks[i].data = std::vector<char>(); break;
-            case MeshAttributeType::UnsignedByte:
-            attributesBatchedChunks[i].data = std::vector<unsigned char>(); break;
-            case MeshAttributeType::Short:
-            attributesBatchedChunks[i].data = std::vector<short>(); break;
-            case MeshAttributeType::UnsignedShort:
-            attributesBatchedChunks[i].data = std::vector<unsigned short>(); break;
-            case MeshAttributeType::None: break;
-        }
+        attributesBatchedChunks[i].stride = attributesBatchedChunks[i].attribute.AttributeDataSize();
     }
+    // Chunks are allocated once, so meshes attributes are only copied with memcpy
+    size_t groupVerticesCount = 0;
+    for(auto &&object : batchGroup)
+        groupVerticesCount += object.first.get().mesh->GetVerticesCount();
+    for(auto &&instanceGroup : instancesGroups)
+        groupVerticesCount += instanceGroup[0].first.get().mesh->GetVerticesCount();
+    for(auto &&attributesBatchedChunk : attributesBatchedChunks)
+        attributesBatchedChunk.data.Reserve(groupVerticesCount * attributesBatchedChunk.stride);
+    if(shaderGroup.vertexPulling)
+        renderGroupBuffers.verticesLayouts.reserve(objectsCount * Constants::ShaderStandard::pullingSlotsCount);
 
     MeshIndexData& indicesBatchedChunk = renderGroupBuffers.indicesData;
     indicesBatchedChunk.type = meshGlobalIndicesType;
@@ -638,48 +1061,14 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
     for(auto &&object : batchGroup){
         auto& mesh = object.first.get().mesh;
 
-        size_t attributeIndex = 0;
-        for(auto &&attributesData : mesh->GetAttributesDatas()){
-            attributesBatchedChunks[attributeIndex].dataSize += attributesData.dataSize;
-            switch(attributesData.attribute.type){
-                case MeshAttributeType::Float:
-                std::get<std::vector<float>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<float>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<float>>(attributesData.data).begin(),
-                std::get<std::vector<float>>(attributesData.data).end()); break;
-                case MeshAttributeType::Int:
-                std::get<std::vector<int>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<int>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<int>>(attributesData.data).begin(),
-                std::get<std::vector<int>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedInt:
-                std::get<std::vector<unsigned int>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned int>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned int>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned int>>(attributesData.data).end()); break;
-                case MeshAttributeType::Byte:
-                std::get<std::vector<char>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<char>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<char>>(attributesData.data).begin(),
-                std::get<std::vector<char>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedByte:
-                std::get<std::vector<unsigned char>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned char>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned char>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned char>>(attributesData.data).end()); break;
-                case MeshAttributeType::Short:
-                std::get<std::vector<short>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<short>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<short>>(attributesData.data).begin(),
-                std::get<std::vector<short>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedShort:
-                std::get<std::vector<unsigned short>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned short>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned short>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned short>>(attributesData.data).end()); break;
-                case MeshAttributeType::None: break;
+        if(shaderGroup.vertexPulling){
+            PushPulledVertices(renderGroupBuffers, *mesh, 1);
+        } else {
+            size_t attributeIndex = 0;
+            for(auto &&attributesData : mesh->GetAttributesDatas()){
+                attributesBatchedChunks[attributeIndex].Append(attributesData);
+                attributeIndex++;
             }
-            attributeIndex++;
         }
 
         {
@@ -713,10 +1102,17 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
             renderGroupBuffers.batchGroup.drawcount += 1;
             renderGroupBuffers.batchGroup.baseVertex.push_back(baseVertex);
         }
+        // Levels of detail and meshlets of dynamic meshes would be outdated after the first update
+        unsigned int lodsIndicesCount = 0;
+        if(!shaderGroup.isDynamic){
+            PushDrawClusters(renderGroupBuffers, *mesh, firstIndex, objectIndex, instanceCount);
+            lodsIndicesCount = PushDrawLODs(renderGroupBuffers, *mesh, firstIndex, objectIndex, instanceCount);
+        }
 
-        //Base vertex is offset of vertices, not of indices
-        baseVertex += mesh->GetVerticesCount();
-        firstIndex += indicesCount;
+        //Base vertex is offset of vertices, not of indices. Pulled vertices are addressed by object layouts instead
+        if(!shaderGroup.vertexPulling)
+            baseVertex += mesh->GetVerticesCount();
+        firstIndex += indicesCount + lodsIndicesCount;
         baseInstance += instanceCount;
 
         auto& objectMaterial = object.first.get().material;
@@ -765,48 +1161,14 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
         auto& mesh = instanceGroup[0].first.get().mesh;
         unsigned int instanceCount = instanceGroup.size();
 
-        int attributeIndex = 0;
-        for(auto &&attributesData : mesh->GetAttributesDatas()){
-            attributesBatchedChunks[attributeIndex].dataSize += attributesData.dataSize;
-            switch(attributesData.attribute.type){
-                case MeshAttributeType::Float:
-                std::get<std::vector<float>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<float>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<float>>(attributesData.data).begin(),
-                std::get<std::vector<float>>(attributesData.data).end()); break;
-                case MeshAttributeType::Int:
-                std::get<std::vector<int>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<int>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<int>>(attributesData.data).begin(),
-                std::get<std::vector<int>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedInt:
-                std::get<std::vector<unsigned int>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned int>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned int>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned int>>(attributesData.data).end()); break;
-                case MeshAttributeType::Byte:
-                std::get<std::vector<char>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<char>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<char>>(attributesData.data).begin(),
-                std::get<std::vector<char>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedByte:
-                std::get<std::vector<unsigned char>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned char>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned char>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned char>>(attributesData.data).end()); break;
-                case MeshAttributeType::Short:
-                std::get<std::vector<short>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<short>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<short>>(attributesData.data).begin(),
-                std::get<std::vector<short>>(attributesData.data).end()); break;
-                case MeshAttributeType::UnsignedShort:
-                std::get<std::vector<unsigned short>>(attributesBatchedChunks[attributeIndex].data).insert(
-                std::get<std::vector<unsigned short>>(attributesBatchedChunks[attributeIndex].data).end(),
-                std::get<std::vector<unsigned short>>(attributesData.data).begin(),
-                std::get<std::vector<unsigned short>>(attributesData.data).end()); break;
-                case MeshAttributeType::None: break;
+        if(shaderGroup.vertexPulling){
+            PushPulledVertices(renderGroupBuffers, *mesh, instanceCount);
+        } else {
+            int attributeIndex = 0;
+            for(auto &&attributesData : mesh->GetAttributesDatas()){
+                attributesBatchedChunks[attributeIndex].Append(attributesData);
+                attributeIndex++;
             }
-            attributeIndex++;
         }
 
         {
@@ -842,10 +1204,16 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
             instanceGroupToPush.baseInstance = baseInstance;
             renderGroupBuffers.instancesGroups.push_back(std::move(instanceGroupToPush));
         }
+        unsigned int lodsIndicesCount = 0;
+        if(!shaderGroup.isDynamic){
+            PushDrawClusters(renderGroupBuffers, *mesh, firstIndex, objectIndex, instanceCount);
+            lodsIndicesCount = PushDrawLODs(renderGroupBuffers, *mesh, firstIndex, objectIndex, instanceCount);
+        }
 
-        //Base vertex is offset of vertices, not of indices
-        baseVertex += mesh->GetVerticesCount();
-        firstIndex += mesh->GetIndicesCount();
+        //Base vertex is offset of vertices, not of indices. Pulled vertices are addressed by object layouts instead
+        if(!shaderGroup.vertexPulling)
+            baseVertex += mesh->GetVerticesCount();
+        firstIndex += mesh->GetIndicesCount() + lodsIndicesCount;
         baseInstance += instanceCount;
 
         for(auto &&object : instanceGroup){
@@ -892,6 +1260,108 @@ void Renderer::BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, c
 
     renderGroupBuffers.objectsCount = objectsCount;
     renderGroupBuffers.materialStructArray = matParamStructArray;
+    if(std::none_of(renderGroupBuffers.drawsLODs.begin(), renderGroupBuffers.drawsLODs.end(), [](const DrawLODs &drawLODs){
+        return drawLODs.levels.size() > 1;
+    })){
+        renderGroupBuffers.drawsLODs.clear();
+    }
+    if(renderGroupBuffers.clusters.Size() == 0)
+        renderGroupBuffers.drawsClusters.clear();
+}
+
+void Renderer::PushPulledVertices(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, int objectsCount)
+{
+    std::array<glm::uvec4, Constants::ShaderStandard::pullingSlotsCount> layouts;
+    layouts.fill(glm::uvec4(0u));
+    std::vector<unsigned char> &data = renderGroupBuffers.pulledVerticesData;
+    for(auto &&attributeData : mesh.GetAttributesDatas()){
+        const MeshAttribute &attribute = attributeData.attribute;
+        int slot = -1;
+        switch(attribute.alias){
+            case MeshAttributeAlias::Position: slot = Constants::ShaderStandard::positionPullingSlot; break;
+            case MeshAttributeAlias::Normal: slot = Constants::ShaderStandard::normalPullingSlot; break;
+            case MeshAttributeAlias::Tangent: slot = Constants::ShaderStandard::tangentPullingSlot; break;
+            case MeshAttributeAlias::Bitangent: slot = Constants::ShaderStandard::bitangentPullingSlot; break;
+            case MeshAttributeAlias::Color: slot = Constants::ShaderStandard::colorPullingSlot; break;
+            case MeshAttributeAlias::TexCoord0: slot = Constants::ShaderStandard::texCoord0PullingSlot; break;
+            case MeshAttributeAlias::QTangent: slot = Constants::ShaderStandard::qTangentPullingSlot; break;
+            default: break;
+        }
+        // Other attributes are not read by standard shaders
+        if(slot < 0 || attribute.type == MeshAttributeType::None || attribute.ScalarElementsCount() > 4)
+            continue;
+        // Blocks start at words, so components (packed in their sizes) never straddle two words
+        size_t offset = (data.size() + 3) & ~size_t(3);
+        size_t attributeSize = attribute.AttributeDataSize();
+        data.resize(offset + attributeData.dataSize);
+        if(attributeData.IsPacked()){
+            std::memcpy(data.data() + offset, attributeData.data.Data(), attributeData.dataSize);
+        } else { // Interleaved attributes are packed
+            const unsigned char *source = attributeData.data.Data();
+            for(size_t i = 0, count = attributeData.VerticesCount(); i < count; i++)
+                std::memcpy(data.data() + offset + i * attributeSize, source + i * attributeData.stride, attributeSize);
+        }
+        unsigned int encoding = static_cast<unsigned int>(attribute.type) | (attribute.normalized ? 0x100u : 0u);
+        layouts[slot] = glm::uvec4(offset, attributeSize, encoding, attribute.ScalarElementsCount());
+    }
+    data.resize((data.size() + 3) & ~size_t(3));
+    // Instances of mesh share its blocks
+    for(int i = 0; i < objectsCount; i++)
+        renderGroupBuffers.verticesLayouts.insert(renderGroupBuffers.verticesLayouts.end(), layouts.begin(), layouts.end());
+}
+
+void Renderer::PushDrawClusters(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, unsigned int firstIndex, int firstObject, int objectsCount)
+{
+    if(!clusterCullingFlag || !IsClusterCullingSupported())
+        return;
+    DrawClusters drawClusters;
+    drawClusters.firstCluster = renderGroupBuffers.clusters.Size();
+    drawClusters.clustersCount = mesh.GetMeshlets().size();
+    drawClusters.firstObject = firstObject;
+    drawClusters.objectsCount = objectsCount;
+    for(auto &&meshlet : mesh.GetMeshlets())
+        renderGroupBuffers.clusters.PushMeshlet(meshlet, firstIndex + meshlet.firstIndex);
+    renderGroupBuffers.drawsClusters.push_back(drawClusters);
+}
+
+unsigned int Renderer::PushDrawLODs(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, unsigned int firstIndex, int firstObject, int objectsCount)
+{
+    DrawLODs drawLODs;
+    drawLODs.boundingSphere = mesh.GetBoundingSphere();
+    drawLODs.firstObject = firstObject;
+    drawLODs.objectsCount = objectsCount;
+    LODRange fullDetail;
+    fullDetail.firstIndex = firstIndex;
+    fullDetail.count = mesh.GetIndicesCount();
+    drawLODs.levels.push_back(fullDetail);
+    unsigned int lodsIndicesCount = 0;
+    MeshIndexData& indicesBatchedChunk = renderGroupBuffers.indicesData;
+    // Levels are stored contiguously after full detail indices of mesh
+    for(int level = 0; level < mesh.GetLODsCount(); level++){
+        const MeshLOD &lod = mesh.GetLOD(level);
+        indicesBatchedChunk.indicesSize += lod.indicesData.indicesSize;
+        switch(lod.indicesData.type){
+            case MeshIndexType::UnsignedInt:
+            std::get<std::vector<unsigned int>>(indicesBatchedChunk.indices).insert(
+            std::get<std::vector<unsigned int>>(indicesBatchedChunk.indices).end(),
+            std::get<std::vector<unsigned int>>(lod.indicesData.indices).begin(),
+            std::get<std::vector<unsigned int>>(lod.indicesData.indices).end()); break;
+            case MeshIndexType::UnsignedShort:
+            std::get<std::vector<unsigned short>>(indicesBatchedChunk.indices).insert(
+            std::get<std::vector<unsigned short>>(indicesBatchedChunk.indices).end(),
+            std::get<std::vector<unsigned short>>(lod.indicesData.indices).begin(),
+            std::get<std::vector<unsigned short>>(lod.indicesData.indices).end()); break;
+            case MeshIndexType::None: break;
+        }
+        LODRange range;
+        range.firstIndex = firstIndex + fullDetail.count + lodsIndicesCount;
+        range.count = lod.indicesCount;
+        range.error = lod.error;
+        drawLODs.levels.push_back(range);
+        lodsIndicesCount += lod.indicesCount;
+    }
+    renderGroupBuffers.drawsLODs.push_back(std::move(drawLODs));
+    return lodsIndicesCount;
 }
 
 void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffers &renderGroupBuffers, const ShaderGroup &shaderGroup)
@@ -912,8 +1382,12 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     renderGroup.commands = renderGroupBuffers.commands;
     renderGroup.batchGroup = renderGroupBuffers.batchGroup;
     renderGroup.instancesGroups = renderGroupBuffers.instancesGroups;
+    renderGroup.drawsLODs = renderGroupBuffers.drawsLODs;
+    renderGroup.drawsClusters = renderGroupBuffers.drawsClusters;
+    renderGroup.clusters = renderGroupBuffers.clusters;
+    renderGroup.vertexPulling = shaderGroup.vertexPulling;
 
-    int attributesCount = renderGroupBuffers.meshLayout.attributes.size();
+    int attributesCount = shaderGroup.vertexPulling ? 0 : renderGroupBuffers.meshLayout.attributes.size();
 
     //Temp auxiliary variables
     int objectIndex = 0; // Indexer for every object
@@ -922,6 +1396,14 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     renderGroup.models = std::vector<glm::mat4>(objectsCount, glm::mat4(1.0f));
     renderGroup.normalMatrices = std::vector<glm::mat4>(objectsCount, glm::mat4(1.0f));
     renderGroup.transforms.reserve(objectsCount);
+    // Quantized positions need per object dequantization folded into the matrices. Pulled meshes may
+    // mix formats, so every object has one (identity for float positions)
+    bool quantizedPositions = shaderGroup.vertexPulling || std::any_of(renderGroupBuffers.meshLayout.attributes.begin(), renderGroupBuffers.meshLayout.attributes.end(),
+    [](const MeshAttribute &attribute){
+        return attribute.alias == MeshAttributeAlias::Position && attribute.type != MeshAttributeType::Float;
+    });
+    if(quantizedPositions)
+        renderGroup.positionDequantizations.reserve(objectsCount);
 
     int textureParametersCount = 0;
     // Each texture array contains a map with texture pointer key and the index of layer
@@ -944,6 +1426,8 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     }
     texturesArraysImagesIndexMap = std::vector<std::unordered_map<Texture*, int>>(textureParametersCount);
     texturesArraysIndices = std::vector<std::vector<glm::ivec4>>(textureParametersCount);
+    // Mip levels available in all textures of each array. Textures built at load time have complete chains
+    std::vector<int> texturesArraysLevels(textureParametersCount, std::numeric_limits<int>::max());
     for(auto &vec : texturesArraysIndices){
         vec = std::vector<glm::ivec4>(objectsCount);
     }
@@ -958,6 +1442,7 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                     int index = texturesArraysImagesIndexMap[texParameterIndexer].size();
                     texturesArraysImagesIndexMap[texParameterIndexer][tex.get()] = index;
                 }
+                texturesArraysLevels[texParameterIndexer] = std::min(texturesArraysLevels[texParameterIndexer], tex->GetLevelsCount());
                 texturesArraysNamesMap.try_emplace(texParameterIndexer, texParameter.first);
                 texParameterIndexer++;
             }
@@ -973,6 +1458,7 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                         int index = texturesArraysImagesIndexMap[texParameterIndexer].size();
                         texturesArraysImagesIndexMap[texParameterIndexer][tex.get()] = index;
                     }
+                    texturesArraysLevels[texParameterIndexer] = std::min(texturesArraysLevels[texParameterIndexer], tex->GetLevelsCount());
                     texturesArraysNamesMap.try_emplace(texParameterIndexer, texParameter.first);
                     texParameterIndexer++;
                 }
@@ -982,6 +1468,8 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     // Textures use a compressed format
     std::vector<bool> texCompressed(textureParametersCount, false);
     std::vector<bool> forceSRGBs(textureParametersCount, false);
+    // Arrays with textures without mip chain (e.g. compressed files with a single level) are generated on GPU
+    std::vector<bool> generateMipmapsOnGPU(textureParametersCount, false);
     { // Setup textures arrays
         bool texturesArraysInitialized = false; // Check if texture arrays are setup
         bool atLeastOneTexParameter = false; // At least one tex array map is setup
@@ -998,10 +1486,12 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                     GLenum internalFormat = Texture::GliInternalFormatToGLenum(tex->GetFormat(), forceSRGB);
                     Ref<GL::TextureGL> textureGL = CreateRef<GL::TextureGL>(GL_TEXTURE_2D_ARRAY, internalFormat);
                     //textureGL->SetupStorage3D(maxTexDimensions[texParameterIndexer].maxWidth, maxTexDimensions[texParameterIndexer].maxHeight, texturesArraysImagesIndexMap[texParameterIndexer].size());
-                    textureGL->SetupStorage3D(tex->GetDimensions().x, tex->GetDimensions().y, texturesArraysImagesIndexMap[texParameterIndexer].size());
+                    generateMipmapsOnGPU[texParameterIndexer] = texturesArraysLevels[texParameterIndexer] == 1;
+                    textureGL->SetupStorage3D(tex->GetDimensions().x, tex->GetDimensions().y, texturesArraysImagesIndexMap[texParameterIndexer].size(),
+                    generateMipmapsOnGPU[texParameterIndexer] ? 0 : texturesArraysLevels[texParameterIndexer]);
                     textureGL->SetupParameters();
-                    renderGroup.texturesArrays.push_back(GL::TextureGLResource(textureGL));
-                    renderGroup.shader->SetInt(texParameter.first, texParameterIndexer);
+                    renderGroup.texturesArrays.push_back(textureGL);
+                    renderGroup.samplersNames.push_back(texParameter.first);
                     texCompressed[texParameterIndexer] = tex->IsCompressed();
                     forceSRGBs[texParameterIndexer] = forceSRGB;
                     atLeastOneTexParameter = true;
@@ -1023,10 +1513,12 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                         GLenum internalFormat = Texture::GliInternalFormatToGLenum(tex->GetFormat(), forceSRGB);
                         Ref<GL::TextureGL> textureGL = CreateRef<GL::TextureGL>(GL_TEXTURE_2D_ARRAY, internalFormat);
                         //textureGL->SetupStorage3D(maxTexDimensions[texParameterIndexer].maxWidth, maxTexDimensions[texParameterIndexer].maxHeight, texturesArraysImagesIndexMap[texParameterIndexer].size());
-                        textureGL->SetupStorage3D(tex->GetDimensions().x, tex->GetDimensions().y, texturesArraysImagesIndexMap[texParameterIndexer].size());
+                        generateMipmapsOnGPU[texParameterIndexer] = texturesArraysLevels[texParameterIndexer] == 1;
+                        textureGL->SetupStorage3D(tex->GetDimensions().x, tex->GetDimensions().y, texturesArraysImagesIndexMap[texParameterIndexer].size(),
+                        generateMipmapsOnGPU[texParameterIndexer] ? 0 : texturesArraysLevels[texParameterIndexer]);
                         textureGL->SetupParameters();
-                        renderGroup.texturesArrays.push_back(GL::TextureGLResource(textureGL));
-                        renderGroup.shader->SetInt(texParameter.first, texParameterIndexer);
+                        renderGroup.texturesArrays.push_back(textureGL);
+                        renderGroup.samplersNames.push_back(texParameter.first);
                         texCompressed[texParameterIndexer] = tex->IsCompressed();
                         forceSRGBs[texParameterIndexer] = forceSRGB;
                         atLeastOneTexParameter = true;
@@ -1039,25 +1531,20 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     }
     // Total size of unique textures
     int texturesTotalSize = 0;
+    // Smaller levels of RGB textures have rows not aligned to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     //////
     // Uploading textures datas
     for(auto &&object : batchGroup){
         auto& objectTransform = object.second;
         renderGroup.transforms.emplace_back(objectTransform);
+        if(quantizedPositions)
+            renderGroup.positionDequantizations.push_back(object.first.get().mesh->GetPositionDequantization());
 
         //Material
         auto objectMaterial = object.first.get().material;
         renderGroup.materials.push_back(*objectMaterial);
-        // Register material callbacks
-        objectMaterial->SetOnGlobalFloatChangeCallback([&renderGroup](const std::string &name, float value){
-            renderGroup.shader->SetFloat(name, value);
-        });
-        objectMaterial->SetOnGlobalBooleanChangeCallback([&renderGroup](const std::string &name, bool value){
-            renderGroup.shader->SetBool(name, value);
-        });
-        objectMaterial->SetOnGlobalVector4ChangeCallback([&renderGroup](const std::string &name, glm::vec4 value){
-            renderGroup.shader->SetVec4(name, value);
-        });
+        RegisterMaterialCallbacks(renderGroup, *objectMaterial);
 
         auto matTexParameters = objectMaterial->GetActivatedMapParameters();
         int texParameterIndexer = 0;
@@ -1073,12 +1560,8 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                 // } else if(texture->GetPixels().dataType == TexturePixelDataType::Float){
                 //     renderGroup.texturesArrays[texParameterIndexer]->PushData3DLayer(texture->GetWidth(), texture->GetHeight(), textureLayerIndex, texture->GetFormatGLenum(), std::get<std::vector<GLfloat>>(texture->GetPixels().data));
                 // }
-                if(!texCompressed[texParameterIndexer])
-                    renderGroup.texturesArrays[texParameterIndexer]->PushData3DLayer(texture->GetDimensions().x, texture->GetDimensions().y,
-                    textureLayerIndex, Texture::GliClientFormatToGLenum(texture->GetFormat()), Texture::GliTypeToGLenum(texture->GetFormat()), texture->GetData());
-                else // Compressed texture
-                    renderGroup.texturesArrays[texParameterIndexer]->PushCompressedData3DLayer(texture->GetDimensions().x, texture->GetDimensions().y,
-                    textureLayerIndex, Texture::GliInternalFormatToGLenum(texture->GetFormat(), forceSRGBs[texParameterIndexer]), texture->GetSize(), texture->GetData());
+                PushTextureLevels(*renderGroup.texturesArrays[texParameterIndexer], *texture, textureLayerIndex,
+                texCompressed[texParameterIndexer], forceSRGBs[texParameterIndexer]);
                 texturesTotalSize += texture->GetSize();
                 texturesImagesStored[texture.get()] = true;
             }
@@ -1094,20 +1577,13 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
             //Transform
             auto& objectTransform = object.second;
             renderGroup.transforms.push_back(objectTransform);
+            if(quantizedPositions)
+                renderGroup.positionDequantizations.push_back(object.first.get().mesh->GetPositionDequantization());
 
             //Material
             auto objectMaterial = object.first.get().material;
             renderGroup.materials.push_back(*objectMaterial);
-            // Register material callbacks
-            objectMaterial->SetOnGlobalFloatChangeCallback([&renderGroup](const std::string &name, float value){
-                renderGroup.shader->SetFloat(name, value);
-            });
-            objectMaterial->SetOnGlobalBooleanChangeCallback([&renderGroup](const std::string &name, bool value){
-                renderGroup.shader->SetBool(name, value);
-            });
-            objectMaterial->SetOnGlobalVector4ChangeCallback([&renderGroup](const std::string &name, glm::vec4 value){
-                renderGroup.shader->SetVec4(name, value);
-            });
+            RegisterMaterialCallbacks(renderGroup, *objectMaterial);
 
             auto matTexParameters = objectMaterial->GetActivatedMapParameters();
             int texParameterIndexer = 0;
@@ -1123,12 +1599,8 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
                     // } else if(texture->GetPixels().dataType == TexturePixelDataType::Float){
                     //     renderGroup.texturesArrays[texParameterIndexer]->PushData3DLayer(texture->GetWidth(), texture->GetHeight(), textureLayerIndex, texture->GetFormatGLenum(), std::get<std::vector<GLfloat>>(texture->GetPixels().data));
                     // }
-                    if(!texCompressed[texParameterIndexer])
-                        renderGroup.texturesArrays[texParameterIndexer]->PushData3DLayer(texture->GetDimensions().x, texture->GetDimensions().y,
-                        textureLayerIndex, Texture::GliClientFormatToGLenum(texture->GetFormat()), Texture::GliTypeToGLenum(texture->GetFormat()), texture->GetData());
-                    else // Compressed texture
-                        renderGroup.texturesArrays[texParameterIndexer]->PushCompressedData3DLayer(texture->GetDimensions().x, texture->GetDimensions().y,
-                        textureLayerIndex, Texture::GliInternalFormatToGLenum(texture->GetFormat(), forceSRGBs[texParameterIndexer]), texture->GetSize(), texture->GetData());
+                    PushTextureLevels(*renderGroup.texturesArrays[texParameterIndexer], *texture, textureLayerIndex,
+                    texCompressed[texParameterIndexer], forceSRGBs[texParameterIndexer]);
                     texturesTotalSize += texture->GetSize();
                     texturesImagesStored[texture.get()] = true;
                 }
@@ -1139,9 +1611,11 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
             objectIndex++;
         }
     }
-    // After all data is pushed, generate mipmaps for each texture array
-    for(auto &texArray : renderGroup.texturesArrays){
-        texArray->GenerateMipmaps();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Mip chains are uploaded from textures. Only arrays without them still use driver generation
+    for(size_t i = 0; i < renderGroup.texturesArrays.size(); i++){
+        if(generateMipmapsOnGPU[i])
+            renderGroup.texturesArrays[i]->GenerateMipmaps();
     }
     auto setupEnd = std::chrono::high_resolution_clock::now();
     fmt::print("Time to setup textures data: {0} (μs)\n",
@@ -1160,7 +1634,37 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
     std::vector<GLsizei> attributesStrides(attributesCount);
 
     // VBO
-    if(!interleaveAttributesFlag)
+    if(shaderGroup.isDynamic){
+        // Buffers are mutable, so growth respecifies them without recreating the VAO bindings
+        renderGroup.dynamicGeometry = CreateRef<DynamicGeometry>();
+        DynamicGeometry &geometry = *renderGroup.dynamicGeometry;
+        geometry.mesh = batchGroup.empty() ? instancesGroups[0][0].first.get().mesh.Object() : batchGroup[0].first.get().mesh.Object();
+        geometry.layout = renderGroupBuffers.meshLayout;
+        GLuint buffersNames[2] = {0, 0};
+        glCreateBuffers(2, buffersNames);
+        renderGroup.attributesBuffer.name = buffersNames[0];
+        renderGroup.attributesBuffer.bindingPoint = vboBindingPoint;
+        renderGroup.indicesBuffer.name = buffersNames[1];
+        AllocateDynamicGeometry(renderGroup);
+        UploadDynamicVertices(renderGroup, 0, geometry.verticesCount);
+        UploadDynamicIndices(renderGroup, 0, geometry.indicesCount);
+        geometry.mesh->ClearDirtyRanges();
+        attributesOffsets = geometry.attributesOffsets;
+        attributesStrides = geometry.attributesStrides;
+        meshesTotalSize += renderGroup.attributesBuffer.bufferSize + renderGroup.indicesBuffer.bufferSize;
+    } else if(shaderGroup.vertexPulling){
+        GLuint buffersNames[2] = {0, 0};
+        glCreateBuffers(2, buffersNames);
+        renderGroup.verticesDataBuffer = Buffer(buffersNames[0], renderGroupBuffers.pulledVerticesData.size(), sizeof(GLuint),
+        Constants::ShaderStandard::vertexDataStorageBinding);
+        renderGroup.verticesLayoutsBuffer = Buffer(buffersNames[1], sizeof(glm::uvec4) * renderGroupBuffers.verticesLayouts.size(),
+        sizeof(glm::uvec4) * Constants::ShaderStandard::pullingSlotsCount, Constants::ShaderStandard::vertexLayoutsStorageBinding);
+        glNamedBufferStorage(renderGroup.verticesDataBuffer.name, renderGroup.verticesDataBuffer.bufferSize,
+        renderGroupBuffers.pulledVerticesData.data(), GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(renderGroup.verticesLayoutsBuffer.name, renderGroup.verticesLayoutsBuffer.bufferSize,
+        renderGroupBuffers.verticesLayouts.data(), GL_DYNAMIC_STORAGE_BIT);
+        meshesTotalSize += renderGroup.verticesDataBuffer.bufferSize;
+    } else if(!interleaveAttributesFlag)
     {
         for(size_t i = 0; i < renderGroupBuffers.attributesData.size(); i++){
             attributesOffsets[i] = attributesBufferTotalSize;
@@ -1177,23 +1681,8 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
         glNamedBufferStorage(renderGroup.attributesBuffer.name, renderGroup.attributesBuffer.bufferSize,
         nullptr, GL_DYNAMIC_STORAGE_BIT);
         for(size_t i = 0; i < renderGroupBuffers.attributesData.size(); i++){
-            switch(renderGroupBuffers.attributesData[i].attribute.type){
-                case MeshAttributeType::Float:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<float>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::Int:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<int>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::UnsignedInt:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<unsigned int>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::Byte:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<char>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::UnsignedByte:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<unsigned char>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::Short:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<short>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::UnsignedShort:
-                glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize, std::get<std::vector<unsigned short>>(renderGroupBuffers.attributesData[i].data).data()); break;
-                case MeshAttributeType::None: break;
-            }
+            glNamedBufferSubData(renderGroup.attributesBuffer.name, attributesOffsets[i], renderGroupBuffers.attributesData[i].dataSize,
+            renderGroupBuffers.attributesData[i].data.Data());
         }
         meshesTotalSize += attributesBufferTotalSize;
     } else {
@@ -1210,19 +1699,14 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
             attributesStrides[i] = vertexSize;
         }
         vboData.resize(attributesBufferTotalSize);
-        size_t verticesCount = 0;
-        size_t firstScalarsCount = renderGroupBuffers.attributesData[0].attribute.ScalarElementsCount();
-        std::visit([&verticesCount, firstScalarsCount](auto&& vector){
-            verticesCount = vector.size() / firstScalarsCount;
-        }, renderGroupBuffers.attributesData[0].data);
-        for(size_t i = 0; i < verticesCount; i++){
-            for(size_t j = 0; j < renderGroupBuffers.attributesData.size(); j++){
-                size_t scalarsCount = renderGroupBuffers.attributesData[j].attribute.ScalarElementsCount();
-                size_t attribSize = renderGroupBuffers.attributesData[j].attribute.AttributeDataSize();
-                std::visit([&vboData, &attributesOffsets, i, j, vertexSize, scalarsCount, attribSize](auto&& vector){
-                    std::memcpy(&vboData[vertexSize*i + attributesOffsets[j]], &vector[i*scalarsCount], attribSize);
-                }, renderGroupBuffers.attributesData[j].data);
-            }
+        size_t verticesCount = renderGroupBuffers.attributesData[0].VerticesCount();
+        for(size_t j = 0; j < renderGroupBuffers.attributesData.size(); j++){
+            const MeshAttributeData &attributeData = renderGroupBuffers.attributesData[j];
+            size_t attribSize = attributeData.attribute.AttributeDataSize();
+            const unsigned char *source = attributeData.data.Data();
+            char *destination = vboData.data() + attributesOffsets[j];
+            for(size_t i = 0; i < verticesCount; i++)
+                std::memcpy(destination + vertexSize*i, source + attributeData.stride*i, attribSize);
         }
 
         GLuint attributesBuffersName = 0;
@@ -1237,7 +1721,7 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
         meshesTotalSize += attributesBufferTotalSize;
     }
     // EBO
-    {
+    if(!shaderGroup.isDynamic){
         GLuint indicesBufferName = 0;
         glCreateBuffers(1, std::addressof(indicesBufferName));
         renderGroup.indicesBuffer.name = indicesBufferName;
@@ -1314,15 +1798,25 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
         }
     }
 
-    SetRenderGroupLayout(renderGroup, renderGroupBuffers.meshLayout);
-    BindRenderGroupAttributesBuffers(renderGroup, attributesOffsets, attributesStrides);
+    if(!shaderGroup.vertexPulling){
+        SetRenderGroupLayout(renderGroup, renderGroupBuffers.meshLayout);
+        BindRenderGroupAttributesBuffers(renderGroup, attributesOffsets, attributesStrides);
+    }
+    if(deformationShader && !shaderGroup.isDynamic && !shaderGroup.vertexPulling)
+        BuildGroupDeformation(renderGroup, shaderGroup, renderGroupBuffers.meshLayout, attributesOffsets, attributesStrides);
 
     if(isIndirect){
         GLuint drawCmdBufferName = 0;
         glCreateBuffers(1, std::addressof(drawCmdBufferName));
         renderGroup.drawCmdBuffer.name = drawCmdBufferName;
-        renderGroup.drawCmdBuffer.bufferSize = sizeof(DrawElementsIndirectCommand) * renderGroup.commands.size();
-        glNamedBufferStorage(renderGroup.drawCmdBuffer.name, renderGroup.drawCmdBuffer.bufferSize, renderGroup.commands.data(), GL_DYNAMIC_STORAGE_BIT);
+        // Culling may emit one command per meshlet of every object, besides whole draws of coarser levels
+        size_t commandsCapacity = renderGroup.commands.size();
+        for(auto &&drawClusters : renderGroup.drawsClusters)
+            commandsCapacity += drawClusters.clustersCount * drawClusters.objectsCount;
+        renderGroup.culledCommands.reserve(commandsCapacity);
+        renderGroup.drawCmdBuffer.bufferSize = sizeof(DrawElementsIndirectCommand) * commandsCapacity;
+        glNamedBufferStorage(renderGroup.drawCmdBuffer.name, renderGroup.drawCmdBuffer.bufferSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferSubData(renderGroup.drawCmdBuffer.name, 0, sizeof(DrawElementsIndirectCommand) * renderGroup.commands.size(), renderGroup.commands.data());
         renderGroup.drawCmdBuffer.commandsCount = renderGroup.commands.size();
     }
 
@@ -1355,7 +1849,7 @@ void Renderer::BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffe
 }
 
 void Renderer::DrawFunctionIndirect(RenderGroup &renderGroup){
-    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderGroup.drawCmdBuffer.name);
+    glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, renderGroup.drawCmdBuffer.name);
     glMultiDrawElementsIndirect(
         renderGroup.mode,
         renderGroup.indicesType,
@@ -1392,13 +1886,601 @@ void Renderer::SetMainWindow(Window *mainWindow){
     this->mainWindow = mainWindow;
 }
 
-void Renderer::SetupDepthShader()
+void Renderer::SelectLODs(RenderGroup &renderGroup, const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform)
+{
+    float halfViewportHeight = 0.5f * (mainWindow ? mainWindow->GetHeight() : 1);
+    float projectionScale = mainCamera.isPerspective ? halfViewportHeight / glm::tan(glm::radians(mainCamera.fieldOfView) * 0.5f) :
+    halfViewportHeight / mainCamera.orthographicSize;
+    bool commandsChanged = false;
+    for(size_t drawIndex = 0; drawIndex < renderGroup.drawsLODs.size(); drawIndex++){
+        DrawLODs &drawLODs = renderGroup.drawsLODs[drawIndex];
+        int levelsCount = drawLODs.levels.size();
+        int level = drawLODs.currentLevel;
+        if(lodOverride >= 0){
+            level = glm::min(lodOverride, levelsCount - 1);
+        } else if(levelsCount > 1){
+            // Instances use the level of their largest projection
+            float radiusInPixels = 0.0f;
+            for(int i = drawLODs.firstObject; i < drawLODs.firstObject + drawLODs.objectsCount; i++){
+                const TransformComponent &transform = renderGroup.transforms[i].get();
+                glm::vec3 center = transform.position + transform.rotation * (transform.scale * glm::vec3(drawLODs.boundingSphere));
+                float radius = drawLODs.boundingSphere.w * glm::max(glm::abs(transform.scale.x), glm::max(glm::abs(transform.scale.y), glm::abs(transform.scale.z)));
+                float distance = glm::length(center - mainCameraTransform.position);
+                if(mainCamera.isPerspective && distance <= radius){
+                    radiusInPixels = std::numeric_limits<float>::max();
+                    break;
+                }
+                radiusInPixels = glm::max(radiusInPixels, radius * projectionScale / (mainCamera.isPerspective ? distance : 1.0f));
+            }
+            auto coarsestLevel = [&](float threshold){
+                int selected = 0;
+                for(int l = 1; l < levelsCount; l++){
+                    if(drawLODs.levels[l].error * radiusInPixels <= threshold)
+                        selected = l;
+                }
+                return selected;
+            };
+            // Current level is kept while it is inside hysteresis band
+            int finerLevel = coarsestLevel(lodPixelThreshold / (1.0f + lodHysteresis));
+            int coarserLevel = coarsestLevel(lodPixelThreshold * (1.0f + lodHysteresis));
+            level = glm::clamp(level, finerLevel, coarserLevel);
+        }
+        if(level == drawLODs.currentLevel)
+            continue;
+        drawLODs.currentLevel = level;
+        const LODRange &range = drawLODs.levels[level];
+        if(isIndirect){
+            renderGroup.commands[drawIndex].firstIndex = range.firstIndex;
+            renderGroup.commands[drawIndex].count = range.count;
+            commandsChanged = true;
+        } else if(static_cast<GLsizei>(drawIndex) < renderGroup.batchGroup.drawcount){
+            renderGroup.batchGroup.count[drawIndex] = range.count;
+            renderGroup.batchGroup.indices[drawIndex] = (GLvoid*)(intptr_t)(range.firstIndex*renderGroup.indicesTypeSize);
+        } else {
+            InstanceGroup &instanceGroup = renderGroup.instancesGroups[drawIndex - renderGroup.batchGroup.drawcount];
+            instanceGroup.firstIndex = range.firstIndex;
+            instanceGroup.count = range.count;
+        }
+    }
+    // Cluster culling uploads its own commands
+    if(commandsChanged && renderGroup.drawsClusters.empty())
+        glNamedBufferSubData(renderGroup.drawCmdBuffer.name, 0, sizeof(DrawElementsIndirectCommand) * renderGroup.commands.size(), renderGroup.commands.data());
+}
+
+bool Renderer::IsClusterCullingSupported() const
+{
+    return isIndirect && version >= GLApiVersion::V460;
+}
+
+void Renderer::CullClusters(RenderGroup &renderGroup, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    const ClusterBounds &clusters = renderGroup.clusters;
+    renderGroup.culledCommands.clear();
+    for(size_t drawIndex = 0; drawIndex < renderGroup.commands.size(); drawIndex++){
+        const DrawElementsIndirectCommand &command = renderGroup.commands[drawIndex];
+        const DrawClusters &drawClusters = renderGroup.drawsClusters[drawIndex];
+        submittedTrianglesCount += static_cast<size_t>(command.count / 3) * command.instanceCount;
+        // Meshlets cover only full detail indices
+        bool fullDetail = renderGroup.drawsLODs.empty() || renderGroup.drawsLODs[drawIndex].currentLevel == 0;
+        if(drawClusters.clustersCount == 0 || !fullDetail){
+            renderGroup.culledCommands.push_back(command);
+            drawnTrianglesCount += static_cast<size_t>(command.count / 3) * command.instanceCount;
+            continue;
+        }
+        for(int objectIndex = drawClusters.firstObject; objectIndex < drawClusters.firstObject + drawClusters.objectsCount; objectIndex++){
+            const TransformComponent &transform = renderGroup.transforms[objectIndex].get();
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation) *
+            glm::scale(glm::mat4(1.0f), transform.scale);
+            // Frustum planes and camera are taken to mesh space, so meshlets bounds are not transformed
+            glm::mat4 meshToClip = viewProjection * model;
+            glm::vec4 planes[6];
+            for(int axis = 0; axis < 3; axis++){
+                glm::vec4 row(meshToClip[0][axis], meshToClip[1][axis], meshToClip[2][axis], meshToClip[3][axis]);
+                glm::vec4 rowW(meshToClip[0][3], meshToClip[1][3], meshToClip[2][3], meshToClip[3][3]);
+                planes[2 * axis] = rowW + row;
+                planes[2 * axis + 1] = rowW - row;
+            }
+            for(glm::vec4 &plane : planes)
+                plane /= glm::length(glm::vec3(plane));
+            glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+            size_t cluster = drawClusters.firstCluster;
+            size_t clustersEnd = drawClusters.firstCluster + drawClusters.clustersCount;
+            auto emitCluster = [&](size_t c){
+                renderGroup.culledCommands.emplace_back(clusters.counts[c], 1, clusters.firstIndices[c], command.baseVertex,
+                static_cast<unsigned int>(objectIndex));
+                drawnTrianglesCount += clusters.counts[c] / 3;
+            };
+#ifdef __AVX__
+            for(; cluster + 8 <= clustersEnd; cluster += 8){
+                __m256 centerX = _mm256_loadu_ps(&clusters.centersX[cluster]);
+                __m256 centerY = _mm256_loadu_ps(&clusters.centersY[cluster]);
+                __m256 centerZ = _mm256_loadu_ps(&clusters.centersZ[cluster]);
+                __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&clusters.radii[cluster]));
+                __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for(const glm::vec4 &plane : planes){
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)),
+                    _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+                    _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+                    visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+                }
+                __m256 directionX = _mm256_sub_ps(_mm256_loadu_ps(&clusters.apexesX[cluster]), _mm256_set1_ps(camera.x));
+                __m256 directionY = _mm256_sub_ps(_mm256_loadu_ps(&clusters.apexesY[cluster]), _mm256_set1_ps(camera.y));
+                __m256 directionZ = _mm256_sub_ps(_mm256_loadu_ps(&clusters.apexesZ[cluster]), _mm256_set1_ps(camera.z));
+                __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, _mm256_loadu_ps(&clusters.axesX[cluster])),
+                _mm256_mul_ps(directionY, _mm256_loadu_ps(&clusters.axesY[cluster]))),
+                _mm256_mul_ps(directionZ, _mm256_loadu_ps(&clusters.axesZ[cluster])));
+                __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, directionX),
+                _mm256_mul_ps(directionY, directionY)), _mm256_mul_ps(directionZ, directionZ)));
+                __m256 backFacing = _mm256_cmp_ps(dot, _mm256_mul_ps(_mm256_loadu_ps(&clusters.cutoffs[cluster]), length), _CMP_GE_OQ);
+                int mask = _mm256_movemask_ps(_mm256_andnot_ps(backFacing, visible));
+                for(int lane = 0; lane < 8; lane++){
+                    if(mask & (1 << lane))
+                        emitCluster(cluster + lane);
+                }
+            }
+#endif
+            for(; cluster < clustersEnd; cluster++){
+                glm::vec3 center(clusters.centersX[cluster], clusters.centersY[cluster], clusters.centersZ[cluster]);
+                bool visible = true;
+                for(const glm::vec4 &plane : planes)
+                    visible = visible && glm::dot(glm::vec3(plane), center) + plane.w > -clusters.radii[cluster];
+                glm::vec3 direction = glm::vec3(clusters.apexesX[cluster], clusters.apexesY[cluster], clusters.apexesZ[cluster]) - camera;
+                glm::vec3 axis(clusters.axesX[cluster], clusters.axesY[cluster], clusters.axesZ[cluster]);
+                bool backFacing = glm::dot(direction, axis) >= clusters.cutoffs[cluster] * glm::length(direction);
+                if(visible && !backFacing)
+                    emitCluster(cluster);
+            }
+        }
+    }
+    glNamedBufferSubData(renderGroup.drawCmdBuffer.name, 0, sizeof(DrawElementsIndirectCommand) * renderGroup.culledCommands.size(),
+    renderGroup.culledCommands.data());
+    renderGroup.drawCmdBuffer.commandsCount = renderGroup.culledCommands.size();
+}
+
+void Renderer::AllocateDynamicGeometry(RenderGroup &renderGroup)
+{
+    DynamicGeometry &geometry = *renderGroup.dynamicGeometry;
+    Mesh &mesh = *geometry.mesh;
+    geometry.verticesCount = mesh.GetVerticesCount();
+    geometry.indicesCount = mesh.GetIndicesCount();
+    // Amortized growth: capacity only increases by growth factor steps
+    if(static_cast<size_t>(geometry.verticesCount) > geometry.verticesCapacity)
+        geometry.verticesCapacity = std::max(static_cast<size_t>(geometry.verticesCount),
+        geometry.verticesCapacity > 0 ? static_cast<size_t>(geometry.verticesCapacity * dynamicGrowthFactor) : 0);
+    if(geometry.indicesCount > geometry.indicesCapacity)
+        geometry.indicesCapacity = std::max(static_cast<size_t>(geometry.indicesCount),
+        geometry.indicesCapacity > 0 ? static_cast<size_t>(geometry.indicesCapacity * dynamicGrowthFactor) : 0);
+
+    size_t attributesCount = geometry.layout.attributes.size();
+    geometry.attributesOffsets.resize(attributesCount);
+    geometry.attributesStrides.resize(attributesCount);
+    size_t vertexSize = 0;
+    for(size_t i = 0; i < attributesCount; i++){
+        size_t attributeSize = geometry.layout.attributes[i].AttributeDataSize();
+        // Interleaved offsets are relative to vertex, otherwise each attribute has a block with capacity vertices
+        geometry.attributesOffsets[i] = interleaveAttributesFlag ? vertexSize : vertexSize * geometry.verticesCapacity;
+        geometry.attributesStrides[i] = attributeSize;
+        vertexSize += attributeSize;
+    }
+    if(interleaveAttributesFlag)
+        std::fill(geometry.attributesStrides.begin(), geometry.attributesStrides.end(), vertexSize);
+    renderGroup.attributesBuffer.bufferSize = vertexSize * geometry.verticesCapacity;
+    renderGroup.attributesBuffer.stride = interleaveAttributesFlag ? vertexSize : renderGroup.attributesBuffer.bufferSize;
+    renderGroup.indicesBuffer.bufferSize = geometry.indicesCapacity * renderGroup.indicesTypeSize;
+    glNamedBufferData(renderGroup.attributesBuffer.name, std::max(renderGroup.attributesBuffer.bufferSize, 1u), nullptr, GL_STREAM_DRAW);
+    glNamedBufferData(renderGroup.indicesBuffer.name, std::max(renderGroup.indicesBuffer.bufferSize, 1u), nullptr, GL_STREAM_DRAW);
+}
+
+void Renderer::UploadDynamicVertices(RenderGroup &renderGroup, size_t firstVertex, size_t count)
+{
+    if(count == 0)
+        return;
+    DynamicGeometry &geometry = *renderGroup.dynamicGeometry;
+    const auto &attributesData = geometry.mesh->GetAttributesDatas();
+    if(interleaveAttributesFlag){
+        size_t vertexSize = geometry.attributesStrides[0];
+        geometry.stagingData.resize(count * vertexSize);
+        for(size_t j = 0; j < attributesData.size(); j++){
+            size_t attributeSize = attributesData[j].attribute.AttributeDataSize();
+            const unsigned char *source = attributesData[j].data.Data() + firstVertex * attributesData[j].stride;
+            unsigned char *destination = geometry.stagingData.data() + geometry.attributesOffsets[j];
+            for(size_t i = 0; i < count; i++)
+                std::memcpy(destination + i * vertexSize, source + i * attributesData[j].stride, attributeSize);
+        }
+        glNamedBufferSubData(renderGroup.attributesBuffer.name, firstVertex * vertexSize, count * vertexSize, geometry.stagingData.data());
+        streamedBytesCount += count * vertexSize;
+        return;
+    }
+    for(size_t j = 0; j < attributesData.size(); j++){
+        size_t attributeSize = attributesData[j].attribute.AttributeDataSize();
+        const unsigned char *source = attributesData[j].data.Data() + firstVertex * attributesData[j].stride;
+        if(!attributesData[j].IsPacked()){
+            geometry.stagingData.resize(count * attributeSize);
+            for(size_t i = 0; i < count; i++)
+                std::memcpy(geometry.stagingData.data() + i * attributeSize, source + i * attributesData[j].stride, attributeSize);
+            source = geometry.stagingData.data();
+        }
+        glNamedBufferSubData(renderGroup.attributesBuffer.name, geometry.attributesOffsets[j] + firstVertex * attributeSize,
+        count * attributeSize, source);
+        streamedBytesCount += count * attributeSize;
+    }
+}
+
+void Renderer::UploadDynamicIndices(RenderGroup &renderGroup, size_t firstIndex, size_t count)
+{
+    if(count == 0)
+        return;
+    std::visit([&](auto &&indices){
+        glNamedBufferSubData(renderGroup.indicesBuffer.name, firstIndex * sizeof(indices[0]), count * sizeof(indices[0]),
+        indices.data() + firstIndex);
+    }, renderGroup.dynamicGeometry->mesh->GetIndices().indices);
+    streamedBytesCount += count * renderGroup.indicesTypeSize;
+}
+
+void Renderer::StreamDynamicGeometry(RenderGroup &renderGroup)
+{
+    DynamicGeometry &geometry = *renderGroup.dynamicGeometry;
+    Mesh &mesh = *geometry.mesh;
+    const DirtyRanges &dirtyVertices = mesh.GetDirtyVertices();
+    const DirtyRanges &dirtyIndices = mesh.GetDirtyIndices();
+    size_t verticesCount = mesh.GetVerticesCount();
+    size_t indicesCount = mesh.GetIndicesCount();
+    unsigned int drawnIndicesCount = geometry.indicesCount;
+    if(dirtyVertices.IsEmpty() && dirtyIndices.IsEmpty() && verticesCount == static_cast<size_t>(geometry.verticesCount) &&
+    indicesCount == drawnIndicesCount)
+        return;
+    if(!IsSameLayout(mesh.GetLayout(), geometry.layout) || mesh.GetIndicesType() != renderGroup.indicesTypeEnum){
+        std::cerr << "Dynamic mesh layout or indices type changed. Its render group is not updated\n";
+        return;
+    }
+    if(verticesCount > geometry.verticesCapacity || indicesCount > geometry.indicesCapacity){
+        // Offsets of attributes blocks depend on capacity, so everything is uploaded again
+        AllocateDynamicGeometry(renderGroup);
+        BindRenderGroupAttributesBuffers(renderGroup, geometry.attributesOffsets, geometry.attributesStrides);
+        UploadDynamicVertices(renderGroup, 0, verticesCount);
+        UploadDynamicIndices(renderGroup, 0, indicesCount);
+    } else {
+        auto stream = [this, &renderGroup](const DirtyRanges &dirtyRanges, size_t elementsCount, GLuint bufferName, unsigned int bufferSize,
+        void (Renderer::*Upload)(RenderGroup&, size_t, size_t)){
+            if(dirtyRanges.ElementsCount() > dynamicOrphanRatio * elementsCount){
+                // Orphaning gives new storage instead of waiting for draws still reading the old one
+                glNamedBufferData(bufferName, std::max(bufferSize, 1u), nullptr, GL_STREAM_DRAW);
+                (this->*Upload)(renderGroup, 0, elementsCount);
+                return;
+            }
+            for(auto &&range : dirtyRanges.GetRanges()){
+                if(range.first < elementsCount)
+                    (this->*Upload)(renderGroup, range.first, std::min(range.end, elementsCount) - range.first);
+            }
+        };
+        stream(dirtyVertices, verticesCount, renderGroup.attributesBuffer.name, renderGroup.attributesBuffer.bufferSize,
+        &Renderer::UploadDynamicVertices);
+        stream(dirtyIndices, indicesCount, renderGroup.indicesBuffer.name, renderGroup.indicesBuffer.bufferSize,
+        &Renderer::UploadDynamicIndices);
+        geometry.verticesCount = verticesCount;
+        geometry.indicesCount = indicesCount;
+    }
+    // Group has a single mesh, so every draw starts at zero and only counts change
+    if(indicesCount != drawnIndicesCount){
+        for(auto &&command : renderGroup.commands)
+            command.count = indicesCount;
+        for(auto &&count : renderGroup.batchGroup.count)
+            count = indicesCount;
+        for(auto &&instanceGroup : renderGroup.instancesGroups)
+            instanceGroup.count = indicesCount;
+        if(isIndirect)
+            glNamedBufferSubData(renderGroup.drawCmdBuffer.name, 0, sizeof(DrawElementsIndirectCommand) * renderGroup.commands.size(),
+            renderGroup.commands.data());
+    }
+}
+
+void Renderer::BindRenderGroupVertices(RenderGroup &renderGroup)
+{
+    if(!renderGroup.vertexPulling){
+        glState.BindVertexArray(renderGroup.vao.GetHandle());
+        return;
+    }
+    // Every pulled render group is drawn with the same VAO
+    glState.SetVertexArrayElementBuffer(pullingVao->GetHandle(), renderGroup.indicesBuffer.name);
+    glState.BindVertexArray(pullingVao->GetHandle());
+    std::vector<std::pair<GLuint, GLuint>> storageBindings{
+        {renderGroup.verticesDataBuffer.bindingPoint, renderGroup.verticesDataBuffer.name},
+        {renderGroup.verticesLayoutsBuffer.bindingPoint, renderGroup.verticesLayoutsBuffer.name}
+    };
+    glState.BindBuffersBase(GL_SHADER_STORAGE_BUFFER, storageBindings);
+}
+
+bool Renderer::IsDeformed(const MeshRendererComponent &meshRenderer) const
+{
+    return deformationShader && meshRenderer.animator && !meshRenderer.isDynamic && meshRenderer.mesh->IsDeformable();
+}
+
+void Renderer::SetupDeformationShader()
+{
+    // One invocation per deformed vertex. Morph targets are applied first, then the skin matrix blended
+    // from palette by joints weights. Attributes buffer is read as words, as written attributes are float vectors
+    const std::string source =
+    "#version 430 core\n"
+    "layout(local_size_x = 64) in;\n"
+    "struct SourceVertex{ vec4 vectors[4]; uvec4 influence; };\n"
+    "struct DeformedObject{ uvec4 vertices; uvec4 morph; uvec4 outputs; };\n"
+    "layout(std430, binding = 0) buffer Attributes{ float attributes[]; };\n"
+    "layout(std430, binding = 1) readonly buffer Sources{ SourceVertex sources[]; };\n"
+    "layout(std430, binding = 2) readonly buffer Deltas{ vec4 deltas[]; };\n"
+    "layout(std430, binding = 3) readonly buffer Objects{ DeformedObject objects[]; };\n"
+    "layout(std430, binding = 4) readonly buffer VertexObjects{ uint vertexObjects[]; };\n"
+    "layout(std430, binding = 5) readonly buffer Palettes{ mat4 palettes[]; };\n"
+    "layout(std430, binding = 6) readonly buffer MorphWeights{ float morphWeights[]; };\n"
+    "uniform int deformedVerticesCount;\n"
+    "void Store(uint firstWord, uint vertex, uint stride, vec3 value){\n"
+    "    if(firstWord == 0xFFFFFFFFu)\n"
+    "        return;\n"
+    "    uint word = firstWord + vertex * stride;\n"
+    "    attributes[word] = value.x;\n"
+    "    attributes[word + 1u] = value.y;\n"
+    "    attributes[word + 2u] = value.z;\n"
+    "}\n"
+    "vec3 SafeNormalize(vec3 v){\n"
+    "    float len = length(v);\n"
+    "    return len > 0.0 ? v / len : v;\n"
+    "}\n"
+    "void main(){\n"
+    "    if(int(gl_GlobalInvocationID.x) >= deformedVerticesCount)\n"
+    "        return;\n"
+    "    DeformedObject object = objects[vertexObjects[gl_GlobalInvocationID.x]];\n"
+    "    uint vertex = gl_GlobalInvocationID.x - object.vertices.w;\n"
+    "    SourceVertex source = sources[object.vertices.x + vertex];\n"
+    "    vec3 position = source.vectors[0].xyz;\n"
+    "    vec3 normal = source.vectors[1].xyz;\n"
+    "    vec3 tangent = source.vectors[2].xyz;\n"
+    "    vec3 bitangent = source.vectors[3].xyz;\n"
+    "    for(uint t = 0u; t < object.morph.y; t++){\n"
+    "        float weight = morphWeights[object.morph.z + t];\n"
+    "        if(weight == 0.0)\n"
+    "            continue;\n"
+    "        uint delta = 2u * (object.morph.x + t * object.vertices.y + vertex);\n"
+    "        position += weight * deltas[delta].xyz;\n"
+    "        normal += weight * deltas[delta + 1u].xyz;\n"
+    "    }\n"
+    "    if(object.vertices.z != 0xFFFFFFFFu){\n"
+    "        uvec4 joints = (uvec4(source.influence.x) >> uvec4(0u, 8u, 16u, 24u)) & 0xFFu;\n"
+    "        vec4 weights = unpackUnorm4x8(source.influence.y);\n"
+    "        uint palette = object.vertices.z;\n"
+    "        mat4 skin = weights.x * palettes[palette + joints.x] + weights.y * palettes[palette + joints.y] +\n"
+    "        weights.z * palettes[palette + joints.z] + weights.w * palettes[palette + joints.w];\n"
+    "        position = (skin * vec4(position, 1.0)).xyz;\n"
+    "        mat3 skinLinear = mat3(skin);\n"
+    "        normal = skinLinear * normal;\n"
+    "        tangent = skinLinear * tangent;\n"
+    "        bitangent = skinLinear * bitangent;\n"
+    "    }\n"
+    "    uint stride = object.morph.w;\n"
+    "    Store(object.outputs.x, vertex, stride, position);\n"
+    "    Store(object.outputs.y, vertex, stride, SafeNormalize(normal));\n"
+    "    Store(object.outputs.z, vertex, stride, SafeNormalize(tangent));\n"
+    "    Store(object.outputs.w, vertex, stride, SafeNormalize(bitangent));\n"
+    "}\n";
+    // Compiled as generated programs are, so its binary is cached too
+    deformationShader = ShaderCode::CompileSources({{GL_COMPUTE_SHADER, source}});
+    static constexpr GL::UniformName deformedVerticesCountName("deformedVerticesCount");
+    deformedVerticesCountUniform = deformationShader->GetUniformHandle<int>(deformedVerticesCountName);
+}
+
+void Renderer::BuildGroupDeformation(RenderGroup &renderGroup, const ShaderGroup &shaderGroup, const MeshLayout &layout,
+const std::vector<GLintptr> &attributesOffsets, const std::vector<GLsizei> &attributesStrides)
+{
+    struct SourceVertex{
+        glm::vec4 vectors[4]; // Position, normal, tangent and bitangent
+        glm::uvec4 influence = glm::uvec4(0u); // Packed joints and unorm weights
+    };
+    struct MeshSource{
+        unsigned int firstSource = 0;
+        unsigned int firstDelta = 0;
+        int jointsCount = 0; // Joints referenced by weighted influences
+    };
+    const MeshAttributeAlias aliases[4] = {MeshAttributeAlias::Position, MeshAttributeAlias::Normal, MeshAttributeAlias::Tangent,
+    MeshAttributeAlias::Bitangent};
+    // Written attributes are float vectors at word boundaries. With blocks their strides are equal, with
+    // interleaving it is the vertex size
+    int outputs[4] = {-1, -1, -1, -1};
+    for(int k = 0; k < 4; k++){
+        for(size_t i = 0; i < layout.attributes.size(); i++){
+            const MeshAttribute &attribute = layout.attributes[i];
+            if(attribute.alias == aliases[k] && attribute.type == MeshAttributeType::Float && attribute.format == MeshAttributeFormat::Vec3
+            && attributesOffsets[i] % 4 == 0 && attributesStrides[i] % 4 == 0)
+                outputs[k] = i;
+        }
+    }
+    if(outputs[0] < 0)
+        return;
+    GLsizei stride = attributesStrides[outputs[0]];
+    for(int k = 1; k < 4; k++){
+        if(outputs[k] >= 0 && attributesStrides[outputs[k]] != stride)
+            outputs[k] = -1;
+    }
+    auto findFloat3 = [](Mesh &mesh, MeshAttributeAlias alias) -> const MeshAttributeData*{
+        for(auto &&attributeData : mesh.GetAttributesDatas()){
+            const MeshAttribute &attribute = attributeData.attribute;
+            if(attribute.alias == alias && attribute.type == MeshAttributeType::Float && attribute.format == MeshAttributeFormat::Vec3)
+                return &attributeData;
+        }
+        return nullptr;
+    };
+
+    Ref<GroupDeformation> deformation = CreateRef<GroupDeformation>();
+    std::vector<SourceVertex> sources;
+    std::vector<glm::vec4> deltas; // Pairs of position and normal offsets
+    std::vector<unsigned int> vertexObjects;
+    // Objects of the same mesh share its sources
+    std::unordered_map<Mesh*, MeshSource> meshSources;
+    size_t palettesCount = 0;
+    size_t weightsCount = 0;
+    int baseVertex = 0;
+    for(auto &&object : shaderGroup.GetBatchGroup()){
+        MeshRendererComponent &meshRenderer = object.first.get();
+        Mesh &mesh = *meshRenderer.mesh;
+        unsigned int verticesCount = mesh.GetVerticesCount();
+        int objectBaseVertex = baseVertex;
+        baseVertex += verticesCount;
+        if(!IsDeformed(meshRenderer))
+            continue;
+        auto meshSource = meshSources.find(&mesh);
+        if(meshSource == meshSources.end()){
+            const MeshAttributeData *attributesData[4];
+            for(int k = 0; k < 4; k++)
+                attributesData[k] = findFloat3(mesh, aliases[k]);
+            if(!attributesData[0])
+                continue; // Quantized positions can't be deformed, so mesh keeps bind pose
+            MeshSource newSource;
+            newSource.firstSource = sources.size();
+            newSource.firstDelta = deltas.size() / 2;
+            sources.resize(sources.size() + verticesCount);
+            SourceVertex *meshVertices = &sources[newSource.firstSource];
+            for(int k = 0; k < 4; k++){
+                if(!attributesData[k])
+                    continue;
+                auto view = attributesData[k]->View<float>();
+                for(unsigned int i = 0; i < verticesCount; i++){
+                    const float *value = view[i];
+                    meshVertices[i].vectors[k] = glm::vec4(value[0], value[1], value[2], 0.0f);
+                }
+            }
+            const auto &joints = mesh.GetSkinJoints();
+            const auto &weights = mesh.GetSkinWeights();
+            for(size_t i = 0; i < joints.size(); i++){
+                std::memcpy(&meshVertices[i].influence.x, &joints[i], sizeof(glm::u8vec4));
+                std::memcpy(&meshVertices[i].influence.y, &weights[i], sizeof(glm::u8vec4));
+                for(int j = 0; j < 4; j++){
+                    if(weights[i][j] > 0)
+                        newSource.jointsCount = std::max(newSource.jointsCount, joints[i][j] + 1);
+                }
+            }
+            for(auto &&target : mesh.GetMorphTargets()){
+                for(unsigned int i = 0; i < verticesCount; i++){
+                    deltas.push_back(i < target.positionDeltas.size() ? glm::vec4(target.positionDeltas[i], 0.0f) : glm::vec4(0.0f));
+                    deltas.push_back(i < target.normalDeltas.size() ? glm::vec4(target.normalDeltas[i], 0.0f) : glm::vec4(0.0f));
+                }
+            }
+            meshSource = meshSources.emplace(&mesh, newSource).first;
+        }
+        // Influences referencing joints out of skin would read other objects palettes
+        bool skinned = meshRenderer.skin && mesh.IsSkinned() &&
+        static_cast<size_t>(meshSource->second.jointsCount) <= meshRenderer.skin->joints.size();
+        unsigned int targetsCount = mesh.GetMorphTargets().size();
+        DeformedObject descriptor;
+        descriptor.vertices = glm::uvec4(meshSource->second.firstSource, verticesCount, skinned ? palettesCount : ~0u,
+        deformation->verticesCount);
+        descriptor.morph = glm::uvec4(meshSource->second.firstDelta, targetsCount, weightsCount, stride / 4);
+        for(int k = 0; k < 4; k++){
+            if(outputs[k] >= 0)
+                descriptor.outputs[k] = (attributesOffsets[outputs[k]] + static_cast<GLintptr>(objectBaseVertex) * stride) / 4;
+        }
+        if(skinned)
+            palettesCount += meshRenderer.skin->joints.size();
+        weightsCount += targetsCount;
+        vertexObjects.insert(vertexObjects.end(), verticesCount, deformation->descriptors.size());
+        deformation->verticesCount += verticesCount;
+        deformation->objects.push_back(meshRenderer);
+        deformation->descriptors.push_back(descriptor);
+    }
+    if(deformation->descriptors.empty())
+        return;
+    deformation->palettes = std::vector<glm::mat4>(palettesCount, glm::mat4(1.0f));
+    deformation->morphWeights = std::vector<float>(weightsCount, 0.0f);
+    // Storage can't be empty, so unused buffers have one element
+    auto createStorage = [](Buffer &buffer, int bindingPoint, size_t size, const void *data){
+        GLuint bufferName = 0;
+        glCreateBuffers(1, std::addressof(bufferName));
+        buffer = Buffer(bufferName, std::max<size_t>(size, sizeof(glm::vec4)), 0, bindingPoint);
+        glNamedBufferStorage(buffer.name, buffer.bufferSize, size > 0 ? data : nullptr, GL_DYNAMIC_STORAGE_BIT);
+    };
+    createStorage(deformation->sourcesBuffer, 1, sizeof(SourceVertex) * sources.size(), sources.data());
+    createStorage(deformation->deltasBuffer, 2, sizeof(glm::vec4) * deltas.size(), deltas.data());
+    createStorage(deformation->objectsBuffer, 3, sizeof(DeformedObject) * deformation->descriptors.size(), deformation->descriptors.data());
+    createStorage(deformation->vertexObjectsBuffer, 4, sizeof(unsigned int) * vertexObjects.size(), vertexObjects.data());
+    createStorage(deformation->palettesBuffer, 5, sizeof(glm::mat4) * palettesCount, deformation->palettes.data());
+    createStorage(deformation->morphWeightsBuffer, 6, sizeof(float) * weightsCount, deformation->morphWeights.data());
+    renderGroup.deformation = deformation;
+    fmt::print("Deformed objects: {0} ({1} vertices, {2} joints, {3} morph targets)\n", deformation->descriptors.size(),
+    deformation->verticesCount, palettesCount, weightsCount);
+}
+
+void Renderer::DeformGeometry(float deltaTime)
+{
+    deformedVerticesCount = 0;
+    if(!deformationShader)
+        return;
+    // Objects of an instance share its animator, so each one is updated once
+    std::vector<Animator*> animators;
+    {
+        std::unordered_set<Animator*> visited;
+        for(auto &&renderGroup : renderGroups){
+            if(!renderGroup.deformation)
+                continue;
+            for(auto &&object : renderGroup.deformation->objects){
+                Animator *animator = object.get().animator.get();
+                if(visited.insert(animator).second)
+                    animators.push_back(animator);
+            }
+        }
+    }
+    tbb::parallel_for(size_t(0), animators.size(), [&](size_t i){
+        animators[i]->Update(deltaTime);
+    });
+    bool dispatched = false;
+    for(auto &&renderGroup : renderGroups){
+        if(!renderGroup.deformation)
+            continue;
+        GroupDeformation &deformation = *renderGroup.deformation;
+        tbb::parallel_for(size_t(0), deformation.objects.size(), [&](size_t i){
+            const MeshRendererComponent &meshRenderer = deformation.objects[i].get();
+            const DeformedObject &descriptor = deformation.descriptors[i];
+            const Animator &animator = *meshRenderer.animator;
+            if(descriptor.vertices.z != ~0u)
+                animator.ComputeSkinPalette(*meshRenderer.skin, meshRenderer.animatorNode, &deformation.palettes[descriptor.vertices.z]);
+            // Node weights are used when animated, otherwise the default weights of mesh
+            const std::vector<float> &nodeWeights = animator.GetMorphWeights(meshRenderer.animatorNode);
+            const std::vector<float> &weights = nodeWeights.empty() ? meshRenderer.mesh->GetMorphWeights() : nodeWeights;
+            for(unsigned int t = 0; t < descriptor.morph.y; t++)
+                deformation.morphWeights[descriptor.morph.z + t] = t < weights.size() ? weights[t] : 0.0f;
+        });
+        if(!deformation.palettes.empty())
+            glNamedBufferSubData(deformation.palettesBuffer.name, 0, sizeof(glm::mat4) * deformation.palettes.size(), deformation.palettes.data());
+        if(!deformation.morphWeights.empty())
+            glNamedBufferSubData(deformation.morphWeightsBuffer.name, 0, sizeof(float) * deformation.morphWeights.size(),
+            deformation.morphWeights.data());
+        glState.UseProgram(deformationShader->GetHandle());
+        dispatched = true;
+        std::vector<std::pair<GLuint, GLuint>> storageBindings{{0, renderGroup.attributesBuffer.name}};
+        for(const Buffer *buffer : {&deformation.sourcesBuffer, &deformation.deltasBuffer, &deformation.objectsBuffer,
+        &deformation.vertexObjectsBuffer, &deformation.palettesBuffer, &deformation.morphWeightsBuffer})
+            storageBindings.emplace_back(buffer->bindingPoint, buffer->name);
+        glState.BindBuffersBase(GL_SHADER_STORAGE_BUFFER, storageBindings);
+        deformationShader->Set(deformedVerticesCountUniform, static_cast<int>(deformation.verticesCount));
+        glDispatchCompute((deformation.verticesCount + 63) / 64, 1, 1);
+        deformedVerticesCount += deformation.verticesCount;
+    }
+    // Every group is written before vertices are fetched
+    if(dispatched)
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void Renderer::SetupDepthShader(bool vertexPulling)
 {
     ShaderCode depthCode;
     depthCode.SetVersion(RenderCapabilities::GetGLSLVersion());
     depthCode.SetStageToPipeline(ShaderStage::Vertex, true);
     depthCode.SetStageToPipeline(ShaderStage::Fragment, true);
-    depthCode.AddVertexAttribute("aPosition", ShaderDataType::Float3, Constants::ShaderStandard::positionAttribLocation);
+    // Quantized positions (normalized unorm16) are read as floats too. Their dequantization is folded into MVPs
+    std::string positionString;
+    if(vertexPulling){
+        ShaderStandard::AddVertexPullingCode(depthCode);
+        positionString = "vec3 aPosition = FetchAttribute(objID, " + std::to_string(Constants::ShaderStandard::positionPullingSlot) +
+        ", vec4(0.0, 0.0, 0.0, 1.0)).xyz;\n";
+    } else {
+        depthCode.AddVertexAttribute("aPosition", ShaderDataType::Float3, Constants::ShaderStandard::positionAttribLocation);
+    }
     std::string objIDString;
     if(RenderCapabilities::GetAPIVersion() < GLApiVersion::V460){ // This works with the non indirect drawing version
         depthCode.AddExtension("GL_ARB_shader_draw_parameters");
@@ -1414,20 +2496,22 @@ void Renderer::SetupDepthShader()
     depthCode.CreateUniformBlock(ShaderStage::Vertex, "mvpsUBO", "mat4 mvps[" + maxObjectsGroupString + "];"); // MVPs uniform block
     depthCode.SetBindingPurpose(ShaderStage::Vertex, "mvpsUBO", Constants::ShaderStandard::mvpsBinding);
     depthCode.SetMain(ShaderStage::Vertex,
-    "int objID = "+objIDString+";\n"
+    "int objID = "+objIDString+";\n" +
+    positionString +
     "mat4 mvp = mvps[objID];\n"
     "gl_Position = mvp*vec4(aPosition, 1.0);\n"
     //"gl_Position.z += 0.001;\n"
     );
     depthCode.SetMain(ShaderStage::Fragment, "");
-    depthShader = depthCode.Generate();
+    Ref<GL::ShaderGL> &shader = vertexPulling ? pullingDepthShader : depthShader;
+    shader = depthCode.Generate();
     for(auto &&bindingPurpose : depthCode.GetBindingsPurposes(ShaderStage::Vertex)){
         std::optional<int> binding = AddUBOBindingPurpose(bindingPurpose.second);
         if(!binding.has_value()){
             // No binding point available
             return;
         }
-        depthShader->SetBlockBinding(bindingPurpose.first, uboBindingsPurposes[bindingPurpose.second]);
+        shader->SetBlockBinding(bindingPurpose.first, uboBindingsPurposes[bindingPurpose.second]);
     }
 
 }
@@ -1441,11 +2525,147 @@ void Renderer::SetDepthPrepassState(bool depthPass){
     this->depthPassFlag = depthPass;
 }
 
+void Renderer::SetAdaptivePrepassState(bool adaptivePrepass){
+    adaptivePrepassFlag = adaptivePrepass;
+    framesToPrepassSample = 0;
+    for(auto &&renderGroup : renderGroups)
+        renderGroup.inDepthPrepass = true;
+}
+
+void Renderer::SetDepthPrepassOptions(const DepthPrepassOptions &options){
+    depthPrepassOptions = options;
+    depthPrepassOptions.sampleInterval = glm::max(options.sampleInterval, 1);
+    depthPrepassOptions.minOccluderCoverage = glm::max(options.minOccluderCoverage, 0.0f);
+    depthPrepassOptions.minFragmentNanoseconds = glm::max(options.minFragmentNanoseconds, 0.0f);
+}
+
+void Renderer::SetAlphaModesState(bool alphaModes){
+    this->alphaModesFlag = alphaModes;
+}
+
+void Renderer::SetPassTimingState(bool passTiming){
+    passTimingFlag = passTiming;
+    frameGraph.SetTimingState(passTimingFlag || dynamicResolutionFlag);
+}
+
+void Renderer::SetDynamicResolutionState(bool dynamicResolution){
+    dynamicResolutionFlag = dynamicResolution;
+    // Controller reads GPU times of passes
+    frameGraph.SetTimingState(passTimingFlag || dynamicResolutionFlag);
+    if(dynamicResolutionFlag && !upscaleShader)
+        SetupUpscaleShader();
+}
+
+void Renderer::SetDynamicResolutionOptions(const DynamicResolutionOptions &options){
+    dynamicResolutionOptions = options;
+    dynamicResolutionOptions.minScale = glm::clamp(options.minScale, 0.1f, 1.0f);
+    dynamicResolutionOptions.maxScale = glm::clamp(options.maxScale, dynamicResolutionOptions.minScale, 1.0f);
+    dynamicResolutionOptions.targetMilliseconds = glm::max(options.targetMilliseconds, 0.1f);
+    dynamicResolutionOptions.sharpness = glm::clamp(options.sharpness, 0.0f, 1.0f);
+    resolutionScale = dynamicResolutionOptions.maxScale;
+}
+
+float Renderer::GetResolutionScale() const{
+    return dynamicResolutionFlag ? resolutionScale : 1.0f;
+}
+
+const std::vector<FrameGraphPassTiming> &Renderer::GetPassTimings() const{
+    return frameGraph.GetTimings();
+}
+
+const FrameGraphStats &Renderer::GetFrameGraphStats() const{
+    return frameGraph.GetStats();
+}
+
+void Renderer::SetRenderPath(RenderPath renderPath){
+    if(renderPath == RenderPath::Deferred && !IsDeferredSupported()){
+        std::cout << "Deferred shading needs OpenGL 4.3 - Forward path is kept\n";
+        return;
+    }
+    this->renderPath = renderPath;
+}
+
+RenderPath Renderer::GetRenderPath() const{
+    return renderPath;
+}
+
+void Renderer::SetLODPixelThreshold(float threshold){
+    this->lodPixelThreshold = threshold;
+}
+
+void Renderer::SetLODHysteresis(float hysteresis){
+    this->lodHysteresis = glm::max(hysteresis, 0.0f);
+}
+
+void Renderer::SetLODOverride(int level){
+    this->lodOverride = level;
+}
+
+void Renderer::SetClusterCullingState(bool clusterCulling){
+    this->clusterCullingFlag = clusterCulling;
+    if(clusterCulling && !IsClusterCullingSupported())
+        std::cout << "Cluster culling needs indirect drawing with GL 4.6 - Drawing whole meshes\n";
+}
+
+void Renderer::SetRenderGroupPlanningState(bool planGroups){
+    this->renderGroupPlanningFlag = planGroups;
+}
+
+void Renderer::SetRenderGroupPlanOptions(const RenderGroupPlanOptions &options){
+    this->renderGroupPlanOptions = options;
+}
+
+void Renderer::SetDynamicGrowthFactor(float growthFactor){
+    dynamicGrowthFactor = glm::max(growthFactor, 1.0f);
+}
+
+void Renderer::SetParallelShaderCompileState(bool parallelShaderCompile){
+    this->parallelShaderCompileFlag = parallelShaderCompile;
+}
+
+void Renderer::SetLightsBucketsState(bool lightsBuckets){
+    this->lightsBucketsFlag = lightsBuckets;
+}
+
+void Renderer::SetVertexPullingState(bool vertexPulling){
+    // Storage buffers and multi draw indirect are core since GL 4.3
+    if(vertexPulling && version < GLApiVersion::V430){
+        std::cout << "Vertex pulling needs storage buffers with GL 4.3 - Using vertex arrays\n";
+        vertexPulling = false;
+    }
+    this->vertexPullingFlag = vertexPulling;
+    if(vertexPulling && !pullingVao){
+        pullingVao = CreateRef<GL::VertexArrayGL>();
+        SetupDepthShader(true);
+    }
+}
+
+size_t Renderer::GetDeformedVerticesCount() const{
+    return deformedVerticesCount;
+}
+
+size_t Renderer::GetStreamedBytesCount() const{
+    return streamedBytesCount;
+}
+
+size_t Renderer::GetSubmittedTrianglesCount() const{
+    return submittedTrianglesCount;
+}
+
+size_t Renderer::GetDrawnTrianglesCount() const{
+    return drawnTrianglesCount;
+}
+
+const GL::StateCounters &Renderer::GetStateCounters() const{
+    return glState.GetCounters();
+}
+
 void Renderer::Start(entt::registry &registry){
     PrepareRenderGroups(registry);
 }
 
 void Renderer::Update(entt::registry &registry, float deltaTime){
+    glState.ResetCounters();
     auto cameraView = registry.view<CameraComponent, TransformComponent>();
 
     CameraComponent mainCamera;
@@ -1463,13 +2683,19 @@ void Renderer::Update(entt::registry &registry, float deltaTime){
     }
 
     auto lightView = registry.view<LightComponent, TransformComponent>();
+    // Deferred shading reads lights from storage buffers, so it takes more lights than forward programs
+    bool deferredLights = renderPath == RenderPath::Deferred && deferredShadingSetup;
+    const size_t maxPointLights = deferredLights ? Constants::ShaderStandard::maxDeferredLights : Constants::ShaderStandard::maxPointLights;
+    const size_t maxDirectionalLights = deferredLights ? Constants::ShaderStandard::maxDeferredLights :
+    Constants::ShaderStandard::maxDirectionalLights;
+    const size_t maxSpotLights = deferredLights ? Constants::ShaderStandard::maxDeferredLights : Constants::ShaderStandard::maxSpotLights;
     size_t pointLightCounter = 0;
     size_t directionalLightCounter = 0;
     size_t spotLightCounter = 0;
     for(auto entity : lightView){
         auto &light = lightView.get<LightComponent>(entity);
         auto &transform = lightView.get<TransformComponent>(entity);
-        if(light.type == LightType::Point && pointLightCounter < Constants::ShaderStandard::maxPointLights){
+        if(light.type == LightType::Point && pointLightCounter < maxPointLights){
             PointLight pointLight;
             pointLight.position = glm::vec4(transform.position, 1.0f);
             pointLight.color = light.isHDR ?
@@ -1485,7 +2711,7 @@ void Renderer::Update(entt::registry &registry, float deltaTime){
                 pointLights.push_back(pointLight);
                 pointLightCounter++;
             }
-        } else if(light.type == LightType::Directional && directionalLightCounter < Constants::ShaderStandard::maxDirectionalLights){
+        } else if(light.type == LightType::Directional && directionalLightCounter < maxDirectionalLights){
             DirectionalLight directionalLight;
             directionalLight.direction = glm::vec4(transform.Forward(), 1.0f);
             directionalLight.color = light.isHDR ?
@@ -1498,7 +2724,7 @@ void Renderer::Update(entt::registry &registry, float deltaTime){
                 directionalLightCounter++;
             }
 
-        } else if(light.type == LightType::Spot && spotLightCounter < Constants::ShaderStandard::maxSpotLights){
+        } else if(light.type == LightType::Spot && spotLightCounter < maxSpotLights){
             SpotLight spotLight;
             spotLight.position = glm::vec4(transform.position, 1.0f);
             spotLight.direction = glm::vec4(transform.Forward(), 1.0f);
@@ -1518,17 +2744,250 @@ void Renderer::Update(entt::registry &registry, float deltaTime){
             }
         }
     }
-    glNamedBufferSubData(pointLightUniformBuffer.name, 0, sizeof(PointLight)*pointLights.size(), pointLights.data());
-    glNamedBufferSubData(directionalLightUniformBuffer.name, 0, sizeof(DirectionalLight)*directionalLights.size(), directionalLights.data());
-    glNamedBufferSubData(spotLightUniformBuffer.name, 0, sizeof(SpotLight)*spotLights.size(), spotLights.data());
-    Draw(mainCamera, mainCameraTransform, std::vector<std::pair<std::string, size_t>>{
-        {Constants::ShaderStandard::pointLightCountName, pointLightCounter},
-        {Constants::ShaderStandard::directionalLightCountName, directionalLightCounter},
-        {Constants::ShaderStandard::spotLightCountName, spotLightCounter}
+    glNamedBufferSubData(pointLightUniformBuffer.name, 0,
+    sizeof(PointLight)*std::min(pointLights.size(), Constants::ShaderStandard::maxPointLights), pointLights.data());
+    glNamedBufferSubData(directionalLightUniformBuffer.name, 0,
+    sizeof(DirectionalLight)*std::min(directionalLights.size(), Constants::ShaderStandard::maxDirectionalLights), directionalLights.data());
+    glNamedBufferSubData(spotLightUniformBuffer.name, 0,
+    sizeof(SpotLight)*std::min(spotLights.size(), Constants::ShaderStandard::maxSpotLights), spotLights.data());
+    if(deferredLights){
+        glNamedBufferSubData(pointLightStorageBuffer.name, 0, sizeof(PointLight)*pointLightCounter, pointLights.data());
+        glNamedBufferSubData(directionalLightStorageBuffer.name, 0, sizeof(DirectionalLight)*directionalLightCounter, directionalLights.data());
+        glNamedBufferSubData(spotLightStorageBuffer.name, 0, sizeof(SpotLight)*spotLightCounter, spotLights.data());
+    }
+    DeformGeometry(deltaTime);
+    Draw(mainCamera, mainCameraTransform, glm::ivec3(pointLightCounter, directionalLightCounter, spotLightCounter));
+}
+
+void Renderer::RegisterMaterialCallbacks(RenderGroup &renderGroup, Material &material){
+    // Program may still be linking in parallel, and values set to it before link are lost
+    material.SetOnGlobalFloatChangeCallback([&renderGroup](const std::string &name, float value){
+        if(renderGroup.shaderReady)
+            renderGroup.shader->SetFloat(name, value);
+        else
+            renderGroup.pendingGlobalFloats.emplace_back(name, value);
+    });
+    material.SetOnGlobalBooleanChangeCallback([&renderGroup](const std::string &name, bool value){
+        if(renderGroup.shaderReady)
+            renderGroup.shader->SetBool(name, value);
+        else
+            renderGroup.pendingGlobalBooleans.emplace_back(name, value);
+    });
+    material.SetOnGlobalVector4ChangeCallback([&renderGroup](const std::string &name, glm::vec4 value){
+        if(renderGroup.shaderReady)
+            renderGroup.shader->SetVec4(name, value);
+        else
+            renderGroup.pendingGlobalVectors4.emplace_back(name, value);
     });
 }
 
-void Renderer::Draw(const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform, const std::vector<std::pair<std::string, size_t>> &lightsCounters){
+void Renderer::PollRenderGroupsShaders(){
+    // Depth only and G-buffer programs set no uniforms per frame, so only their samplers are set once linked
+    auto pollPassShader = [this](RenderGroup &renderGroup, Ref<GL::ShaderGL> &pendingShader, Ref<GL::ShaderGL> &shader,
+    const char *failure){
+        if(!pendingShader || !pendingShader->IsReady())
+            return;
+        Ref<GL::ShaderGL> passShader = std::move(pendingShader);
+        pendingShader = nullptr;
+        pendingShadersCount--;
+        if(!passShader->IsLinked()){
+            std::cout << failure << "\n";
+            return;
+        }
+        ProgramBinaryCache::Store(*passShader);
+        for(size_t i = 0; i < renderGroup.samplersNames.size(); i++)
+            passShader->SetInt(renderGroup.samplersNames[i], i);
+        shader = passShader;
+    };
+    for(auto &&renderGroup : renderGroups){
+        pollPassShader(renderGroup, renderGroup.pendingDepthShader, renderGroup.maskedDepthShader,
+        "Depth only program failed to link - Masked group is not drawn in depth prepass");
+        pollPassShader(renderGroup, renderGroup.pendingGBufferShader, renderGroup.gBufferShader,
+        "G-buffer program failed to link - Deferred shading is not used");
+        if(!renderGroup.pendingShader || !renderGroup.pendingShader->IsReady())
+            continue;
+        Ref<GL::ShaderGL> shader = std::move(renderGroup.pendingShader);
+        renderGroup.pendingShader = nullptr;
+        pendingShadersCount--;
+        if(!shader->IsLinked()){
+            std::cout << "Render group program failed to link - Group keeps its program\n";
+            continue;
+        }
+        // Only first group of a program stores it
+        ProgramBinaryCache::Store(*shader);
+        // Values set to replaced program, like material globals, are kept
+        if(renderGroup.shaderReady && shader != renderGroup.shader)
+            shader->CopyUniformValues(*renderGroup.shader);
+        renderGroup.shader = shader;
+        // Uniforms are only found after link
+        renderGroup.pointLightCountUniform = renderGroup.shader->GetUniformHandle<int>(Constants::ShaderStandard::pointLightCountName);
+        renderGroup.directionalLightCountUniform = renderGroup.shader->GetUniformHandle<int>(Constants::ShaderStandard::directionalLightCountName);
+        renderGroup.spotLightCountUniform = renderGroup.shader->GetUniformHandle<int>(Constants::ShaderStandard::spotLightCountName);
+        renderGroup.viewPosUniform = renderGroup.shader->GetUniformHandle<glm::vec3>(Constants::ShaderStandard::viewPosName);
+        for(size_t i = 0; i < renderGroup.samplersNames.size(); i++)
+            renderGroup.shader->SetInt(renderGroup.samplersNames[i], i);
+        for(auto &&global : renderGroup.pendingGlobalFloats)
+            renderGroup.shader->SetFloat(global.first, global.second);
+        for(auto &&global : renderGroup.pendingGlobalBooleans)
+            renderGroup.shader->SetBool(global.first, global.second);
+        for(auto &&global : renderGroup.pendingGlobalVectors4)
+            renderGroup.shader->SetVec4(global.first, global.second);
+        renderGroup.pendingGlobalFloats.clear();
+        renderGroup.pendingGlobalBooleans.clear();
+        renderGroup.pendingGlobalVectors4.clear();
+        renderGroup.shaderReady = true;
+    }
+    if(pendingShadersCount == 0 && reportShadersWallTime){
+        auto shadersEnd = std::chrono::high_resolution_clock::now();
+        fmt::print("Shader programs wall time: {0} (μs)\n",
+        std::chrono::duration_cast<std::chrono::microseconds>(shadersEnd-shadersBegin).count());
+        reportShadersWallTime = false;
+    }
+}
+
+glm::ivec3 Renderer::CountLights(entt::registry &registry) const{
+    glm::ivec3 lightsCounts(0);
+    auto lightView = registry.view<LightComponent, TransformComponent>();
+    for(auto entity : lightView){
+        switch(lightView.get<LightComponent>(entity).type){
+            case LightType::Point: lightsCounts.x++; break;
+            case LightType::Directional: lightsCounts.y++; break;
+            case LightType::Spot: lightsCounts.z++; break;
+            default: break;
+        }
+    }
+    return glm::min(lightsCounts, glm::ivec3(Constants::ShaderStandard::maxPointLights, Constants::ShaderStandard::maxDirectionalLights,
+    Constants::ShaderStandard::maxSpotLights));
+}
+
+glm::ivec3 Renderer::LightsBuckets(const glm::ivec3 &lightsCounts) const{
+    const glm::ivec3 maxLights(Constants::ShaderStandard::maxPointLights, Constants::ShaderStandard::maxDirectionalLights,
+    Constants::ShaderStandard::maxSpotLights);
+    glm::ivec3 buckets;
+    for(int i = 0; i < 3; i++)
+        buckets[i] = glm::min(lightsCounts[i] <= 1 ? lightsCounts[i] : (lightsCounts[i] <= 4 ? 4 : 16), maxLights[i]);
+    return buckets;
+}
+
+ShaderVariantKey Renderer::WithLightsBuckets(const ShaderVariantKey &key, const glm::ivec3 &buckets){
+    static const int lightingBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::lightingName);
+    // Bit of each bucket (0, 1, 4 and 16) of each light type
+    static const auto bucketsBits = [](){
+        std::array<std::array<int, 4>, 3> bits;
+        const char *types[3] = {"point", "directional", "spot"};
+        const int bucketsValues[4] = {0, 1, 4, 16};
+        for(int type = 0; type < 3; type++)
+            for(int bucket = 0; bucket < 4; bucket++)
+                bits[type][bucket] = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag,
+                std::string("lightsBucket:") + types[type] + ":" + std::to_string(bucketsValues[bucket]));
+        return bits;
+    }();
+    ShaderVariantKey bucketsKey = key;
+    for(auto &&typeBits : bucketsBits)
+        for(int bit : typeBits)
+            bucketsKey.ClearFeatureBit(bit);
+    if(!key.HasFeatureBit(lightingBit))
+        return bucketsKey;
+    for(int type = 0; type < 3; type++){
+        int bucket = buckets[type];
+        if(bucket >= 0)
+            bucketsKey.SetFeatureBit(bucketsBits[type][bucket == 0 ? 0 : (bucket == 1 ? 1 : (bucket <= 4 ? 2 : 3))]);
+    }
+    return bucketsKey;
+}
+
+Ref<GL::ShaderGL> Renderer::RequestVariantProgram(const ShaderVariantKey &key, const glm::ivec3 &buckets){
+    auto program = variantsPrograms.find(key);
+    if(program != variantsPrograms.end())
+        return program->second;
+    static const int depthOnlyBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::depthOnlyName);
+    static const int gBufferBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::gBufferName);
+    ShaderVariantKey sourceKey = WithLightsBuckets(key, glm::ivec3(-1));
+    sourceKey.ClearFeatureBit(depthOnlyBit);
+    sourceKey.ClearFeatureBit(gBufferBit);
+    auto source = shaderModelSources.find(sourceKey);
+    if(source == shaderModelSources.end())
+        return nullptr;
+    if(shaderCodeCache.count(key) == 0){
+        ShaderStandard shader;
+        BuildShaderModel(*source->second.material, source->second.layout, source->second.indicesType, shader, source->second.vertexPulling);
+        shader.SetLightsBuckets(buckets.x, buckets.y, buckets.z);
+        shader.SetDepthOnly(key.HasFeatureBit(depthOnlyBit));
+        shader.SetGBufferOutput(key.HasFeatureBit(gBufferBit));
+        shaderCodeCache.emplace(key, shader.ProcessCode());
+    }
+    ShaderCode &code = shaderCodeCache[key];
+    std::vector<std::pair<GLenum, std::string>> sources;
+    if(!code.GenerateSources(sources))
+        return nullptr;
+    Ref<GL::ShaderGL> shader = ShaderCode::CompileSources(sources, !parallelShaderCompileFlag);
+    if(!BindShaderBlocks(*shader, code))
+        return nullptr;
+    variantsPrograms.emplace(key, shader);
+    return shader;
+}
+
+void Renderer::SelectLightsVariants(){
+    size_t requestedCount = 0;
+    for(auto &&renderGroup : renderGroups){
+        ShaderVariantKey key = WithLightsBuckets(renderGroup.variantKey, lightsBuckets);
+        if(key == renderGroup.variantKey)
+            continue; // Unlit or already with these buckets
+        size_t programsCount = variantsPrograms.size();
+        Ref<GL::ShaderGL> shader = RequestVariantProgram(key, lightsBuckets);
+        if(!shader)
+            continue;
+        requestedCount += variantsPrograms.size() - programsCount;
+        // Group draws with its current program until the new one is ready
+        if(!renderGroup.pendingShader)
+            pendingShadersCount++;
+        renderGroup.pendingShader = shader;
+        renderGroup.variantKey = key;
+    }
+    if(requestedCount > 0)
+        fmt::print("Light buckets ({0}, {1}, {2}): {3} shader programs submitted\n", lightsBuckets.x, lightsBuckets.y, lightsBuckets.z,
+        requestedCount);
+}
+
+Renderer::AlphaMode Renderer::GetAlphaMode(const ShaderVariantKey &key) const{
+    static const int alphaMaskBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::alphaMaskName);
+    static const int transparentBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::transparentName);
+    if(!alphaModesFlag)
+        return AlphaMode::Opaque;
+    if(key.HasFeatureBit(transparentBit))
+        return AlphaMode::Transparent;
+    return key.HasFeatureBit(alphaMaskBit) ? AlphaMode::Masked : AlphaMode::Opaque;
+}
+
+ShaderVariantKey Renderer::DepthOnlyKey(const ShaderVariantKey &key){
+    static const int depthOnlyBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::depthOnlyName);
+    // Depth only variants have no lighting, so light buckets don't apply
+    ShaderVariantKey depthKey = WithLightsBuckets(key, glm::ivec3(-1));
+    depthKey.SetFeatureBit(depthOnlyBit);
+    return depthKey;
+}
+
+ShaderVariantKey Renderer::GBufferKey(const ShaderVariantKey &key){
+    static const int gBufferBit = ShaderVariantKey::FeatureBit(ShaderFeatureKind::Flag, Constants::ShaderStandard::gBufferName);
+    // Lights are applied by resolve pass, so light buckets don't apply
+    ShaderVariantKey gBufferKey = WithLightsBuckets(key, glm::ivec3(-1));
+    gBufferKey.SetFeatureBit(gBufferBit);
+    return gBufferKey;
+}
+
+bool Renderer::BindShaderBlocks(GL::ShaderGL &program, const ShaderCode &code){
+    for(ShaderStage stage : {ShaderStage::Vertex, ShaderStage::Fragment}){
+        for(auto &&bindingPurpose : code.GetBindingsPurposes(stage)){
+            std::optional<int> binding = AddUBOBindingPurpose(bindingPurpose.second);
+            if(!binding.has_value())
+                return false;
+            program.SetBlockBinding(bindingPurpose.first, binding.value());
+        }
+    }
+    return true;
+}
+
+void Renderer::Draw(const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform, const glm::ivec3 &lightsCounts){
     glm::mat4 mainCameraProjection = mainCamera.isPerspective ?
     glm::perspectiveLH(glm::radians(mainCamera.fieldOfView), mainCamera.aspectRatio,
     mainCamera.nearPlane, mainCamera.farPlane) :
@@ -1542,6 +3001,19 @@ void Renderer::Draw(const CameraComponent &mainCamera, const TransformComponent
         mainCameraView = rotate * translate;
     }
 
+    submittedTrianglesCount = 0;
+    drawnTrianglesCount = 0;
+    streamedBytesCount = 0;
+    glm::mat4 mainCameraViewProjection = mainCameraProjection * mainCameraView;
+    for(auto &renderGroup : renderGroups){
+        if(renderGroup.dynamicGeometry)
+            StreamDynamicGeometry(renderGroup);
+    }
+    // Cleared after all groups are streamed, as a mesh with several materials is in several groups
+    for(auto &renderGroup : renderGroups){
+        if(renderGroup.dynamicGeometry)
+            renderGroup.dynamicGeometry->mesh->ClearDirtyRanges();
+    }
     // Updating matrices
     for(auto &renderGroup : renderGroups){
         for(int i = 0; i < renderGroup.objectsCount; i++){
@@ -1551,76 +3023,737 @@ void Renderer::Draw(const CameraComponent &mainCamera, const TransformComponent
             glm::mat4 rot = glm::mat4_cast(transform.get().rotation);
             glm::mat4 trn = glm::translate(model, transform.get().position);
             model = trn*rot*scl;
+            // Normals are not quantized, so normal matrix comes from model without dequantization
+            renderGroup.normalMatrices[i] = glm::transpose(glm::inverse(model));
+            if(!renderGroup.positionDequantizations.empty())
+                model = model * renderGroup.positionDequantizations[i];
             renderGroup.mvps[i] = mainCameraProjection * mainCameraView * model;
             renderGroup.models[i] = model;
-            renderGroup.normalMatrices[i] = glm::transpose(glm::inverse(model));
         }
         BufferSubDataMVPs(renderGroup); // Update MVPs of objects
         BufferSubDataModels(renderGroup); // Update models of objects
         BufferSubDataNormalMatrices(renderGroup); // Update normal matrices of objects
+        if(!renderGroup.drawsLODs.empty())
+            SelectLODs(renderGroup, mainCamera, mainCameraTransform);
+        if(!renderGroup.drawsClusters.empty()){
+            CullClusters(renderGroup, mainCameraViewProjection, mainCameraTransform.position);
+        } else {
+            size_t trianglesCount = 0;
+            for(auto &&command : renderGroup.commands)
+                trianglesCount += static_cast<size_t>(command.count / 3) * command.instanceCount;
+            for(auto &&count : renderGroup.batchGroup.count)
+                trianglesCount += count / 3;
+            for(auto &&instanceGroup : renderGroup.instancesGroups)
+                trianglesCount += static_cast<size_t>(instanceGroup.count / 3) * instanceGroup.instanceCount;
+            submittedTrianglesCount += trianglesCount;
+            drawnTrianglesCount += trianglesCount;
+        }
     }
 
-    // Clear color buffer of default framebuffer
-    glClearNamedFramebufferfv(0, GL_COLOR, 0, colorClearValue.data());
-    // Clearing depth buffer from depth framebuffer
-    glClearNamedFramebufferfv(0, GL_DEPTH, 0, depthClearValue.data());
+    if(lightsBucketsFlag){
+        glm::ivec3 buckets = LightsBuckets(lightsCounts);
+        if(buckets != lightsBuckets){
+            lightsBuckets = buckets;
+            SelectLightsVariants();
+        }
+    }
+    if(renderPath == RenderPath::Deferred && !deferredShadingSetup)
+        SetupDeferredShading();
+    if(pendingShadersCount > 0)
+        PollRenderGroupsShaders();
+
+    // Forward programs read up to forward maxima of lights
+    glm::ivec3 forwardLightsCounts = glm::min(lightsCounts, glm::ivec3(Constants::ShaderStandard::maxPointLights,
+    Constants::ShaderStandard::maxDirectionalLights, Constants::ShaderStandard::maxSpotLights));
+    // Scratch vectors of binds, shared by passes of the frame
+    std::vector<std::pair<GLuint, GLuint>> uniformBindings;
+    std::vector<GLuint> texturesNames;
+    glm::ivec2 windowSize(mainWindow->GetWidth(), mainWindow->GetHeight());
+    // Minimized window has no backbuffer to draw, and targets of its size can't be created
+    if(windowSize.x <= 0 || windowSize.y <= 0)
+        return;
+    frameGraph.Reset();
+    FrameGraphResource backbuffer = frameGraph.ImportBackbuffer(windowSize.x, windowSize.y);
+    // Scene is drawn to backbuffer, or to targets of scaled size upscaled to it
+    glm::ivec2 renderSize = windowSize;
+    if(dynamicResolutionFlag){
+        UpdateResolutionScale();
+        renderSize = glm::max(glm::ivec2(glm::round(glm::vec2(windowSize) * resolutionScale)), glm::ivec2(1));
+    }
+    if(adaptivePrepassFlag && depthPassFlag)
+        UpdateDepthPrepassGroups(renderSize);
+    FrameGraphResource sceneColor = backbuffer;
+    if(renderPath == RenderPath::Deferred && IsDeferredReady()){
+        sceneColor = AddDeferredPasses(renderSize, mainCameraProjection, mainCameraView, mainCameraTransform.position, lightsCounts,
+        uniformBindings, texturesNames);
+    } else {
+        FrameGraphResource sceneDepth = backbuffer;
+        if(dynamicResolutionFlag){
+            sceneColor = frameGraph.CreateTexture("SceneColor", {renderSize.x, renderSize.y, GL_RGBA8});
+            sceneDepth = frameGraph.CreateTexture("SceneDepth", {renderSize.x, renderSize.y, GL_DEPTH_COMPONENT24});
+        }
+        AddForwardPasses(sceneColor, sceneDepth, mainCameraTransform.position, forwardLightsCounts, uniformBindings, texturesNames);
+    }
+    if(dynamicResolutionFlag)
+        AddUpscalePass(sceneColor, backbuffer);
+    else if(sceneColor != backbuffer)
+        AddPresentPass(sceneColor, backbuffer, renderSize);
+    // Passes added after this point, like overlays, draw at window resolution
+    frameGraph.Compile();
+    frameGraph.Execute();
+    if(prepassSampling){
+        prepassSampling = false;
+        prepassSamplePending = true;
+    }
+    // Names of freed pooled textures may be reused while tracker still has them bound
+    if(frameGraph.GetStats().releasedTextures > 0)
+        glState.Invalidate();
+}
 
+void Renderer::AddForwardPasses(FrameGraphResource colorTarget, FrameGraphResource depthTarget, const glm::vec3 &cameraPosition,
+const glm::ivec3 &lightsCounts, std::vector<std::pair<GLuint, GLuint>> &uniformBindings, std::vector<GLuint> &texturesNames){
     if(depthPassFlag){
-        glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
-        glDepthFunc(GL_LESS);
-        glDisable(GL_BLEND);
-        depthShader->Use();
-        // Depth prepass rendering
+        frameGraph.AddPass("DepthPrepass", [colorTarget, depthTarget](FrameGraphBuilder &builder){
+            builder.WriteAttachment(colorTarget, GL_COLOR_ATTACHMENT0, false);
+            builder.WriteAttachment(depthTarget, GL_DEPTH_ATTACHMENT, false);
+        }, [this, &uniformBindings, &texturesNames](const FrameGraphContext &context){
+            // Clear color buffer of target framebuffer
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_COLOR, 0, colorClearValue.data());
+            // Clearing depth buffer from depth framebuffer
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_DEPTH, 0, depthClearValue.data());
+            DrawDepthPrepass(uniformBindings, texturesNames);
+        });
+    }
+    frameGraph.AddPass("Color", [this, colorTarget, depthTarget](FrameGraphBuilder &builder){
+        builder.WriteAttachment(colorTarget, GL_COLOR_ATTACHMENT0, depthPassFlag);
+        builder.WriteAttachment(depthTarget, GL_DEPTH_ATTACHMENT, depthPassFlag);
+    }, [this, cameraPosition, lightsCounts, &uniformBindings, &texturesNames](const FrameGraphContext &context){
+        if(!depthPassFlag){
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_COLOR, 0, colorClearValue.data());
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_DEPTH, 0, depthClearValue.data());
+        }
+        glState.SetColorMask(true, true, true, true);
+        glState.SetDepthFunc(depthPassFlag ? GL_LEQUAL : GL_LESS);
+        // Opaque and masked fragments are never blended
+        glState.SetCapability(GL_BLEND, !alphaModesFlag);
+
         for(auto &&renderGroup : renderGroups){
+            if(!renderGroup.shaderReady || renderGroup.alphaMode == AlphaMode::Transparent)
+                continue;
+            // Use main shader
+            glState.UseProgram(renderGroup.shader->GetHandle());
             // VAO Binding
-            renderGroup.vao.Bind();
-
-            // Binding MVPs UBO
-            glBindBufferBase(GL_UNIFORM_BUFFER, renderGroup.mvpsUniformBuffer.bindingPoint, renderGroup.mvpsUniformBuffer.name);
+            BindRenderGroupVertices(renderGroup);
+
+            // Binding UBOs and textures
+            BindRenderGroupResources(renderGroup, uniformBindings, texturesNames);
+            ////
+            // Lighting
+            renderGroup.shader->Set(renderGroup.pointLightCountUniform, lightsCounts.x);
+            renderGroup.shader->Set(renderGroup.directionalLightCountUniform, lightsCounts.y);
+            renderGroup.shader->Set(renderGroup.spotLightCountUniform, lightsCounts.z);
+            ////
+            // Camera / View
+            renderGroup.shader->Set(renderGroup.viewPosUniform, cameraPosition);
+            ////
             // Render
+
+            BeginPrepassSample(renderGroup, 1);
             (this->*DrawFunction)(renderGroup);
+            EndPrepassSample(renderGroup, 1);
         }
+    });
+    if(alphaModesFlag){
+        frameGraph.AddPass("Transparent", [colorTarget, depthTarget](FrameGraphBuilder &builder){
+            builder.WriteAttachment(colorTarget, GL_COLOR_ATTACHMENT0, true);
+            builder.WriteAttachment(depthTarget, GL_DEPTH_ATTACHMENT, true);
+        }, [this, cameraPosition, lightsCounts](const FrameGraphContext &){
+            DrawTransparentObjects(cameraPosition, lightsCounts);
+        });
     }
+}
 
-    glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
-    glDepthFunc(depthPassFlag ? GL_LEQUAL : GL_LESS);
-    glEnable(GL_BLEND);
-
+void Renderer::DrawDepthPrepass(std::vector<std::pair<GLuint, GLuint>> &uniformBindings, std::vector<GLuint> &texturesNames){
+    glState.SetColorMask(false, false, false, false);
+    glState.SetDepthFunc(GL_LESS);
+    glState.SetCapability(GL_BLEND, false);
     for(auto &&renderGroup : renderGroups){
-        // Remember last shader program handle
-        // Use main shader
-        if(renderGroup.shader->GetHandle() != lastShaderProgram){
-            renderGroup.shader->Use();
-            lastShaderProgram = renderGroup.shader->GetHandle();
+        // Groups are drawn in both passes only when their program is ready
+        if(!renderGroup.shaderReady || renderGroup.alphaMode == AlphaMode::Transparent)
+            continue;
+        // Sampled frames draw every group in prepass, so their measures don't depend on last decisions
+        if(adaptivePrepassFlag && !renderGroup.inDepthPrepass && !prepassSampling)
+            continue;
+        if(renderGroup.alphaMode == AlphaMode::Masked){
+            // Masked groups need their alpha test, so they only reach color pass until it is ready
+            if(!renderGroup.maskedDepthShader)
+                continue;
+            glState.UseProgram(renderGroup.maskedDepthShader->GetHandle());
+            BindRenderGroupVertices(renderGroup);
+            BindRenderGroupResources(renderGroup, uniformBindings, texturesNames);
+            BeginPrepassSample(renderGroup, 0);
+            (this->*DrawFunction)(renderGroup);
+            EndPrepassSample(renderGroup, 0);
+            continue;
         }
+        const Ref<GL::ShaderGL> &groupDepthShader = renderGroup.vertexPulling ? pullingDepthShader : depthShader;
+        glState.UseProgram(groupDepthShader->GetHandle());
         // VAO Binding
-        renderGroup.vao.Bind();
-
-        // Binding UBOs
-        glBindBufferBase(GL_UNIFORM_BUFFER, renderGroup.mvpsUniformBuffer.bindingPoint, renderGroup.mvpsUniformBuffer.name);
-        glBindBufferBase(GL_UNIFORM_BUFFER, renderGroup.modelsUniformBuffer.bindingPoint, renderGroup.modelsUniformBuffer.name);
-        glBindBufferBase(GL_UNIFORM_BUFFER, renderGroup.normalMatricesUniformBuffer.bindingPoint, renderGroup.normalMatricesUniformBuffer.name);
-        if(renderGroup.materialUniformBuffer.name > 0)
-            glBindBufferBase(GL_UNIFORM_BUFFER, renderGroup.materialUniformBuffer.bindingPoint, renderGroup.materialUniformBuffer.name);
-        for(auto &&buffer : renderGroup.texLayersIndexBuffers){
-            glBindBufferBase(GL_UNIFORM_BUFFER, buffer.bindingPoint, buffer.name);
-        }
-        for(size_t i = 0; i < renderGroup.texturesArrays.size(); i++){
-            renderGroup.texturesArrays[i]->Bind(i);
-        }
-        ////
-        // Lighting
-        for(auto& [name, count] : lightsCounters){
-            renderGroup.shader->SetInt(name, count);
-        }
-        ////
-        // Camera / View
-        renderGroup.shader->SetVec3(Constants::ShaderStandard::viewPosName, mainCameraTransform.position);
-        ////
-        // Render
+        BindRenderGroupVertices(renderGroup);
 
+        // Binding MVPs UBO
+        glState.BindBufferBase(GL_UNIFORM_BUFFER, renderGroup.mvpsUniformBuffer.bindingPoint, renderGroup.mvpsUniformBuffer.name);
+        // Render
+        BeginPrepassSample(renderGroup, 0);
         (this->*DrawFunction)(renderGroup);
+        EndPrepassSample(renderGroup, 0);
+    }
+}
+
+void Renderer::BeginPrepassSample(RenderGroup &renderGroup, int phase){
+    if(!prepassSampling)
+        return;
+    if(renderGroup.prepassQueries.names[0] == 0)
+        glGenQueries(renderGroup.prepassQueries.names.size(), renderGroup.prepassQueries.names.data());
+    // Timestamps, as time elapsed queries of frame graph passes may be active
+    glBeginQuery(GL_SAMPLES_PASSED, renderGroup.prepassQueries.names[3 * phase]);
+    glQueryCounter(renderGroup.prepassQueries.names[3 * phase + 1], GL_TIMESTAMP);
+}
+
+void Renderer::EndPrepassSample(RenderGroup &renderGroup, int phase){
+    if(!prepassSampling)
+        return;
+    glQueryCounter(renderGroup.prepassQueries.names[3 * phase + 2], GL_TIMESTAMP);
+    glEndQuery(GL_SAMPLES_PASSED);
+    renderGroup.prepassSampled[phase] = true;
+}
+
+Renderer::PrepassQueries::PrepassQueries(PrepassQueries &&other): names(other.names){
+    other.names.fill(0);
+}
+
+Renderer::PrepassQueries &Renderer::PrepassQueries::operator=(PrepassQueries &&other){
+    if(this != &other){
+        if(names[0] != 0)
+            glDeleteQueries(names.size(), names.data());
+        names = other.names;
+        other.names.fill(0);
+    }
+    return *this;
+}
+
+Renderer::PrepassQueries::~PrepassQueries(){
+    // Queries are generated together on first sample of group
+    if(names[0] != 0)
+        glDeleteQueries(names.size(), names.data());
+}
+
+void Renderer::UpdateDepthPrepassGroups(const glm::ivec2 &size){
+    if(prepassSamplePending){
+        if(EvaluatePrepassSamples())
+            prepassSamplePending = false;
+        return;
+    }
+    if(--framesToPrepassSample > 0)
+        return;
+    framesToPrepassSample = depthPrepassOptions.sampleInterval;
+    prepassSampling = true;
+    prepassSamplePixels = static_cast<size_t>(size.x) * size.y;
+    for(auto &&renderGroup : renderGroups)
+        renderGroup.prepassSampled = {false, false};
+}
+
+bool Renderer::EvaluatePrepassSamples(){
+    for(auto &&renderGroup : renderGroups){
+        for(int phase = 0; phase < 2; phase++){
+            if(!renderGroup.prepassSampled[phase])
+                continue;
+            // End timestamp is the last query of phase, so the others are available with it
+            GLint available = 0;
+            glGetQueryObjectiv(renderGroup.prepassQueries.names[3 * phase + 2], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available)
+                return false;
+        }
+    }
+    size_t sampledCount = 0;
+    size_t prepassCount = 0;
+    for(auto &&renderGroup : renderGroups){
+        // Groups not drawn in both passes of sampled frame keep their decision
+        if(!renderGroup.prepassSampled[0] || !renderGroup.prepassSampled[1])
+            continue;
+        std::array<GLuint64, 6> results;
+        for(size_t i = 0; i < results.size(); i++)
+            glGetQueryObjectui64v(renderGroup.prepassQueries.names[i], GL_QUERY_RESULT, &results[i]);
+        // Prepass samples are depth writes of group as occluder. Color samples are its visible fragments, as every
+        // group was in prepass
+        renderGroup.prepassCoverage = static_cast<float>(static_cast<double>(results[0]) / glm::max(prepassSamplePixels, size_t(1)));
+        renderGroup.fragmentNanoseconds = results[3] > 0 && results[5] > results[4] ?
+        static_cast<float>(static_cast<double>(results[5] - results[4]) / results[3]) : 0.0f;
+        renderGroup.inDepthPrepass = renderGroup.prepassCoverage >= depthPrepassOptions.minOccluderCoverage ||
+        renderGroup.fragmentNanoseconds >= depthPrepassOptions.minFragmentNanoseconds;
+        sampledCount++;
+        if(renderGroup.inDepthPrepass)
+            prepassCount++;
+    }
+    if(prepassCount != prepassGroupsCount)
+        fmt::print("Adaptive depth prepass: {0} of {1} sampled groups in prepass\n", prepassCount, sampledCount);
+    prepassGroupsCount = prepassCount;
+    return true;
+}
+
+void Renderer::PrintDepthPrepassStats() const{
+    const char *alphaModesNames[3] = {"opaque", "masked", "transparent"};
+    fmt::print("Depth prepass groups:\n");
+    for(size_t i = 0; i < renderGroups.size(); i++){
+        const RenderGroup &renderGroup = renderGroups[i];
+        if(renderGroup.alphaMode == AlphaMode::Transparent)
+            continue;
+        const char *reason = "not sampled";
+        if(renderGroup.prepassSampled[0] && renderGroup.prepassSampled[1]){
+            if(renderGroup.prepassCoverage >= depthPrepassOptions.minOccluderCoverage)
+                reason = "occluder";
+            else if(renderGroup.fragmentNanoseconds >= depthPrepassOptions.minFragmentNanoseconds)
+                reason = "expensive fragments";
+            else
+                reason = "cheap";
+        }
+        fmt::print("  Group {0} ({1} objects, {2}): {3} ({4}) - coverage: {5:.2f}%, fragment: {6:.3f} ns\n", i, renderGroup.objectsCount,
+        alphaModesNames[static_cast<int>(renderGroup.alphaMode)], renderGroup.inDepthPrepass ? "prepass" : "single pass", reason,
+        100.0f * renderGroup.prepassCoverage, renderGroup.fragmentNanoseconds);
+    }
+}
+
+void Renderer::BindRenderGroupResources(RenderGroup &renderGroup, std::vector<std::pair<GLuint, GLuint>> &uniformBindings,
+std::vector<GLuint> &texturesNames){
+    uniformBindings.clear();
+    uniformBindings.emplace_back(renderGroup.mvpsUniformBuffer.bindingPoint, renderGroup.mvpsUniformBuffer.name);
+    uniformBindings.emplace_back(renderGroup.modelsUniformBuffer.bindingPoint, renderGroup.modelsUniformBuffer.name);
+    uniformBindings.emplace_back(renderGroup.normalMatricesUniformBuffer.bindingPoint, renderGroup.normalMatricesUniformBuffer.name);
+    if(renderGroup.materialUniformBuffer.name > 0)
+        uniformBindings.emplace_back(renderGroup.materialUniformBuffer.bindingPoint, renderGroup.materialUniformBuffer.name);
+    for(auto &&buffer : renderGroup.texLayersIndexBuffers){
+        uniformBindings.emplace_back(buffer.bindingPoint, buffer.name);
     }
+    glState.BindBuffersBase(GL_UNIFORM_BUFFER, uniformBindings);
+    texturesNames.clear();
+    for(auto &&textureArray : renderGroup.texturesArrays){
+        texturesNames.push_back(textureArray->GetHandle());
+    }
+    glState.BindTextures(0, texturesNames.size(), texturesNames.data());
+}
+
+void Renderer::DrawTransparentObjects(const glm::vec3 &cameraPosition, const glm::ivec3 &lightsCounts){
+    transparentDraws.clear();
+    for(size_t groupIndex = 0; groupIndex < renderGroups.size(); groupIndex++){
+        RenderGroup &renderGroup = renderGroups[groupIndex];
+        if(!renderGroup.shaderReady || renderGroup.alphaMode != AlphaMode::Transparent)
+            continue;
+        // Each instance is a separate draw, as instances may be far apart
+        auto pushDraws = [&](GLsizei count, GLuint firstIndex, GLint baseVertex, GLuint baseInstance, GLuint instanceCount){
+            for(GLuint object = baseInstance; object < baseInstance + instanceCount; object++){
+                glm::vec3 offset = renderGroup.transforms[object].get().position - cameraPosition;
+                transparentDraws.push_back({glm::dot(offset, offset), groupIndex, count, firstIndex, baseVertex, object});
+            }
+        };
+        if(isIndirect){
+            // Full commands, as meshlets are culled for batched draws only
+            for(auto &&command : renderGroup.commands)
+                pushDraws(command.count, command.firstIndex, command.baseVertex, command.baseInstance, command.instanceCount);
+        } else {
+            // Batched objects are addressed by draw ID, which is their order in batch
+            for(GLsizei i = 0; i < renderGroup.batchGroup.drawcount; i++)
+                pushDraws(renderGroup.batchGroup.count[i],
+                static_cast<GLuint>(reinterpret_cast<intptr_t>(renderGroup.batchGroup.indices[i]) / renderGroup.indicesTypeSize),
+                renderGroup.batchGroup.baseVertex[i], i, 1);
+            for(auto &&instanceGroup : renderGroup.instancesGroups)
+                pushDraws(instanceGroup.count, instanceGroup.firstIndex, instanceGroup.baseVertex, instanceGroup.baseInstance,
+                instanceGroup.instanceCount);
+        }
+    }
+    if(transparentDraws.empty())
+        return;
+    std::sort(transparentDraws.begin(), transparentDraws.end(), [](const TransparentDraw &a, const TransparentDraw &b){
+        return a.distance > b.distance;
+    });
+    // Transparent fragments are tested against opaque depth without hiding each other
+    glState.SetCapability(GL_BLEND, true);
+    glState.SetDepthMask(false);
+    std::vector<std::pair<GLuint, GLuint>> uniformBindings;
+    std::vector<GLuint> texturesNames;
+    size_t boundGroup = renderGroups.size();
+    for(auto &&draw : transparentDraws){
+        RenderGroup &renderGroup = renderGroups[draw.group];
+        if(draw.group != boundGroup){
+            glState.UseProgram(renderGroup.shader->GetHandle());
+            BindRenderGroupVertices(renderGroup);
+            BindRenderGroupResources(renderGroup, uniformBindings, texturesNames);
+            renderGroup.shader->Set(renderGroup.pointLightCountUniform, lightsCounts.x);
+            renderGroup.shader->Set(renderGroup.directionalLightCountUniform, lightsCounts.y);
+            renderGroup.shader->Set(renderGroup.spotLightCountUniform, lightsCounts.z);
+            renderGroup.shader->Set(renderGroup.viewPosUniform, cameraPosition);
+            boundGroup = draw.group;
+        }
+        glDrawElementsInstancedBaseVertexBaseInstance(renderGroup.mode, draw.count, renderGroup.indicesType,
+        reinterpret_cast<GLvoid *>(static_cast<intptr_t>(draw.firstIndex) * renderGroup.indicesTypeSize), 1, draw.baseVertex, draw.object);
+    }
+    glState.SetDepthMask(true);
+}
+
+bool Renderer::IsDeferredSupported() const{
+    // Compute resolve needs compute shaders, storage buffers and image stores
+    return version >= GLApiVersion::V430;
+}
+
+void Renderer::SetupDeferredShading(){
+    deferredShadingSetup = true;
+    SetupDeferredResolveShader();
+    // Storage buffers of each light type, binding points of the resolve program only
+    std::pair<Buffer*, int> storageBuffers[3] = {{&pointLightStorageBuffer, static_cast<int>(sizeof(PointLight))},
+    {&directionalLightStorageBuffer, static_cast<int>(sizeof(DirectionalLight))}, {&spotLightStorageBuffer, static_cast<int>(sizeof(SpotLight))}};
+    for(int i = 0; i < 3; i++){
+        Buffer &buffer = *storageBuffers[i].first;
+        glCreateBuffers(1, &buffer.name);
+        buffer.stride = storageBuffers[i].second;
+        buffer.bufferSize = buffer.stride * Constants::ShaderStandard::maxDeferredLights;
+        buffer.bindingPoint = i;
+        glNamedBufferStorage(buffer.name, buffer.bufferSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+    size_t requestedCount = 0;
+    for(auto &&renderGroup : renderGroups){
+        if(renderGroup.alphaMode == AlphaMode::Transparent)
+            continue;
+        size_t programsCount = variantsPrograms.size();
+        renderGroup.pendingGBufferShader = RequestVariantProgram(GBufferKey(renderGroup.variantKey), glm::ivec3(-1));
+        if(!renderGroup.pendingGBufferShader){
+            std::cout << "G-buffer program not built - Deferred shading is not used\n";
+            continue;
+        }
+        requestedCount += variantsPrograms.size() - programsCount;
+        pendingShadersCount++;
+    }
+    fmt::print("Deferred shading: {0} G-buffer programs submitted\n", requestedCount);
+}
+
+void Renderer::SetupDeferredResolveShader(){
+    // One invocation per pixel, one work group per 16x16 tile. Tile depth bounds give a view space box, and point
+    // and spot lights whose range reaches it are listed in shared memory. Each pixel then applies directional
+    // lights and listed lights with the lighting functions of forward programs
+    const std::string maxTileLights = std::to_string(Constants::ShaderStandard::maxTileLights);
+    const std::string viewPosName = Constants::ShaderStandard::viewPosName;
+    const std::string source =
+    "#version 430 core\n"
+    "layout(local_size_x = 16, local_size_y = 16) in;\n"
+    "struct PointLight{ vec4 position; vec4 color; float intensity; float colorTemperature; float range; float cutoff; };\n"
+    "struct DirectionalLight{ vec4 direction; vec4 color; };\n"
+    "struct SpotLight{ vec4 position; vec4 direction; vec4 color; float range; float innerCutoff; float outerCutoff; float cutoff; };\n"
+    "layout(std430, binding = 0) readonly buffer PointLights{ PointLight pointLights[]; };\n"
+    "layout(std430, binding = 1) readonly buffer DirectionalLights{ DirectionalLight directionalLights[]; };\n"
+    "layout(std430, binding = 2) readonly buffer SpotLights{ SpotLight spotLights[]; };\n"
+    "layout(binding = 0) uniform sampler2D gAlbedo;\n"
+    "layout(binding = 1) uniform sampler2D gNormal;\n"
+    "layout(binding = 2) uniform sampler2D gSpecular;\n"
+    "layout(binding = 3) uniform sampler2D gDepth;\n"
+    "layout(rgba8, binding = 0) writeonly uniform image2D resolvedColor;\n"
+    "uniform mat4 inverseProjection;\n"
+    "uniform mat4 inverseViewProjection;\n"
+    "uniform mat4 view;\n"
+    "uniform vec3 "+viewPosName+";\n"
+    "uniform vec4 clearColor;\n"
+    "uniform int pointLightsCount;\n"
+    "uniform int directionalLightsCount;\n"
+    "uniform int spotLightsCount;\n"
+    "shared uint tileMinDepth;\n"
+    "shared uint tileMaxDepth;\n"
+    "shared uint tileLightsCount;\n"
+    "shared uint tileLights["+maxTileLights+"];\n"
+    "vec4 albedo;\n"
+    "vec3 normal;\n"
+    "vec3 specularColor;\n"
+    "vec3 fragPos;\n" +
+    ShaderStandard::LightingFunctionsCode() +
+    "bool SphereInBox(vec3 center, float radius, vec3 boxMin, vec3 boxMax){\n"
+    "    vec3 offset = center - clamp(center, boxMin, boxMax);\n"
+    "    return dot(offset, offset) <= radius * radius;\n"
+    "}\n"
+    "void main(){\n"
+    "    ivec2 size = textureSize(gDepth, 0);\n"
+    "    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    bool inside = all(lessThan(pixel, size));\n"
+    "    float depth = inside ? texelFetch(gDepth, pixel, 0).r : 1.0;\n"
+    "    if(gl_LocalInvocationIndex == 0u){\n"
+    "        tileMinDepth = 0xFFFFFFFFu;\n"
+    "        tileMaxDepth = 0u;\n"
+    "        tileLightsCount = 0u;\n"
+    "    }\n"
+    "    barrier();\n"
+    // Depths are positive, so their bits order as the floats
+    "    if(depth < 1.0){\n"
+    "        atomicMin(tileMinDepth, floatBitsToUint(depth));\n"
+    "        atomicMax(tileMaxDepth, floatBitsToUint(depth));\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if(tileMinDepth <= tileMaxDepth){\n"
+    "        vec2 ndcMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) / vec2(size) * 2.0 - 1.0;\n"
+    "        vec2 ndcMax = vec2((gl_WorkGroupID.xy + 1u) * gl_WorkGroupSize.xy) / vec2(size) * 2.0 - 1.0;\n"
+    "        vec2 ndcDepth = vec2(uintBitsToFloat(tileMinDepth), uintBitsToFloat(tileMaxDepth)) * 2.0 - 1.0;\n"
+    "        vec3 boxMin = vec3(3.4e38);\n"
+    "        vec3 boxMax = vec3(-3.4e38);\n"
+    "        for(int i = 0; i < 8; i++){\n"
+    "            vec4 corner = inverseProjection * vec4((i & 1) == 0 ? ndcMin.x : ndcMax.x, (i & 2) == 0 ? ndcMin.y : ndcMax.y,\n"
+    "            (i & 4) == 0 ? ndcDepth.x : ndcDepth.y, 1.0);\n"
+    "            boxMin = min(boxMin, corner.xyz / corner.w);\n"
+    "            boxMax = max(boxMax, corner.xyz / corner.w);\n"
+    "        }\n"
+    "        uint lightsCount = uint(pointLightsCount + spotLightsCount);\n"
+    "        for(uint i = gl_LocalInvocationIndex; i < lightsCount; i += gl_WorkGroupSize.x * gl_WorkGroupSize.y){\n"
+    "            bool isPoint = i < uint(pointLightsCount);\n"
+    "            vec4 position = isPoint ? pointLights[i].position : spotLights[i - uint(pointLightsCount)].position;\n"
+    "            float range = isPoint ? pointLights[i].range : spotLights[i - uint(pointLightsCount)].range;\n"
+    "            if(SphereInBox((view * vec4(position.xyz, 1.0)).xyz, range, boxMin, boxMax)){\n"
+    "                uint slot = atomicAdd(tileLightsCount, 1u);\n"
+    "                if(slot < "+maxTileLights+"u)\n"
+    "                    tileLights[slot] = i;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    barrier();\n"
+    "    if(!inside)\n"
+    "        return;\n"
+    "    if(depth == 1.0){\n"
+    "        imageStore(resolvedColor, pixel, clearColor);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec4 albedoSample = texelFetch(gAlbedo, pixel, 0);\n"
+    // Unlit pixels store their final color
+    "    if(albedoSample.a == 0.0){\n"
+    "        imageStore(resolvedColor, pixel, vec4(albedoSample.rgb, 1.0));\n"
+    "        return;\n"
+    "    }\n"
+    "    albedo = vec4(pow(albedoSample.rgb, vec3(2.2)), 1.0);\n"
+    "    normal = normalize(texelFetch(gNormal, pixel, 0).xyz * 2.0 - 1.0);\n"
+    "    specularColor = texelFetch(gSpecular, pixel, 0).rgb;\n"
+    "    vec4 worldPos = inverseViewProjection * vec4((vec2(pixel) + 0.5) / vec2(size) * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+    "    fragPos = worldPos.xyz / worldPos.w;\n"
+    "    vec3 finalColor = vec3(0.005) * albedo.rgb;\n"
+    "    for(int i = 0; i < directionalLightsCount; i++)\n"
+    "        finalColor += CalcDirectionalLight(directionalLights[i]);\n"
+    "    uint tileCount = min(tileLightsCount, "+maxTileLights+"u);\n"
+    "    for(uint i = 0u; i < tileCount; i++){\n"
+    "        uint light = tileLights[i];\n"
+    "        finalColor += light < uint(pointLightsCount) ? CalcPointLight(pointLights[light]) :\n"
+    "        CalcSpotLight(spotLights[light - uint(pointLightsCount)]);\n"
+    "    }\n"
+    "    imageStore(resolvedColor, pixel, vec4(pow(finalColor, vec3(1.0/2.2)), 1.0));\n"
+    "}\n";
+    deferredResolveShader = ShaderCode::CompileSources({{GL_COMPUTE_SHADER, source}});
+    static constexpr GL::UniformName inverseProjectionName("inverseProjection");
+    static constexpr GL::UniformName inverseViewProjectionName("inverseViewProjection");
+    static constexpr GL::UniformName viewName("view");
+    static constexpr GL::UniformName clearColorName("clearColor");
+    static constexpr GL::UniformName pointLightsCountName("pointLightsCount");
+    static constexpr GL::UniformName directionalLightsCountName("directionalLightsCount");
+    static constexpr GL::UniformName spotLightsCountName("spotLightsCount");
+    resolveInverseProjectionUniform = deferredResolveShader->GetUniformHandle<glm::mat4>(inverseProjectionName);
+    resolveInverseViewProjectionUniform = deferredResolveShader->GetUniformHandle<glm::mat4>(inverseViewProjectionName);
+    resolveViewUniform = deferredResolveShader->GetUniformHandle<glm::mat4>(viewName);
+    resolveViewPosUniform = deferredResolveShader->GetUniformHandle<glm::vec3>(Constants::ShaderStandard::viewPosName);
+    resolveClearColorUniform = deferredResolveShader->GetUniformHandle<glm::vec4>(clearColorName);
+    resolvePointLightsCountUniform = deferredResolveShader->GetUniformHandle<int>(pointLightsCountName);
+    resolveDirectionalLightsCountUniform = deferredResolveShader->GetUniformHandle<int>(directionalLightsCountName);
+    resolveSpotLightsCountUniform = deferredResolveShader->GetUniformHandle<int>(spotLightsCountName);
+}
+
+bool Renderer::IsDeferredReady() const{
+    if(!deferredShadingSetup || !deferredResolveShader || !deferredResolveShader->IsLinked())
+        return false;
+    for(auto &&renderGroup : renderGroups){
+        if(renderGroup.alphaMode == AlphaMode::Transparent)
+            continue;
+        if(!renderGroup.shaderReady || !renderGroup.gBufferShader)
+            return false;
+    }
+    return true;
+}
+
+FrameGraphResource Renderer::AddDeferredPasses(const glm::ivec2 &size, const glm::mat4 &projection, const glm::mat4 &view,
+const glm::vec3 &cameraPosition, const glm::ivec3 &lightsCounts, std::vector<std::pair<GLuint, GLuint>> &uniformBindings,
+std::vector<GLuint> &texturesNames){
+    int width = size.x;
+    int height = size.y;
+    // Albedo is stored gamma encoded, so 8 bits keep the precision of textures. Its alpha tells lit pixels
+    FrameGraphResource albedo = frameGraph.CreateTexture("GBufferAlbedo", {width, height, GL_RGBA8});
+    FrameGraphResource normal = frameGraph.CreateTexture("GBufferNormal", {width, height, GL_RGB10_A2});
+    FrameGraphResource specular = frameGraph.CreateTexture("GBufferSpecular", {width, height, GL_RGBA8});
+    FrameGraphResource depth = frameGraph.CreateTexture("GBufferDepth", {width, height, GL_DEPTH_COMPONENT24});
+    FrameGraphResource resolved = frameGraph.CreateTexture("ResolvedColor", {width, height, GL_RGBA8});
+    FrameGraphResource lights[3] = {frameGraph.ImportBuffer("PointLights", pointLightStorageBuffer.name),
+    frameGraph.ImportBuffer("DirectionalLights", directionalLightStorageBuffer.name),
+    frameGraph.ImportBuffer("SpotLights", spotLightStorageBuffer.name)};
+
+    if(depthPassFlag){
+        frameGraph.AddPass("DepthPrepass", [depth](FrameGraphBuilder &builder){
+            builder.WriteAttachment(depth, GL_DEPTH_ATTACHMENT, false);
+        }, [this, &uniformBindings, &texturesNames](const FrameGraphContext &context){
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_DEPTH, 0, depthClearValue.data());
+            DrawDepthPrepass(uniformBindings, texturesNames);
+        });
+    }
+    frameGraph.AddPass("GBuffer", [this, albedo, normal, specular, depth](FrameGraphBuilder &builder){
+        builder.WriteAttachment(albedo, GL_COLOR_ATTACHMENT0, false);
+        builder.WriteAttachment(normal, GL_COLOR_ATTACHMENT1, false);
+        builder.WriteAttachment(specular, GL_COLOR_ATTACHMENT2, false);
+        builder.WriteAttachment(depth, GL_DEPTH_ATTACHMENT, depthPassFlag);
+    }, [this, &uniformBindings, &texturesNames](const FrameGraphContext &context){
+        const std::array<float, 4> gBufferClearValue = {0.0f, 0.0f, 0.0f, 0.0f};
+        glState.SetColorMask(true, true, true, true);
+        for(GLint drawBuffer = 0; drawBuffer < 3; drawBuffer++)
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_COLOR, drawBuffer, gBufferClearValue.data());
+        if(!depthPassFlag)
+            glClearNamedFramebufferfv(context.GetFramebuffer(), GL_DEPTH, 0, depthClearValue.data());
+        glState.SetDepthFunc(depthPassFlag ? GL_LEQUAL : GL_LESS);
+        glState.SetCapability(GL_BLEND, false);
+        for(auto &&renderGroup : renderGroups){
+            if(renderGroup.alphaMode == AlphaMode::Transparent)
+                continue;
+            glState.UseProgram(renderGroup.gBufferShader->GetHandle());
+            BindRenderGroupVertices(renderGroup);
+            BindRenderGroupResources(renderGroup, uniformBindings, texturesNames);
+            BeginPrepassSample(renderGroup, 1);
+            (this->*DrawFunction)(renderGroup);
+            EndPrepassSample(renderGroup, 1);
+        }
+    });
+    frameGraph.AddPass("DeferredResolve", [albedo, normal, specular, depth, resolved, lights](FrameGraphBuilder &builder){
+        for(FrameGraphResource gBufferTexture : {albedo, normal, specular, depth})
+            builder.Read(gBufferTexture, FrameGraphUsage::Sampled);
+        for(FrameGraphResource lightsBuffer : lights)
+            builder.Read(lightsBuffer, FrameGraphUsage::Storage);
+        builder.Write(resolved, FrameGraphUsage::Image);
+    }, [this, projection, view, cameraPosition, lightsCounts, width, height, albedo, normal, specular, depth, resolved,
+    lights](const FrameGraphContext &context){
+        glState.UseProgram(deferredResolveShader->GetHandle());
+        deferredResolveShader->Set(resolveInverseProjectionUniform, glm::inverse(projection));
+        deferredResolveShader->Set(resolveInverseViewProjectionUniform, glm::inverse(projection * view));
+        deferredResolveShader->Set(resolveViewUniform, view);
+        deferredResolveShader->Set(resolveViewPosUniform, cameraPosition);
+        deferredResolveShader->Set(resolveClearColorUniform, glm::vec4(colorClearValue[0], colorClearValue[1], colorClearValue[2],
+        colorClearValue[3]));
+        deferredResolveShader->Set(resolvePointLightsCountUniform, lightsCounts.x);
+        deferredResolveShader->Set(resolveDirectionalLightsCountUniform, lightsCounts.y);
+        deferredResolveShader->Set(resolveSpotLightsCountUniform, lightsCounts.z);
+        const GLuint gBufferTextures[4] = {context.GetTexture(albedo).GetHandle(), context.GetTexture(normal).GetHandle(),
+        context.GetTexture(specular).GetHandle(), context.GetTexture(depth).GetHandle()};
+        glState.BindTextures(0, 4, gBufferTextures);
+        for(GLuint i = 0; i < 3; i++)
+            glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, i, context.GetBuffer(lights[i]));
+        glBindImageTexture(0, context.GetTexture(resolved).GetHandle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    });
+    if(alphaModesFlag){
+        // Transparent objects are shaded forward over resolved color, tested against G-buffer depth
+        glm::ivec3 forwardLightsCounts = glm::min(lightsCounts, glm::ivec3(Constants::ShaderStandard::maxPointLights,
+        Constants::ShaderStandard::maxDirectionalLights, Constants::ShaderStandard::maxSpotLights));
+        frameGraph.AddPass("Transparent", [resolved, depth](FrameGraphBuilder &builder){
+            builder.WriteAttachment(resolved, GL_COLOR_ATTACHMENT0, true);
+            builder.WriteAttachment(depth, GL_DEPTH_ATTACHMENT, true);
+        }, [this, cameraPosition, forwardLightsCounts](const FrameGraphContext &){
+            DrawTransparentObjects(cameraPosition, forwardLightsCounts);
+        });
+    }
+    return resolved;
+}
+
+void Renderer::AddPresentPass(FrameGraphResource source, FrameGraphResource backbuffer, const glm::ivec2 &size){
+    frameGraph.AddPass("Present", [source, backbuffer](FrameGraphBuilder &builder){
+        builder.Read(source, FrameGraphUsage::BlitSource);
+        builder.WriteAttachment(backbuffer, GL_COLOR_ATTACHMENT0, false);
+    }, [size](const FrameGraphContext &context){
+        glBlitNamedFramebuffer(context.GetReadFramebuffer(), 0, 0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    });
+}
+
+void Renderer::AddUpscalePass(FrameGraphResource source, FrameGraphResource backbuffer){
+    frameGraph.AddPass("Upscale", [source, backbuffer](FrameGraphBuilder &builder){
+        builder.Read(source, FrameGraphUsage::Sampled);
+        builder.WriteAttachment(backbuffer, GL_COLOR_ATTACHMENT0, false);
+    }, [this, source](const FrameGraphContext &context){
+        glState.UseProgram(upscaleShader->GetHandle());
+        upscaleShader->Set(upscaleSharpnessUniform, dynamicResolutionOptions.sharpness);
+        GLuint sourceTexture = context.GetTexture(source).GetHandle();
+        glState.BindTextures(0, 1, &sourceTexture);
+        glState.BindSampler(0, upscaleSampler);
+        glState.SetColorMask(true, true, true, true);
+        glState.SetCapability(GL_DEPTH_TEST, false);
+        glState.SetCapability(GL_CULL_FACE, false);
+        glState.SetCapability(GL_BLEND, false);
+        // Triangle covering the screen, with positions from vertex IDs
+        glState.BindVertexArray(upscaleVertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glState.BindSampler(0, 0);
+        glState.SetCapability(GL_DEPTH_TEST, true);
+        glState.SetCapability(GL_CULL_FACE, true);
+    });
+}
+
+void Renderer::SetupUpscaleShader(){
+    ShaderCode upscaleCode;
+    upscaleCode.SetVersion(RenderCapabilities::GetGLSLVersion());
+    upscaleCode.SetStageToPipeline(ShaderStage::Vertex, true);
+    upscaleCode.SetStageToPipeline(ShaderStage::Fragment, true);
+    upscaleCode.AddOutput(ShaderStage::Vertex, "uv", ShaderDataType::Float2);
+    upscaleCode.AddOutput(ShaderStage::Fragment, "FragColor", ShaderDataType::Float4);
+    upscaleCode.AddUniform(ShaderStage::Fragment, "sceneColor", ShaderDataType::Sampler2D);
+    upscaleCode.AddUniform(ShaderStage::Fragment, "sharpness", ShaderDataType::Float);
+    upscaleCode.SetMain(ShaderStage::Vertex,
+    "uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n");
+    // Bilinear sample, sharpened by its difference with neighbors one source texel away
+    upscaleCode.SetMain(ShaderStage::Fragment,
+    "vec3 color = texture(sceneColor, uv).rgb;\n"
+    "if(sharpness > 0.0){\n"
+    "    vec2 texel = 1.0 / vec2(textureSize(sceneColor, 0));\n"
+    "    vec3 neighbors = texture(sceneColor, uv + vec2(texel.x, 0.0)).rgb + texture(sceneColor, uv - vec2(texel.x, 0.0)).rgb +\n"
+    "    texture(sceneColor, uv + vec2(0.0, texel.y)).rgb + texture(sceneColor, uv - vec2(0.0, texel.y)).rgb;\n"
+    "    color = clamp(color + sharpness * (color - 0.25 * neighbors), 0.0, 1.0);\n"
+    "}\n"
+    "FragColor = vec4(color, 1.0);\n");
+    upscaleShader = upscaleCode.Generate();
+    upscaleShader->SetInt("sceneColor", 0);
+    static constexpr GL::UniformName sharpnessName("sharpness");
+    upscaleSharpnessUniform = upscaleShader->GetUniformHandle<float>(sharpnessName);
+    glCreateVertexArrays(1, &upscaleVertexArray);
+    glCreateSamplers(1, &upscaleSampler);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(upscaleSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void Renderer::UpdateResolutionScale(){
+    double gpuMilliseconds = frameGraph.GetGPUMilliseconds();
+    if(gpuMilliseconds < 0.0)
+        return;
+    // Smoothed, as frames vary with scene and timer results come some frames late
+    smoothedGPUMilliseconds = smoothedGPUMilliseconds < 0.0 ? gpuMilliseconds :
+    glm::mix(smoothedGPUMilliseconds, gpuMilliseconds, 0.1);
+    // Times of a new scale are only read some frames after it is set
+    if(++framesSinceScaleChange < scaleChangeFrames)
+        return;
+    double target = dynamicResolutionOptions.targetMilliseconds;
+    if(glm::abs(smoothedGPUMilliseconds - target) < 0.05 * target)
+        return;
+    // GPU time grows about with pixels, so with square of scale. Scale moves by steps, so pooled targets are not
+    // reallocated for small changes, and by at most a few steps a change
+    float wantedScale = resolutionScale * static_cast<float>(glm::sqrt(target / smoothedGPUMilliseconds));
+    wantedScale = glm::clamp(wantedScale, resolutionScale - 4.0f * scaleStep, resolutionScale + 4.0f * scaleStep);
+    float scale = glm::clamp(glm::round(wantedScale / scaleStep) * scaleStep, dynamicResolutionOptions.minScale,
+    dynamicResolutionOptions.maxScale);
+    if(scale == resolutionScale)
+        return;
+    // Smoothed time is carried to new scale, so next change doesn't wait for old times to fade
+    smoothedGPUMilliseconds *= (scale * scale) / (resolutionScale * resolutionScale);
+    resolutionScale = scale;
+    framesSinceScaleChange = 0;
 }
 
 Renderer::Renderer(){
@@ -1629,13 +3762,27 @@ Renderer::Renderer(){
     for(GLuint i = 0; i < maxBindingPoints; i++){
         availableBindingPoints.emplace(i, true);
     }
+    glState.SetMultiBindState(version >= GLApiVersion::V440);
+    if(RenderCapabilities::HasParallelShaderCompile()){
+        GL::ShaderGL::SetParallelCompile(true);
+        // Driver chooses compiler threads count
+        if(GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        else
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
     // Enabling some opengl fragment tests
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.SetCapability(GL_DEPTH_TEST, true);
+    glState.SetCapability(GL_CULL_FACE, true);
+    glState.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     SetDrawFunction();
-    SetupDepthShader();
+    SetupDepthShader(false);
+}
+
+Renderer::~Renderer(){
+    for(auto &&meshRenderer : plannedMeshRenderers)
+        meshRenderer.mesh.Release();
 }
 
 int Renderer::GetDrawGroupsCount(){
@@ -6,6 +6,12 @@
 #include "System.hpp"
 #include "Window.hpp"
 #include "GLObjects.hpp"
+#include "GLState.hpp"
+#include "FrameGraph.hpp"
+#include <chrono>
+#include <deque>
+
+class ShaderStandard;
 
 struct Member {
     std::string name;
@@ -45,9 +51,73 @@ public:
 
     const std::vector<char> &GetData() const;
 };
+// How meshes that only differ by index type are unified in one render group
+enum class IndexUnification{
+    Disabled,
+    Promote, // 16 bits indices are converted to 32 bits
+    Split, // Meshes with 32 bits indices are split in parts with 16 bits indices. Falls back to promotion
+    // for meshes with levels of detail or meshlets
+    Automatic // Option with lower memory cost, with extra draw commands of split weighted by drawCommandCost
+};
+// Heuristics of render groups consolidation, applied to meshes before grouping
+struct RenderGroupPlanOptions{
+    IndexUnification indexUnification = IndexUnification::Automatic;
+    // Bytes an extra draw command is worth when promotion and split are compared
+    size_t drawCommandCost = 4096;
+    // Pads missing colors, and texture coordinates of materials without maps, so compatible layouts share groups
+    bool padAttributes = true;
+    // Largest padding relative to vertex size of a mesh
+    float maxPaddingRatio = 0.5f;
+};
+// Per group depth prepass decisions, from queries of frames sampled periodically. A group stays in prepass when
+// it covers enough of the target as occluder or when its fragments are expensive to shade
+struct DepthPrepassOptions{
+    int sampleInterval = 300; // Frames between samples
+    float minOccluderCoverage = 0.05f; // Samples written in prepass relative to target pixels
+    float minFragmentNanoseconds = 1.0f; // Color pass GPU time per shaded sample
+};
+// Scene resolution driven by GPU time of frames, upscaled to window
+struct DynamicResolutionOptions{
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float targetMilliseconds = 16.6f;
+    // Zero upscales bilinearly. Up to one sharpens by difference with neighbors
+    float sharpness = 0.0f;
+};
+// Forward shades fragments while drawing groups. Deferred writes a G-buffer and shades each pixel once in a
+// compute pass with lights culled per screen tile
+enum class RenderPath{
+    Forward,
+    Deferred
+};
 class Renderer : public System{
 private:
-    GLuint lastShaderProgram = 0;
+    // Every binding and fixed function state change of renderer goes through it
+    GL::StateTracker glState;
+    // Passes of frame, declared again each frame
+    FrameGraph frameGraph;
+    bool passTimingFlag = false;
+    // Adaptive depth prepass. Queries of a sampled frame are read once available, without waiting
+    bool adaptivePrepassFlag = false;
+    DepthPrepassOptions depthPrepassOptions;
+    int framesToPrepassSample = 0;
+    bool prepassSampling = false;
+    bool prepassSamplePending = false;
+    size_t prepassSamplePixels = 0;
+    size_t prepassGroupsCount = 0;
+    // Dynamic resolution
+    bool dynamicResolutionFlag = false;
+    DynamicResolutionOptions dynamicResolutionOptions;
+    float resolutionScale = 1.0f;
+    double smoothedGPUMilliseconds = -1.0;
+    int framesSinceScaleChange = 0;
+    // Frames between scale changes, longer than timer results take to be read
+    static constexpr int scaleChangeFrames = 8;
+    static constexpr float scaleStep = 0.05f;
+    Ref<GL::ShaderGL> upscaleShader;
+    GL::UniformHandle<float> upscaleSharpnessUniform;
+    GLuint upscaleVertexArray = 0;
+    GLuint upscaleSampler = 0;
     Window* mainWindow = nullptr;
     unsigned int objectsCountToGroup = 512;
     const GLuint maxBindingPoints = 50;
@@ -92,10 +162,52 @@ private:
         GLint baseVertex = 0;
         GLuint baseInstance = 0;
     };
+    // Index range of a level of detail in render group indices buffer
+    struct LODRange{
+        unsigned int firstIndex = 0;
+        unsigned int count = 0;
+        float error = 0.0f; // Simplification error relative to bounding sphere radius
+    };
+    // Levels of detail of a draw (full detail first). Instances of a draw share the selected level
+    struct DrawLODs{
+        std::vector<LODRange> levels;
+        glm::vec4 boundingSphere = glm::vec4(0.0f); // Mesh space center and radius
+        int firstObject = 0;
+        int objectsCount = 0;
+        int currentLevel = 0;
+    };
+    // Meshlets bounds of a render group in structure of arrays layout, for vectorized culling in mesh space
+    struct ClusterBounds{
+        std::vector<float> centersX, centersY, centersZ, radii;
+        std::vector<float> apexesX, apexesY, apexesZ;
+        std::vector<float> axesX, axesY, axesZ, cutoffs;
+        std::vector<unsigned int> firstIndices; // Offsets in render group indices buffer
+        std::vector<unsigned int> counts;
+        void PushMeshlet(const Meshlet &meshlet, unsigned int firstIndex);
+        size_t Size() const{
+            return counts.size();
+        }
+    };
+    // Meshlets range of a draw. Every object of the draw is culled separately
+    struct DrawClusters{
+        size_t firstCluster = 0;
+        size_t clustersCount = 0;
+        int firstObject = 0;
+        int objectsCount = 0;
+    };
+    // Materials of a render group share their alpha mode, as its flags are part of the variant key
+    enum class AlphaMode{
+        Opaque, // Drawn without blending
+        Masked, // Alpha tested, also in depth prepass
+        Transparent // Blended after opaque objects, sorted back to front without depth writes
+    };
     using Renderable = std::pair<std::reference_wrapper<MeshRendererComponent>,
     std::reference_wrapper<TransformComponent>>;
     struct ShaderGroup{
         Ref<GL::ShaderGL> shader;
+        ShaderVariantKey variantKey;
+        bool isDynamic = false; // Renderables of a single dynamic mesh
+        bool vertexPulling = false;
         std::vector<Renderable> batchGroup;
         std::vector<std::vector<Renderable>> instancesGroups;
         const std::vector<Renderable> &GetBatchGroup() const{
@@ -121,6 +233,62 @@ private:
         // For non indirect drawing
         BatchGroup batchGroup;
         std::vector<InstanceGroup> instancesGroups;
+        // One entry per draw, in the same order of commands. Empty when no mesh has levels of detail
+        std::vector<DrawLODs> drawsLODs;
+        // One entry per draw, in the same order of commands. Empty when cluster culling is not used
+        std::vector<DrawClusters> drawsClusters;
+        ClusterBounds clusters;
+        // Vertex pulling mode. Attributes blocks of every mesh, 4 bytes aligned, and layouts of each object attributes slot
+        std::vector<unsigned char> pulledVerticesData;
+        std::vector<glm::uvec4> verticesLayouts;
+    };
+    // Streaming state of the render group of a dynamic mesh. Buffers have spare capacity, so growth
+    // reallocates rarely, and only dirty ranges of the mesh are uploaded
+    struct DynamicGeometry{
+        Ref<Mesh> mesh;
+        MeshLayout layout;
+        size_t verticesCapacity = 0;
+        size_t indicesCapacity = 0;
+        // Counts in buffers
+        int verticesCount = 0;
+        unsigned int indicesCount = 0;
+        std::vector<GLintptr> attributesOffsets;
+        std::vector<GLsizei> attributesStrides;
+        std::vector<unsigned char> stagingData; // Interleaved or packed vertices of a dirty range
+    };
+    // Compute pass input of an object skinned or morphed on GPU
+    struct DeformedObject{
+        // First source vertex, vertices count, first palette matrix (~0 without skin) and first deformed vertex of group
+        glm::uvec4 vertices = glm::uvec4(0u);
+        // First morph delta, targets count, first morph weight and stride of written attributes in words
+        glm::uvec4 morph = glm::uvec4(0u);
+        // First word in attributes buffer of position, normal, tangent and bitangent (~0 when not written)
+        glm::uvec4 outputs = glm::uvec4(~0u);
+    };
+    // Deformed objects of a render group. Their vertices are rewritten in the attributes buffer every frame
+    // from bind pose sources, so they are drawn by the render group as static geometry
+    struct GroupDeformation{
+        std::vector<std::reference_wrapper<MeshRendererComponent>> objects;
+        std::vector<DeformedObject> descriptors;
+        std::vector<glm::mat4> palettes;
+        std::vector<float> morphWeights;
+        unsigned int verticesCount = 0;
+        Buffer sourcesBuffer; // Bind pose vertices and influences of each mesh
+        Buffer deltasBuffer; // Position and normal offsets of morph targets of each mesh
+        Buffer objectsBuffer;
+        Buffer vertexObjectsBuffer; // Object of each deformed vertex
+        Buffer palettesBuffer;
+        Buffer morphWeightsBuffer;
+    };
+    // Samples passed, begin and end timestamps of prepass then of color pass. Deleted with their group
+    struct PrepassQueries{
+        std::array<GLuint, 6> names = {};
+        PrepassQueries() = default;
+        PrepassQueries(const PrepassQueries &) = delete;
+        PrepassQueries &operator=(const PrepassQueries &) = delete;
+        PrepassQueries(PrepassQueries &&other);
+        PrepassQueries &operator=(PrepassQueries &&other);
+        ~PrepassQueries();
     };
     struct RenderGroup{
         GL::VertexArrayGL vao;
@@ -132,10 +300,38 @@ private:
         // Textures
         int textureParametersCount = 0;
         // Each texture in vector is a texture array with objectsCountToGroup layers count
-        std::vector<GL::TextureGLResource> texturesArrays;
+        std::vector<Ref<GL::TextureGL>> texturesArrays; // Owned by group, released with it
         // Buffers vector that stores indices array for acessing texture array layers
         // This is used to access duplied textures in use
         std::vector<Buffer> texLayersIndexBuffers; // UBO in Fragment Shader
+        // Uniforms set every frame, resolved in shader when group is built
+        GL::UniformHandle<int> pointLightCountUniform;
+        GL::UniformHandle<int> directionalLightCountUniform;
+        GL::UniformHandle<int> spotLightCountUniform;
+        GL::UniformHandle<glm::vec3> viewPosUniform;
+        // Sampler of each texture array unit, set when program is ready
+        std::vector<std::string> samplersNames;
+        ShaderVariantKey variantKey; // Variant of pending program when there is one, otherwise of shader
+        // Program replacing shader once its link finishes
+        Ref<GL::ShaderGL> pendingShader;
+        bool shaderReady = false; // Linked and uniforms resolved. Group is skipped until then
+        // Material globals changed before program of group is ready, set once it links
+        std::vector<std::pair<std::string, float>> pendingGlobalFloats;
+        std::vector<std::pair<std::string, bool>> pendingGlobalBooleans;
+        std::vector<std::pair<std::string, glm::vec4>> pendingGlobalVectors4;
+        AlphaMode alphaMode = AlphaMode::Opaque;
+        // Depth only variant of masked groups, drawn in depth prepass once linked
+        Ref<GL::ShaderGL> maskedDepthShader;
+        Ref<GL::ShaderGL> pendingDepthShader;
+        // G-buffer variant of opaque and masked groups, requested when deferred path is first used
+        Ref<GL::ShaderGL> gBufferShader;
+        Ref<GL::ShaderGL> pendingGBufferShader;
+        // Adaptive depth prepass. Group is drawn in prepass until samples show it is not worth it
+        bool inDepthPrepass = true;
+        PrepassQueries prepassQueries;
+        std::array<bool, 2> prepassSampled = {};
+        float prepassCoverage = 0.0f;
+        float fragmentNanoseconds = 0.0f;
         ////
         int objectsCount = 0;
         Buffer mvpsUniformBuffer;
@@ -145,6 +341,8 @@ private:
         std::vector<glm::mat4> models;
         Buffer normalMatricesUniformBuffer; // UBO in Vertex Shader
         std::vector<glm::mat4> normalMatrices; // Transposed inverse of model matrices
+        // Mesh dequantization transforms of objects with quantized positions. Empty for float positions
+        std::vector<glm::mat4> positionDequantizations;
         Buffer materialUniformBuffer; // UBO in Fragment Shader
         std::vector<std::reference_wrapper<Material>> materials;
         StructArray materialsStructArray; // Contains material uniform block layout and data
@@ -163,7 +361,18 @@ private:
         BatchGroup batchGroup; // Objects that were batched
         std::vector<InstanceGroup> instancesGroups;
         //
+        std::vector<DrawLODs> drawsLODs;
+        std::vector<DrawClusters> drawsClusters;
+        ClusterBounds clusters;
+        // Commands of surviving clusters, rebuilt every frame
+        std::vector<DrawElementsIndirectCommand> culledCommands;
         bool useLighting = false;
+        Ref<DynamicGeometry> dynamicGeometry; // Null for static geometry
+        // Storage buffers read by shaders in vertex pulling mode, which draws with the shared empty VAO
+        bool vertexPulling = false;
+        Buffer verticesDataBuffer;
+        Buffer verticesLayoutsBuffer;
+        Ref<GroupDeformation> deformation; // Null without skinned or morphed objects
     };
     struct PointLight{
         glm::vec4 position = glm::vec4(0.0f);
@@ -203,36 +412,246 @@ private:
 
     // Objects used for depth prepass
     bool depthPassFlag = true;
+    // Opaque groups are drawn without blending, masked ones alpha tested and transparent ones in a sorted pass.
+    // Disabled draws every group in one pass with blending
+    bool alphaModesFlag = true;
+    // Draw of one object of a transparent group
+    struct TransparentDraw{
+        float distance = 0.0f; // Squared distance of object to camera
+        size_t group = 0;
+        GLsizei count = 0;
+        GLuint firstIndex = 0;
+        GLint baseVertex = 0;
+        GLuint object = 0; // Base instance, so object ID is the same of batched draws
+    };
+    std::vector<TransparentDraw> transparentDraws;
+    // Deferred shading. Needs GL 4.3 for compute resolve. Forward path is drawn until G-buffer programs of every
+    // opaque and masked group are ready
+    RenderPath renderPath = RenderPath::Forward;
+    bool deferredShadingSetup = false;
+    Ref<GL::ShaderGL> deferredResolveShader;
+    GL::UniformHandle<glm::mat4> resolveInverseProjectionUniform;
+    GL::UniformHandle<glm::mat4> resolveInverseViewProjectionUniform;
+    GL::UniformHandle<glm::mat4> resolveViewUniform;
+    GL::UniformHandle<glm::vec3> resolveViewPosUniform;
+    GL::UniformHandle<glm::vec4> resolveClearColorUniform;
+    GL::UniformHandle<int> resolvePointLightsCountUniform;
+    GL::UniformHandle<int> resolveDirectionalLightsCountUniform;
+    GL::UniformHandle<int> resolveSpotLightsCountUniform;
+    // Lights of deferred shading, up to maxDeferredLights of each type
+    Buffer pointLightStorageBuffer;
+    Buffer directionalLightStorageBuffer;
+    Buffer spotLightStorageBuffer;
     std::array<float, 4> colorClearValue = {0.0f,0.0f,0.0f,1.0f};
     std::array<float, 1> depthClearValue = {1.0f};
     Ref<GL::ShaderGL> depthShader;
+    // Vertex pulling. Needs GL 4.3 for storage buffers. Render groups of dynamic meshes still use their VAOs
+    bool vertexPullingFlag = false;
+    Ref<GL::VertexArrayGL> pullingVao; // Without attributes. Only element buffer changes between render groups
+    Ref<GL::ShaderGL> pullingDepthShader;
+    // Skinning and morph targets evaluation. Needs GL 4.3 for compute shaders, otherwise meshes keep bind pose
+    Ref<GL::ShaderGL> deformationShader;
+    GL::UniformHandle<int> deformedVerticesCountUniform;
+    size_t deformedVerticesCount = 0;
+    // Levels of detail selection. The coarsest level with projected error below threshold (in pixels) is drawn
+    float lodPixelThreshold = 1.0f;
+    // Relative band around threshold where current level is kept, which avoids popping between levels
+    float lodHysteresis = 0.25f;
+    int lodOverride = -1; // Forces a level for debugging. Negative for automatic selection
+    // Meshlets culling against frustum and normal cones. Object IDs come from base instance, so it needs
+    // indirect drawing with GL 4.6 shaders
+    bool clusterCullingFlag = false;
+    bool renderGroupPlanningFlag = false;
+    RenderGroupPlanOptions renderGroupPlanOptions;
+    // Components of mesh parts created by render groups planning. Deque keeps references valid
+    std::deque<MeshRendererComponent> plannedMeshRenderers;
+    // Capacity of dynamic geometry buffers is multiplied by this factor when exceeded
+    float dynamicGrowthFactor = 1.5f;
+    // Dirty fraction of dynamic geometry above which the buffer is orphaned and uploaded whole
+    float dynamicOrphanRatio = 0.5f;
+    size_t streamedBytesCount = 0;
+    // Triangles of selected levels and triangles left after cluster culling in last frame
+    size_t submittedTrianglesCount = 0;
+    size_t drawnTrianglesCount = 0;
     //
     GLenum GetDrawMode(MeshTopology topology);
     GLenum GetIndicesType(MeshIndexType type);
     void BufferSubDataMVPs(RenderGroup &renderGroup);
     void BufferSubDataModels(RenderGroup &renderGroup);
     void BufferSubDataNormalMatrices(RenderGroup &renderGroup);
+    // Uploads every mip level of texture stored in layer of texture array
+    void PushTextureLevels(GL::TextureGL &textureArray, const Texture &texture, int layer, bool isCompressed, bool forceSRGB);
     void SetRenderGroupLayout(const RenderGroup &renderGroup, const MeshLayout &layout);
     void BindRenderGroupAttributesBuffers(RenderGroup &renderGroup, const std::vector<GLintptr> &offsets, const std::vector<GLsizei> &strides);
     void DrawFunctionNonIndirect(RenderGroup &renderGroup);
     void DrawFunctionIndirect(RenderGroup &renderGroup);
-    void SetupDepthShader();
+    // Appends levels of detail indices of mesh after its full detail indices. Returns appended indices count
+    unsigned int PushDrawLODs(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, unsigned int firstIndex, int firstObject, int objectsCount);
+    // Appends meshlets bounds of mesh with offsets in render group indices buffer
+    void PushDrawClusters(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, unsigned int firstIndex, int firstObject, int objectsCount);
+    // Emits one command per visible meshlet of each object and uploads them
+    void CullClusters(RenderGroup &renderGroup, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+    bool IsClusterCullingSupported() const;
+    // Selects level of each draw by projected bounding sphere and rewrites draw commands
+    void SelectLODs(RenderGroup &renderGroup, const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform);
+    // (Re)specifies dynamic geometry buffers with capacity for mesh counts. Contents are not uploaded
+    void AllocateDynamicGeometry(RenderGroup &renderGroup);
+    void UploadDynamicVertices(RenderGroup &renderGroup, size_t firstVertex, size_t count);
+    void UploadDynamicIndices(RenderGroup &renderGroup, size_t firstIndex, size_t count);
+    // Uploads dirty ranges of dynamic mesh, growing buffers and updating draw counts when needed
+    void StreamDynamicGeometry(RenderGroup &renderGroup);
+    // Appends packed attributes of mesh and layouts of its objects for vertex pulling
+    void PushPulledVertices(RenderGroupBuffers &renderGroupBuffers, Mesh &mesh, int objectsCount);
+    void BindRenderGroupVertices(RenderGroup &renderGroup);
+    // Object with an animator and a skinned or morphed mesh. These objects are never instanced
+    bool IsDeformed(const MeshRendererComponent &meshRenderer) const;
+    void SetupDeformationShader();
+    // Uploads sources of deformed objects of batch group, written at attributes offsets and strides
+    void BuildGroupDeformation(RenderGroup &renderGroup, const ShaderGroup &shaderGroup, const MeshLayout &layout,
+    const std::vector<GLintptr> &attributesOffsets, const std::vector<GLsizei> &attributesStrides);
+    // Advances animators and writes deformed vertices of every render group
+    void DeformGeometry(float deltaTime);
+    void SetupDepthShader(bool vertexPulling);
     void SetDrawFunction();
     void BuildRenderGroupBuffers(RenderGroupBuffers &renderGroupBuffers, const ShaderGroup &shaderGroup);
     void BuildRenderGroup(RenderGroup &renderGroup, const RenderGroupBuffers &renderGroupBuffers, const ShaderGroup &shaderGroup);
+    // Material globals are set to program of group, or queued until it is ready
+    void RegisterMaterialCallbacks(RenderGroup &renderGroup, Material &material);
     //Defaulft drawing is direct type
     bool isIndirect = false;
     void (Renderer::*DrawFunction)(RenderGroup&) = &Renderer::DrawFunctionNonIndirect;
+    // Shader model of material and mesh layout. Returns false when material shader is not a standard shader
+    // In vertex pulling mode only attributes presence is part of model
+    bool BuildShaderModel(Material &material, const MeshLayout &meshLayout, MeshIndexType indicesType, ShaderStandard &shader,
+    bool vertexPulling = false);
+    // Variant key of the shader model above, built without strings. Returns false when material shader is not a
+    // standard shader
+    bool BuildVariantKey(Material &material, const MeshLayout &meshLayout, MeshIndexType indicesType, ShaderVariantKey &key,
+    bool vertexPulling = false);
+    // Programs are linked in background and render groups are drawn once theirs is ready. Disabled compiles
+    // and links each variant in turn
+    bool parallelShaderCompileFlag = true;
+    size_t pendingShadersCount = 0;
+    std::chrono::high_resolution_clock::time_point shadersBegin;
+    bool reportShadersWallTime = false;
+    // Lit variants are specialized on bucketed light counts of each type (point, directional and spot). Disabled
+    // keeps loops over count uniforms up to maximum lights
+    bool lightsBucketsFlag = true;
+    glm::ivec3 lightsBuckets = glm::ivec3(-1);
+    // Shader model inputs of each variant without light buckets, for building its other buckets on first use
+    struct ShaderModelSource{
+        Ref<Material> material;
+        MeshLayout layout;
+        MeshIndexType indicesType;
+        bool vertexPulling = false;
+    };
+    std::unordered_map<ShaderVariantKey, ShaderModelSource, ShaderVariantKeyHash> shaderModelSources;
+    // Programs of variants already submitted
+    std::unordered_map<ShaderVariantKey, Ref<GL::ShaderGL>, ShaderVariantKeyHash> variantsPrograms;
+    // Lights of each type used by shaders, up to maximum of each type
+    glm::ivec3 CountLights(entt::registry &registry) const;
+    // Capacity of 0, 1, 4 or 16 lights of each type, clamped by maximum lights of type
+    glm::ivec3 LightsBuckets(const glm::ivec3 &lightsCounts) const;
+    // Variant key with light buckets features of a lit variant. Negative buckets clear them
+    static ShaderVariantKey WithLightsBuckets(const ShaderVariantKey &key, const glm::ivec3 &buckets);
+    // Returns program of variant, submitting it when not built yet. Null when variant has no source
+    Ref<GL::ShaderGL> RequestVariantProgram(const ShaderVariantKey &key, const glm::ivec3 &buckets);
+    // Programs of lit groups with current light buckets are set as pending programs
+    void SelectLightsVariants();
+    // Binds uniform blocks of program to binding points of their purposes. Returns false when points are exhausted
+    bool BindShaderBlocks(GL::ShaderGL &program, const ShaderCode &code);
+    // Resolves uniforms of groups whose program finished linking
+    void PollRenderGroupsShaders();
+    // Alpha mode of materials of variant. Opaque when alpha modes are disabled
+    AlphaMode GetAlphaMode(const ShaderVariantKey &key) const;
+    // Key of depth only variant of a masked variant
+    static ShaderVariantKey DepthOnlyKey(const ShaderVariantKey &key);
+    // Binds uniform buffers and textures arrays of group
+    void BindRenderGroupResources(RenderGroup &renderGroup, std::vector<std::pair<GLuint, GLuint>> &uniformBindings,
+    std::vector<GLuint> &texturesNames);
+    // Draws objects of transparent groups one by one, farthest first
+    void DrawTransparentObjects(const glm::vec3 &cameraPosition, const glm::ivec3 &lightsCounts);
+    // Writes depth of opaque and masked groups to bound framebuffer
+    void DrawDepthPrepass(std::vector<std::pair<GLuint, GLuint>> &uniformBindings, std::vector<GLuint> &texturesNames);
+    bool IsDeferredSupported() const;
+    // Key of G-buffer variant of a variant
+    static ShaderVariantKey GBufferKey(const ShaderVariantKey &key);
+    // Builds resolve program and light storage buffers, and submits G-buffer programs of groups
+    void SetupDeferredShading();
+    void SetupDeferredResolveShader();
+    bool IsDeferredReady() const;
+    // Passes of depth prepass, color and transparent objects over targets
+    void AddForwardPasses(FrameGraphResource colorTarget, FrameGraphResource depthTarget, const glm::vec3 &cameraPosition,
+    const glm::ivec3 &lightsCounts, std::vector<std::pair<GLuint, GLuint>> &uniformBindings, std::vector<GLuint> &texturesNames);
+    // Passes drawing G-buffer, resolving lighting per tile and drawing transparent objects forward over it. Targets are
+    // transient textures of frame graph. Returns resolved color
+    FrameGraphResource AddDeferredPasses(const glm::ivec2 &size, const glm::mat4 &projection, const glm::mat4 &view,
+    const glm::vec3 &cameraPosition, const glm::ivec3 &lightsCounts, std::vector<std::pair<GLuint, GLuint>> &uniformBindings,
+    std::vector<GLuint> &texturesNames);
+    // Copies color of same size to backbuffer
+    void AddPresentPass(FrameGraphResource source, FrameGraphResource backbuffer, const glm::ivec2 &size);
+    // Filters color of scaled size to backbuffer
+    void AddUpscalePass(FrameGraphResource source, FrameGraphResource backbuffer);
+    void SetupUpscaleShader();
+    // Moves scale toward target GPU time of frame
+    void UpdateResolutionScale();
+    // Starts a sampled frame or reads results of last one
+    void UpdateDepthPrepassGroups(const glm::ivec2 &size);
+    // Returns false while results are not available
+    bool EvaluatePrepassSamples();
+    // Queries around draws of group in prepass (phase 0) or color pass (phase 1) of sampled frames
+    void BeginPrepassSample(RenderGroup &renderGroup, int phase);
+    void EndPrepassSample(RenderGroup &renderGroup, int phase);
+    // Code of shader variants already processed, kept between render groups preparations
+    std::unordered_map<ShaderVariantKey, ShaderCode, ShaderVariantKeyHash> shaderCodeCache;
+    // Pads layouts and unifies index types of meshes, so renderables fall in fewer render groups
+    void PlanRenderGroups(std::vector<Renderable> &renderables);
     // Performs grouping operations for batching and instancing. This process work for now only with standard shaders
     void PrepareRenderGroups(entt::registry &registry);
     std::optional<int> AddUBOBindingPurpose(const std::string &purpose);
     // Executes the drawing at update call
-    void Draw(const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform, const std::vector<std::pair<std::string, size_t>> &lightsCounters);
+    void Draw(const CameraComponent &mainCamera, const TransformComponent &mainCameraTransform, const glm::ivec3 &lightsCounts);
 public:
     Renderer();
+    // Releases mesh parts created by planning from meshes pool
+    ~Renderer();
     void SetMainWindow(Window *mainWindow);
     void SetInterleaveAttribState(bool interleave);
     void SetDepthPrepassState(bool depthPass);
+    void SetAlphaModesState(bool alphaModes);
+    // Chooses groups of depth prepass when it is enabled
+    void SetAdaptivePrepassState(bool adaptivePrepass);
+    void SetDepthPrepassOptions(const DepthPrepassOptions &options);
+    // Prints decision and measures of each group
+    void PrintDepthPrepassStats() const;
+    // Deferred path is kept forward when GL 4.3 is not available
+    void SetRenderPath(RenderPath renderPath);
+    RenderPath GetRenderPath() const;
+    // CPU and GPU times of each pass of frame graph, measured with timer queries
+    void SetPassTimingState(bool passTiming);
+    const std::vector<FrameGraphPassTiming> &GetPassTimings() const;
+    const FrameGraphStats &GetFrameGraphStats() const;
+    void SetDynamicResolutionState(bool dynamicResolution);
+    void SetDynamicResolutionOptions(const DynamicResolutionOptions &options);
+    float GetResolutionScale() const;
+    void SetLODPixelThreshold(float threshold);
+    void SetLODHysteresis(float hysteresis);
+    // Negative level restores automatic selection
+    void SetLODOverride(int level);
+    void SetClusterCullingState(bool clusterCulling);
+    void SetRenderGroupPlanningState(bool planGroups);
+    void SetRenderGroupPlanOptions(const RenderGroupPlanOptions &options);
+    void SetDynamicGrowthFactor(float growthFactor);
+    void SetVertexPullingState(bool vertexPulling);
+    void SetParallelShaderCompileState(bool parallelShaderCompile);
+    void SetLightsBucketsState(bool lightsBuckets);
+    // Bytes of dynamic geometry uploaded in last frame
+    size_t GetStreamedBytesCount() const;
+    size_t GetSubmittedTrianglesCount() const;
+    // Issued and elided GL state calls of last frame
+    const GL::StateCounters &GetStateCounters() const;
+    size_t GetDrawnTrianglesCount() const;
+    size_t GetDeformedVerticesCount() const;
     void Start(entt::registry &registry) override;
     void Update(entt::registry &registry, float deltaTime) override;
     int GetDrawGroupsCount();
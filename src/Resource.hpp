@@ -1,18 +1,190 @@
 #ifndef RESOURCE_H
 #define RESOURCE_H
-#include "RandomHelper.hpp"
 #include "Base.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
-using ResourceHandle = UUIDv4::UUID;
+// 32 bits reference to an object in the pool of its type: slot index in low bits and slot generation in
+// high bits. Zero is the null handle. Handles of released objects fail validation, as slot generation changes
+template <typename T>
+struct ResourceHandle{
+    static constexpr uint32_t indexBits = 20;
+    static constexpr uint32_t indexMask = (1u << indexBits) - 1;
+    uint32_t value = 0;
+    ResourceHandle() = default;
+    ResourceHandle(uint32_t index, uint32_t generation):value((generation << indexBits) | index){}
+    uint32_t Index() const{
+        return value & indexMask;
+    }
+    uint32_t Generation() const{
+        return value >> indexBits;
+    }
+    explicit operator bool() const{
+        return value != 0;
+    }
+    bool operator==(const ResourceHandle &handle) const{
+        return value == handle.value;
+    }
+    bool operator!=(const ResourceHandle &handle) const{
+        return value != handle.value;
+    }
+    bool operator<(const ResourceHandle &handle) const{
+        return value < handle.value;
+    }
+};
+
+namespace std{
+    template <typename T>
+    struct hash<ResourceHandle<T>>{
+        size_t operator()(const ResourceHandle<T> &handle) const{
+            return std::hash<uint32_t>()(handle.value);
+        }
+    };
+}
+
+// Generational slot map owning the objects of a type. Slots are allocated in blocks that never move, so
+// lookups don't lock and stay valid while other threads insert. Objects live until they are released
+template <typename T>
+class ResourcePool{
+private:
+    struct Slot{
+        Ref<T> object;
+        uint32_t generation = 1;
+        uint32_t denseIndex = 0;
+    };
+    static constexpr uint32_t blockBits = 10;
+    static constexpr uint32_t blockSize = 1u << blockBits;
+    static constexpr uint32_t blocksCount = (ResourceHandle<T>::indexMask + 1) >> blockBits;
+    static constexpr uint32_t maxGeneration = (1u << (32 - ResourceHandle<T>::indexBits)) - 1;
+    std::array<std::unique_ptr<Slot[]>, blocksCount> blocks;
+    uint32_t slotsCount = 1; // Slot 0 is reserved, so the null handle is never issued
+    std::vector<uint32_t> freeSlots;
+    // Live handles, packed for iteration
+    std::vector<ResourceHandle<T>> handles;
+    // Each object has one handle, so resources of the same object compare equal
+    std::unordered_map<const T*, ResourceHandle<T>> objectsHandles;
+    mutable std::mutex mutex;
+    Slot &SlotAt(uint32_t index) const{
+        return blocks[index >> blockBits][index & (blockSize - 1)];
+    }
+    Slot *FindSlot(ResourceHandle<T> handle) const{
+        uint32_t index = handle.Index();
+        if(!blocks[index >> blockBits])
+            return nullptr;
+        Slot &slot = SlotAt(index);
+        return slot.object && slot.generation == handle.Generation() ? &slot : nullptr;
+    }
+    ResourcePool() = default;
+public:
+    ResourcePool(const ResourcePool &) = delete;
+    ResourcePool &operator=(const ResourcePool &) = delete;
+    static ResourcePool &Instance(){
+        static ResourcePool pool;
+        return pool;
+    }
+    // Returns handle of object, inserting it when not in pool. Null for null objects or a full pool
+    ResourceHandle<T> Insert(Ref<T> object){
+        if(!object)
+            return ResourceHandle<T>();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto objectHandle = objectsHandles.find(object.get());
+        if(objectHandle != objectsHandles.end())
+            return objectHandle->second;
+        uint32_t index = 0;
+        if(!freeSlots.empty()){
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if(slotsCount > ResourceHandle<T>::indexMask){
+                std::cout << "Resource pool is full - Object not inserted\n";
+                return ResourceHandle<T>();
+            }
+            index = slotsCount++;
+            auto &block = blocks[index >> blockBits];
+            if(!block)
+                block = std::make_unique<Slot[]>(blockSize);
+        }
+        Slot &slot = SlotAt(index);
+        ResourceHandle<T> handle(index, slot.generation);
+        slot.denseIndex = handles.size();
+        objectsHandles.emplace(object.get(), handle);
+        slot.object = std::move(object);
+        handles.push_back(handle);
+        return handle;
+    }
+    // Drops pool ownership of object. Returns false for stale handles
+    bool Release(ResourceHandle<T> handle){
+        Ref<T> released; // Destroyed after unlocking, as its destructor may release other resources
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Slot *slot = FindSlot(handle);
+            if(!slot)
+                return false;
+            // Last live handle takes the released position
+            ResourceHandle<T> last = handles.back();
+            handles[slot->denseIndex] = last;
+            SlotAt(last.Index()).denseIndex = slot->denseIndex;
+            handles.pop_back();
+            objectsHandles.erase(slot->object.get());
+            released = std::move(slot->object);
+            slot->generation = slot->generation == maxGeneration ? 1 : slot->generation + 1;
+            freeSlots.push_back(handle.Index());
+        }
+        return true;
+    }
+    bool IsValid(ResourceHandle<T> handle) const{
+        return FindSlot(handle) != nullptr;
+    }
+    // Null for stale handles
+    T *Find(ResourceHandle<T> handle) const{
+        Slot *slot = FindSlot(handle);
+        return slot ? slot->object.get() : nullptr;
+    }
+    const Ref<T> &FindRef(ResourceHandle<T> handle) const{
+        static const Ref<T> nullObject;
+        Slot *slot = FindSlot(handle);
+        return slot ? slot->object : nullObject;
+    }
+    size_t Size() const{
+        std::lock_guard<std::mutex> lock(mutex);
+        return handles.size();
+    }
+    // Visits live objects in packed order. Function must not insert or release objects of this pool
+    void ForEach(const std::function<void(ResourceHandle<T>, T&)> &function) const{
+        std::lock_guard<std::mutex> lock(mutex);
+        for(ResourceHandle<T> handle : handles)
+            function(handle, *SlotAt(handle.Index()).object);
+    }
+};
 
+// Reference to an object in the pool of its type. Copies are only the handle, without reference counting
 template <typename T>
 class Resource{
 public:
-    ResourceHandle resourceHandle = RandomHelper::UUIDGenerator.getUUID();
-    Ref<T> object;
+    ResourceHandle<T> handle;
     Resource() = default;
-    Resource(Ref<T> object):object(std::move(object)){}
-    T& operator*() const { return *object;}
-    T* operator->() const { return object.get();}
+    Resource(Ref<T> object):handle(ResourcePool<T>::Instance().Insert(std::move(object))){}
+    T *Get() const{
+        return ResourcePool<T>::Instance().Find(handle);
+    }
+    // Shared reference held by pool, for objects kept beyond their pool lifetime
+    const Ref<T> &Object() const{
+        return ResourcePool<T>::Instance().FindRef(handle);
+    }
+    bool IsValid() const{
+        return ResourcePool<T>::Instance().IsValid(handle);
+    }
+    // Every resource with this handle becomes invalid
+    void Release(){
+        ResourcePool<T>::Instance().Release(handle);
+        handle = ResourceHandle<T>();
+    }
+    T& operator*() const { return *Get();}
+    T* operator->() const { return Get();}
 };
 #endif
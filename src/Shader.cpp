@@ -62,6 +62,28 @@ std::size_t Shader::Hash() const {
     return combinedHash;
 }
 
+ShaderVariantKey Shader::GetVariantKey() const{
+    ShaderVariantKey key;
+    for(const auto& [name, used] : maps){
+        if(used)
+            key.SetFeature(ShaderFeatureKind::Map, name);
+    }
+    for(const auto& [name, used] : uniforms){
+        if(used)
+            key.SetFeature(ShaderFeatureKind::Uniform, name);
+    }
+    for(const auto& [name, used] : flags){
+        if(used)
+            key.SetFeature(ShaderFeatureKind::Flag, name);
+    }
+    for(const auto& [name, attribute] : attributes){
+        if(attribute.first)
+            key.SetAttribute(attribute.second);
+    }
+    key.SetIndexType(indexType);
+    return key;
+}
+
 const std::unordered_map<std::string, bool>& Shader::GetMaps(){
     return maps;
 }
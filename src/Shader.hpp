@@ -2,6 +2,7 @@
 #define SHADER_H
 #include "ShaderCode.hpp"
 #include "Mesh.hpp"
+#include "ShaderVariantKey.hpp"
 // Base class to model the shaders used in materials
 class Shader{
 protected:
@@ -19,6 +20,8 @@ public:
     bool operator==(const Shader& other) const;
     // Calculates hashes for identify uniquely the shaders
     std::size_t Hash() const;
+    // Variant of used maps, uniforms, flags, attributes and index type, for comparisons without strings
+    ShaderVariantKey GetVariantKey() const;
     const std::unordered_map<std::string, bool>& GetMaps();
     const std::vector<std::pair<std::string, bool>>& GetUniforms();
     const std::unordered_map<std::string, bool>& GetFlags();
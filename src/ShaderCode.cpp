@@ -1,4 +1,5 @@
 #include "ShaderCode.hpp"
+#include "ProgramBinaryCache.hpp"
 #include <algorithm>
 const std::string ShaderCode::GLSLTypeToString(ShaderDataType type){ 
     switch (type)
@@ -225,6 +226,18 @@ void ShaderCode::CreateUniformBlock(ShaderStage shaderStage, const std::string &
     }
 }
 
+void ShaderCode::CreateStorageBlock(ShaderStage shaderStage, const std::string &name, const std::string &body, int binding)
+{
+    switch(shaderStage){
+        case ShaderStage::Vertex : vertexShader.storageBlocks[name] = {binding, body}; break;
+        case ShaderStage::TesselationControl : tesselationControlShader.storageBlocks[name] = {binding, body}; break;
+        case ShaderStage::TesselationEvaluation : tesselationEvaluationShader.storageBlocks[name] = {binding, body}; break;
+        case ShaderStage::Geometry : geometryShader.storageBlocks[name] = {binding, body}; break;
+        case ShaderStage::Fragment : fragmentShader.storageBlocks[name] = {binding, body}; break;
+        default: return;
+    }
+}
+
 void ShaderCode::PushOutsideCode(ShaderStage shaderStage, const std::string &code)
 {
     switch(shaderStage){
@@ -319,6 +332,11 @@ std::string &outsideString, std::string &outsideStringIns){
         outsideString += "layout (std140) uniform " + uniformBlock.first + "{\n" + uniformBlock.second + "};\n";
     }
 
+    for(auto &&storageBlock : shaderStageCode.storageBlocks){
+        outsideString += "layout (std430, binding = " + std::to_string(storageBlock.second.first) + ") readonly buffer " +
+        storageBlock.first + "{\n" + storageBlock.second.second + "};\n";
+    }
+
     for(auto &&outsideCode : shaderStageCode.outsideCodes){
         outsideString += outsideCode + "\n";
     }
@@ -385,35 +403,36 @@ void ShaderCode::PushMaterialParameter(ShaderStage shaderStage, const std::strin
     }
 }
 
-Ref<GL::ShaderGL> ShaderCode::Generate()
+bool ShaderCode::GenerateSources(std::vector<std::pair<GLenum, std::string>> &sources)
 {
-    std::vector<GL::ShaderObjectGL> shaderObjects;
+    std::vector<GLenum> shaderTypes;
     // Reserve for vertex and fragment shader
-    shaderObjects.reserve(2);
+    shaderTypes.reserve(2);
     
     // Vertex Shader is needed
     if(vertexShader.enabled)
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_VERTEX_SHADER));
+        shaderTypes.push_back(GL_VERTEX_SHADER);
     else
-        return nullptr;
+        return false;
 
     if(tesselationControlShader.enabled && tesselationEvaluationShader.enabled){
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_TESS_CONTROL_SHADER));
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_TESS_EVALUATION_SHADER));
+        shaderTypes.push_back(GL_TESS_CONTROL_SHADER);
+        shaderTypes.push_back(GL_TESS_EVALUATION_SHADER);
     } else if(!tesselationControlShader.enabled && tesselationEvaluationShader.enabled){
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_TESS_EVALUATION_SHADER));
+        shaderTypes.push_back(GL_TESS_EVALUATION_SHADER);
     } else if(tesselationControlShader.enabled && !tesselationEvaluationShader.enabled){
         // Tess control cannot be used without tess evaluation
-        return nullptr;
+        return false;
     }
 
     if(geometryShader.enabled)
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_GEOMETRY_SHADER));
+        shaderTypes.push_back(GL_GEOMETRY_SHADER);
 
     if(fragmentShader.enabled)
-        shaderObjects.emplace_back(GL::ShaderObjectGL(GL_FRAGMENT_SHADER));
+        shaderTypes.push_back(GL_FRAGMENT_SHADER);
+    sources.clear();
     std::string outsideStringInsPrevious;
-    for(size_t i = 0; i < shaderObjects.size(); i++){
+    for(size_t i = 0; i < shaderTypes.size(); i++){
         std::string versionString = "#version " + std::to_string(version) + "\n";
         std::string extensionsString;
         for(auto &&extension : extensions){
@@ -424,16 +443,16 @@ Ref<GL::ShaderGL> ShaderCode::Generate()
         std::string outsideStringIns;
         std::string shaderSource;
 
-        if(shaderObjects[i].GetType() == GL_VERTEX_SHADER){
+        if(shaderTypes[i] == GL_VERTEX_SHADER){
             ProcessVertexShaderCode(vertexShader, outsideString);
             ProcessShaderStageCode(vertexShader, mainString, outsideString, outsideStringIns);
-        } else if(shaderObjects[i].GetType() == GL_TESS_CONTROL_SHADER){
+        } else if(shaderTypes[i] == GL_TESS_CONTROL_SHADER){
             ProcessShaderStageCode(tesselationControlShader, mainString, outsideString, outsideStringIns);
-        } else if(shaderObjects[i].GetType() == GL_TESS_EVALUATION_SHADER){
+        } else if(shaderTypes[i] == GL_TESS_EVALUATION_SHADER){
             ProcessShaderStageCode(tesselationEvaluationShader, mainString, outsideString, outsideStringIns);
-        } else if(shaderObjects[i].GetType() == GL_GEOMETRY_SHADER){
+        } else if(shaderTypes[i] == GL_GEOMETRY_SHADER){
             ProcessShaderStageCode(geometryShader, mainString, outsideString, outsideStringIns);
-        } else if(shaderObjects[i].GetType() == GL_FRAGMENT_SHADER){
+        } else if(shaderTypes[i] == GL_FRAGMENT_SHADER){
             ProcessShaderStageCode(fragmentShader, mainString, outsideString, outsideStringIns);
         }
         // If Vertex Shader
@@ -447,12 +466,51 @@ Ref<GL::ShaderGL> ShaderCode::Generate()
             mainString + "\n}";
         }
         outsideStringInsPrevious = outsideStringIns;
-        shaderObjects[i].Compile(shaderSource);
+        sources.emplace_back(shaderTypes[i], std::move(shaderSource));
+    }
+    return true;
+}
+
+Ref<GL::ShaderGL> ShaderCode::CompileSources(const std::vector<std::pair<GLenum, std::string>> &sources, bool waitLink)
+{
+    Ref<GL::ShaderGL> shader = CreateRef<GL::ShaderGL>();
+    if(ProgramBinaryCache::IsEnabled()){
+        uint64_t key = ProgramBinaryCache::Key(sources);
+        if(ProgramBinaryCache::Load(key, *shader))
+            return shader;
+        // Binary is stored when link finishes
+        shader->SetBinaryRetrievable();
+        shader->SetBinaryKey(key);
+    }
+    std::vector<GL::ShaderObjectGL> shaderObjects;
+    shaderObjects.reserve(sources.size());
+    for(auto &&source : sources){
+        shaderObjects.emplace_back(source.first);
+        shaderObjects.back().Compile(source.second);
+    }
+    for(auto &&shaderObject : shaderObjects)
+        shader->AttachShaderObject(shaderObject);
+    if(waitLink){
+        shader->Link();
+        ProgramBinaryCache::Store(*shader);
+    } else
+        shader->BeginLink();
+    // Program keeps linked code, so shader objects are no longer needed
+    for(auto &&shaderObject : shaderObjects){
+        shader->DetachShaderObject(shaderObject);
+        shaderObject.Release();
     }
-    Ref<GL::ShaderGL> shader = CreateRef<GL::ShaderGL>(shaderObjects);
     return shader;
 }
 
+Ref<GL::ShaderGL> ShaderCode::Generate()
+{
+    std::vector<std::pair<GLenum, std::string>> sources;
+    if(!GenerateSources(sources))
+        return nullptr;
+    return CompileSources(sources);
+}
+
 const std::unordered_map<std::string, ShaderCodeParameter> &ShaderCode::GetUniforms(ShaderStage shaderStage){
     switch(shaderStage){
         case ShaderStage::Vertex : return vertexShader.uniforms;
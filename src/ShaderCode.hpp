@@ -37,6 +37,8 @@ struct ShaderStageCode{
     std::pair<std::string, std::string> materialParametersUniformBlock;
     int materialParametersSpaceUsed = 0;
     std::unordered_map<std::string, std::string> uniformBlocks;
+    // Read only shader storage blocks, name -> (binding, body)
+    std::unordered_map<std::string, std::pair<int, std::string>> storageBlocks;
     ///
     std::unordered_map<std::string, std::string> uniformBlockBindingPurposes;
     // Auxiliar outside codes. Useful for defining structs or functions
@@ -81,6 +83,7 @@ public:
     void AddMaterialMapArray(ShaderStage shaderStage, const std::string &name, Ref<Texture> defaultValue = nullptr);
     void UpdateMaterialParameterUniformBlock(ShaderStage shaderStage, const std::string &name, const std::string &body);
     void CreateUniformBlock(ShaderStage shaderStage, const std::string &name, const std::string &body);
+    void CreateStorageBlock(ShaderStage shaderStage, const std::string &name, const std::string &body, int binding);
     void PushOutsideCode(ShaderStage shaderStage, const std::string &code);
     void SetMain(ShaderStage shaderStage, const std::string &main);
     const std::unordered_map<std::string, ShaderCodeParameter> &GetUniforms(ShaderStage shaderStage);
@@ -88,6 +91,10 @@ public:
     std::vector<std::pair<std::string, Ref<Texture>>> GetMaterialTexturesProperties(ShaderStage shaderStage) const;
     void SetBindingPurpose(ShaderStage shaderStage, const std::string &uniformBlockName, const std::string &purpose);
     std::unordered_map<std::string, std::string> GetBindingsPurposes(ShaderStage shaderStage) const;
+    // GLSL source of each enabled stage. Makes no GL calls, so codes can be processed on workers
+    bool GenerateSources(std::vector<std::pair<GLenum, std::string>> &sources);
+    // Without waiting link, program must be ready before its uniforms are used
+    static Ref<GL::ShaderGL> CompileSources(const std::vector<std::pair<GLenum, std::string>> &sources, bool waitLink = true);
     Ref<GL::ShaderGL> Generate();
 };
 #endif
@@ -3,6 +3,7 @@
 #include "ShaderCode.hpp"
 #include "ShaderTypes.hpp"
 #include "Constants.hpp"
+#include <algorithm>
 ShaderStandard::ShaderStandard(){
     // Declare attributes used in shader
     attributes.emplace(Constants::ShaderStandard::positionAttribName, std::make_pair(false, MeshAttribute()));
@@ -18,6 +19,7 @@ ShaderStandard::ShaderStandard(){
     attributes.emplace(Constants::ShaderStandard::texCoord5AttribName, std::make_pair(false, MeshAttribute()));
     attributes.emplace(Constants::ShaderStandard::texCoord6AttribName, std::make_pair(false, MeshAttribute()));
     attributes.emplace(Constants::ShaderStandard::texCoord7AttribName, std::make_pair(false, MeshAttribute()));
+    attributes.emplace(Constants::ShaderStandard::qTangentAttribName, std::make_pair(false, MeshAttribute()));
     // Declare parameters and maps used in shader
     maps.emplace(Constants::ShaderStandard::diffuseMapName, false);
     maps.emplace(Constants::ShaderStandard::specularMapName, false);
@@ -27,6 +29,9 @@ ShaderStandard::ShaderStandard(){
     uniforms.emplace_back(Constants::ShaderStandard::specularUniformName, false);
     // Flags only to enable certain shader effects or processings
     flags.emplace(Constants::ShaderStandard::lightingName, false);
+    flags.emplace(Constants::ShaderStandard::alphaMaskName, false);
+    flags.emplace(Constants::ShaderStandard::transparentName, false);
+    flags.emplace(Constants::ShaderStandard::vertexPullingName, false);
 }
 
 ShaderStandard::~ShaderStandard(){
@@ -79,6 +84,9 @@ void ShaderStandard::EnableAttribBiTangent(const MeshAttribute &attributeInfo){
 void ShaderStandard::EnableAttribColor(const MeshAttribute &attributeInfo){
     attributes["color"] = std::make_pair(true, attributeInfo);
 }
+void ShaderStandard::EnableAttribQTangent(const MeshAttribute &attributeInfo){
+    attributes["qTangent"] = std::make_pair(true, attributeInfo);
+}
 void ShaderStandard::UseDiffuseUniform(){
     auto it = GetUniform(Constants::ShaderStandard::diffuseUniformName);
     if(it == uniforms.end())
@@ -106,11 +114,136 @@ void ShaderStandard::ActivateLighting(){
     flags[Constants::ShaderStandard::lightingName] = true;
 }
 
+void ShaderStandard::SetLightsBuckets(int pointLights, int directionalLights, int spotLights){
+    lightsBuckets[0] = pointLights;
+    lightsBuckets[1] = directionalLights;
+    lightsBuckets[2] = spotLights;
+}
+
+void ShaderStandard::ActivateAlphaMask(){
+    flags[Constants::ShaderStandard::alphaMaskName] = true;
+}
+
+void ShaderStandard::ActivateTransparency(){
+    flags[Constants::ShaderStandard::transparentName] = true;
+}
+
+void ShaderStandard::SetDepthOnly(bool depthOnly){
+    this->depthOnly = depthOnly;
+}
+
+void ShaderStandard::SetGBufferOutput(bool gBufferOutput){
+    this->gBufferOutput = gBufferOutput;
+}
+
+void ShaderStandard::ActivateVertexPulling(){
+    flags[Constants::ShaderStandard::vertexPullingName] = true;
+}
+
 void ShaderStandard::SetIndexType(MeshIndexType type)
 {
     indexType = type;
 }
 
+void ShaderStandard::AddVertexPullingCode(ShaderCode &code)
+{
+    // Layout of an attribute of an object: byte offset, stride, type (MeshAttributeType order) with
+    // normalized bit, and components count (zero when mesh lacks attribute)
+    code.CreateStorageBlock(ShaderStage::Vertex, "vertexDataSSBO", "uint vertexData[];", Constants::ShaderStandard::vertexDataStorageBinding);
+    code.CreateStorageBlock(ShaderStage::Vertex, "vertexLayoutsSSBO", "uvec4 vertexLayouts[];", Constants::ShaderStandard::vertexLayoutsStorageBinding);
+    code.PushOutsideCode(ShaderStage::Vertex,
+    "float FetchComponent(uint address, uint type, bool normalized){\n"
+    "  uint word = vertexData[address >> 2];\n"
+    "  if(type == 0u)\n"
+    "    return uintBitsToFloat(word);\n"
+    "  int bits = type >= 5u ? 16 : (type >= 3u ? 8 : 32);\n"
+    "  int offset = int(address & 3u) * 8;\n"
+    "  if(type == 1u || type == 3u || type == 5u){\n"
+    "    int value = bitfieldExtract(int(word), offset, bits);\n"
+    "    return normalized ? max(float(value) / (exp2(float(bits - 1)) - 1.0), -1.0) : float(value);\n"
+    "  }\n"
+    "  uint value = bitfieldExtract(word, offset, bits);\n"
+    "  return normalized ? float(value) / (exp2(float(bits)) - 1.0) : float(value);\n"
+    "}"
+    );
+    code.PushOutsideCode(ShaderStage::Vertex,
+    "vec4 FetchAttribute(int objID, int slot, vec4 defaultValue){\n"
+    "  uvec4 attributeLayout = vertexLayouts[objID * " + std::to_string(Constants::ShaderStandard::pullingSlotsCount) + " + slot];\n"
+    "  uint type = attributeLayout.z & 0xFFu;\n"
+    "  bool normalized = (attributeLayout.z & 0x100u) != 0u;\n"
+    "  uint componentSize = type >= 5u ? 2u : (type >= 3u ? 1u : 4u);\n"
+    "  uint address = attributeLayout.x + uint(gl_VertexID) * attributeLayout.y;\n"
+    "  vec4 value = defaultValue;\n"
+    "  for(uint i = 0u; i < min(attributeLayout.w, 4u); i++)\n"
+    "    value[i] = FetchComponent(address + i * componentSize, type, normalized);\n"
+    "  return value;\n"
+    "}"
+    );
+}
+
+std::string ShaderStandard::LightingFunctionsCode()
+{
+    const std::string pointLightStruct = "PointLight";
+    const std::string directionalLightStruct = "DirectionalLight";
+    const std::string spotLightStruct = "SpotLight";
+    const std::string viewPosName = Constants::ShaderStandard::viewPosName;
+    return
+    "vec3 CalcPointLight("+pointLightStruct+" pointLight){\n"
+    "  vec3 lightPos = pointLight.position.xyz;\n"
+    "  vec3 lightDirNorm = normalize(lightPos - fragPos);\n" // Norm vector
+    "  vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
+    "  vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
+    "  float diff = max(dot(normal, lightDirNorm), 0.0);\n"
+    "  float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
+    "  float lightRange = pointLight.range;\n"
+    "  vec3 lightFragDirection = lightPos - fragPos;\n"
+    "  float lightFragDistance = length(lightFragDirection);\n"
+    "  float attenuation = clamp(1.0 - (lightFragDistance / lightRange), 0.0, 1.0);\n"
+    "  attenuation *= attenuation;\n"
+    "  float cutoff = pointLight.cutoff;\n"
+    "  float cutoffFactor = (cutoff == 0.0) ? step(cutoff, attenuation) : smoothstep(cutoff, cutoff * 1.2, attenuation);\n" // Smooth transition to cutoff region
+    "  attenuation *= cutoffFactor;\n"
+    "  vec3 lightColor = pointLight.color.rgb;\n"
+    "  vec3 diffuse = diff * albedo.rgb;\n"
+    "  vec3 specular = spec * specularColor;\n"
+    "  return (diffuse + specular) * lightColor * attenuation;\n" // Final color
+    "}\n"
+    "vec3 CalcDirectionalLight("+directionalLightStruct+" directionalLight){\n"
+    "   vec3 lightDirNorm = normalize(-directionalLight.direction.xyz);\n"
+    "   vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
+    "   vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
+    "   float diff = max(dot(normal, lightDirNorm), 0.0);\n"
+    "   float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
+    "   vec3 lightColor = directionalLight.color.rgb;\n"
+    "   vec3 diffuse = diff * albedo.rgb;\n"
+    "   vec3 specular = spec * specularColor;\n"
+    "   return (diffuse + specular) * lightColor;\n"
+    "}\n"
+    "vec3 CalcSpotLight("+spotLightStruct+" spotLight){\n"
+    "  vec3 lightPos = spotLight.position.xyz;\n"
+    "  vec3 lightDirNorm = normalize(lightPos - fragPos);\n"
+    "  vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
+    "  vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
+    "  float diff = max(dot(normal, lightDirNorm), 0.0);\n"
+    "  float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
+    "  float lightRange = spotLight.range;\n"
+    "  vec3 lightFragDirection = lightPos - fragPos;\n"
+    "  float lightFragDistance = length(lightFragDirection);\n"
+    "  float attenuation = clamp(1.0 - (lightFragDistance / lightRange), 0.0, 1.0);\n"
+    "  attenuation *= attenuation;\n"
+    "  float cutoff = spotLight.cutoff;\n"
+    "  float cutoffFactor = (cutoff == 0.0) ? step(cutoff, attenuation) : smoothstep(cutoff, cutoff * 1.2, attenuation);\n" // Smooth transition to cutoff region
+    "  attenuation *= cutoffFactor;\n"
+    "  float theta = dot(lightDirNorm, normalize(-spotLight.direction.xyz));\n"
+    "  float epsilon = spotLight.innerCutoff - spotLight.outerCutoff;\n"
+    "  float spotIntensity = clamp((theta - spotLight.outerCutoff) / epsilon, 0.0, 1.0);\n"
+    "  vec3 lightColor = spotLight.color.rgb;\n"
+    "  vec3 diffuse = diff * albedo.rgb;\n"
+    "  vec3 specular = spec * specularColor;\n"
+    "  return (diffuse + specular) * attenuation * spotIntensity;\n" // Final color
+    "}\n";
+}
+
 ShaderCode ShaderStandard::ProcessCode()
 {
     ShaderCode code; // Shader code to build
@@ -128,6 +261,7 @@ ShaderCode ShaderStandard::ProcessCode()
     int texCoord5Location = Constants::ShaderStandard::texCoord5AttribLocation;
     int texCoord6Location = Constants::ShaderStandard::texCoord6AttribLocation;
     int texCoord7Location = Constants::ShaderStandard::texCoord7AttribLocation;
+    int qTangentLocation = Constants::ShaderStandard::qTangentAttribLocation;
 
     bool positionEnabled = attributes[Constants::ShaderStandard::positionAttribName].first;
     bool normalEnabled = attributes[Constants::ShaderStandard::normalAttribName].first;
@@ -142,6 +276,10 @@ ShaderCode ShaderStandard::ProcessCode()
     bool texCoord5Enabled = attributes[Constants::ShaderStandard::texCoord5AttribName].first;
     bool texCoord6Enabled = attributes[Constants::ShaderStandard::texCoord6AttribName].first;
     bool texCoord7Enabled = attributes[Constants::ShaderStandard::texCoord7AttribName].first;
+    bool qTangentEnabled = attributes[Constants::ShaderStandard::qTangentAttribName].first;
+    // Compressed normals are stored in two components (octahedral encoding)
+    bool normalOctahedral = normalEnabled &&
+    attributes[Constants::ShaderStandard::normalAttribName].second.format == MeshAttributeFormat::Vec2;
 
     // Modules
     bool diffuseMapActivated = maps[Constants::ShaderStandard::diffuseMapName];
@@ -149,7 +287,9 @@ ShaderCode ShaderStandard::ProcessCode()
     bool normalMapActivated = maps[Constants::ShaderStandard::normalMapName];
     bool diffuseUniformUsed = (*GetUniform(Constants::ShaderStandard::diffuseUniformName)).second;
     bool specularUniformUsed = (*GetUniform(Constants::ShaderStandard::specularUniformName)).second;
-    bool lightingActivated = flags[Constants::ShaderStandard::lightingName];
+    bool lightingActivated = flags[Constants::ShaderStandard::lightingName] && !depthOnly;
+    bool alphaMaskActivated = flags[Constants::ShaderStandard::alphaMaskName];
+    bool vertexPullingActivated = flags[Constants::ShaderStandard::vertexPullingName];
     bool materialsUniformBlockToUse =
     diffuseUniformUsed |
     specularUniformUsed;
@@ -160,6 +300,8 @@ ShaderCode ShaderStandard::ProcessCode()
 
     // Vertex strings
     std::string objIDOutSetString;
+    std::string pulledAttributesString; // Attributes fetched from storage buffers in vertex pulling mode
+    std::string attributesDecodeString; // Decoding of compressed attributes to normal, tangent and bitangent
     std::string texCoord0OutSetting; // Setting output texCoord0Out
     std::string normalMatrixString; // Get normal matrix at objID position from uniform block
     std::string modelMatrixString; // Get model matrix at objID position from uniform block
@@ -188,7 +330,13 @@ ShaderCode ShaderStandard::ProcessCode()
     code.SetStageToPipeline(ShaderStage::Vertex, true);
     code.SetStageToPipeline(ShaderStage::Fragment, true);
 
-    code.AddOutput(ShaderStage::Fragment, "FragColor", ShaderDataType::Float4); // Final color output in fragment shader
+    if(gBufferOutput){ // Targets of deferred shading G-buffer
+        code.AddOutput(ShaderStage::Fragment, "gAlbedo", ShaderDataType::Float4, 0);
+        code.AddOutput(ShaderStage::Fragment, "gNormal", ShaderDataType::Float4, 1);
+        code.AddOutput(ShaderStage::Fragment, "gSpecular", ShaderDataType::Float4, 2);
+    } else {
+        code.AddOutput(ShaderStage::Fragment, "FragColor", ShaderDataType::Float4); // Final color output in fragment shader
+    }
 
     std::string objIDString;
     if(RenderCapabilities::GetAPIVersion() < GLApiVersion::V460){ // This works with the non indirect drawing version
@@ -199,8 +347,18 @@ ShaderCode ShaderStandard::ProcessCode()
     }
     code.AddOutput(ShaderStage::Vertex, "objID", ShaderDataType::Int);
     objIDOutSetString = "objID = " + objIDString + ";\n";
+    if(vertexPullingActivated)
+        AddVertexPullingCode(code);
+    // In vertex pulling mode, attributes are locals with the same names fetched with the object layout
+    auto declareAttribute = [&](const std::string &name, ShaderDataType dataType, int location,
+    const std::string &glslType, int slot, const std::string &defaultValue, const std::string &swizzle){
+        if(vertexPullingActivated)
+            pulledAttributesString += glslType + " " + name + " = FetchAttribute(objID, " + std::to_string(slot) + ", " + defaultValue + ")" + swizzle + ";\n";
+        else
+            code.AddVertexAttribute(name, dataType, location);
+    };
     if(positionEnabled){
-        code.AddVertexAttribute("aPosition", ShaderDataType::Float3, positionLocation);
+        declareAttribute("aPosition", ShaderDataType::Float3, positionLocation, "vec3", Constants::ShaderStandard::positionPullingSlot, "vec4(0.0, 0.0, 0.0, 1.0)", ".xyz");
         code.CreateUniformBlock(ShaderStage::Vertex, "mvpsUBO", "mat4 mvps[" + maxObjectsGroupString + "];"); // MVPs uniform block
         code.SetBindingPurpose(ShaderStage::Vertex, "mvpsUBO", Constants::ShaderStandard::mvpsBinding);
         mvpMatrixString = "mat4 mvp = mvps[objID];\n";
@@ -210,21 +368,71 @@ ShaderCode ShaderStandard::ProcessCode()
     }
 
     if(texCoord0Enabled){
-        code.AddVertexAttribute("aTexCoord0", ShaderDataType::Float2, texCoord0Location);
+        declareAttribute("aTexCoord0", ShaderDataType::Float2, texCoord0Location, "vec2", Constants::ShaderStandard::texCoord0PullingSlot, "vec4(0.0)", ".xy");
         code.AddOutput(ShaderStage::Vertex, "aTexCoord0Out", ShaderDataType::Float2);
         texCoord0OutSetting += "aTexCoord0Out = aTexCoord0;\n";
     }
-    if(normalEnabled){
-        code.AddVertexAttribute("aNormal", ShaderDataType::Float3, normalLocation);
-    }
-    if(tangentEnabled){
-        code.AddVertexAttribute("aTangent", ShaderDataType::Float3, tangentLocation);
-    }
-    if(bitangentEnabled){
-        code.AddVertexAttribute("aBitangent", ShaderDataType::Float3, bitangentLocation);
+    if(qTangentEnabled){
+        // QTangent replaces normal, tangent and bitangent. Sign of w is bitangent handedness
+        declareAttribute("aQTangent", ShaderDataType::Float4, qTangentLocation, "vec4", Constants::ShaderStandard::qTangentPullingSlot, "vec4(0.0, 0.0, 0.0, 1.0)", "");
+        code.PushOutsideCode(ShaderStage::Vertex,
+        "mat3 DecodeQTangent(vec4 q){\n"
+        "  q = normalize(q);\n"
+        "  vec3 t = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));\n"
+        "  vec3 b = vec3(2.0 * (q.x * q.y - q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z + q.w * q.x));\n"
+        "  vec3 n = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));\n"
+        "  return mat3(t, b * (q.w < 0.0 ? -1.0 : 1.0), n);\n"
+        "}"
+        );
+        attributesDecodeString += "mat3 tangentFrame = DecodeQTangent(aQTangent);\n"
+                                  "vec3 tangentAttrib = tangentFrame[0];\n"
+                                  "vec3 bitangentAttrib = tangentFrame[1];\n"
+                                  "vec3 normalAttrib = tangentFrame[2];\n";
+        normalEnabled = tangentEnabled = bitangentEnabled = true;
+    } else {
+        if(normalEnabled && vertexPullingActivated){
+            // Octahedral normals have two components. Encoding is chosen per object, so both share a program
+            declareAttribute("aNormal", ShaderDataType::Float4, normalLocation, "vec4", Constants::ShaderStandard::normalPullingSlot, "vec4(0.0, 0.0, 1.0, 0.0)", "");
+            code.PushOutsideCode(ShaderStage::Vertex,
+            "vec3 DecodeOctahedral(vec2 e){\n"
+            "  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+            "  float t = max(-n.z, 0.0);\n"
+            "  n.x += n.x >= 0.0 ? -t : t;\n"
+            "  n.y += n.y >= 0.0 ? -t : t;\n"
+            "  return normalize(n);\n"
+            "}"
+            );
+            attributesDecodeString += "vec3 normalAttrib = vertexLayouts[objID * " + std::to_string(Constants::ShaderStandard::pullingSlotsCount) +
+            " + " + std::to_string(Constants::ShaderStandard::normalPullingSlot) + "].w == 2u ? DecodeOctahedral(aNormal.xy) : aNormal.xyz;\n";
+        } else if(normalEnabled){
+            if(normalOctahedral){
+                code.AddVertexAttribute("aNormal", ShaderDataType::Float2, normalLocation);
+                code.PushOutsideCode(ShaderStage::Vertex,
+                "vec3 DecodeOctahedral(vec2 e){\n"
+                "  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+                "  float t = max(-n.z, 0.0);\n"
+                "  n.x += n.x >= 0.0 ? -t : t;\n"
+                "  n.y += n.y >= 0.0 ? -t : t;\n"
+                "  return normalize(n);\n"
+                "}"
+                );
+                attributesDecodeString += "vec3 normalAttrib = DecodeOctahedral(aNormal);\n";
+            } else {
+                code.AddVertexAttribute("aNormal", ShaderDataType::Float3, normalLocation);
+                attributesDecodeString += "vec3 normalAttrib = aNormal;\n";
+            }
+        }
+        if(tangentEnabled){
+            declareAttribute("aTangent", ShaderDataType::Float3, tangentLocation, "vec3", Constants::ShaderStandard::tangentPullingSlot, "vec4(1.0, 0.0, 0.0, 0.0)", ".xyz");
+            attributesDecodeString += "vec3 tangentAttrib = aTangent;\n";
+        }
+        if(bitangentEnabled){
+            declareAttribute("aBitangent", ShaderDataType::Float3, bitangentLocation, "vec3", Constants::ShaderStandard::bitangentPullingSlot, "vec4(0.0, 1.0, 0.0, 0.0)", ".xyz");
+            attributesDecodeString += "vec3 bitangentAttrib = aBitangent;\n";
+        }
     }
     if(colorEnabled){
-        code.AddVertexAttribute("aColor", ShaderDataType::Float4, colorLocation);
+        declareAttribute("aColor", ShaderDataType::Float4, colorLocation, "vec4", Constants::ShaderStandard::colorPullingSlot, "vec4(1.0)", "");
         code.AddOutput(ShaderStage::Vertex, "aColorOut", ShaderDataType::Float4);
         if(diffuseMapActivated){
             if(diffuseUniformUsed){ // Color Attrib + Diffuse Map + Base Color
@@ -292,12 +500,12 @@ ShaderCode ShaderStandard::ProcessCode()
             normalMatrixString = "mat3 normalMatrix = mat3(normalMatrices[objID]);\n";
             modelMatrixString = "mat4 modelMatrix = models[objID];\n";
             fragPosSetting = "fragPos = vec3(modelMatrix * vec4(aPosition, 1.0));\n";
-            tbnCalcString += "vec3 T = normalize(normalMatrix * aTangent);\n"
-                             "vec3 N = normalize(normalMatrix * aNormal);\n"
+            tbnCalcString += "vec3 T = normalize(normalMatrix * tangentAttrib);\n"
+                             "vec3 N = normalize(normalMatrix * normalAttrib);\n"
                              "T = normalize(T - dot(T, N) * N);\n";
             if(bitangentEnabled){ // Bitangent only makes sense working with normal and tangent
                 // Already declared aBitangent input
-                tbnCalcString += "vec3 B = normalize(normalMatrix * aBitangent);\n";
+                tbnCalcString += "vec3 B = normalize(normalMatrix * bitangentAttrib);\n";
             } else {
                 tbnCalcString += "vec3 B = cross(N, T);\n";
             }
@@ -305,51 +513,86 @@ ShaderCode ShaderStandard::ProcessCode()
             normalOutSetString = "aNormalOut = N;\n";
 
             //// Fragment shader
-            const std::string pointLightStruct = "PointLight";
-            // 48 bytes per light
-            code.CreateStruct(ShaderStage::Fragment, pointLightStruct);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "position", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "color", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "intensity", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "colorTemperature", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "range", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "cutoff", ShaderDataType::Float);
-
-            const std::string directionalLightStruct = "DirectionalLight";
-            // 32 bytes per light
-            code.CreateStruct(ShaderStage::Fragment, directionalLightStruct);
-            code.AddParameterToStruct(ShaderStage::Fragment, directionalLightStruct, "direction", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, directionalLightStruct, "color", ShaderDataType::Float4);
-
-            const std::string spotLightStruct = "SpotLight";
-            // 64 bytes per light
-            code.CreateStruct(ShaderStage::Fragment, spotLightStruct);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "position", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "direction", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "color", ShaderDataType::Float4);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "range", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "innerCutoff", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "outerCutoff", ShaderDataType::Float);
-            code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "cutoff", ShaderDataType::Float);
-
-            const std::string maxPointLightsString = std::to_string(Constants::ShaderStandard::maxPointLights);
-            const std::string maxDirectionalLightsString = std::to_string(Constants::ShaderStandard::maxDirectionalLights);
-            const std::string maxSpotLightsString = std::to_string(Constants::ShaderStandard::maxSpotLights);
-            code.CreateUniformBlock(ShaderStage::Fragment, "pointLightUBO", pointLightStruct+" pointLights[" + maxPointLightsString + "];");
-            code.SetBindingPurpose(ShaderStage::Fragment, "pointLightUBO", Constants::ShaderStandard::pointLightsBinding);
-            code.CreateUniformBlock(ShaderStage::Fragment, "directionalLightUBO", directionalLightStruct+" directionalLights[" + maxDirectionalLightsString + "];");
-            code.SetBindingPurpose(ShaderStage::Fragment, "directionalLightUBO", Constants::ShaderStandard::directionalLightsBinding);
-            code.CreateUniformBlock(ShaderStage::Fragment, "spotLightUBO", spotLightStruct+" spotLights[" + maxSpotLightsString + "];");
-            code.SetBindingPurpose(ShaderStage::Fragment, "spotLightUBO", Constants::ShaderStandard::spotLightsBinding);
-            // Uniform (vertex and fragment) to set the number of lights to use
-            const std::string pointLightCountName = Constants::ShaderStandard::pointLightCountName;
-            const std::string directionalLightCountName = Constants::ShaderStandard::directionalLightCountName;
-            const std::string spotLightCountName = Constants::ShaderStandard::spotLightCountName;
-            const std::string viewPosName = Constants::ShaderStandard::viewPosName;
-            code.AddUniform(ShaderStage::Fragment, pointLightCountName, ShaderDataType::Int);
-            code.AddUniform(ShaderStage::Fragment, directionalLightCountName, ShaderDataType::Int);
-            code.AddUniform(ShaderStage::Fragment, spotLightCountName, ShaderDataType::Int);
-            code.AddUniform(ShaderStage::Fragment, viewPosName, ShaderDataType::Float3); // Get World space view position
+            // Sum of lights of each type not compiled out. Functions of types compiled out are left unused
+            std::string lightsString;
+            // G-buffer variants are shaded by deferred resolve, so they declare no lights
+            if(!gBufferOutput){
+                const std::string pointLightStruct = "PointLight";
+                // 48 bytes per light
+                code.CreateStruct(ShaderStage::Fragment, pointLightStruct);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "position", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "color", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "intensity", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "colorTemperature", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "range", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, pointLightStruct, "cutoff", ShaderDataType::Float);
+
+                const std::string directionalLightStruct = "DirectionalLight";
+                // 32 bytes per light
+                code.CreateStruct(ShaderStage::Fragment, directionalLightStruct);
+                code.AddParameterToStruct(ShaderStage::Fragment, directionalLightStruct, "direction", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, directionalLightStruct, "color", ShaderDataType::Float4);
+
+                const std::string spotLightStruct = "SpotLight";
+                // 64 bytes per light
+                code.CreateStruct(ShaderStage::Fragment, spotLightStruct);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "position", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "direction", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "color", ShaderDataType::Float4);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "range", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "innerCutoff", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "outerCutoff", ShaderDataType::Float);
+                code.AddParameterToStruct(ShaderStage::Fragment, spotLightStruct, "cutoff", ShaderDataType::Float);
+
+                // Each light type: structure, uniform block, binding purpose, count uniform, maximum lights and bucket
+                struct LightType{
+                    std::string structName;
+                    std::string blockName;
+                    std::string arrayName;
+                    std::string bindingPurpose;
+                    std::string countName;
+                    std::string function;
+                    unsigned long maxLights;
+                    int bucket;
+                };
+                const LightType lightTypes[3] = {
+                    {pointLightStruct, "pointLightUBO", "pointLights", Constants::ShaderStandard::pointLightsBinding,
+                    Constants::ShaderStandard::pointLightCountName, "CalcPointLight", Constants::ShaderStandard::maxPointLights, lightsBuckets[0]},
+                    {directionalLightStruct, "directionalLightUBO", "directionalLights", Constants::ShaderStandard::directionalLightsBinding,
+                    Constants::ShaderStandard::directionalLightCountName, "CalcDirectionalLight", Constants::ShaderStandard::maxDirectionalLights, lightsBuckets[1]},
+                    {spotLightStruct, "spotLightUBO", "spotLights", Constants::ShaderStandard::spotLightsBinding,
+                    Constants::ShaderStandard::spotLightCountName, "CalcSpotLight", Constants::ShaderStandard::maxSpotLights, lightsBuckets[2]}
+                };
+                for(auto &&lightType : lightTypes){
+                    if(lightType.bucket == 0)
+                        continue;
+                    unsigned long arraySize = lightType.bucket < 0 ? lightType.maxLights :
+                    std::min(static_cast<unsigned long>(lightType.bucket), lightType.maxLights);
+                    code.CreateUniformBlock(ShaderStage::Fragment, lightType.blockName, lightType.structName + " " + lightType.arrayName +
+                    "[" + std::to_string(arraySize) + "];");
+                    code.SetBindingPurpose(ShaderStage::Fragment, lightType.blockName, lightType.bindingPurpose);
+                    if(arraySize == 1 && lightType.bucket > 0){
+                        lightsString += "finalColor += " + lightType.function + "(" + lightType.arrayName + "[0]);\n";
+                        continue;
+                    }
+                    // Number of lights to use
+                    code.AddUniform(ShaderStage::Fragment, lightType.countName, ShaderDataType::Int);
+                    if(lightType.bucket < 0){
+                        lightsString +=
+                        "for(int i = 0; i < "+lightType.countName+"; i++){\n"
+                        "   finalColor += "+lightType.function+"("+lightType.arrayName+"[i]);\n"
+                        "}\n";
+                    } else { // Constant bound, so compiler may unroll it
+                        lightsString +=
+                        "for(int i = 0; i < "+std::to_string(arraySize)+"; i++){\n"
+                        "   if(i >= "+lightType.countName+") break;\n"
+                        "   finalColor += "+lightType.function+"("+lightType.arrayName+"[i]);\n"
+                        "}\n";
+                    }
+                }
+                const std::string viewPosName = Constants::ShaderStandard::viewPosName;
+                code.AddUniform(ShaderStage::Fragment, viewPosName, ShaderDataType::Float3); // Get World space view position
+            }
 
             // Lighting
 
@@ -380,85 +623,32 @@ ShaderCode ShaderStandard::ProcessCode()
             code.PushOutsideCode(ShaderStage::Fragment, "vec3 normal = vec3(0.0);");
             code.PushOutsideCode(ShaderStage::Fragment, "vec3 specularColor = vec3(0.0);");
 
-            code.PushOutsideCode(ShaderStage::Fragment,
-            "vec3 CalcPointLight("+pointLightStruct+" pointLight){\n"
-            "  vec3 lightPos = pointLight.position.xyz;\n"
-            "  vec3 lightDirNorm = normalize(lightPos - fragPos);\n" // Norm vector
-            "  vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
-            "  vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
-            "  float diff = max(dot(normal, lightDirNorm), 0.0);\n"
-            "  float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
-            "  float lightRange = pointLight.range;\n"
-            "  vec3 lightFragDirection = lightPos - fragPos;\n"
-            "  float lightFragDistance = length(lightFragDirection);\n"
-            "  float attenuation = clamp(1.0 - (lightFragDistance / lightRange), 0.0, 1.0);\n"
-            "  attenuation *= attenuation;\n"
-            "  float cutoff = pointLight.cutoff;\n"
-            "  float cutoffFactor = (cutoff == 0.0) ? step(cutoff, attenuation) : smoothstep(cutoff, cutoff * 1.2, attenuation);\n" // Smooth transition to cutoff region
-            "  attenuation *= cutoffFactor;\n"
-            "  vec3 lightColor = pointLight.color.rgb;\n"
-            "  vec3 diffuse = diff * albedo.rgb;\n"
-            "  vec3 specular = spec * specularColor;\n"
-            "  return (diffuse + specular) * lightColor * attenuation;\n" // Final color
-            "}"
-            );
-            code.PushOutsideCode(ShaderStage::Fragment,
-            "vec3 CalcDirectionalLight("+directionalLightStruct+" directionalLight){\n"
-            "   vec3 lightDirNorm = normalize(-directionalLight.direction.xyz);\n"
-            "   vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
-            "   vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
-            "   float diff = max(dot(normal, lightDirNorm), 0.0);\n"
-            "   float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
-            "   vec3 lightColor = directionalLight.color.rgb;\n"
-            "   vec3 diffuse = diff * albedo.rgb;\n"
-            "   vec3 specular = spec * specularColor;\n"
-            "   return (diffuse + specular) * lightColor;\n"
-            "}");
-            code.PushOutsideCode(ShaderStage::Fragment,
-            "vec3 CalcSpotLight("+spotLightStruct+" spotLight){\n"
-            "  vec3 lightPos = spotLight.position.xyz;\n"
-            "  vec3 lightDirNorm = normalize(lightPos - fragPos);\n"
-            "  vec3 viewDirNorm = normalize("+viewPosName+" - fragPos);\n"
-            "  vec3 halfwayDirNorm = normalize(lightDirNorm + viewDirNorm);\n"
-            "  float diff = max(dot(normal, lightDirNorm), 0.0);\n"
-            "  float spec = pow(max(dot(normal, halfwayDirNorm), 0.0), 16.0);\n"
-            "  float lightRange = spotLight.range;\n"
-            "  vec3 lightFragDirection = lightPos - fragPos;\n"
-            "  float lightFragDistance = length(lightFragDirection);\n"
-            "  float attenuation = clamp(1.0 - (lightFragDistance / lightRange), 0.0, 1.0);\n"
-            "  attenuation *= attenuation;\n"
-            "  float cutoff = spotLight.cutoff;\n"
-            "  float cutoffFactor = (cutoff == 0.0) ? step(cutoff, attenuation) : smoothstep(cutoff, cutoff * 1.2, attenuation);\n" // Smooth transition to cutoff region
-            "  attenuation *= cutoffFactor;\n"
-            "  float theta = dot(lightDirNorm, normalize(-spotLight.direction.xyz));\n"
-            "  float epsilon = spotLight.innerCutoff - spotLight.outerCutoff;\n"
-            "  float spotIntensity = clamp((theta - spotLight.outerCutoff) / epsilon, 0.0, 1.0);\n"
-            "  vec3 lightColor = spotLight.color.rgb;\n"
-            "  vec3 diffuse = diff * albedo.rgb;\n"
-            "  vec3 specular = spec * specularColor;\n"
-            "  return (diffuse + specular) * attenuation * spotIntensity;\n" // Final color
-            "}"
-            );
-            fragColorString +=
-            "vec3 finalColor = vec3(0.0);\n"
-            "vec3 ambientLight = vec3(0.005, 0.005, 0.005);\n"
-            "vec3 ambient = ambientLight * albedo.rgb;\n"
-            "finalColor += ambient;\n"
-            "for(int i = 0; i < "+pointLightCountName+"; i++){\n"
-            "   finalColor += CalcPointLight(pointLights[i]);\n"
-            "}\n"
-            "for(int i = 0; i < "+directionalLightCountName+"; i++){\n"
-            "   finalColor += CalcDirectionalLight(directionalLights[i]);\n"
-            "}\n"
-            "for(int i = 0; i < "+spotLightCountName+"; i++){\n"
-            "   finalColor += CalcSpotLight(spotLights[i]);\n"
-            "}\n"
-            //"finalColor = finalColor / (finalColor + vec3(1.0));\n"
-            "float gamma = 2.2;\n"
-            "FragColor = vec4(pow(finalColor, vec3(1.0/gamma)), albedo.a);\n";
+            if(gBufferOutput){ // Albedo is gamma encoded for 8 bits precision. Alpha marks lit pixels
+                fragColorString +=
+                "gAlbedo = vec4(pow(albedo.rgb, vec3(1.0/2.2)), 1.0);\n"
+                "gNormal = vec4(normal * 0.5 + 0.5, 0.0);\n"
+                "gSpecular = vec4(specularColor, 0.0);\n";
+            } else {
+                code.PushOutsideCode(ShaderStage::Fragment, LightingFunctionsCode());
+                fragColorString +=
+                "vec3 finalColor = vec3(0.0);\n"
+                "vec3 ambientLight = vec3(0.005, 0.005, 0.005);\n"
+                "vec3 ambient = ambientLight * albedo.rgb;\n"
+                "finalColor += ambient;\n" +
+                lightsString +
+                //"finalColor = finalColor / (finalColor + vec3(1.0));\n"
+                "float gamma = 2.2;\n"
+                "FragColor = vec4(pow(finalColor, vec3(1.0/gamma)), albedo.a);\n";
+            }
         } else { // Cannot do lighting without normal and tangent attribute
             return ShaderCode();
         }
+    } else if(gBufferOutput){ // Unlit pixels are resolved to albedo
+        fragColorString += "gAlbedo = vec4(pow(albedo.rgb, vec3(1.0/2.2)), 0.0);\n"
+                           "gNormal = vec4(0.5, 0.5, 0.5, 0.0);\n"
+                           "gSpecular = vec4(0.0);\n";
+    } else if(depthOnly){ // Color writes are masked, so only alpha is kept
+        fragColorString += "FragColor = vec4(0.0, 0.0, 0.0, albedo.a);\n";
     } else {
         fragColorString += "float gamma = 2.2;\n";
         // The albedo vector4 is set of combination of using color attribute and diffuse map
@@ -466,6 +656,8 @@ ShaderCode ShaderStandard::ProcessCode()
     }
     std::string vertexMainString;
     vertexMainString += objIDOutSetString;
+    vertexMainString += pulledAttributesString;
+    vertexMainString += attributesDecodeString;
     vertexMainString += normalMatrixString;
     vertexMainString += modelMatrixString;
     vertexMainString += mvpMatrixString;
@@ -478,6 +670,8 @@ ShaderCode ShaderStandard::ProcessCode()
     std::string fragmentMainString;
     // Attribution phase
     fragmentMainString += albedoString;
+    if(alphaMaskActivated)
+        fragmentMainString += "if(albedo.a < " + std::to_string(Constants::ShaderStandard::alphaCutoff) + ") discard;\n";
     fragmentMainString += normalString;
     fragmentMainString += specularColorString;
     ///
@@ -6,6 +6,10 @@
 class ShaderStandard : public Shader {
 private:
     std::vector<std::pair<std::string, bool>>::iterator GetUniform(const std::string &name);
+    // Point, directional and spot lights the lighting module is specialized for
+    int lightsBuckets[3] = {-1, -1, -1};
+    bool depthOnly = false;
+    bool gBufferOutput = false;
 public:
     ShaderStandard();
     ~ShaderStandard() override;
@@ -22,6 +26,8 @@ public:
     void EnableAttribTangent(const MeshAttribute &attributeInfo);
     void EnableAttribBiTangent(const MeshAttribute &attributeInfo);
     void EnableAttribColor(const MeshAttribute &attributeInfo);
+    // Compressed tangent frame. Used in place of normal, tangent and bitangent attributes
+    void EnableAttribQTangent(const MeshAttribute &attributeInfo);
     // Use diffuse or albedo uniform value. This is and other uniforms are vec4 for better general
     // handling of parameters
     void UseDiffuseUniform();
@@ -35,8 +41,25 @@ public:
     void ActivateNormalMap();
     // Activate default lighting module. Needs at least Normals enabled. Enables Tangent for tangent space calculation
     void ActivateLighting();
+    // Specializes lighting on lights count of each type: zero compiles type out, one reads a single light
+    // and larger buckets loop over a constant bound. Negative loops over a count uniform up to maximum lights
+    void SetLightsBuckets(int pointLights, int directionalLights, int spotLights);
+    // Discard fragments with albedo alpha below cutoff
+    void ActivateAlphaMask();
+    // Albedo alpha is blended. Renderer draws these materials in a sorted pass
+    void ActivateTransparency();
+    // Fragment stage only computes albedo alpha for the alpha test, for depth passes of alpha tested materials
+    void SetDepthOnly(bool depthOnly);
+    // Writes albedo, normal and specular color to G-buffer targets instead of shading, for deferred resolve
+    void SetGBufferOutput(bool gBufferOutput);
+    // Fetch attributes from storage buffers by vertex ID, so meshes with different formats share a program
+    void ActivateVertexPulling();
     // This defines if indices are unsigned int or unsigned short
     void SetIndexType(MeshIndexType type);
+    // Declares vertex data storage blocks and attribute fetching functions in vertex stage
+    static void AddVertexPullingCode(ShaderCode &code);
+    // Point, directional and spot lights functions. They read albedo, normal, specularColor, fragPos and viewPos
+    static std::string LightingFunctionsCode();
     ShaderCode ProcessCode() override;
 };
 
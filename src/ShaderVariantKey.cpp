@@ -0,0 +1,74 @@
+#include "ShaderVariantKey.hpp"
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+int ShaderVariantKey::FeatureBit(ShaderFeatureKind kind, const std::string &name)
+{
+    static std::mutex featuresMutex;
+    // Kind is part of the name, so a map and a flag with the same name are different features
+    static std::unordered_map<std::string, int> featuresBits;
+    std::string featureName = std::to_string(static_cast<int>(kind)) + name;
+    std::lock_guard<std::mutex> lock(featuresMutex);
+    auto it = featuresBits.find(featureName);
+    if(it != featuresBits.end())
+        return it->second;
+    if(static_cast<int>(featuresBits.size()) >= maxFeatures){
+        std::cout << "Shader variant features limit reached - Feature " << name << " ignored\n";
+        return -1;
+    }
+    int bit = indexTypeBits + featuresBits.size();
+    featuresBits.emplace(std::move(featureName), bit);
+    return bit;
+}
+
+void ShaderVariantKey::SetFeature(ShaderFeatureKind kind, const std::string &name)
+{
+    SetFeatureBit(FeatureBit(kind, name));
+}
+
+void ShaderVariantKey::SetFeatureBit(int bit)
+{
+    if(bit >= indexTypeBits && bit < 64)
+        features |= 1ULL << bit;
+}
+
+void ShaderVariantKey::ClearFeatureBit(int bit)
+{
+    if(bit >= indexTypeBits && bit < 64)
+        features &= ~(1ULL << bit);
+}
+
+bool ShaderVariantKey::HasFeatureBit(int bit) const
+{
+    return bit >= indexTypeBits && bit < 64 && (features & (1ULL << bit)) != 0;
+}
+
+void ShaderVariantKey::SetIndexType(MeshIndexType type)
+{
+    features = (features & ~((1ULL << indexTypeBits) - 1)) | static_cast<uint64_t>(type);
+}
+
+MeshIndexType ShaderVariantKey::GetIndexType() const
+{
+    return static_cast<MeshIndexType>(features & ((1ULL << indexTypeBits) - 1));
+}
+
+void ShaderVariantKey::SetAttribute(const MeshAttribute &attribute)
+{
+    int alias = static_cast<int>(attribute.alias);
+    if(alias < 1 || alias > 16)
+        return;
+    // Type in bits 0-2, format plus one in bits 3-5 (so used attributes are never zero), normalization
+    // in bit 6 and integer interpretation in bit 7
+    uint64_t code = static_cast<uint64_t>(attribute.type) | (static_cast<uint64_t>(attribute.format) + 1) << 3 |
+    static_cast<uint64_t>(attribute.normalized) << 6 | static_cast<uint64_t>(attribute.interpretAsInt) << 7;
+    int word = (alias - 1) / 8;
+    int shift = 8 * ((alias - 1) % 8);
+    formats[word] = (formats[word] & ~(0xFFULL << shift)) | code << shift;
+}
+
+void ShaderVariantKey::ClearAttributes()
+{
+    formats[0] = formats[1] = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef SHADER_VARIANT_KEY_H
+#define SHADER_VARIANT_KEY_H
+#include <cstdint>
+#include <string>
+#include "Mesh.hpp"
+
+enum class ShaderFeatureKind{
+    Map, Uniform, Flag
+};
+
+// Fixed width description of a shader variant: index type and used features (maps, uniforms and flags)
+// as bits, and an 8 bits format code for each attribute alias. Names of features are interned once, so
+// comparing and hashing variants never touches strings
+struct ShaderVariantKey{
+    static constexpr int indexTypeBits = 2;
+    static constexpr int maxFeatures = 64 - indexTypeBits;
+    uint64_t features = 0;
+    // Format codes of aliases 1 to 14 (zero when attribute is not used)
+    uint64_t formats[2] = {0, 0};
+    // Bit of feature name, interned on first use. -1 when every feature bit is in use
+    static int FeatureBit(ShaderFeatureKind kind, const std::string &name);
+    void SetFeature(ShaderFeatureKind kind, const std::string &name);
+    void SetFeatureBit(int bit);
+    void ClearFeatureBit(int bit);
+    bool HasFeatureBit(int bit) const;
+    void SetIndexType(MeshIndexType type);
+    MeshIndexType GetIndexType() const;
+    // Attribute is stored by its alias. Attributes without alias are not part of variants
+    void SetAttribute(const MeshAttribute &attribute);
+    void ClearAttributes();
+    bool operator==(const ShaderVariantKey &other) const{
+        return features == other.features && formats[0] == other.formats[0] && formats[1] == other.formats[1];
+    }
+    bool operator!=(const ShaderVariantKey &other) const{
+        return !(*this == other);
+    }
+    bool operator<(const ShaderVariantKey &other) const{
+        if(features != other.features)
+            return features < other.features;
+        if(formats[0] != other.formats[0])
+            return formats[0] < other.formats[0];
+        return formats[1] < other.formats[1];
+    }
+};
+
+struct ShaderVariantKeyHash{
+    std::size_t operator()(const ShaderVariantKey &key) const{
+        // Multiply and fold mixing of the three words
+        uint64_t hash = key.features * 0x9E3779B97F4A7C15ULL;
+        hash = (hash ^ (hash >> 32) ^ key.formats[0]) * 0xBF58476D1CE4E5B9ULL;
+        hash = (hash ^ (hash >> 29) ^ key.formats[1]) * 0x94D049BB133111EBULL;
+        return static_cast<std::size_t>(hash ^ (hash >> 31));
+    }
+};
+#endif
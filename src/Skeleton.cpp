@@ -0,0 +1,202 @@
+#include "Skeleton.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+int Skeleton::AddNode(const SkeletonNode &node)
+{
+    nodes.push_back(node);
+    if(nodes.back().parent >= static_cast<int>(nodes.size()) - 1)
+        nodes.back().parent = -1;
+    return nodes.size() - 1;
+}
+
+void Skeleton::AddClip(AnimationClip &&clip)
+{
+    clips.push_back(std::move(clip));
+}
+
+int Skeleton::FindNode(const std::string &name) const
+{
+    for(size_t i = 0; i < nodes.size(); i++){
+        if(nodes[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+int Skeleton::FindClip(const std::string &name) const
+{
+    for(size_t i = 0; i < clips.size(); i++){
+        if(clips[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+void Skeleton::SetMirrorZ(bool mirrorZ)
+{
+    this->mirrorZ = mirrorZ;
+}
+
+bool Skeleton::IsMirroredZ() const
+{
+    return mirrorZ;
+}
+
+const std::vector<SkeletonNode> &Skeleton::GetNodes() const
+{
+    return nodes;
+}
+
+const std::vector<AnimationClip> &Skeleton::GetClips() const
+{
+    return clips;
+}
+
+Animator::Animator(Ref<Skeleton> skeleton):
+skeleton(skeleton)
+{
+    const auto &nodes = skeleton->GetNodes();
+    translations.resize(nodes.size());
+    rotations.resize(nodes.size());
+    scales.resize(nodes.size());
+    morphWeights.resize(nodes.size());
+    globalTransforms.resize(nodes.size(), glm::mat4(1.0f));
+    if(!skeleton->GetClips().empty())
+        clip = 0;
+    EvaluatePose();
+}
+
+void Animator::Play(int clip, bool loop)
+{
+    this->clip = clip < static_cast<int>(skeleton->GetClips().size()) ? clip : -1;
+    this->loop = loop;
+    time = 0.0f;
+}
+
+void Animator::SetTime(float time)
+{
+    this->time = time;
+}
+
+void Animator::SetSpeed(float speed)
+{
+    this->speed = speed;
+}
+
+int Animator::GetClip() const
+{
+    return clip;
+}
+
+float Animator::GetTime() const
+{
+    return time;
+}
+
+const Ref<Skeleton> &Animator::GetSkeleton() const
+{
+    return skeleton;
+}
+
+void Animator::SampleChannel(const AnimationChannel &channel, float sampleTime)
+{
+    if(channel.node < 0 || channel.node >= static_cast<int>(translations.size()) || channel.times.empty())
+        return;
+    size_t keysCount = channel.times.size();
+    size_t valuesCount = channel.values.size() / keysCount;
+    if(valuesCount == 0)
+        return;
+    // Keys around sample time. Outside keys range the nearest key is held
+    size_t next = std::upper_bound(channel.times.begin(), channel.times.end(), sampleTime) - channel.times.begin();
+    size_t previous = next == 0 ? 0 : next - 1;
+    next = std::min(next, keysCount - 1);
+    float factor = 0.0f;
+    if(channel.interpolation == AnimationInterpolation::Linear && next != previous){
+        float interval = channel.times[next] - channel.times[previous];
+        factor = interval > 0.0f ? std::clamp((sampleTime - channel.times[previous]) / interval, 0.0f, 1.0f) : 0.0f;
+    }
+    const float *a = &channel.values[previous * valuesCount];
+    const float *b = &channel.values[next * valuesCount];
+    switch(channel.path){
+        case AnimationPath::Translation:
+        case AnimationPath::Scale:{
+            if(valuesCount < 3)
+                return;
+            glm::vec3 value = glm::mix(glm::vec3(a[0], a[1], a[2]), glm::vec3(b[0], b[1], b[2]), factor);
+            (channel.path == AnimationPath::Translation ? translations : scales)[channel.node] = value;
+        } break;
+        case AnimationPath::Rotation:{
+            if(valuesCount < 4)
+                return;
+            glm::quat rotationA(a[3], a[0], a[1], a[2]);
+            glm::quat rotationB(b[3], b[0], b[1], b[2]);
+            rotations[channel.node] = glm::normalize(glm::slerp(rotationA, rotationB, factor));
+        } break;
+        case AnimationPath::MorphWeights:{
+            auto &weights = morphWeights[channel.node];
+            weights.resize(valuesCount);
+            for(size_t i = 0; i < valuesCount; i++)
+                weights[i] = a[i] + (b[i] - a[i]) * factor;
+        } break;
+    }
+}
+
+void Animator::EvaluatePose()
+{
+    const auto &nodes = skeleton->GetNodes();
+    for(size_t i = 0; i < nodes.size(); i++){
+        translations[i] = nodes[i].translation;
+        rotations[i] = nodes[i].rotation;
+        scales[i] = nodes[i].scale;
+        morphWeights[i] = nodes[i].morphWeights;
+    }
+    if(clip >= 0){
+        for(auto &&channel : skeleton->GetClips()[clip].channels)
+            SampleChannel(channel, time);
+    }
+    // Parents come before children, so global transforms are built in one pass
+    for(size_t i = 0; i < nodes.size(); i++){
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), translations[i]) * glm::mat4_cast(rotations[i]) *
+        glm::scale(glm::mat4(1.0f), scales[i]);
+        globalTransforms[i] = nodes[i].parent >= 0 ? globalTransforms[nodes[i].parent] * local : local;
+    }
+}
+
+void Animator::Update(float deltaTime)
+{
+    if(clip >= 0){
+        float duration = skeleton->GetClips()[clip].duration;
+        time += deltaTime * speed;
+        if(duration <= 0.0f)
+            time = 0.0f;
+        else if(loop)
+            time = time - duration * std::floor(time / duration);
+        else
+            time = std::clamp(time, 0.0f, duration);
+    }
+    EvaluatePose();
+}
+
+void Animator::ComputeSkinPalette(const Skin &skin, int meshNode, glm::mat4 *palette) const
+{
+    // Mesh node transform is applied by the object transform, so joints are taken to mesh node space
+    glm::mat4 meshInverse = meshNode >= 0 && meshNode < static_cast<int>(globalTransforms.size()) ?
+    glm::inverse(globalTransforms[meshNode]) : glm::mat4(1.0f);
+    glm::mat4 mirror = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, -1.0f));
+    for(size_t i = 0; i < skin.joints.size(); i++){
+        int joint = skin.joints[i];
+        glm::mat4 jointTransform = joint >= 0 && joint < static_cast<int>(globalTransforms.size()) ?
+        globalTransforms[joint] : glm::mat4(1.0f);
+        palette[i] = meshInverse * jointTransform * skin.inverseBindMatrices[i];
+        if(skeleton->IsMirroredZ())
+            palette[i] = mirror * palette[i] * mirror;
+    }
+}
+
+const std::vector<float> &Animator::GetMorphWeights(int node) const
+{
+    static const std::vector<float> noWeights;
+    return node >= 0 && node < static_cast<int>(morphWeights.size()) ? morphWeights[node] : noWeights;
+}
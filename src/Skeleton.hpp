@@ -0,0 +1,102 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+#include "Base.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+
+// Node of a model hierarchy with its rest transform. Parents come before children
+struct SkeletonNode{
+    std::string name;
+    int parent = -1;
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    // Rest weights of morph targets of node mesh
+    std::vector<float> morphWeights;
+};
+
+enum class AnimationPath{
+    Translation, Rotation, Scale, MorphWeights
+};
+
+enum class AnimationInterpolation{
+    Step, Linear
+};
+
+// Keyframes of one property of a node. Each key has 3 (translation and scale), 4 (rotation as xyzw)
+// or morph targets count values
+struct AnimationChannel{
+    int node = -1;
+    AnimationPath path = AnimationPath::Translation;
+    AnimationInterpolation interpolation = AnimationInterpolation::Linear;
+    std::vector<float> times; // Seconds, increasing
+    std::vector<float> values;
+};
+
+struct AnimationClip{
+    std::string name;
+    float duration = 0.0f;
+    std::vector<AnimationChannel> channels;
+};
+
+// Joints of a skinned mesh, as skeleton nodes, with transforms from mesh space to each joint space
+struct Skin{
+    std::vector<int> joints;
+    std::vector<glm::mat4> inverseBindMatrices;
+};
+
+// Node hierarchy and animation clips of a model. Shared by every animator of its instances
+class Skeleton{
+private:
+    std::vector<SkeletonNode> nodes;
+    std::vector<AnimationClip> clips;
+    // Source data is right handed and meshes are mirrored in Z, so poses are mirrored when skinning
+    bool mirrorZ = false;
+public:
+    // Parent must already be in skeleton. Returns node index
+    int AddNode(const SkeletonNode &node);
+    void AddClip(AnimationClip &&clip);
+    // First node with name or -1
+    int FindNode(const std::string &name) const;
+    int FindClip(const std::string &name) const;
+    void SetMirrorZ(bool mirrorZ);
+    bool IsMirroredZ() const;
+    const std::vector<SkeletonNode> &GetNodes() const;
+    const std::vector<AnimationClip> &GetClips() const;
+};
+
+// Playback state of a skeleton instance. Pose is evaluated once per update and read by every
+// skinned or morphed mesh of the instance
+class Animator{
+private:
+    Ref<Skeleton> skeleton;
+    int clip = -1;
+    float time = 0.0f;
+    float speed = 1.0f;
+    bool loop = true;
+    // Local pose, reset to rest pose before sampling
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<std::vector<float>> morphWeights;
+    std::vector<glm::mat4> globalTransforms;
+    void SampleChannel(const AnimationChannel &channel, float sampleTime);
+    void EvaluatePose();
+public:
+    Animator(Ref<Skeleton> skeleton);
+    // Negative clip shows rest pose
+    void Play(int clip, bool loop = true);
+    void SetTime(float time);
+    void SetSpeed(float speed);
+    int GetClip() const;
+    float GetTime() const;
+    const Ref<Skeleton> &GetSkeleton() const;
+    // Advances time of current clip and evaluates pose
+    void Update(float deltaTime);
+    // Joint matrices of skin, from bind pose in mesh node space to posed mesh node space
+    void ComputeSkinPalette(const Skin &skin, int meshNode, glm::mat4 *palette) const;
+    const std::vector<float> &GetMorphWeights(int node) const;
+};
+#endif
@@ -2,15 +2,19 @@
 #include <filesystem>
 #include <stb/stb_image.h>
 
-bool Texture::Load(const std::string &filePath, bool isSRGB, bool mirrorVertically)
+bool Texture::Load(const std::string &filePath, bool isSRGB, bool mirrorVertically, MipmapFilter mipmapFilter)
 {
     if(!std::filesystem::exists(filePath) || !std::filesystem::is_regular_file(filePath))
         return false;
     // Try compressed formats (dds or ktx) first
     handle = gli::load(filePath);
 
-    if(!handle.empty())
+    if(!handle.empty()){
+        // Uncompressed files may come without mip levels
+        if(handle.levels() == 1)
+            GenerateMipmaps(mipmapFilter);
         return true;
+    }
 
     //Using common image formats
     // sail::image image(filePath);
@@ -36,6 +40,8 @@ bool Texture::Load(const std::string &filePath, bool isSRGB, bool mirrorVertical
     glm::ivec2 dimensions;
     int channels = 0;
     unsigned char *image = stbi_load(filePath.c_str(), &dimensions.x, &dimensions.y, &channels, 0);
+    if(image == nullptr)
+        return false;
     gli::format format;
     switch(channels){
         case 3:
@@ -48,11 +54,13 @@ bool Texture::Load(const std::string &filePath, bool isSRGB, bool mirrorVertical
 
     std::memcpy(handle.data(), image, channels*sizeof(unsigned char)*dimensions.x*dimensions.y);
     stbi_image_free(image);
+    GenerateMipmaps(mipmapFilter);
 
     return true;
 }
 
-bool Texture::LoadFromMemory(const std::vector<unsigned char> &pixels, gli::format format, int width, int height, bool mirrorVertically)
+bool Texture::LoadFromMemory(const std::vector<unsigned char> &pixels, gli::format format, int width, int height, bool mirrorVertically,
+MipmapFilter mipmapFilter)
 {
     handle = gli::texture2d(format, glm::ivec2(width, height));
     if(handle.empty() || handle.size() < sizeof(unsigned char)*pixels.size())
@@ -61,6 +69,25 @@ bool Texture::LoadFromMemory(const std::vector<unsigned char> &pixels, gli::form
     std::memcpy(handle.data(), pixels.data(), sizeof(unsigned char)*pixels.size());
     if(mirrorVertically)
         handle = gli::flip(handle);
+    GenerateMipmaps(mipmapFilter);
+    return true;
+}
+
+bool Texture::GenerateMipmaps(MipmapFilter filter)
+{
+    if(handle.empty() || handle.target() != gli::TARGET_2D || !MipmapGenerator::IsFormatSupported(handle.format()))
+        return false;
+
+    gli::texture2d texture(handle);
+    // Storage must hold the complete chain before filling it
+    if(texture.levels() < static_cast<size_t>(gli::levels(texture.extent()))){
+        gli::texture2d completeChain(texture.format(), texture.extent(), texture.swizzles());
+        std::memcpy(completeChain.data(0, 0, 0), texture.data(0, 0, 0), texture.size(0));
+        texture = completeChain;
+    }
+    if(!MipmapGenerator::Generate(texture, filter))
+        return false;
+    handle = texture;
     return true;
 }
 
@@ -175,16 +202,31 @@ bool Texture::IsCompressed() const
     return gli::is_compressed(handle.format());
 }
 
-gli::texture::extent_type Texture::GetDimensions() const
+gli::texture::extent_type Texture::GetDimensions(int level) const
 {
-    return handle.extent();
+    return handle.extent(level);
+}
+
+int Texture::GetLevelsCount() const
+{
+    return handle.levels();
 }
 
 int Texture::GetSize() const{
     return handle.size();
 }
 
+int Texture::GetLevelSize(int level) const
+{
+    return handle.size(level);
+}
+
 const void *Texture::GetData() const
 {
     return handle.data();
 }
+
+const void *Texture::GetLevelData(int level) const
+{
+    return handle.data(0, 0, level);
+}
@@ -2,6 +2,7 @@
 #define TEXTURE_H
 #include <GL/glew.h>
 #include <gli/gli.hpp>
+#include "MipmapGenerator.hpp"
 #include <vector>
 
 class Texture{
@@ -10,17 +11,24 @@ private:
 public:
     Texture() = default;
     // Generic load function for common image formats or compressed textures
-    bool Load(const std::string &filePath, bool isSRGB = true, bool mirrorVertically = false);
-    bool LoadFromMemory(const std::vector<unsigned char> &pixels, gli::format format, int width, int height, bool mirrorVertically = false);
+    bool Load(const std::string &filePath, bool isSRGB = true, bool mirrorVertically = false, MipmapFilter mipmapFilter = MipmapFilter::Box);
+    bool LoadFromMemory(const std::vector<unsigned char> &pixels, gli::format format, int width, int height, bool mirrorVertically = false,
+    MipmapFilter mipmapFilter = MipmapFilter::Box);
+    // Builds the complete mip chain on CPU from base level. Compressed textures keep their own levels
+    bool GenerateMipmaps(MipmapFilter filter = MipmapFilter::Box);
     gli::format GetFormat() const;
     // Get GLenum equivalent to texture internal format. You also can force srgb return value
     static GLenum GliInternalFormatToGLenum(gli::format format, bool forceSRGB = false);
     static GLenum GliClientFormatToGLenum(gli::format format);
     static GLenum GliTypeToGLenum(gli::format format);
     bool IsCompressed() const;
-    gli::texture::extent_type GetDimensions() const;
+    gli::texture::extent_type GetDimensions(int level = 0) const;
+    int GetLevelsCount() const;
+    // Total size of all levels
     int GetSize() const;
+    int GetLevelSize(int level) const;
     const void* GetData() const;
+    const void* GetLevelData(int level) const;
 public:
 };
 #endif
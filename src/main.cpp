@@ -9,9 +9,12 @@
 #include "RenderCapabilities.hpp"
 #include "ShaderStandard.hpp"
 #include "ShaderCode.hpp"
+#include "ProgramBinaryCache.hpp"
 #include "Input.hpp"
 #include "Model.hpp"
 #include <filesystem>
+#include <map>
+#include <random>
 #include <fmt/core.h>
 #include <tbb/parallel_for.h>
 
@@ -101,6 +104,33 @@ int main(int argc, const char *argv[])
     max_s = M_PI;
     max_t = 2*M_PI;
     bool perfomanceCounter = true;
+    bool benchmarkLoaders = false;
+    bool compressVertices = false;
+    bool optimizeMeshes = false;
+    bool generateLODs = false;
+    bool clusterCulling = false;
+    bool deduplicateMeshes = false;
+    int lodOverride = -1;
+    float lodHysteresis = 0.25f;
+    bool planRenderGroups = false;
+    bool vertexPulling = false;
+    bool parallelShaders = true;
+    bool lightsBuckets = true;
+    bool deferredShading = false;
+    bool passTimings = false;
+    bool dynamicResolution = false;
+    DynamicResolutionOptions dynamicResolutionOptions;
+    bool adaptivePrepass = false;
+    DepthPrepassOptions depthPrepassOptions;
+    bool alphaModes = true;
+    int lightCount = 15;
+    std::string shaderCacheDirectory = "shader_cache"; // Empty disables program binary cache
+    int shaderCacheSize = 64; // In MB
+    int dynamicGridSize = 0; // Vertices per side of the streaming benchmark grid. Zero disables it
+    std::string animatedModelPath; // Skinned or morphed model drawn as a grid of instances with their own animators
+    int animatedInstances = 1;
+    int stressEntities = 0; // Quads with their own materials, for entity creation and grouping timing
+    RenderGroupPlanOptions renderGroupPlanOptions;
 
     for(int i = 1; i < argc; i++){
         std::string argvString = argv[i];
@@ -207,6 +237,256 @@ int main(int argc, const char *argv[])
                 continue;
             }
         }
+        if(argvString == "--bench_loaders"){
+            benchmarkLoaders = true;
+            continue;
+        }
+        if(argvString == "--compress_vertices"){
+            compressVertices = true;
+            continue;
+        }
+        if(argvString == "--optimize_meshes"){
+            optimizeMeshes = true;
+            continue;
+        }
+        if(argvString == "--lods"){
+            generateLODs = true;
+            continue;
+        }
+        if(argvString == "--meshlets"){
+            clusterCulling = true;
+            continue;
+        }
+        if(argvString == "--dedup_meshes"){
+            deduplicateMeshes = true;
+            continue;
+        }
+        if(argvString == "--lod_level" && i < argc - 1){
+            try{
+            lodOverride = std::stoi(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument lod_level\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--lod_hysteresis" && i < argc - 1){
+            try{
+            lodHysteresis = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument lod_hysteresis\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--plan_groups"){
+            planRenderGroups = true;
+            continue;
+        }
+        if(argvString == "--vertex_pulling"){
+            vertexPulling = true;
+            continue;
+        }
+        if(argvString == "--serial_shaders"){
+            parallelShaders = false;
+            continue;
+        }
+        if(argvString == "--blend_all"){
+            alphaModes = false;
+            continue;
+        }
+        if(argvString == "--dynamic_light_loops"){
+            lightsBuckets = false;
+            continue;
+        }
+        if(argvString == "--deferred"){
+            deferredShading = true;
+            continue;
+        }
+        if(argvString == "--pass_timings"){
+            passTimings = true;
+            continue;
+        }
+        if(argvString == "--adaptive_prepass"){
+            adaptivePrepass = true;
+            continue;
+        }
+        if(argvString == "--prepass_interval" && i < argc - 1){
+            try{
+            depthPrepassOptions.sampleInterval = std::stoi(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument prepass_interval\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--prepass_min_coverage" && i < argc - 1){
+            try{
+            depthPrepassOptions.minOccluderCoverage = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument prepass_min_coverage\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--prepass_fragment_ns" && i < argc - 1){
+            try{
+            depthPrepassOptions.minFragmentNanoseconds = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument prepass_fragment_ns\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--dynamic_resolution"){
+            dynamicResolution = true;
+            continue;
+        }
+        if(argvString == "--frame_budget" && i < argc - 1){
+            try{
+            dynamicResolutionOptions.targetMilliseconds = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument frame_budget\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--min_resolution_scale" && i < argc - 1){
+            try{
+            dynamicResolutionOptions.minScale = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument min_resolution_scale\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--max_resolution_scale" && i < argc - 1){
+            try{
+            dynamicResolutionOptions.maxScale = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument max_resolution_scale\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--sharpen" && i < argc - 1){
+            try{
+            dynamicResolutionOptions.sharpness = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument sharpen\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--point_lights" && i < argc - 1){
+            try{
+            lightCount = std::stoi(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument point_lights\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--index_unification" && i < argc - 1){
+            std::string mode = argv[i+1];
+            if(mode == "none")
+                renderGroupPlanOptions.indexUnification = IndexUnification::Disabled;
+            else if(mode == "promote")
+                renderGroupPlanOptions.indexUnification = IndexUnification::Promote;
+            else if(mode == "split")
+                renderGroupPlanOptions.indexUnification = IndexUnification::Split;
+            else if(mode == "auto")
+                renderGroupPlanOptions.indexUnification = IndexUnification::Automatic;
+            else
+                std::cout << mode << " - Invalid value for argument index_unification (none, promote, split or auto)\n";
+            continue;
+        }
+        if(argvString == "--no_padding"){
+            renderGroupPlanOptions.padAttributes = false;
+            continue;
+        }
+        if(argvString == "--max_padding" && i < argc - 1){
+            try{
+            renderGroupPlanOptions.maxPaddingRatio = std::stof(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument max_padding\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--draw_command_cost" && i < argc - 1){
+            try{
+            renderGroupPlanOptions.drawCommandCost = std::stoul(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument draw_command_cost\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--dynamic_grid" && i < argc - 1){
+            try{
+            dynamicGridSize = std::stoi(argv[i+1]);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument dynamic_grid\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--shader_cache" && i < argc - 1){
+            shaderCacheDirectory = argv[i+1];
+            continue;
+        }
+        if(argvString == "--no_shader_cache"){
+            shaderCacheDirectory.clear();
+            continue;
+        }
+        if(argvString == "--shader_cache_size" && i < argc - 1){
+            try{
+            shaderCacheSize = std::max(std::stoi(argv[i+1]), 1);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument shader_cache_size\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--animated_model" && i < argc - 1){
+            animatedModelPath = argv[i+1];
+            continue;
+        }
+        if(argvString == "--animated_instances" && i < argc - 1){
+            try{
+            animatedInstances = std::max(std::stoi(argv[i+1]), 1);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument animated_instances\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
+        if(argvString == "--stress_entities" && i < argc - 1){
+            try{
+            stressEntities = std::max(std::stoi(argv[i+1]), 0);
+            continue;
+            }catch (const std::invalid_argument &e){
+                std::cout << e.what() << " - Invalid value for argument stress_entities\n";
+            } catch (const std::out_of_range &e){
+                std::cout << e.what() << " - Out of range value\n";
+            }
+        }
         if(argvString == "-d"){
             glEnable(GL_DEBUG_OUTPUT);
             glDebugMessageCallback(GLDebugCallback, nullptr);
@@ -412,6 +692,44 @@ int main(int argc, const char *argv[])
     graph.AddComponent<MeshRendererComponent>(graphMesh, graphMaterial);
     graph.GetComponent<TransformComponent>().position = glm::vec3(0, 0, 0);
 
+    // Streaming benchmark: a grid deformed every frame as a dynamic mesh (1000 per side is 1M vertices)
+    Ref<Mesh> gridMesh;
+    if(dynamicGridSize > 1){
+        gridMesh = CreateRef<Mesh>();
+        size_t gridVerticesCount = static_cast<size_t>(dynamicGridSize) * dynamicGridSize;
+        std::vector<float> gridPositions(3 * gridVerticesCount);
+        std::vector<float> gridTexCoords(2 * gridVerticesCount);
+        for(int row = 0; row < dynamicGridSize; row++){
+            for(int column = 0; column < dynamicGridSize; column++){
+                size_t vertex = static_cast<size_t>(row) * dynamicGridSize + column;
+                float u = static_cast<float>(column) / (dynamicGridSize - 1);
+                float v = static_cast<float>(row) / (dynamicGridSize - 1);
+                gridPositions[3*vertex] = 10.0f * u - 5.0f;
+                gridPositions[3*vertex + 2] = 10.0f * v - 5.0f;
+                gridTexCoords[2*vertex] = u;
+                gridTexCoords[2*vertex + 1] = v;
+            }
+        }
+        std::vector<unsigned int> gridIndices;
+        gridIndices.reserve(6 * static_cast<size_t>(dynamicGridSize - 1) * (dynamicGridSize - 1));
+        for(int row = 0; row < dynamicGridSize - 1; row++){
+            for(int column = 0; column < dynamicGridSize - 1; column++){
+                unsigned int vertex = row * dynamicGridSize + column;
+                gridIndices.insert(gridIndices.end(), {vertex, vertex + dynamicGridSize, vertex + 1,
+                vertex + 1, vertex + dynamicGridSize, vertex + dynamicGridSize + 1});
+            }
+        }
+        gridMesh->PushAttributePosition(gridPositions);
+        gridMesh->PushAttributeTexCoord0(gridTexCoords);
+        gridMesh->SetIndices(std::move(gridIndices), MeshTopology::Triangles);
+        Ref<Material> gridMaterial = CreateRef<Material>(shaderStandard);
+        gridMaterial->SetParameterMap("diffuseMap", defaultTexture);
+        gridMaterial->SetFlag("lighting", false);
+        Entity grid = mainScene.CreateEntity();
+        grid.AddComponent<MeshRendererComponent>(gridMesh, gridMaterial).isDynamic = true;
+        grid.GetComponent<TransformComponent>().position = glm::vec3(0, -2, 0);
+    }
+
     // Descriptor of models
     // FlipUVs is true for default - This is correct if y-axis convention is equal OpenGL
     // If y-axis convention is opposite of OpenGL, set FlipUVs to false
@@ -426,11 +744,41 @@ int main(int argc, const char *argv[])
     modelsDescriptors.emplace_back("../resources/modelos/sponza/Sponza.gltf");
     modelsDescriptors.emplace_back("../resources/modelos/porsche/scene.gltf");
     modelsDescriptors.emplace_back("../resources/modelos/backpack/backpack.obj", false);
+    if(benchmarkLoaders){
+        // Compares native glTF loader against Assimp for glTF models (Sponza and Porsche)
+        for(auto &&descriptor : modelsDescriptors){
+            std::string extension = descriptor.path.substr(descriptor.path.find_last_of('.') + 1);
+            if(extension != "gltf" && extension != "glb")
+                continue;
+            for(bool nativeLoader : {true, false}){
+                Model model = Model();
+                model.SetNativeGLTFLoaderState(nativeLoader);
+                model.SetVertexCompressionState(compressVertices);
+                model.SetMeshOptimizationState(optimizeMeshes);
+                model.SetLODGenerationState(generateLODs);
+                model.SetMeshletGenerationState(clusterCulling);
+                auto benchBegin = std::chrono::high_resolution_clock::now();
+                bool loaded = model.Load(descriptor.path, shaderStandard, true, descriptor.flipUVs);
+                auto benchEnd = std::chrono::high_resolution_clock::now();
+                fmt::print("Time to load {0} with {1}: {2} (ms){3}\n", descriptor.path, nativeLoader ? "native glTF loader" : "Assimp",
+                std::chrono::duration_cast<std::chrono::milliseconds>(benchEnd-benchBegin).count(), loaded ? "" : " - Failed");
+                model.ReleaseResources();
+            }
+        }
+    }
     std::vector<Model> models(modelsDescriptors.size());
     std::vector<Entity> sceneObjects;
+    // Shared by all models, so identical geometry of different files is also collapsed
+    MeshRegistry meshRegistry;
     auto loadBegin = std::chrono::high_resolution_clock::now();
     tbb::parallel_for(0, static_cast<int>(modelsDescriptors.size()), [&](int i){
         Model model = Model();
+        model.SetVertexCompressionState(compressVertices);
+        model.SetMeshOptimizationState(optimizeMeshes);
+        model.SetLODGenerationState(generateLODs);
+        model.SetMeshletGenerationState(clusterCulling);
+        if(deduplicateMeshes)
+            model.SetMeshRegistry(&meshRegistry);
         if(!model.Load(modelsDescriptors[i].path, shaderStandard, true, modelsDescriptors[i].flipUVs))
             return;
         models[i] = model;
@@ -438,13 +786,60 @@ int main(int argc, const char *argv[])
     for(auto& model : models){
         for(auto &component : model.GetComponents()){
             Entity ent = mainScene.CreateEntity();
-            ent.AddComponent<MeshRendererComponent>(component.first.mesh.object, component.first.material.object);
+            // Copies animator and skin of deformable meshes too
+            ent.AddComponent<MeshRendererComponent>(component.first);
             ent.transform = component.second;
             sceneObjects.push_back(ent);
         }
     }
+    if(!animatedModelPath.empty()){
+        Model animatedModel = Model();
+        if(animatedModel.Load(animatedModelPath, shaderStandard, true, false)){
+            // Instances in a square grid. Objects of an instance share a copy of the model animator, with a
+            // different start time so instances are not in sync
+            int gridSide = static_cast<int>(glm::ceil(glm::sqrt(static_cast<float>(animatedInstances))));
+            for(int instance = 0; instance < animatedInstances; instance++){
+                glm::vec3 offset(2.0f * (instance % gridSide - gridSide / 2), 0.0f, 2.0f * (instance / gridSide - gridSide / 2));
+                std::unordered_map<Animator*, Ref<Animator>> instanceAnimators;
+                for(auto &component : animatedModel.GetComponents()){
+                    Entity ent = mainScene.CreateEntity();
+                    MeshRendererComponent &meshRenderer = ent.AddComponent<MeshRendererComponent>(component.first);
+                    if(meshRenderer.animator){
+                        Ref<Animator> &animator = instanceAnimators[meshRenderer.animator.get()];
+                        if(!animator){
+                            animator = CreateRef<Animator>(*meshRenderer.animator);
+                            animator->SetTime(0.37f * instance);
+                        }
+                        meshRenderer.animator = animator;
+                    }
+                    ent.transform = component.second;
+                    ent.transform.position += offset;
+                    sceneObjects.push_back(ent);
+                }
+            }
+        }
+    }
+    if(stressEntities > 0){
+        auto stressBegin = std::chrono::high_resolution_clock::now();
+        int gridSide = static_cast<int>(glm::ceil(glm::sqrt(static_cast<float>(stressEntities))));
+        for(int i = 0; i < stressEntities; i++){
+            Ref<Material> stressMaterial = CreateRef<Material>(shaderStandard);
+            stressMaterial->SetParameterMap("diffuseMap", defaultTexture);
+            stressMaterial->SetFlag("lighting", false);
+            Entity ent = mainScene.CreateEntity();
+            ent.AddComponent<MeshRendererComponent>(mesh, stressMaterial);
+            ent.transform.position = glm::vec3(1.5f * (i % gridSide - gridSide / 2), 3.0f, 1.5f * (i / gridSide - gridSide / 2));
+        }
+        auto stressEnd = std::chrono::high_resolution_clock::now();
+        fmt::print("Time to create {0} entities: {1} (ms) - Pools: {2} meshes, {3} materials\n", stressEntities,
+        std::chrono::duration_cast<std::chrono::milliseconds>(stressEnd-stressBegin).count(),
+        ResourcePool<Mesh>::Instance().Size(), ResourcePool<Material>::Instance().Size());
+    }
     auto loadEnd = std::chrono::high_resolution_clock::now();
     fmt::print("Time to load models {0} (ms)\n", std::chrono::duration_cast<std::chrono::milliseconds>(loadEnd-loadBegin).count());
+    if(deduplicateMeshes)
+        fmt::print("Mesh registry: {0} unique meshes, {1} duplicates collapsed ({2} KB saved)\n", meshRegistry.GetRegisteredCount(),
+        meshRegistry.GetDuplicatesCount(), meshRegistry.GetSavedBytes() / 1024);
 
     mainCamera.AddComponent<CameraComponent>().isMain = true;
 
@@ -461,7 +856,6 @@ int main(int argc, const char *argv[])
     // testLight.transform.position = glm::vec3(0, 5.0f, 0);
     // testLight.transform.rotation = glm::quat(glm::vec3(glm::radians(90.0f), 0.0f, 0.0f));
 
-    int lightCount = 15;
     std::vector<Entity> lights;
     std::random_device r;
     std::default_random_engine e(r());
@@ -495,15 +889,39 @@ int main(int argc, const char *argv[])
         lights.push_back(light);
     }
 
+    // Before renderer, as it builds its own programs
+    if(!shaderCacheDirectory.empty())
+        ProgramBinaryCache::Initialize(shaderCacheDirectory, static_cast<size_t>(shaderCacheSize) * 1024 * 1024);
     Renderer mainRenderer = Renderer();
     mainRenderer.SetMainWindow(std::addressof(window));
     mainRenderer.SetInterleaveAttribState(false);
     mainRenderer.SetDepthPrepassState(true);
+    mainRenderer.SetAlphaModesState(alphaModes);
+    mainRenderer.SetLODHysteresis(lodHysteresis);
+    mainRenderer.SetLODOverride(lodOverride);
+    mainRenderer.SetClusterCullingState(clusterCulling);
+    mainRenderer.SetRenderGroupPlanningState(planRenderGroups);
+    mainRenderer.SetRenderGroupPlanOptions(renderGroupPlanOptions);
+    mainRenderer.SetVertexPullingState(vertexPulling);
+    mainRenderer.SetParallelShaderCompileState(parallelShaders);
+    mainRenderer.SetLightsBucketsState(lightsBuckets);
+    if(deferredShading)
+        mainRenderer.SetRenderPath(RenderPath::Deferred);
+    mainRenderer.SetPassTimingState(passTimings);
+    mainRenderer.SetDynamicResolutionOptions(dynamicResolutionOptions);
+    mainRenderer.SetDynamicResolutionState(dynamicResolution);
+    mainRenderer.SetDepthPrepassOptions(depthPrepassOptions);
+    mainRenderer.SetAdaptivePrepassState(adaptivePrepass);
     double initialRendererTime = SDL_GetTicks();
     mainRenderer.Start(mainScene.registry);
     double prepareTime = (SDL_GetTicks() - initialRendererTime)/1000;
     fmt::print("\nTime to prepare meshes for grouping: {0:.2f} (ms)\n", 1000*prepareTime);
     fmt::print("Computed draw groups: {0}\n\n", mainRenderer.GetDrawGroupsCount());
+    if(ProgramBinaryCache::IsEnabled()){
+        const ProgramBinaryCacheCounters &cacheCounters = ProgramBinaryCache::GetCounters();
+        fmt::print("Program binary cache - hits: {0}, misses: {1}, rejected: {2}\n\n", cacheCounters.hits, cacheCounters.misses,
+        cacheCounters.rejected);
+    }
 
     double time = 0;
     double lastTime = 0;
@@ -511,6 +929,25 @@ int main(int argc, const char *argv[])
     double maxDeltaTime = 0;
     double minDeltaTime = 0;
     unsigned long ticks = 0;
+    double submittedTriangles = 0;
+    double drawnTriangles = 0;
+    double streamedBytes = 0;
+    double deformedVertices = 0;
+    double issuedStateCalls = 0;
+    double elidedStateCalls = 0;
+    int64_t deformTimeTotal = 0;
+    FrameGraphStats frameGraphTotals;
+    // Sums for deviation of frame times and mean resolution scale
+    double deltaTimeSum = 0;
+    double deltaTimeSquaresSum = 0;
+    double resolutionScaleSum = 0;
+    // Sums of CPU and GPU times of each pass, with frames GPU time was available
+    struct PassTimes{
+        double cpu = 0;
+        double gpu = 0;
+        unsigned long gpuFrames = 0;
+    };
+    std::map<std::string, PassTimes> passesTimes;
 
     mainCamera.transform = freeCameraTransform;
     // Camera parameters
@@ -521,6 +958,8 @@ int main(int argc, const char *argv[])
     float yRotation = 180.0f;
     freeCameraTransform.rotation = glm::quat(glm::vec3(glm::radians(xRotation), glm::radians(yRotation), 0.0f));
     /* Loop until the user closes the window */
+    // Uniforms counters only of frames
+    GL::ShaderGL::GetUniformCounters() = GL::UniformCounters();
     bool running = true;
     while (running)
     {
@@ -553,7 +992,32 @@ int main(int argc, const char *argv[])
                 fmt::print("Min Delta Time: {0:.2f} ms\n", 1000*minDeltaTime);
                 fmt::print("Max Delta Time: {0:.2f} ms\n", 1000*maxDeltaTime);
                 fmt::print("Ticks/Sec: {0:.2f}\n", ticks/time);
+                double meanDeltaTime = deltaTimeSum / ticks;
+                fmt::print("Delta Time std deviation: {0:.2f} ms\n",
+                1000*glm::sqrt(glm::max(deltaTimeSquaresSum / ticks - meanDeltaTime * meanDeltaTime, 0.0)));
+                if(dynamicResolution)
+                    fmt::print("Mean resolution scale: {0:.2f}\n", resolutionScaleSum / ticks);
+                fmt::print("Triangles submitted/drawn per frame: {0:.0f} / {1:.0f}\n", submittedTriangles/ticks, drawnTriangles/ticks);
+                if(gridMesh)
+                    fmt::print("Dynamic grid of {0} vertices - deform: {1:.2f} ms, streamed: {2:.2f} MB per frame\n",
+                    gridMesh->GetVerticesCount(), deformTimeTotal / (1000.0 * ticks), streamedBytes / (1024 * 1024 * ticks));
+                if(!animatedModelPath.empty())
+                    fmt::print("Skinned and morphed vertices per frame: {0:.0f}\n", deformedVertices/ticks);
+                const GL::UniformCounters &uniformCounters = GL::ShaderGL::GetUniformCounters();
+                fmt::print("Uniforms per frame - name lookups: {0:.1f}, GL calls: {1:.1f}, redundant calls skipped: {2:.1f}\n",
+                static_cast<double>(uniformCounters.stringLookups) / ticks, static_cast<double>(uniformCounters.uniformCalls) / ticks,
+                static_cast<double>(uniformCounters.redundantCalls) / ticks);
+                fmt::print("GL state calls per frame - issued: {0:.1f}, elided: {1:.1f}\n", issuedStateCalls / ticks, elidedStateCalls / ticks);
+                fmt::print("Frame graph per frame - passes: {0:.1f}, culled: {1:.1f}, transient textures: {2:.1f}, aliased: {3:.1f}, "
+                "barriers: {4:.1f}\n", static_cast<double>(frameGraphTotals.passes) / ticks,
+                static_cast<double>(frameGraphTotals.culledPasses) / ticks, static_cast<double>(frameGraphTotals.transientTextures) / ticks,
+                static_cast<double>(frameGraphTotals.aliasedTextures) / ticks, static_cast<double>(frameGraphTotals.barriers) / ticks);
+                for(auto &&passTimes : passesTimes)
+                    fmt::print("Pass {0} - CPU: {1:.3f} ms, GPU: {2:.3f} ms\n", passTimes.first, passTimes.second.cpu / ticks,
+                    passTimes.second.gpuFrames > 0 ? passTimes.second.gpu / passTimes.second.gpuFrames : 0.0);
             }
+            if(adaptivePrepass)
+                mainRenderer.PrintDepthPrepassStats();
             running = false;
         }
 
@@ -597,6 +1061,10 @@ int main(int argc, const char *argv[])
         if (Input::GetKeyDown(SDLK_T)){
             isFreeCamera = !isFreeCamera;
         }
+        if (Input::GetKeyDown(SDLK_R)){
+            mainRenderer.SetRenderPath(mainRenderer.GetRenderPath() == RenderPath::Forward ? RenderPath::Deferred : RenderPath::Forward);
+            fmt::print("Render path: {0}\n", mainRenderer.GetRenderPath() == RenderPath::Forward ? "forward" : "deferred");
+        }
         //mainLight.transform.position = glm::vec3(1.5f*glm::cos(time), 3, 1.5f*glm::sin(time));
         for(size_t i = 0; i < lights.size(); i++){
             if(lights[i].transform.position.y > 15.0f){
@@ -611,9 +1079,49 @@ int main(int argc, const char *argv[])
 
         graph.GetComponent<MeshRendererComponent>().material->SetGlobalParameterFloat(timeString, time);
         graph.transform.eulerAngles(glm::vec3(0, -30*time, 0));
+        if(gridMesh){
+            auto deformBegin = std::chrono::high_resolution_clock::now();
+            float *positions = reinterpret_cast<float*>(gridMesh->GetMutableAttributeData(0));
+            float phase = static_cast<float>(time);
+            tbb::parallel_for(0, dynamicGridSize, [&](int row){
+                float *rowPositions = positions + 3 * static_cast<size_t>(row) * dynamicGridSize;
+                for(int column = 0; column < dynamicGridSize; column++){
+                    float *position = rowPositions + 3 * column;
+                    position[1] = 0.25f * glm::sin(2.0f * position[0] + 3.0f * phase) * glm::cos(2.0f * position[2] + 2.0f * phase);
+                }
+            });
+            gridMesh->MarkVerticesDirty(0, gridMesh->GetVerticesCount());
+            auto deformEnd = std::chrono::high_resolution_clock::now();
+            deformTimeTotal += std::chrono::duration_cast<std::chrono::microseconds>(deformEnd-deformBegin).count();
+        }
         // Rendering
         /* Render here */
         mainRenderer.Update(mainScene.registry, deltaTime);
+        if(perfomanceCounter){
+            submittedTriangles += mainRenderer.GetSubmittedTrianglesCount();
+            drawnTriangles += mainRenderer.GetDrawnTrianglesCount();
+            streamedBytes += mainRenderer.GetStreamedBytesCount();
+            deformedVertices += mainRenderer.GetDeformedVerticesCount();
+            issuedStateCalls += mainRenderer.GetStateCounters().issuedCalls;
+            elidedStateCalls += mainRenderer.GetStateCounters().elidedCalls;
+            deltaTimeSum += deltaTime;
+            deltaTimeSquaresSum += deltaTime * deltaTime;
+            resolutionScaleSum += mainRenderer.GetResolutionScale();
+            const FrameGraphStats &frameGraphStats = mainRenderer.GetFrameGraphStats();
+            frameGraphTotals.passes += frameGraphStats.passes;
+            frameGraphTotals.culledPasses += frameGraphStats.culledPasses;
+            frameGraphTotals.transientTextures += frameGraphStats.transientTextures;
+            frameGraphTotals.aliasedTextures += frameGraphStats.aliasedTextures;
+            frameGraphTotals.barriers += frameGraphStats.barriers;
+            for(auto &&passTiming : mainRenderer.GetPassTimings()){
+                PassTimes &passTimes = passesTimes[passTiming.name];
+                passTimes.cpu += passTiming.cpuMilliseconds;
+                if(passTiming.gpuMilliseconds >= 0.0){
+                    passTimes.gpu += passTiming.gpuMilliseconds;
+                    passTimes.gpuFrames++;
+                }
+            }
+        }
         /* Swap front and back buffers */
         SDL_GL_SwapWindow(window.GetHandle());
     }
@@ -0,0 +1,119 @@
+#include "Mesh.hpp"
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+// Owned and adopted storage of AttributeBuffer. Adopted bytes must never be written, and turning them into owned
+// bytes keeps the values that are still in range. Best run with address sanitizer, which reports overflows
+
+static int failures = 0;
+
+static void Expect(const char *test, bool condition)
+{
+    if(condition)
+        return;
+    std::cout << test << " - failed\n";
+    failures++;
+}
+
+static std::shared_ptr<std::vector<unsigned char>> SourceBytes(size_t size)
+{
+    auto bytes = std::make_shared<std::vector<unsigned char>>(size);
+    std::iota(bytes->begin(), bytes->end(), static_cast<unsigned char>(1));
+    return bytes;
+}
+
+static bool HasSourceBytes(const AttributeBuffer &buffer, const std::vector<unsigned char> &source, size_t count)
+{
+    return buffer.Size() >= count && std::memcmp(buffer.Data(), source.data(), count) == 0;
+}
+
+static void TestShrinkAfterAdopt()
+{
+    auto source = SourceBytes(256);
+    std::vector<unsigned char> original = *source;
+    AttributeBuffer buffer;
+    buffer.Adopt(source, source->data(), source->size());
+    buffer.Resize(16);
+    Expect("Shrink after adopt - owned", !buffer.IsAdopted());
+    Expect("Shrink after adopt - size", buffer.Size() == 16);
+    Expect("Shrink after adopt - values", HasSourceBytes(buffer, original, 16));
+    Expect("Shrink after adopt - source untouched", *source == original);
+    // Shrunk buffer keeps growing from its own bytes
+    unsigned char extra[64] = {};
+    buffer.Append(extra, sizeof(extra));
+    Expect("Shrink after adopt - append", buffer.Size() == 80 && HasSourceBytes(buffer, original, 16));
+}
+
+static void TestResizeToZeroAfterAdopt()
+{
+    auto source = SourceBytes(64);
+    AttributeBuffer buffer;
+    buffer.Adopt(source, source->data(), source->size());
+    buffer.Resize(0);
+    Expect("Resize to zero after adopt", !buffer.IsAdopted() && buffer.Size() == 0);
+}
+
+static void TestGrowAfterAdopt()
+{
+    auto source = SourceBytes(48);
+    std::vector<unsigned char> original = *source;
+    AttributeBuffer buffer;
+    buffer.Adopt(source, source->data(), source->size());
+    buffer.Resize(200);
+    Expect("Grow after adopt", !buffer.IsAdopted() && buffer.Size() == 200 && HasSourceBytes(buffer, original, 48));
+    Expect("Grow after adopt - source untouched", *source == original);
+}
+
+static void TestReserveAfterAdopt()
+{
+    auto source = SourceBytes(96);
+    std::vector<unsigned char> original = *source;
+    AttributeBuffer buffer;
+    buffer.Adopt(source, source->data(), source->size());
+    buffer.Reserve(8);
+    Expect("Reserve after adopt", !buffer.IsAdopted() && buffer.Size() == 96 && HasSourceBytes(buffer, original, 96));
+}
+
+static void TestMutableDataAfterAdopt()
+{
+    auto source = SourceBytes(32);
+    std::vector<unsigned char> original = *source;
+    AttributeBuffer buffer;
+    buffer.Adopt(source, source->data(), source->size());
+    AttributeBuffer copy = buffer;
+    Expect("Copy of adopted buffer", copy.IsAdopted() && copy.Data() == source->data());
+    buffer.MutableData()[0] = 0;
+    Expect("Mutable data after adopt", !buffer.IsAdopted() && buffer.Data()[0] == 0 && buffer.Data()[1] == original[1]);
+    Expect("Mutable data after adopt - source untouched", *source == original && copy.Data()[0] == original[0]);
+}
+
+static void TestOwnedResize()
+{
+    auto source = SourceBytes(100);
+    AttributeBuffer buffer;
+    buffer.Assign(source->data(), source->size());
+    buffer.Resize(10);
+    buffer.Resize(100);
+    Expect("Owned shrink and grow", buffer.Size() == 100 && HasSourceBytes(buffer, *source, 10));
+    AttributeBuffer moved = std::move(buffer);
+    Expect("Owned move", moved.Size() == 100 && buffer.Size() == 0 && buffer.Data() == nullptr);
+}
+
+int main()
+{
+    TestShrinkAfterAdopt();
+    TestResizeToZeroAfterAdopt();
+    TestGrowAfterAdopt();
+    TestReserveAfterAdopt();
+    TestMutableDataAfterAdopt();
+    TestOwnedResize();
+    if(failures > 0){
+        std::cout << failures << " attribute buffer checks failed\n";
+        return 1;
+    }
+    std::cout << "Attribute buffer checks passed\n";
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "AttributeQuantizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Parity of quantization kernels with the scalar expressions Model::processMesh used before them.
+// Sizes up to 40 cover empty arrays, vector bodies and every tail length that is not a multiple of 8
+
+static short ReferenceSnorm16(float value)
+{
+    int quantized = std::round(value * 32768.0f);
+    return static_cast<short>(std::clamp(quantized, -32768, 32767));
+}
+
+static unsigned short ReferenceUnorm16(float value)
+{
+    return static_cast<unsigned short>(std::round(value * 65535.0f));
+}
+
+static unsigned char ReferenceUnorm8(float value)
+{
+    return static_cast<unsigned char>(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+static int failures = 0;
+
+template<typename T>
+static void Expect(const char *kernel, size_t index, float input, T value, T expected)
+{
+    if(value == expected)
+        return;
+    if(failures < 20)
+        std::cout << kernel << " - element " << index << " of input " << input << ": " << +value << ", expected " << +expected << "\n";
+    failures++;
+}
+
+// Values with x * scale exactly halfway between integers, their float neighbours and range boundaries
+static std::vector<float> EdgeValues(float scale, float minValue, float maxValue)
+{
+    std::vector<float> values = {-1.0f, -0.0f, 0.0f, 1.0f, minValue, maxValue, 0.5f, -0.5f};
+    for(int k = -4; k <= 4; k++){
+        for(float halfway : {(k + 0.5f) / scale, (std::floor(scale / 2.0f) + k + 0.5f) / scale, (scale - 1.0f + k + 0.5f) / scale}){
+            values.push_back(halfway);
+            values.push_back(-halfway);
+            values.push_back(std::nextafter(halfway, 2.0f));
+            values.push_back(std::nextafter(halfway, -2.0f));
+        }
+    }
+    return values;
+}
+
+static std::vector<float> TestValues(float scale, float minValue, float maxValue, size_t randomCount)
+{
+    std::vector<float> values = EdgeValues(scale, minValue, maxValue);
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> distribution(minValue, maxValue);
+    for(size_t i = 0; i < randomCount; i++)
+        values.push_back(distribution(generator));
+    // Random order puts edge values in vector bodies and in tails
+    std::shuffle(values.begin(), values.end(), generator);
+    return values;
+}
+
+static void TestSnorm16()
+{
+    // Out of range values up to 2 must clamp
+    std::vector<float> values = TestValues(32768.0f, -2.0f, 2.0f, 4096);
+    for(size_t size = 0; size <= 40; size++){
+        for(size_t offset = 0; offset + size <= values.size(); offset += 97){
+            std::vector<short> output(size);
+            AttributeQuantizer::FloatToSnorm16(values.data() + offset, size, output.data());
+            for(size_t i = 0; i < size; i++)
+                Expect("FloatToSnorm16", i, values[offset + i], output[i], ReferenceSnorm16(values[offset + i]));
+        }
+    }
+}
+
+static void TestUnorm16()
+{
+    // Only values inside [0, 1] are stored as unorm16, as tex coords outside it stay float
+    std::vector<float> values = TestValues(65535.0f, 0.0f, 1.0f, 4096);
+    values.erase(std::remove_if(values.begin(), values.end(), [](float value){
+        return value < 0.0f || value > 1.0f;
+    }), values.end());
+    for(int stride : {2, 3, 4}){
+        for(size_t count = 0; count <= 40; count++){
+            for(size_t offset = 0; (offset + count) * stride <= values.size(); offset += 31){
+                const float *input = values.data() + offset * stride;
+                std::vector<unsigned short> output(2 * count);
+                AttributeQuantizer::Float2ToUnorm16(input, count, stride, output.data());
+                for(size_t i = 0; i < count; i++){
+                    Expect("Float2ToUnorm16", 2 * i, input[i * stride], output[2 * i], ReferenceUnorm16(input[i * stride]));
+                    Expect("Float2ToUnorm16", 2 * i + 1, input[i * stride + 1], output[2 * i + 1], ReferenceUnorm16(input[i * stride + 1]));
+                }
+            }
+        }
+    }
+}
+
+static void TestUnorm8()
+{
+    std::vector<float> values = TestValues(255.0f, -1.0f, 2.0f, 4096);
+    for(size_t size = 0; size <= 40; size++){
+        for(size_t offset = 0; offset + size <= values.size(); offset += 97){
+            std::vector<unsigned char> output(size);
+            AttributeQuantizer::FloatToUnorm8(values.data() + offset, size, output.data());
+            for(size_t i = 0; i < size; i++)
+                Expect("FloatToUnorm8", i, values[offset + i], output[i], ReferenceUnorm8(values[offset + i]));
+        }
+    }
+}
+
+static void TestMinMax()
+{
+    std::vector<float> values = TestValues(1.0f, -1000.0f, 1000.0f, 4096);
+    for(int stride = 1; stride <= 5; stride++){
+        for(size_t count = 0; count <= 40; count++){
+            for(size_t offset = 0; (offset + count) * stride <= values.size(); offset += 53){
+                const float *input = values.data() + offset * stride;
+                float minValues[5];
+                float maxValues[5];
+                AttributeQuantizer::MinMax(input, count, stride, minValues, maxValues);
+                for(int c = 0; c < stride; c++){
+                    float expectedMin = std::numeric_limits<float>::max();
+                    float expectedMax = std::numeric_limits<float>::lowest();
+                    for(size_t i = 0; i < count; i++){
+                        expectedMin = std::min(expectedMin, input[i * stride + c]);
+                        expectedMax = std::max(expectedMax, input[i * stride + c]);
+                    }
+                    // Compared as bits, so -0 and 0 are told apart
+                    Expect("MinMax min", c, static_cast<float>(count), std::memcmp(&minValues[c], &expectedMin, sizeof(float)) == 0, true);
+                    Expect("MinMax max", c, static_cast<float>(count), std::memcmp(&maxValues[c], &expectedMax, sizeof(float)) == 0, true);
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestSnorm16();
+    TestUnorm16();
+    TestUnorm8();
+    TestMinMax();
+    if(failures > 0){
+        std::cout << failures << " quantized values differ from scalar reference\n";
+        return 1;
+    }
+    std::cout << "Quantization kernels match scalar reference\n";
+    return 0;
+}